@@ -0,0 +1,102 @@
+#ifndef ARG_UTILS_H
+#define ARG_UTILS_H
+
+#include <Arduino.h>
+#include <string_view>
+
+/**
+ * @brief Splits a command argument into space separated tokens in place
+ *
+ * Tokens are views into the original buffer, nothing is copied or
+ * allocated. The buffer must outlive the tokens.
+ */
+class ArgTokenizer {
+public:
+  explicit ArgTokenizer(std::string_view input) : _rest(input) {}
+
+  /// Next space separated token from the front, empty when exhausted
+  std::string_view next() {
+    skipSpaces();
+    size_t end = _rest.find(' ');
+    std::string_view token = _rest.substr(0, end);
+    _rest.remove_prefix(token.length());
+    return token;
+  }
+
+  /// Last space separated token from the back, empty when exhausted
+  std::string_view last() {
+    trimTrailingSpaces();
+    size_t start = _rest.rfind(' ');
+    start = start == std::string_view::npos ? 0 : start + 1;
+    std::string_view token = _rest.substr(start);
+    _rest.remove_suffix(token.length());
+    return token;
+  }
+
+  /// Everything not consumed yet, without surrounding spaces
+  std::string_view rest() {
+    skipSpaces();
+    trimTrailingSpaces();
+    return _rest;
+  }
+
+private:
+  void skipSpaces() {
+    while (!_rest.empty() && _rest.front() == ' ') {
+      _rest.remove_prefix(1);
+    }
+  }
+
+  void trimTrailingSpaces() {
+    while (!_rest.empty() && _rest.back() == ' ') {
+      _rest.remove_suffix(1);
+    }
+  }
+
+  std::string_view _rest;
+};
+
+/**
+ * @brief Copy a view into an Arduino String
+ *
+ * Only for handlers that have to store the value or pass it to an API that
+ * takes a String.
+ */
+inline String toString(std::string_view value) {
+  return String(value.data(), value.length());
+}
+
+/**
+ * @brief Case-insensitive comparison of a view against a literal
+ */
+inline bool argEqualsIgnoreCase(std::string_view value, const char *literal) {
+  size_t length = strlen(literal);
+  return value.length() == length &&
+         strncasecmp(value.data(), literal, length) == 0;
+}
+
+/**
+ * @brief Parse an unsigned decimal number from a view
+ * @param value Digits to parse
+ * @param result Parsed number, untouched on failure
+ * @return bool False if the view is empty, not a number or overflows
+ */
+inline bool argToUint32(std::string_view value, uint32_t &result) {
+  if (value.empty()) {
+    return false;
+  }
+  uint64_t number = 0;
+  for (char c : value) {
+    if (c < '0' || c > '9') {
+      return false;
+    }
+    number = number * 10 + (c - '0');
+    if (number > UINT32_MAX) {
+      return false;
+    }
+  }
+  result = (uint32_t)number;
+  return true;
+}
+
+#endif // ARG_UTILS_H
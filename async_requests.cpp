@@ -0,0 +1,408 @@
+/**
+ * @file async_requests.cpp
+ * @brief HTTP requests running concurrently on worker tasks
+ *
+ * This file contains the ASYNC command. A request gets an ID chosen by the
+ * client and runs on its own worker task, so a slow download no longer
+ * blocks the executor or other requests. Every response line and body frame
+ * of the request is tagged with the ID (the frame channel in framed mode,
+ * a "#<id> " prefix in text mode). Sockets already wait with select() and
+ * TLS handshakes are non-blocking, so a waiting worker costs no CPU.
+ *
+ * Each running request is charged an estimate of the heap it needs, and a
+ * request only starts while the free heap covers its charge plus a reserve
+ * for the rest of the firmware. Requests that cannot start yet wait in a
+ * short queue.
+ */
+
+#include "async_requests.h"
+#include "arg_utils.h"
+#include "http_utils.h"
+#include "perf_utils.h"
+#include "uart_frame.h"
+#include "uart_utils.h"
+#include "udp_reply.h"
+#include <deque>
+#include <mutex>
+#include <vector>
+
+/// Stack size of a worker, HTTPS handlers need the same as the executor
+const uint32_t ASYNC_WORKER_STACK_SIZE = 12 * 1024;
+
+/// Worker priority, same as the executor
+const UBaseType_t ASYNC_WORKER_PRIORITY = 2;
+
+/// Estimated heap of a request over TLS (mbedTLS buffers and session)
+const uint32_t ASYNC_HEAP_TLS = 48 * 1024;
+
+/// Estimated heap of a plain HTTP request
+const uint32_t ASYNC_HEAP_PLAIN = 12 * 1024;
+
+/// Free heap kept for WiFi, UDP and the executor while requests run
+const uint32_t ASYNC_HEAP_RESERVE = 24 * 1024;
+
+/// Lowest request ID, 0 and 1 are the event and response channels
+const uint8_t ASYNC_FIRST_ID = UART_CHANNEL_RESPONSE + 1;
+
+/// Commands that can run as an asynchronous request
+static const char *const asyncCommands[] = {
+    "GET",         "GET_STREAM", "POST",      "POST_STREAM",
+    "FILE_STREAM", "FILE_RANGE", "FILE_PAGE", "EXECUTE_HTTP_CALL"};
+
+/**
+ * @struct AsyncRequest
+ * @brief A request waiting for or running on a worker
+ */
+struct AsyncRequest {
+  uint8_t id;             ///< Request ID, also the output channel
+  String line;            ///< Command and argument
+  uint16_t commandLength; ///< Length of the command name
+  AsyncUDPPacket *packet; ///< Owned copy of the UDP packet or null
+  HttpCallSnapshot call;  ///< Builder configuration at submission
+  uint32_t heapCharge;    ///< Estimated heap the request needs
+  uint32_t submittedAt;   ///< millis() when the request was queued
+  uint32_t startedAt;     ///< millis() when a worker picked it up
+  bool deferred = false;  ///< Waited for heap at least once
+
+  ~AsyncRequest() { delete packet; }
+};
+
+/**
+ * @struct AsyncStats
+ * @brief Counters of the asynchronous requests
+ */
+struct AsyncStats {
+  uint32_t completed; ///< Requests that ran to the end
+  uint32_t rejected;  ///< Requests refused at submission
+  uint32_t deferred;  ///< Requests that waited for free heap
+};
+
+/// Guards everything below, never held while printing
+static std::mutex asyncMutex;
+static std::deque<AsyncRequest *> pending;
+static AsyncRequest *running[ASYNC_MAX_WORKERS];
+static uint8_t concurrency = 2;
+static AsyncStats asyncStats;
+
+/**
+ * @brief Heap charged to the running requests
+ * @return uint32_t Sum of the charges
+ */
+static uint32_t chargedHeapLocked() {
+  uint32_t charged = 0;
+  for (AsyncRequest *request : running) {
+    if (request) {
+      charged += request->heapCharge;
+    }
+  }
+  return charged;
+}
+
+/**
+ * @brief Check whether an ID is queued or running
+ * @param id Request ID
+ * @return bool True if the ID is in use
+ */
+static bool idInUseLocked(uint8_t id) {
+  for (AsyncRequest *request : running) {
+    if (request && request->id == id) {
+      return true;
+    }
+  }
+  for (AsyncRequest *request : pending) {
+    if (request->id == id) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * @brief Print a line of a request on its own channel
+ * @param request Request the line belongs to
+ * @param line Text to print
+ */
+static void printForRequest(AsyncRequest *request, const String &line) {
+  uint8_t previous = uartResponseChannel();
+  uartSetResponseChannel(request->id);
+  printResponse(line, request->packet);
+  uartSetResponseChannel(previous);
+}
+
+static void asyncWorkerTask(void *parameter);
+
+/**
+ * @brief Start queued requests while workers and heap are available
+ *
+ * Requests start in submission order; one that does not fit the heap holds
+ * back the ones behind it, unless nothing else is running.
+ */
+static void startRequests() {
+  std::vector<AsyncRequest *> failed;
+  {
+    std::lock_guard<std::mutex> lock(asyncMutex);
+    while (!pending.empty()) {
+      uint8_t active = 0;
+      int freeSlot = -1;
+      for (uint8_t i = 0; i < ASYNC_MAX_WORKERS; i++) {
+        if (running[i]) {
+          active++;
+        } else if (freeSlot < 0) {
+          freeSlot = i;
+        }
+      }
+      if (active >= concurrency || freeSlot < 0) {
+        break;
+      }
+
+      AsyncRequest *request = pending.front();
+      if (active > 0 &&
+          ESP.getFreeHeap() < request->heapCharge + ASYNC_HEAP_RESERVE) {
+        if (!request->deferred) {
+          request->deferred = true;
+          asyncStats.deferred++;
+        }
+        break;
+      }
+
+      pending.pop_front();
+      running[freeSlot] = request;
+      request->startedAt = millis();
+      if (xTaskCreate(asyncWorkerTask, "async_worker", ASYNC_WORKER_STACK_SIZE,
+                      (void *)(intptr_t)freeSlot, ASYNC_WORKER_PRIORITY,
+                      NULL) != pdPASS) {
+        running[freeSlot] = nullptr;
+        failed.push_back(request);
+      }
+    }
+  }
+
+  for (AsyncRequest *request : failed) {
+    printForRequest(request, "ASYNC_ERROR: Could not start a worker");
+    delete request;
+  }
+}
+
+/**
+ * @brief Worker task, runs one request and then exits
+ * @param parameter Index of the request in running[]
+ */
+static void asyncWorkerTask(void *parameter) {
+  int slot = (intptr_t)parameter;
+  AsyncRequest *request;
+  {
+    std::lock_guard<std::mutex> lock(asyncMutex);
+    request = running[slot];
+  }
+
+  uartSetResponseChannel(request->id);
+  request->call.use();
+  udpReplyBegin(request->packet);
+
+  std::string_view line(request->line.c_str(), request->line.length());
+  std::string_view argument;
+  if (request->commandLength < line.length()) {
+    argument = line.substr(request->commandLength + 1);
+  }
+  const Command *entry = findCommand(line.data(), request->commandLength);
+  uint32_t handlerStart = micros();
+  entry->execute(argument, request->packet);
+  perfRecordMicros(PERF_HANDLER, handlerStart);
+  uartReleaseBody();
+
+  uint32_t stackUsed =
+      ASYNC_WORKER_STACK_SIZE - uxTaskGetStackHighWaterMark(NULL);
+  uint32_t now = millis();
+  printResponse("ASYNC_END: ms=" + String(now - request->startedAt) +
+                    " wait_ms=" +
+                    String(request->startedAt - request->submittedAt) +
+                    " stack=" + String(stackUsed) + "/" +
+                    String(ASYNC_WORKER_STACK_SIZE) +
+                    " heap_charge=" + String(request->heapCharge),
+                request->packet);
+  udpReplyEnd();
+  uartSetResponseChannel(UART_CHANNEL_RESPONSE);
+
+  {
+    std::lock_guard<std::mutex> lock(asyncMutex);
+    running[slot] = nullptr;
+    asyncStats.completed++;
+  }
+  delete request;
+  startRequests();
+  vTaskDelete(NULL);
+}
+
+/**
+ * @brief Check whether a command can run asynchronously
+ * @param command Command name
+ * @return bool True for the HTTP request commands
+ */
+static bool isAsyncCommand(std::string_view command) {
+  for (const char *name : asyncCommands) {
+    if (command == name) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * @brief Estimate the heap a request needs
+ *
+ * URLs without a scheme default to HTTPS, and so does EXECUTE_HTTP_CALL,
+ * whose URL is in the builder configuration.
+ *
+ * @param argument Command argument
+ * @return uint32_t Estimated heap in bytes
+ */
+static uint32_t estimateHeap(std::string_view argument) {
+  ArgTokenizer tokens(argument);
+  std::string_view url = tokens.next();
+  return url.substr(0, 7) == "http://" ? ASYNC_HEAP_PLAIN : ASYNC_HEAP_TLS;
+}
+
+/**
+ * @brief Queue an HTTP command to run on a worker task
+ *
+ * The argument is "<id> <command> [argument]". The builder configuration is
+ * copied now, so BUILD_HTTP_* commands sent afterwards do not affect it.
+ *
+ * @param argument Request ID, command and its argument
+ * @param packet Pointer to AsyncUDPPacket for response
+ */
+void submitAsyncRequest(std::string_view argument, AsyncUDPPacket *packet) {
+  ArgTokenizer tokens(argument);
+  std::string_view idArg = tokens.next();
+  std::string_view command = tokens.next();
+  std::string_view commandArgument = tokens.rest();
+
+  uint32_t id = 0;
+  String error;
+  if (!argToUint32(idArg, id) || id < ASYNC_FIRST_ID || id > 255) {
+    error = "ASYNC_ERROR: ID must be " + String(ASYNC_FIRST_ID) + "-255";
+  } else if (!isAsyncCommand(command)) {
+    error = "ASYNC_ERROR: Unsupported command";
+  } else if (uartTaskRedirected()) {
+    // Workers could outlive the session, open another session instead
+    error = "ASYNC_ERROR: Not available on TCP sessions";
+  }
+  if (!error.isEmpty()) {
+    {
+      std::lock_guard<std::mutex> lock(asyncMutex);
+      asyncStats.rejected++;
+    }
+    printResponse(error, packet);
+    return;
+  }
+
+  AsyncRequest *request = new AsyncRequest();
+  request->id = id;
+  request->line = toString(command);
+  request->commandLength = command.length();
+  if (!commandArgument.empty()) {
+    request->line += ' ';
+    request->line += toString(commandArgument);
+  }
+  request->packet = packet ? new AsyncUDPPacket(*packet) : nullptr;
+  request->heapCharge = command == "EXECUTE_HTTP_CALL"
+                            ? ASYNC_HEAP_TLS
+                            : estimateHeap(commandArgument);
+  request->submittedAt = millis();
+
+  // Acknowledge before the worker can print anything on this ID
+  {
+    std::lock_guard<std::mutex> lock(asyncMutex);
+    if (idInUseLocked(id)) {
+      error = "ASYNC_ERROR: ID " + String(id) + " is in use";
+    } else if (pending.size() >= ASYNC_QUEUE_DEPTH) {
+      error = "ASYNC_ERROR: Queue full";
+    }
+    if (!error.isEmpty()) {
+      asyncStats.rejected++;
+    }
+  }
+  if (!error.isEmpty()) {
+    delete request;
+    printResponse(error, packet);
+    return;
+  }
+  printResponse("ASYNC_QUEUED: " + String(id), packet);
+
+  {
+    std::lock_guard<std::mutex> lock(asyncMutex);
+    pending.push_back(request);
+  }
+  startRequests();
+}
+
+/**
+ * @brief Set how many requests may run at once
+ * @param limit Number of workers, 1 to ASYNC_MAX_WORKERS
+ * @param packet Pointer to AsyncUDPPacket for response
+ */
+void setAsyncConcurrency(std::string_view limit, AsyncUDPPacket *packet) {
+  uint32_t value;
+  if (!argToUint32(limit, value) || value < 1 || value > ASYNC_MAX_WORKERS) {
+    printResponse("ASYNC_ERROR: Limit must be 1-" + String(ASYNC_MAX_WORKERS),
+                  packet);
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(asyncMutex);
+    concurrency = value;
+  }
+  printResponse("ASYNC_MAX: " + String(value), packet);
+  startRequests();
+}
+
+/**
+ * @brief Print asynchronous request counters and the running requests
+ * @param packet Pointer to AsyncUDPPacket for response
+ */
+void printAsyncStats(AsyncUDPPacket *packet) {
+  struct RunningInfo {
+    uint8_t id;
+    String command;
+    uint32_t elapsedMs;
+    uint32_t heapCharge;
+  };
+  std::vector<RunningInfo> active;
+  AsyncStats stats;
+  size_t queued;
+  uint8_t limit;
+  uint32_t charged;
+  {
+    std::lock_guard<std::mutex> lock(asyncMutex);
+    uint32_t now = millis();
+    for (AsyncRequest *request : running) {
+      if (request) {
+        active.push_back({request->id,
+                          request->line.substring(0, request->commandLength),
+                          now - request->startedAt, request->heapCharge});
+      }
+    }
+    stats = asyncStats;
+    queued = pending.size();
+    limit = concurrency;
+    charged = chargedHeapLocked();
+  }
+
+  printResponse("ASYNC: running=" + String(active.size()) + "/" +
+                    String(limit) + " queued=" + String(queued) + "/" +
+                    String(ASYNC_QUEUE_DEPTH) +
+                    " completed=" + String(stats.completed) +
+                    " rejected=" + String(stats.rejected) +
+                    " deferred=" + String(stats.deferred),
+                packet);
+  printResponse("ASYNC_HEAP: free=" + String(ESP.getFreeHeap()) +
+                    " charged=" + String(charged) +
+                    " reserve=" + String(ASYNC_HEAP_RESERVE),
+                packet);
+  for (const RunningInfo &info : active) {
+    printResponse("ASYNC_RUNNING: id=" + String(info.id) + " " + info.command +
+                      " ms=" + String(info.elapsedMs) +
+                      " heap_charge=" + String(info.heapCharge),
+                  packet);
+  }
+}
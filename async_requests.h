@@ -0,0 +1,18 @@
+#ifndef ASYNC_REQUESTS_H
+#define ASYNC_REQUESTS_H
+
+#include <Arduino.h>
+#include <AsyncUDP.h>
+#include <string_view>
+
+/// Most requests that can run at once, each needs a worker stack and heap
+const uint8_t ASYNC_MAX_WORKERS = 3;
+
+/// Requests that can wait for a free worker
+const size_t ASYNC_QUEUE_DEPTH = 4;
+
+void submitAsyncRequest(std::string_view argument, AsyncUDPPacket *packet);
+void setAsyncConcurrency(std::string_view limit, AsyncUDPPacket *packet);
+void printAsyncStats(AsyncUDPPacket *packet);
+
+#endif // ASYNC_REQUESTS_H
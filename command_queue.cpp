@@ -0,0 +1,235 @@
+/**
+ * @file command_queue.cpp
+ * @brief Command pipeline between the UART / UDP receivers and the executor
+ *
+ * This file contains the queue of parsed commands coming from UART, UDP and
+ * TCP sessions and the executor task that drains it. Receivers copy a
+ * command line into a free slot and hand the slot index to the executor.
+ * Commands sent back-to-back are queued instead of being glued together in
+ * one receive buffer. Handlers share global state (WiFi credentials, the
+ * HTTP call being built), so every command runs on the executor, one at a
+ * time. While idle the executor blocks on the queue, waking up every few
+ * seconds to close idle keep-alive connections.
+ */
+
+#include "command_queue.h"
+#include "http_pool.h"
+#include "http_utils.h"
+#include "perf_utils.h"
+#include "uart_frame.h"
+#include "uart_utils.h"
+#include "udp_reply.h"
+#include <atomic>
+
+/// Stack size of the executor task, HTTPS handlers need the same as loopTask
+const uint32_t COMMAND_EXECUTOR_STACK_SIZE = 12 * 1024;
+
+/// Executor priority, above loopTask so queued commands start promptly
+const UBaseType_t COMMAND_EXECUTOR_PRIORITY = 2;
+
+/// How often an idle executor closes timed out keep-alive connections
+const uint32_t COMMAND_EXECUTOR_IDLE_MS = 5000;
+
+/// Command slots, owned either by the free queue or the pending queue
+static CommandInvocation commandSlots[COMMAND_QUEUE_DEPTH];
+
+/// Indices of unused slots
+static QueueHandle_t freeSlots = NULL;
+
+/// Indices of slots waiting for the executor, in arrival order
+static QueueHandle_t pendingSlots = NULL;
+
+/**
+ * @struct CommandQueueStats
+ * @brief Counters for tuning the command pipeline
+ *
+ * The UART loop task, the UDP worker and the TCP sessions enqueue while the
+ * executor runs, so every counter is atomic.
+ */
+struct CommandQueueStats {
+  std::atomic<uint32_t> executed{0};    ///< Commands executed
+  std::atomic<uint32_t> dropped{0};     ///< Rejected, all slots were in use
+  std::atomic<uint32_t> tooLong{0};     ///< Rejected, over MAX_COMMAND_LENGTH
+  std::atomic<uint32_t> maxDepth{0};    ///< Most commands waiting at once
+  std::atomic<uint64_t> totalWaitUs{0}; ///< Sum of queue wait times
+  std::atomic<uint32_t> maxWaitUs{0};   ///< Longest queue wait time
+};
+
+static CommandQueueStats queueStats;
+
+/**
+ * @brief Raise an atomic maximum
+ * @param maximum Counter to raise
+ * @param value New sample
+ */
+static void raiseMax(std::atomic<uint32_t> &maximum, uint32_t value) {
+  uint32_t current = maximum.load(std::memory_order_relaxed);
+  while (value > current &&
+         !maximum.compare_exchange_weak(current, value,
+                                        std::memory_order_relaxed)) {
+  }
+}
+
+/**
+ * @brief Executor task, runs queued commands one at a time
+ * @param parameter Unused
+ */
+static void commandExecutorTask(void *parameter) {
+  uint8_t slot;
+  for (;;) {
+    if (xQueueReceive(pendingSlots, &slot,
+                      pdMS_TO_TICKS(COMMAND_EXECUTOR_IDLE_MS)) != pdTRUE) {
+      httpPoolEvictIdle();
+      continue;
+    }
+    CommandInvocation &invocation = commandSlots[slot];
+
+    uint32_t waitUs = micros() - invocation.enqueuedAt;
+    queueStats.executed.fetch_add(1, std::memory_order_relaxed);
+    queueStats.totalWaitUs.fetch_add(waitUs, std::memory_order_relaxed);
+    raiseMax(queueStats.maxWaitUs, waitUs);
+
+    perfMarkHeldBlocks(invocation.heapMark);
+    std::string_view command(invocation.line, invocation.commandLength);
+    std::string_view argument;
+    if (invocation.argumentOffset) {
+      argument = std::string_view(invocation.line + invocation.argumentOffset);
+    }
+    uartRedirectTask(invocation.console);
+    udpReplyBegin(invocation.packet);
+    handleCommand(command, argument, invocation.packet);
+    uartReleaseBody();
+    udpReplyEnd();
+    uartRedirectTask(nullptr);
+
+    delete invocation.packet;
+    invocation.packet = nullptr;
+    TaskHandle_t waiter = invocation.waiter;
+    xQueueSend(freeSlots, &slot, 0);
+    if (waiter) {
+      xTaskNotifyGive(waiter);
+    }
+  }
+}
+
+/**
+ * @brief Create the command queue and start the executor task
+ * @return bool True on success
+ */
+bool initCommandQueue() {
+  freeSlots = xQueueCreate(COMMAND_QUEUE_DEPTH, sizeof(uint8_t));
+  pendingSlots = xQueueCreate(COMMAND_QUEUE_DEPTH, sizeof(uint8_t));
+  if (freeSlots == NULL || pendingSlots == NULL) {
+    return false;
+  }
+  for (uint8_t i = 0; i < COMMAND_QUEUE_DEPTH; i++) {
+    xQueueSend(freeSlots, &i, 0);
+  }
+  return xTaskCreate(commandExecutorTask, "cmd_executor",
+                     COMMAND_EXECUTOR_STACK_SIZE, NULL,
+                     COMMAND_EXECUTOR_PRIORITY, NULL) == pdPASS;
+}
+
+/**
+ * @brief Parse a command line and queue it for the executor
+ *
+ * Never blocks, so it is safe to call from the AsyncUDP callback.
+ *
+ * @param line Raw command line, not null-terminated
+ * @param length Length of the line
+ * @param packet Heap copy of the UDP packet to reply to, or null for UART.
+ *               Ownership passes to the queue when ENQUEUE_OK is returned.
+ * @param heapMark perfHeapMark() taken when the command was received
+ * @param console Where the output goes instead of the UART, null for UART
+ *                and UDP. Must stay valid until waiter is notified.
+ * @param waiter Task to notify once the command finished, or NULL. Not
+ *               notified for an empty line or when the line is rejected.
+ * @return EnqueueResult ENQUEUE_OK, or why the line was rejected
+ */
+EnqueueResult enqueueCommand(const char *line, size_t length,
+                             AsyncUDPPacket *packet, int32_t heapMark,
+                             Print *console, TaskHandle_t waiter) {
+  uint32_t parseStart = perfStart();
+
+  // Trim surrounding whitespace
+  while (length > 0 && isspace((unsigned char)line[0])) {
+    line++;
+    length--;
+  }
+  while (length > 0 && isspace((unsigned char)line[length - 1])) {
+    length--;
+  }
+  if (length == 0) {
+    delete packet;
+    return ENQUEUE_OK;
+  }
+  if (length > MAX_COMMAND_LENGTH) {
+    return ENQUEUE_TOO_LONG;
+  }
+
+  uint8_t slot;
+  if (freeSlots == NULL || xQueueReceive(freeSlots, &slot, 0) != pdTRUE) {
+    return ENQUEUE_FULL;
+  }
+
+  CommandInvocation &invocation = commandSlots[slot];
+  memcpy(invocation.line, line, length);
+  invocation.line[length] = '\0';
+
+  const char *space = (const char *)memchr(invocation.line, ' ', length);
+  if (space) {
+    invocation.commandLength = space - invocation.line;
+    invocation.argumentOffset = invocation.commandLength + 1;
+  } else {
+    invocation.commandLength = length;
+    invocation.argumentOffset = 0;
+  }
+  invocation.packet = packet;
+  invocation.console = console;
+  invocation.waiter = waiter;
+  invocation.enqueuedAt = micros();
+  invocation.heapMark = heapMark;
+  perfRecord(PERF_PARSE, parseStart);
+
+  xQueueSend(pendingSlots, &slot, 0);
+  raiseMax(queueStats.maxDepth, uxQueueMessagesWaiting(pendingSlots));
+  return ENQUEUE_OK;
+}
+
+/**
+ * @brief Count a rejected command and tell the sender why
+ * @param result What enqueueCommand() returned, ENQUEUE_FULL or
+ *               ENQUEUE_TOO_LONG
+ * @param packet Pointer to AsyncUDPPacket for response
+ */
+void reportEnqueueFailure(EnqueueResult result, AsyncUDPPacket *packet) {
+  if (result == ENQUEUE_TOO_LONG) {
+    queueStats.tooLong.fetch_add(1, std::memory_order_relaxed);
+    printResponse("ERROR: Command exceeds " + String(MAX_COMMAND_LENGTH) +
+                      " bytes",
+                  packet);
+  } else if (result == ENQUEUE_FULL) {
+    queueStats.dropped.fetch_add(1, std::memory_order_relaxed);
+    printResponse("ERROR: Command queue full", packet);
+  }
+}
+
+/**
+ * @brief Print command queue depth and wait time counters
+ * @param packet Pointer to AsyncUDPPacket for response
+ */
+void printCommandQueueStats(AsyncUDPPacket *packet) {
+  uint32_t executed = queueStats.executed.load();
+  uint32_t avgWaitUs = executed ? queueStats.totalWaitUs.load() / executed : 0;
+  printResponse("QUEUE_DEPTH: " + String(uxQueueMessagesWaiting(pendingSlots)) +
+                    "/" + String(COMMAND_QUEUE_DEPTH) +
+                    " max=" + String(queueStats.maxDepth.load()),
+                packet);
+  printResponse("QUEUE_WAIT: avg_us=" + String(avgWaitUs) +
+                    " max_us=" + String(queueStats.maxWaitUs.load()),
+                packet);
+  printResponse("QUEUE_COMMANDS: executed=" + String(executed) +
+                    " dropped=" + String(queueStats.dropped.load()) +
+                    " too_long=" + String(queueStats.tooLong.load()),
+                packet);
+}
@@ -0,0 +1,46 @@
+#ifndef COMMAND_QUEUE_H
+#define COMMAND_QUEUE_H
+
+#include <Arduino.h>
+#include <AsyncUDP.h>
+
+/// Maximum length of a single command line
+const size_t MAX_COMMAND_LENGTH = 2048;
+
+/// Number of commands that can wait for the executor
+const size_t COMMAND_QUEUE_DEPTH = 6;
+
+/**
+ * @struct CommandInvocation
+ * @brief A parsed command waiting in the queue
+ *
+ * The line is stored in a fixed slot; command and argument are offsets into
+ * it, so no allocation happens between receiving and executing a command.
+ */
+struct CommandInvocation {
+  char line[MAX_COMMAND_LENGTH + 1]; ///< Trimmed command line
+  uint16_t commandLength;            ///< Length of the command name
+  uint16_t argumentOffset;           ///< Start of the argument, 0 if none
+  AsyncUDPPacket *packet;            ///< Owned copy of the UDP packet or null
+  Print *console;                    ///< Output of a TCP session, or null
+  TaskHandle_t waiter;               ///< Notified when the command finished
+  uint32_t enqueuedAt;               ///< micros() when the command was queued
+  int32_t heapMark;                  ///< perfHeapMark() when it was received
+};
+
+/// Outcome of enqueueCommand()
+enum EnqueueResult {
+  ENQUEUE_OK,       ///< Queued, or an empty line that was ignored
+  ENQUEUE_FULL,     ///< Every slot is in use
+  ENQUEUE_TOO_LONG, ///< The line exceeds MAX_COMMAND_LENGTH
+};
+
+bool initCommandQueue();
+EnqueueResult enqueueCommand(const char *line, size_t length,
+                             AsyncUDPPacket *packet, int32_t heapMark,
+                             Print *console = nullptr,
+                             TaskHandle_t waiter = NULL);
+void reportEnqueueFailure(EnqueueResult result, AsyncUDPPacket *packet);
+void printCommandQueueStats(AsyncUDPPacket *packet);
+
+#endif // COMMAND_QUEUE_H
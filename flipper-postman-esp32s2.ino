@@ -1,7 +1,14 @@
+#include "command_queue.h"
 #include "http_utils.h"
 #include "led.h"
+#include "response_cache.h"
 #include "splash.h"
+#include "uart_frame.h"
+#include "uart_link.h"
+#include "uart_tx.h"
 #include "uart_utils.h"
+#include "udp_inbox.h"
+#include "udp_reply.h"
 #include "wifi_utils.h"
 #include <ArduinoJson.h>
 #include <AsyncUDP.h>
@@ -14,31 +21,48 @@ const char *password;
 AsyncUDP udp;
 
 void setup() {
-  UART0.begin(115200);
+  UART0.begin(UART_DEFAULT_BAUD);
   while (!Serial) {
     ; // Wait for Serial to be ready
   }
+  if (!initUartTx()) {
+    log_e("Error creating UART writer task, writing to UART directly.");
+  }
+  if (!initUartFrame()) {
+    log_e("Error creating UART output lock, ASYNC bodies may interleave.");
+  }
 
   led_init();
   led_set_blue(255);
 
-  uart_buffer_Mutex = xSemaphoreCreateMutex();
-  if (uart_buffer_Mutex == NULL) {
-    log_e("Error creating Mutex. Sketch will fail.");
+  if (!initCommandQueue()) {
+    log_e("Error creating command queue. Sketch will fail.");
     while (true) {
-      UART0.println("Mutex error (NULL). Program halted.");
+      UART0.println("Command queue error. Program halted.");
       delay(2000);
     }
   }
+  if (!initUdpInbox()) {
+    log_e("Error creating UDP worker task, UDP commands are dropped.");
+  }
+  if (!initUdpReply()) {
+    log_e("Error creating UDP flush timer, UDP_COALESCE unavailable.");
+  }
+  if (!initResponseCache()) {
+    log_e("LittleFS mount failed, response cache disabled.");
+  }
   led_set_blue(0);
   UART0.onReceive(UART0_RX_CB);
-  init_cmds();
+  if (!initUartLink()) {
+    log_e("Error creating baud rate timer, UART_BAUD unavailable.");
+  }
 
   printSplashScreen();
   printTitle();
 }
 
 void loop() {
+  // Frames UART input into commands for the executor task, sleeps when idle
   handleSerialInput();
   // Other loop operations can go here
 }
\ No newline at end of file
@@ -0,0 +1,375 @@
+// Host benchmarks for the command path and the HTTP body stream loops.
+//
+// Numbers are from the host build: the UART stand-in writes instantly and
+// the HTTP server is on loopback, so they compare code paths against each
+// other and do not predict throughput on the board.
+
+#include "harness.h"
+#include "http_body.h"
+#include "http_pool.h"
+#include "http_utils.h"
+#include "loopback_server.h"
+#include "uart_frame.h"
+#include "uart_utils.h"
+#include "udp_inbox.h"
+#include <chrono>
+#include <esp_heap_caps.h>
+#include <functional>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+static bool quick = false;
+
+static double elapsedNs(Clock::time_point start) {
+  return std::chrono::duration<double, std::nano>(Clock::now() - start)
+      .count();
+}
+
+/**
+ * @brief Allocations made by the firmware threads since a snapshot
+ *
+ * The bench thread's own allocations (output capture, std::string) are
+ * taken out of the process-wide count.
+ */
+struct AllocationCounter {
+  uint64_t total = hostHeapCounters().allocations;
+  uint64_t own = hostThreadAllocations();
+
+  uint64_t firmware() const {
+    return (hostHeapCounters().allocations - total) -
+           (hostThreadAllocations() - own);
+  }
+  uint64_t all() const { return hostHeapCounters().allocations - total; }
+};
+
+static void report(const char *name, double nsPerOp, double allocsPerOp,
+                   size_t count) {
+  printf("%-22s ns/cmd=%-10.0f allocs/cmd=%-6.2f n=%zu\n", name, nsPerOp,
+         allocsPerOp, count);
+}
+
+/**
+ * @brief UART line in, handleSerialInput() -> handleCommand(), reply out
+ */
+static void benchSerialCommand() {
+  size_t count = quick ? 200 : 5000;
+  harnessCommand("PERF_RESET\n", "PERF_RESET:");
+  AllocationCounter allocations;
+  Clock::time_point start = Clock::now();
+  for (size_t i = 0; i < count; i++) {
+    harnessCommand("VERSION\n", "VERSION:");
+  }
+  report("serial_command", elapsedNs(start) / count,
+         (double)allocations.firmware() / count, count);
+
+  // The firmware's own split of the same commands
+  std::string stats = harnessCommand("PERF_STATS\n", "PERF_HEAP_FREE:");
+  for (const char *metric : {"PERF_PARSE:", "PERF_DISPATCH:", "PERF_PRINT:"}) {
+    size_t at = stats.find(metric);
+    if (at != std::string::npos) {
+      printf("  %s\n", stats.substr(at, stats.find('\n', at) - at).c_str());
+    }
+  }
+}
+
+/**
+ * @brief Print the PERF_HELD_BLOCKS line of PERF_STATS
+ */
+static void reportHeldBlocks() {
+  std::string stats = harnessCommand("PERF_STATS\n", "PERF_HEAP_FREE:");
+  size_t at = stats.find("PERF_HELD_BLOCKS:");
+  if (at != std::string::npos) {
+    printf("  %s\n", stats.substr(at, stats.find('\n', at) - at).c_str());
+  }
+}
+
+/**
+ * @brief UDP datagram in, udpInboxPush() -> handleCommand(), reply out
+ *
+ * The datagram is built on the bench thread like lwIP builds it on the
+ * device. udpInboxPush() runs on the bench thread too, its allocations
+ * are added to the firmware's.
+ */
+static void benchUdpCommand() {
+  size_t count = quick ? 200 : 5000;
+  harnessCommand("PERF_RESET\n", "PERF_RESET:");
+  harnessCommand("PERF_HEAP true\n", "PERF_HEAP:");
+  uint64_t pushAllocations = 0;
+  AllocationCounter allocations;
+  Clock::time_point start = Clock::now();
+  for (size_t i = 0; i < count; i++) {
+    AsyncUDPPacket packet((const uint8_t *)"VERSION", 7);
+    uint64_t own = hostThreadAllocations();
+    udpInboxPush(packet);
+    pushAllocations += hostThreadAllocations() - own;
+    std::shared_ptr<HostUdpReplies> replies = packet.replies();
+    harnessUdpWait(replies, "VERSION:");
+    // Wait for the executor to delete its copy, so the free does not land
+    // in the next command's PERF_HEAP window
+    while (replies.use_count() > 2) {
+      std::this_thread::yield();
+    }
+  }
+  report("udp_command", elapsedNs(start) / count,
+         (double)(allocations.firmware() + pushAllocations) / count, count);
+  reportHeldBlocks();
+
+  harnessCommand("PERF_RESET\n", "PERF_RESET:");
+  for (size_t i = 0; i < count; i++) {
+    harnessCommand("VERSION\n", "VERSION:");
+  }
+  printf("  uart, same run:\n");
+  reportHeldBlocks();
+  harnessCommand("PERF_HEAP false\n", "PERF_HEAP:");
+}
+
+/**
+ * @brief Command names as listed by HELP, checked against findCommand()
+ */
+static std::vector<std::string> commandNames() {
+  std::vector<std::string> names;
+  std::string help = harnessCommand("HELP\n", "type ? to print help");
+  size_t pos = help.find("Available Commands:");
+  while ((pos = help.find('\n', pos)) != std::string::npos) {
+    pos++;
+    size_t end = help.find_first_of(" :\r\n", pos);
+    std::string name = help.substr(pos, end - pos);
+    const Command *entry = findCommand(name.data(), name.size());
+    if (entry && name == entry->name) {
+      names.push_back(name);
+    }
+  }
+  return names;
+}
+
+/**
+ * @brief findCommand() against the linear String scan it replaced
+ *
+ * The old dispatcher compared the received String with every entry of
+ * commands[] in order, so its cost grew with the position of the command.
+ */
+static void benchDispatch() {
+  std::vector<std::string> names = commandNames();
+  std::vector<String> table;
+  for (const std::string &name : names) {
+    table.push_back(String(name.c_str()));
+  }
+  size_t rounds = quick ? 100 : 20000;
+
+  auto hashLookup = [](const std::string &name) {
+    return findCommand(name.data(), name.size()) != nullptr;
+  };
+  auto linearLookup = [&table](const std::string &name) {
+    String command(name.c_str());
+    for (const String &entry : table) {
+      if (command == entry) {
+        return true;
+      }
+    }
+    return false;
+  };
+
+  auto measure = [rounds](const std::vector<std::string> &lookups,
+                          auto lookup) {
+    size_t found = 0;
+    uint64_t own = hostThreadAllocations();
+    Clock::time_point start = Clock::now();
+    for (size_t round = 0; round < rounds; round++) {
+      for (const std::string &name : lookups) {
+        found += lookup(name);
+      }
+    }
+    size_t count = rounds * lookups.size();
+    double ns = elapsedNs(start) / count;
+    double allocations = (double)(hostThreadAllocations() - own) / count;
+    return std::make_pair(found == count ? ns : -1.0, allocations);
+  };
+
+  struct Case {
+    const char *name;
+    std::vector<std::string> lookups;
+  };
+  std::vector<Case> cases = {{"all", names},
+                             {"first", {names.front()}},
+                             {"last", {names.back()}}};
+  for (const Case &lookupCase : cases) {
+    auto hashed = measure(lookupCase.lookups, hashLookup);
+    auto linear = measure(lookupCase.lookups, linearLookup);
+    std::string hashedName = "dispatch_hash_" + std::string(lookupCase.name);
+    std::string linearName =
+        "dispatch_linear_" + std::string(lookupCase.name);
+    report(hashedName.c_str(), hashed.first, hashed.second,
+           rounds * lookupCase.lookups.size());
+    report(linearName.c_str(), linear.first, linear.second,
+           rounds * lookupCase.lookups.size());
+  }
+  printf("  %zu commands\n", names.size());
+}
+
+/**
+ * @brief printResponse() of a short line, as command handlers call it
+ */
+static void benchPrintResponse() {
+  size_t count = quick ? 1000 : 100000;
+  Serial.hostSetCapture(false);
+  AllocationCounter allocations;
+  uint64_t own = hostThreadAllocations();
+  Clock::time_point start = Clock::now();
+  for (size_t i = 0; i < count; i++) {
+    printResponse("UART_TX: queued=0/4096 high_water=0", nullptr);
+  }
+  double ns = elapsedNs(start);
+  uint64_t callerAllocations = hostThreadAllocations() - own;
+  Serial.hostSetCapture(true);
+  harnessCommand("VERSION\n", "VERSION:");
+  report("print_response", ns / count, (double)callerAllocations / count,
+         count);
+}
+
+/**
+ * @brief GET_STREAM of a large body from the loopback server
+ */
+static void benchGetStream() {
+  size_t bodySize = quick ? 256 * 1024 : 4 * 1024 * 1024;
+  size_t count = quick ? 2 : 10;
+  std::string body(bodySize, 'x');
+  LoopbackHttpServer server(
+      [&body](const LoopbackRequest &request, LoopbackConnection &connection) {
+        connection.respond(200, body);
+      });
+  std::string line = "GET_STREAM " + server.url("/stream") + "\n";
+  harnessCommand(line, "STREAM_END", 30000);
+
+  AllocationCounter allocations;
+  Clock::time_point start = Clock::now();
+  for (size_t i = 0; i < count; i++) {
+    harnessCommand(line, "STREAM_END", 30000);
+  }
+  double seconds = elapsedNs(start) / 1e9;
+  printf("%-22s MB/s=%-10.1f allocs/cmd=%-6.2f n=%zu body=%zu\n",
+         "get_stream", bodySize * count / seconds / 1e6,
+         (double)allocations.firmware() / count, count, bodySize);
+}
+
+/**
+ * @brief Body copy loop as it was before the adaptive buffer
+ *
+ * Fixed 512-byte buffer on the stack and a delay(1) whenever no data is
+ * buffered, kept here as the reference for benchStreamLoops().
+ */
+static void fixedBufferRequest(const String &url, bool post) {
+  PooledHTTPClient http;
+  http.begin(url);
+  int code;
+  if (post) {
+    http.addHeader("Content-Type", "application/json");
+    code = http.POST("{\"bench\":true}");
+  } else {
+    code = http.GET();
+  }
+  if (code > 0) {
+    HttpBodyReader body(http);
+    uint8_t buff[512];
+    while (!body.finished()) {
+      int c = body.read(buff, sizeof(buff));
+      if (c <= 0) {
+        delay(1);
+        continue;
+      }
+      uartWriteBody(buff, c);
+    }
+    uartEndBody();
+  }
+  http.end();
+}
+
+/**
+ * @brief GET_STREAM, FILE_STREAM and POST_STREAM before and after the
+ * adaptive buffer
+ *
+ * "bulk" sends the whole body at once, "paced" sends it in 1460-byte
+ * segments 1 ms apart, about what a WiFi link delivers. The request
+ * functions are called from the bench thread with the UART output counted
+ * instead of captured.
+ */
+static void benchStreamLoops() {
+  struct Scenario {
+    const char *name;
+    size_t bodySize;
+    size_t segment; ///< 0 sends the body in one write
+    size_t count;
+  };
+  const Scenario scenarios[] = {
+      {"bulk", quick ? 256 * 1024u : 4 * 1024 * 1024u, 0, quick ? 2u : 5u},
+      {"paced", quick ? 64 * 1024u : 512 * 1024u, 1460, quick ? 2u : 5u},
+      {"small", 4096, 1460, quick ? 20u : 200u}};
+
+  for (const Scenario &scenario : scenarios) {
+    std::string body(scenario.bodySize, 'x');
+    LoopbackHttpServer server(
+        [&body, &scenario](const LoopbackRequest &request,
+                           LoopbackConnection &connection) {
+          if (scenario.segment == 0) {
+            connection.respond(200, body);
+            return;
+          }
+          connection.send("HTTP/1.1 200 OK\r\nContent-Length: " +
+                          std::to_string(body.size()) + "\r\n\r\n");
+          for (size_t at = 0; at < body.size(); at += scenario.segment) {
+            connection.pause(1);
+            connection.send(body.substr(at, scenario.segment));
+          }
+        });
+    String url = server.url("/stream").c_str();
+
+    struct Path {
+      const char *name;
+      std::function<void()> before;
+      std::function<void()> after;
+    };
+    const Path paths[] = {
+        {"get_stream", [&] { fixedBufferRequest(url, false); },
+         [&] { makeHttpRequestStream(url, nullptr); }},
+        {"file_stream", [&] { fixedBufferRequest(url, false); },
+         [&] { makeHttpFileRequest(url, nullptr); }},
+        {"post_stream", [&] { fixedBufferRequest(url, true); },
+         [&] { makeHttpPostFileRequest(url, "{\"bench\":true}", nullptr); }}};
+
+    Serial.hostSetCapture(false);
+    for (const Path &path : paths) {
+      double rates[2];
+      for (int variant = 0; variant < 2; variant++) {
+        const std::function<void()> &run =
+            variant == 0 ? path.before : path.after;
+        run(); // Opens the pooled connection
+        Clock::time_point start = Clock::now();
+        for (size_t i = 0; i < scenario.count; i++) {
+          run();
+        }
+        rates[variant] = scenario.bodySize * scenario.count /
+                         (elapsedNs(start) / 1e9) / 1e6;
+      }
+      std::string name = std::string(path.name) + "_" + scenario.name;
+      printf("%-22s MB/s before=%-8.2f after=%-8.2f body=%zu n=%zu\n",
+             name.c_str(), rates[0], rates[1], scenario.bodySize,
+             scenario.count);
+    }
+    Serial.hostSetCapture(true);
+  }
+  harnessCommand("VERSION\n", "VERSION:");
+}
+
+int main(int argc, char **argv) {
+  quick = argc > 1 && strcmp(argv[1], "--quick") == 0;
+  harnessBoot();
+  benchSerialCommand();
+  benchUdpCommand();
+  benchDispatch();
+  benchPrintResponse();
+  benchGetStream();
+  benchStreamLoops();
+  harnessExit(0);
+}
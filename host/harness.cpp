@@ -0,0 +1,111 @@
+/**
+ * @file harness.cpp
+ * @brief Runs the firmware on the host and plays the Flipper side
+ *
+ * setup() runs on the calling thread and loop() on a task of its own, like
+ * the Arduino loop task. Commands go in through the UART stand-in or the
+ * UDP inbox and the tests read back what the firmware wrote.
+ */
+
+#include "harness.h"
+#include "udp_inbox.h"
+#include <Arduino.h>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <unistd.h>
+
+void setup();
+void loop();
+
+/// Bytes handed to the receive callback at once, well below uart_rx_ring
+static const size_t HARNESS_RX_PIECE = 256;
+
+static int failures = 0;
+
+static void loopTask(void *parameter) {
+  for (;;) {
+    loop();
+  }
+}
+
+void harnessBoot() {
+  static std::once_flag booted;
+  std::call_once(booted, [] {
+    setup();
+    xTaskCreate(loopTask, "loopTask", 8192, NULL, 1, NULL);
+    Serial.hostWaitForOutput("\n", 1000);
+    // Let the splash screen drain before the first command
+    delay(50);
+    Serial.hostTakeOutput();
+  });
+}
+
+std::string harnessCommand(const std::string &line, const char *marker,
+                           uint32_t timeout_ms) {
+  Serial.hostTakeOutput();
+  // The UART delivers at line rate, so long lines arrive in pieces the
+  // loop task drains as they come instead of overrunning uart_rx_ring
+  for (size_t sent = 0; sent < line.size(); sent += HARNESS_RX_PIECE) {
+    if (sent) {
+      delay(2);
+    }
+    Serial.hostInject(line.data() + sent,
+                      min(HARNESS_RX_PIECE, line.size() - sent));
+  }
+  if (!Serial.hostWaitForOutput(marker, timeout_ms)) {
+    return std::string();
+  }
+  // Finish the line the marker is on
+  std::string output = Serial.hostTakeOutput();
+  size_t at = output.find(marker);
+  while (output.find('\n', at) == std::string::npos &&
+         Serial.hostWaitForOutput("\n", timeout_ms)) {
+    output += Serial.hostTakeOutput();
+  }
+  return output;
+}
+
+std::shared_ptr<HostUdpReplies> harnessUdp(const std::string &text) {
+  AsyncUDPPacket packet((const uint8_t *)text.data(), text.size());
+  udpInboxPush(packet);
+  return packet.replies();
+}
+
+std::string harnessUdpWait(const std::shared_ptr<HostUdpReplies> &replies,
+                           const char *marker, uint32_t timeout_ms) {
+  std::string joined;
+  size_t joinedCount = 0;
+  std::unique_lock<std::mutex> lock(replies->mutex);
+  replies->written.wait_for(
+      lock, std::chrono::milliseconds(timeout_ms), [&] {
+        for (; joinedCount < replies->datagrams.size(); joinedCount++) {
+          joined += replies->datagrams[joinedCount];
+        }
+        return joined.find(marker) != std::string::npos;
+      });
+  return joined.find(marker) != std::string::npos ? joined : std::string();
+}
+
+void harnessFail(const char *file, int line, const char *condition) {
+  fprintf(stderr, "%s:%d: check failed: %s\n", file, line, condition);
+  failures++;
+}
+
+int harnessResult() {
+  if (failures) {
+    fprintf(stderr, "%d check(s) failed\n", failures);
+  } else {
+    printf("all checks passed\n");
+  }
+  harnessExit(failures ? 1 : 0);
+  return 1;
+}
+
+void harnessExit(int code) {
+  // The firmware tasks never return, skip the static destructors of the
+  // objects they are still using
+  fflush(stdout);
+  fflush(stderr);
+  _exit(code);
+}
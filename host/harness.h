@@ -0,0 +1,62 @@
+#ifndef HARNESS_H
+#define HARNESS_H
+
+#include <AsyncUDP.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Boot the firmware once: setup(), then loop() on its own task
+ */
+void harnessBoot();
+
+/**
+ * @brief Send a line over the UART and collect the output it produces
+ * @param line Bytes to send, usually ending in a newline
+ * @param marker Output that ends the command, such as "VERSION:"
+ * @param timeout_ms Time to wait for the marker
+ * @return std::string Everything written since the line was sent, empty if
+ *         the marker never appeared
+ */
+std::string harnessCommand(const std::string &line, const char *marker,
+                           uint32_t timeout_ms = 5000);
+
+/**
+ * @brief Send a datagram to the UDP command port
+ * @param text Datagram payload
+ * @return std::shared_ptr<HostUdpReplies> Datagrams sent back to the sender
+ */
+std::shared_ptr<HostUdpReplies> harnessUdp(const std::string &text);
+
+/**
+ * @brief Wait until the replies to a datagram contain a marker
+ * @return std::string Reply datagrams joined, empty on timeout
+ */
+std::string harnessUdpWait(const std::shared_ptr<HostUdpReplies> &replies,
+                           const char *marker, uint32_t timeout_ms = 5000);
+
+/**
+ * @brief Minimal check macro, the tests are plain executables run by ctest
+ */
+#define CHECK(condition)                                                       \
+  do {                                                                         \
+    if (!(condition)) {                                                        \
+      harnessFail(__FILE__, __LINE__, #condition);                             \
+    }                                                                          \
+  } while (0)
+
+void harnessFail(const char *file, int line, const char *condition);
+
+/**
+ * @brief Report the checks and end the process
+ * @return int Never returns, declared for `return harnessResult();`
+ */
+int harnessResult();
+
+/**
+ * @brief End the process while the firmware tasks are still running
+ */
+void harnessExit(int code);
+
+#endif // HARNESS_H
@@ -0,0 +1,158 @@
+/**
+ * @file loopback_server.cpp
+ * @brief Scripted HTTP/1.1 server for the host tests and benchmarks
+ */
+
+#include "loopback_server.h"
+#include <arpa/inet.h>
+#include <chrono>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+bool LoopbackConnection::send(const std::string &data) {
+  size_t sent = 0;
+  while (sent < data.size()) {
+    ssize_t n = ::send(_fd, data.data() + sent, data.size() - sent,
+                       MSG_NOSIGNAL);
+    if (n <= 0) {
+      _closed = true;
+      return false;
+    }
+    sent += n;
+  }
+  return true;
+}
+
+void LoopbackConnection::pause(uint32_t ms) {
+  std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void LoopbackConnection::respond(int status, const std::string &body,
+                                 const std::string &headers) {
+  send("HTTP/1.1 " + std::to_string(status) + " Status\r\nContent-Length: " +
+       std::to_string(body.size()) + "\r\n" + headers + "\r\n" + body);
+}
+
+LoopbackHttpServer::LoopbackHttpServer(LoopbackHandler handler)
+    : _handler(handler) {
+  _listenFd = socket(AF_INET, SOCK_STREAM, 0);
+  int reuse = 1;
+  setsockopt(_listenFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+  struct sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port = 0;
+  bind(_listenFd, (struct sockaddr *)&address, sizeof(address));
+  listen(_listenFd, 16);
+  socklen_t length = sizeof(address);
+  getsockname(_listenFd, (struct sockaddr *)&address, &length);
+  _port = ntohs(address.sin_port);
+  _acceptThread = std::thread(&LoopbackHttpServer::acceptLoop, this);
+}
+
+LoopbackHttpServer::~LoopbackHttpServer() {
+  _stopping = true;
+  shutdown(_listenFd, SHUT_RDWR);
+  _acceptThread.join();
+  close(_listenFd);
+  std::vector<std::thread> workers;
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (int fd : _clientFds) {
+      shutdown(fd, SHUT_RDWR);
+    }
+    workers.swap(_workers);
+  }
+  for (std::thread &worker : workers) {
+    worker.join();
+  }
+}
+
+std::string LoopbackHttpServer::url(const std::string &path) const {
+  return "http://127.0.0.1:" + std::to_string(_port) + path;
+}
+
+void LoopbackHttpServer::acceptLoop() {
+  while (!_stopping) {
+    struct pollfd pfd = {_listenFd, POLLIN, 0};
+    if (poll(&pfd, 1, 100) <= 0) {
+      continue;
+    }
+    int fd = accept(_listenFd, nullptr, nullptr);
+    if (fd < 0) {
+      continue;
+    }
+    int nodelay = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+    _connections++;
+    std::lock_guard<std::mutex> lock(_mutex);
+    _clientFds.push_back(fd);
+    _workers.emplace_back(&LoopbackHttpServer::serve, this, fd);
+  }
+}
+
+/**
+ * @brief Read requests from one connection and run the handler on each
+ */
+void LoopbackHttpServer::serve(int fd) {
+  std::string buffer;
+  char chunk[4096];
+  LoopbackConnection connection(fd);
+  while (!connection.closed()) {
+    size_t headerEnd;
+    while ((headerEnd = buffer.find("\r\n\r\n")) == std::string::npos) {
+      ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+      if (n <= 0) {
+        close(fd);
+        return;
+      }
+      buffer.append(chunk, n);
+    }
+
+    LoopbackRequest request;
+    size_t lineEnd = buffer.find("\r\n");
+    std::string requestLine = buffer.substr(0, lineEnd);
+    size_t space = requestLine.find(' ');
+    request.method = requestLine.substr(0, space);
+    request.target = requestLine.substr(
+        space + 1, requestLine.rfind(' ') - space - 1);
+    size_t pos = lineEnd + 2;
+    while (pos < headerEnd) {
+      size_t end = buffer.find("\r\n", pos);
+      std::string line = buffer.substr(pos, end - pos);
+      size_t colon = line.find(':');
+      if (colon != std::string::npos) {
+        std::string name = line.substr(0, colon);
+        for (char &c : name) {
+          c = tolower((unsigned char)c);
+        }
+        size_t valueStart = line.find_first_not_of(' ', colon + 1);
+        request.headers[name] =
+            valueStart == std::string::npos ? "" : line.substr(valueStart);
+      }
+      pos = end + 2;
+    }
+    buffer.erase(0, headerEnd + 4);
+
+    size_t bodyLength = strtoul(request.header("content-length").c_str(),
+                                nullptr, 10);
+    while (buffer.size() < bodyLength) {
+      ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+      if (n <= 0) {
+        close(fd);
+        return;
+      }
+      buffer.append(chunk, n);
+    }
+    request.body = buffer.substr(0, bodyLength);
+    buffer.erase(0, bodyLength);
+
+    _requests++;
+    _handler(request, connection);
+  }
+  shutdown(fd, SHUT_RDWR);
+  close(fd);
+}
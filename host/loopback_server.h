@@ -0,0 +1,86 @@
+#ifndef LOOPBACK_SERVER_H
+#define LOOPBACK_SERVER_H
+
+#include <atomic>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Request as received by the loopback server
+ */
+struct LoopbackRequest {
+  std::string method;
+  std::string target;
+  std::map<std::string, std::string> headers; ///< Names in lower case
+  std::string body;
+
+  std::string header(const std::string &name) const {
+    auto it = headers.find(name);
+    return it == headers.end() ? std::string() : it->second;
+  }
+};
+
+/**
+ * @brief Server side of one connection, handed to the request handler
+ *
+ * Handlers write raw bytes, so a test controls status line, headers,
+ * framing and segment boundaries. pause() between send() calls puts the
+ * pieces into separate TCP segments.
+ */
+class LoopbackConnection {
+public:
+  explicit LoopbackConnection(int fd) : _fd(fd) {}
+  bool send(const std::string &data);
+  void pause(uint32_t ms);
+  void close() { _closed = true; }
+  bool closed() const { return _closed; }
+
+  /// Complete response with Content-Length
+  void respond(int status, const std::string &body,
+               const std::string &headers = "");
+
+private:
+  int _fd;
+  bool _closed = false;
+};
+
+typedef std::function<void(const LoopbackRequest &, LoopbackConnection &)>
+    LoopbackHandler;
+
+/**
+ * @brief HTTP/1.1 server on 127.0.0.1 with scripted responses
+ *
+ * Every connection gets its own thread and keeps reading requests until
+ * the handler closes it or the client goes away.
+ */
+class LoopbackHttpServer {
+public:
+  explicit LoopbackHttpServer(LoopbackHandler handler);
+  ~LoopbackHttpServer();
+
+  uint16_t port() const { return _port; }
+  std::string url(const std::string &path) const;
+  size_t requests() const { return _requests.load(); }
+  size_t connections() const { return _connections.load(); }
+
+private:
+  void acceptLoop();
+  void serve(int fd);
+
+  LoopbackHandler _handler;
+  int _listenFd = -1;
+  uint16_t _port = 0;
+  std::atomic<bool> _stopping{false};
+  std::atomic<size_t> _requests{0};
+  std::atomic<size_t> _connections{0};
+  std::thread _acceptThread;
+  std::mutex _mutex;
+  std::vector<std::thread> _workers;
+  std::vector<int> _clientFds;
+};
+
+#endif // LOOPBACK_SERVER_H
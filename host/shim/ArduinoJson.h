@@ -0,0 +1,8 @@
+#ifndef HOST_ARDUINOJSON_H
+#define HOST_ARDUINOJSON_H
+
+// Used only when the real ArduinoJson was not found: json_filter.cpp is
+// then replaced by a stand-in (see stand_ins.cpp) and the sketch only
+// includes the header.
+
+#endif // HOST_ARDUINOJSON_H
@@ -0,0 +1,85 @@
+#ifndef HOST_ASYNCUDP_H
+#define HOST_ASYNCUDP_H
+
+#include "Arduino.h"
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Datagrams sent back to one sender, in order
+ */
+struct HostUdpReplies {
+  std::mutex mutex;
+  std::condition_variable written;
+  std::vector<std::string> datagrams;
+};
+
+/**
+ * @brief Received datagram
+ *
+ * Copies share the payload like copies of the device packet share the pbuf.
+ * Every write() is one reply datagram, collected in replies() instead of
+ * being sent, so the harness can check what the sender would receive.
+ */
+class AsyncUDPPacket : public Stream {
+public:
+  AsyncUDPPacket(const uint8_t *data, size_t length,
+                 IPAddress remoteIP = IPAddress(127, 0, 0, 1),
+                 uint16_t remotePort = 50000);
+  AsyncUDPPacket(const AsyncUDPPacket &other) = default;
+  ~AsyncUDPPacket() override = default;
+
+  uint8_t *data() { return _payload->data(); }
+  size_t length() { return _payload->size(); }
+  IPAddress remoteIP() { return _remoteIP; }
+  uint16_t remotePort() { return _remotePort; }
+  IPAddress localIP() { return IPAddress(127, 0, 0, 1); }
+  bool isBroadcast() { return false; }
+  bool isMulticast() { return false; }
+
+  size_t write(const uint8_t *data, size_t length) override;
+  size_t write(uint8_t data) override { return write(&data, 1); }
+  using Print::write;
+  int available() override { return _payload->size() - _readPos; }
+  int read() override;
+  int peek() override;
+
+  std::shared_ptr<HostUdpReplies> replies() const { return _replies; }
+
+private:
+  std::shared_ptr<std::vector<uint8_t>> _payload;
+  std::shared_ptr<HostUdpReplies> _replies;
+  IPAddress _remoteIP;
+  uint16_t _remotePort;
+  size_t _readPos = 0;
+};
+
+typedef std::function<void(AsyncUDPPacket &packet)> AuPacketHandlerFunction;
+
+/**
+ * @brief UDP socket, sends for real and receives through hostReceive()
+ */
+class AsyncUDP : public Print {
+public:
+  ~AsyncUDP() override;
+  bool listen(uint16_t port);
+  void onPacket(AuPacketHandlerFunction handler) { _handler = handler; }
+  size_t writeTo(const uint8_t *data, size_t length, const IPAddress &address,
+                 uint16_t port);
+  size_t write(uint8_t data) override { return 0; }
+  bool connected() { return _listening; }
+  void close() { _listening = false; }
+
+  void hostReceive(AsyncUDPPacket &packet);
+
+private:
+  AuPacketHandlerFunction _handler;
+  bool _listening = false;
+  int _fd = -1;
+};
+
+#endif // HOST_ASYNCUDP_H
@@ -0,0 +1,126 @@
+#ifndef HOST_HTTPCLIENT_H
+#define HOST_HTTPCLIENT_H
+
+#include "Arduino.h"
+#include "NetworkClient.h"
+#include <memory>
+#include <vector>
+
+#define HTTPC_ERROR_CONNECTION_REFUSED (-1)
+#define HTTPC_ERROR_SEND_HEADER_FAILED (-2)
+#define HTTPC_ERROR_SEND_PAYLOAD_FAILED (-3)
+#define HTTPC_ERROR_NOT_CONNECTED (-4)
+#define HTTPC_ERROR_CONNECTION_LOST (-5)
+#define HTTPC_ERROR_NO_STREAM (-6)
+#define HTTPC_ERROR_NO_HTTP_SERVER (-7)
+#define HTTPC_ERROR_TOO_LESS_RAM (-8)
+#define HTTPC_ERROR_ENCODING (-9)
+#define HTTPC_ERROR_STREAM_WRITE (-10)
+#define HTTPC_ERROR_READ_TIMEOUT (-11)
+
+/// Default read timeout of the Arduino client
+#define HTTPCLIENT_DEFAULT_TCP_TIMEOUT (5000)
+
+typedef enum {
+  HTTP_CODE_OK = 200,
+  HTTP_CODE_NO_CONTENT = 204,
+  HTTP_CODE_PARTIAL_CONTENT = 206,
+  HTTP_CODE_MOVED_PERMANENTLY = 301,
+  HTTP_CODE_FOUND = 302,
+  HTTP_CODE_NOT_MODIFIED = 304,
+  HTTP_CODE_NOT_FOUND = 404,
+  HTTP_CODE_RANGE_NOT_SATISFIABLE = 416
+} t_http_codes;
+
+typedef enum {
+  HTTPC_TE_IDENTITY,
+  HTTPC_TE_CHUNKED
+} transferEncoding_t;
+
+typedef enum {
+  HTTPC_DISABLE_FOLLOW_REDIRECTS,
+  HTTPC_STRICT_FOLLOW_REDIRECTS,
+  HTTPC_FORCE_FOLLOW_REDIRECTS
+} followRedirects_t;
+
+/**
+ * @brief HTTP/1.1 client with the Arduino-ESP32 interface
+ *
+ * Sends the request, reads the status line and headers and leaves the body
+ * on the connection, exactly what the firmware expects before it reads the
+ * body through getStreamPtr(). Redirects are reported, not followed.
+ */
+class HTTPClient {
+public:
+  HTTPClient() = default;
+  ~HTTPClient();
+
+  bool begin(String url);
+  bool begin(NetworkClient &client, String url);
+  void end();
+  bool connected();
+
+  void setReuse(bool reuse) { _reuse = reuse; }
+  void setFollowRedirects(followRedirects_t follow) { _follow = follow; }
+  void setTimeout(uint16_t timeout_ms) { _tcpTimeout = timeout_ms; }
+  void setConnectTimeout(int32_t timeout_ms) { _connectTimeout = timeout_ms; }
+  void setAcceptEncoding(const String &encoding) { _acceptEncoding = encoding; }
+  void addHeader(const String &name, const String &value, bool first = false,
+                 bool replace = true);
+
+  int GET() { return sendRequest("GET"); }
+  int POST(const String &payload) { return sendRequest("POST", payload); }
+  int POST(uint8_t *payload, size_t size) {
+    return sendRequest("POST", payload, size);
+  }
+  int PUT(const String &payload) { return sendRequest("PUT", payload); }
+  int PATCH(const String &payload) { return sendRequest("PATCH", payload); }
+  int sendRequest(const char *type, String payload = String()) {
+    return sendRequest(type, (uint8_t *)payload.c_str(), payload.length());
+  }
+  int sendRequest(const char *type, uint8_t *payload, size_t size);
+
+  void collectHeaders(const char *headerKeys[], const size_t headerKeysCount);
+  String header(const char *name);
+  String header(size_t index);
+  String headerName(size_t index);
+  int headers() { return _headers.size(); }
+  bool hasHeader(const char *name);
+  String getLocation() { return _location; }
+  int getSize() { return _size; }
+  NetworkClient &getStream() { return *_client; }
+  NetworkClient *getStreamPtr() { return connected() ? _client : nullptr; }
+  static String errorToString(int error);
+
+protected:
+  struct RequestArgument {
+    String key;
+    String value;
+  };
+
+  bool connect();
+  bool readLine(String &line);
+  int handleHeaderResponse();
+  void disconnect();
+
+  NetworkClient *_client = nullptr;
+  std::unique_ptr<NetworkClient> _ownClient;
+  String _host;
+  uint16_t _port = 0;
+  String _uri;
+  bool _secure = false;
+  bool _reuse = true;
+  bool _canReuse = false;
+  uint16_t _tcpTimeout = HTTPCLIENT_DEFAULT_TCP_TIMEOUT;
+  int32_t _connectTimeout = 5000;
+  followRedirects_t _follow = HTTPC_DISABLE_FOLLOW_REDIRECTS;
+  String _acceptEncoding = "identity;q=1,chunked;q=0.1,*;q=0";
+  std::vector<RequestArgument> _requestHeaders;
+  std::vector<RequestArgument> _headers;
+  String _location;
+  int _returnCode = 0;
+  int _size = -1;
+  transferEncoding_t _transferEncoding = HTTPC_TE_IDENTITY;
+};
+
+#endif // HOST_HTTPCLIENT_H
@@ -0,0 +1,81 @@
+#ifndef HOST_HARDWARESERIAL_H
+#define HOST_HARDWARESERIAL_H
+
+#include "Stream.h"
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+
+enum hardwareSerial_error_t {
+  UART_NO_ERROR,
+  UART_BREAK_ERROR,
+  UART_BUFFER_FULL_ERROR,
+  UART_FIFO_OVF_ERROR,
+  UART_FRAME_ERROR,
+  UART_PARITY_ERROR
+};
+
+typedef std::function<void(void)> OnReceiveCb;
+typedef std::function<void(hardwareSerial_error_t)> OnReceiveErrorCb;
+
+/**
+ * @brief UART stand-in
+ *
+ * Bytes written by the firmware are captured (or only counted) instead of
+ * sent, and the harness plays the Flipper side with hostInject(), which
+ * queues the bytes and runs the onReceive() callback like the UART event
+ * task does on the device.
+ */
+class HardwareSerial : public Stream {
+public:
+  void begin(unsigned long baud, uint32_t config = 0, int8_t rxPin = -1,
+             int8_t txPin = -1) {
+    _baud = baud;
+  }
+  void end() {}
+  void updateBaudRate(unsigned long baud) { _baud = baud; }
+  uint32_t baudRate() { return _baud; }
+  size_t setRxBufferSize(size_t size) { return size; }
+  size_t setTxBufferSize(size_t size) { return size; }
+  bool setRxTimeout(uint8_t symbols) { return true; }
+  bool setRxFIFOFull(uint8_t bytes) { return true; }
+  void onReceive(OnReceiveCb callback, bool onlyOnTimeout = false);
+  void onReceiveError(OnReceiveErrorCb callback);
+  operator bool() const { return true; }
+
+  int available() override;
+  int read() override;
+  int peek() override;
+  size_t read(uint8_t *buffer, size_t size);
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t *buffer, size_t size) override;
+  using Print::write;
+  int availableForWrite() override { return 128; }
+  void flush() override {}
+  void flush(bool txOnly) {}
+
+  // Harness side of the line
+  void hostInject(const void *data, size_t length);
+  void hostInject(const char *text) { hostInject(text, strlen(text)); }
+  void hostSetCapture(bool capture);
+  std::string hostTakeOutput();
+  bool hostWaitForOutput(const char *text, uint32_t timeout_ms);
+  uint64_t hostBytesWritten();
+
+private:
+  std::mutex _mutex;
+  std::condition_variable _written;
+  std::deque<uint8_t> _rx;
+  std::string _tx;
+  bool _capture = true;
+  uint64_t _txBytes = 0;
+  unsigned long _baud = 115200;
+  OnReceiveCb _onReceive;
+  OnReceiveErrorCb _onReceiveError;
+};
+
+extern HardwareSerial Serial;
+
+#endif // HOST_HARDWARESERIAL_H
@@ -0,0 +1,27 @@
+#ifndef HOST_IPADDRESS_H
+#define HOST_IPADDRESS_H
+
+#include "Print.h"
+
+/**
+ * @brief IPv4 address, stored in network byte order like on the device
+ */
+class IPAddress : public Printable {
+public:
+  IPAddress() = default;
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d)
+      : _address(a | (b << 8) | (c << 16) | ((uint32_t)d << 24)) {}
+  IPAddress(uint32_t address) : _address(address) {}
+
+  bool fromString(const char *address);
+  bool fromString(const String &address) { return fromString(address.c_str()); }
+  String toString() const;
+  size_t printTo(Print &p) const override { return p.print(toString()); }
+  operator uint32_t() const { return _address; }
+  uint8_t operator[](int index) const { return _address >> (index * 8); }
+
+private:
+  uint32_t _address = 0;
+};
+
+#endif // HOST_IPADDRESS_H
@@ -0,0 +1,21 @@
+#ifndef HOST_LITTLEFS_H
+#define HOST_LITTLEFS_H
+
+#include "FS.h"
+
+/**
+ * @brief LittleFS on a fresh temporary directory per process
+ */
+class LittleFSFS : public fs::FS {
+public:
+  bool begin(bool formatOnFail = false, const char *basePath = "/littlefs",
+             uint8_t maxOpenFiles = 10, const char *partitionLabel = "spiffs");
+  bool format();
+  void end() {}
+  size_t totalBytes() { return 1408 * 1024; }
+  size_t usedBytes();
+};
+
+extern LittleFSFS LittleFS;
+
+#endif // HOST_LITTLEFS_H
@@ -0,0 +1,90 @@
+#ifndef HOST_NETWORKCLIENT_H
+#define HOST_NETWORKCLIENT_H
+
+#include "Arduino.h"
+#include <memory>
+
+class Client : public Stream {
+public:
+  virtual int connect(IPAddress ip, uint16_t port) = 0;
+  virtual int connect(const char *host, uint16_t port) = 0;
+  size_t write(uint8_t c) override = 0;
+  size_t write(const uint8_t *buf, size_t size) override = 0;
+  using Print::write;
+  int available() override = 0;
+  int read() override = 0;
+  virtual int read(uint8_t *buf, size_t size) = 0;
+  int peek() override = 0;
+  void flush() override = 0;
+  virtual void stop() = 0;
+  virtual uint8_t connected() = 0;
+  virtual operator bool() = 0;
+};
+
+struct HostSocket;
+
+/**
+ * @brief TCP client on a POSIX socket
+ *
+ * Copies share the socket like on the device, the socket closes with the
+ * last copy or stop(). Reads go through a receive buffer of one MSS, the
+ * way the Arduino client reads from lwIP.
+ */
+class NetworkClient : public Client {
+public:
+  NetworkClient();
+  explicit NetworkClient(int fd);
+  ~NetworkClient() override;
+
+  int connect(IPAddress ip, uint16_t port) override;
+  virtual int connect(IPAddress ip, uint16_t port, int32_t timeout_ms);
+  int connect(const char *host, uint16_t port) override;
+  virtual int connect(const char *host, uint16_t port, int32_t timeout_ms);
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t *buf, size_t size) override;
+  using Print::write;
+  int available() override;
+  int read() override;
+  int read(uint8_t *buf, size_t size) override;
+  int peek() override;
+  void flush() override {}
+  void stop() override;
+  uint8_t connected() override;
+  operator bool() override { return connected(); }
+
+  int fd() const;
+  int setTimeout(uint32_t seconds);
+  int setNoDelay(bool nodelay);
+  IPAddress remoteIP() const;
+  uint16_t remotePort() const;
+  void clear();
+
+private:
+  std::shared_ptr<HostSocket> _socket;
+};
+
+/**
+ * @brief Listening TCP socket
+ */
+class NetworkServer {
+public:
+  NetworkServer(uint16_t port = 80, uint8_t maxClients = 4)
+      : _port(port), _maxClients(maxClients) {}
+  ~NetworkServer() { end(); }
+
+  void begin(uint16_t port = 0);
+  NetworkClient accept();
+  NetworkClient available() { return accept(); }
+  bool hasClient();
+  void setNoDelay(bool nodelay) { _noDelay = nodelay; }
+  void end();
+  operator bool() const { return _fd >= 0; }
+
+private:
+  uint16_t _port;
+  uint8_t _maxClients;
+  bool _noDelay = false;
+  int _fd = -1;
+};
+
+#endif // HOST_NETWORKCLIENT_H
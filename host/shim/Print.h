@@ -0,0 +1,80 @@
+#ifndef HOST_PRINT_H
+#define HOST_PRINT_H
+
+#include "WString.h"
+#include <stdarg.h>
+#include <string.h>
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+class Print;
+
+/**
+ * @brief Object that knows how to print itself, e.g. IPAddress
+ */
+class Printable {
+public:
+  virtual ~Printable() {}
+  virtual size_t printTo(Print &p) const = 0;
+};
+
+/**
+ * @brief Arduino Print, formats values and hands bytes to write()
+ */
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t *buffer, size_t size);
+  size_t write(const char *str) {
+    return str ? write((const uint8_t *)str, strlen(str)) : 0;
+  }
+  size_t write(const char *buffer, size_t size) {
+    return write((const uint8_t *)buffer, size);
+  }
+  virtual int availableForWrite() { return 0; }
+  virtual void flush() {}
+
+  size_t printf(const char *format, ...)
+      __attribute__((format(printf, 2, 3)));
+
+  size_t print(const String &s) { return write(s.c_str(), s.length()); }
+  size_t print(const char *s) { return write(s); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(unsigned char value, int base = DEC) {
+    return print(String(value, base));
+  }
+  size_t print(int value, int base = DEC) { return print(String(value, base)); }
+  size_t print(unsigned int value, int base = DEC) {
+    return print(String(value, base));
+  }
+  size_t print(long value, int base = DEC) { return print(String(value, base)); }
+  size_t print(unsigned long value, int base = DEC) {
+    return print(String(value, base));
+  }
+  size_t print(long long value, int base = DEC) {
+    return print(String(value, base));
+  }
+  size_t print(unsigned long long value, int base = DEC) {
+    return print(String(value, base));
+  }
+  size_t print(double value, int decimals = 2) {
+    return print(String(value, decimals));
+  }
+  size_t print(const Printable &p) { return p.printTo(*this); }
+
+  size_t println() { return write("\r\n"); }
+  template <typename T> size_t println(const T &value) {
+    size_t n = print(value);
+    return n + println();
+  }
+  template <typename T> size_t println(const T &value, int format) {
+    size_t n = print(value, format);
+    return n + println();
+  }
+};
+
+#endif // HOST_PRINT_H
@@ -0,0 +1,232 @@
+#include "WString.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <strings.h>
+
+static std::string formatUnsigned(unsigned long long value, unsigned char base) {
+  if (base < 2 || base > 36) {
+    base = 10;
+  }
+  char buf[65];
+  size_t pos = sizeof(buf);
+  buf[--pos] = '\0';
+  do {
+    unsigned digit = value % base;
+    buf[--pos] = digit < 10 ? '0' + digit : 'a' + digit - 10;
+    value /= base;
+  } while (value);
+  return std::string(buf + pos);
+}
+
+static std::string formatSigned(long long value, unsigned char base) {
+  if (base == 10 && value < 0) {
+    return "-" + formatUnsigned(0ULL - (unsigned long long)value, base);
+  }
+  return formatUnsigned((unsigned long long)value, base);
+}
+
+static std::string formatDouble(double value, unsigned int decimals) {
+  char buf[64];
+  snprintf(buf, sizeof(buf), "%.*f", decimals, value);
+  return buf;
+}
+
+String::String(unsigned char value, unsigned char base)
+    : _s(formatUnsigned(value, base)) {}
+String::String(int value, unsigned char base)
+    : _s(base == 10 ? formatSigned(value, base)
+                    : formatUnsigned((unsigned int)value, base)) {}
+String::String(unsigned int value, unsigned char base)
+    : _s(formatUnsigned(value, base)) {}
+String::String(long value, unsigned char base)
+    : _s(base == 10 ? formatSigned(value, base)
+                    : formatUnsigned((unsigned long)value, base)) {}
+String::String(unsigned long value, unsigned char base)
+    : _s(formatUnsigned(value, base)) {}
+String::String(long long value, unsigned char base)
+    : _s(formatSigned(value, base)) {}
+String::String(unsigned long long value, unsigned char base)
+    : _s(formatUnsigned(value, base)) {}
+String::String(float value, unsigned int decimals)
+    : _s(formatDouble(value, decimals)) {}
+String::String(double value, unsigned int decimals)
+    : _s(formatDouble(value, decimals)) {}
+
+bool String::equalsIgnoreCase(const String &other) const {
+  return _s.length() == other._s.length() &&
+         strcasecmp(_s.c_str(), other._s.c_str()) == 0;
+}
+
+bool String::startsWith(const String &prefix) const {
+  return startsWith(prefix, 0);
+}
+
+bool String::startsWith(const String &prefix, unsigned int offset) const {
+  return offset <= _s.length() &&
+         _s.compare(offset, prefix._s.length(), prefix._s) == 0;
+}
+
+bool String::endsWith(const String &suffix) const {
+  return suffix._s.length() <= _s.length() &&
+         _s.compare(_s.length() - suffix._s.length(), suffix._s.length(),
+                    suffix._s) == 0;
+}
+
+char &String::operator[](unsigned int index) {
+  static char dummy;
+  if (index >= _s.length()) {
+    dummy = 0;
+    return dummy;
+  }
+  return _s[index];
+}
+
+int String::indexOf(char c, unsigned int from) const {
+  size_t pos = _s.find(c, from);
+  return pos == std::string::npos ? -1 : (int)pos;
+}
+
+int String::indexOf(const String &str, unsigned int from) const {
+  if (from > _s.length()) {
+    return -1;
+  }
+  size_t pos = _s.find(str._s, from);
+  return pos == std::string::npos ? -1 : (int)pos;
+}
+
+int String::lastIndexOf(char c) const {
+  size_t pos = _s.rfind(c);
+  return pos == std::string::npos ? -1 : (int)pos;
+}
+
+int String::lastIndexOf(char c, unsigned int from) const {
+  if (from >= _s.length()) {
+    return -1;
+  }
+  size_t pos = _s.rfind(c, from);
+  return pos == std::string::npos ? -1 : (int)pos;
+}
+
+int String::lastIndexOf(const String &str) const {
+  size_t pos = _s.rfind(str._s);
+  return pos == std::string::npos ? -1 : (int)pos;
+}
+
+String String::substring(unsigned int from, unsigned int to) const {
+  if (from > to) {
+    unsigned int swap = from;
+    from = to;
+    to = swap;
+  }
+  if (from >= _s.length()) {
+    return String();
+  }
+  if (to > _s.length()) {
+    to = _s.length();
+  }
+  return String(_s.data() + from, to - from);
+}
+
+void String::replace(char find, char replacement) {
+  for (char &c : _s) {
+    if (c == find) {
+      c = replacement;
+    }
+  }
+}
+
+void String::replace(const String &find, const String &replacement) {
+  if (find._s.empty()) {
+    return;
+  }
+  size_t pos = 0;
+  while ((pos = _s.find(find._s, pos)) != std::string::npos) {
+    _s.replace(pos, find._s.length(), replacement._s);
+    pos += replacement._s.length();
+  }
+}
+
+void String::remove(unsigned int index, unsigned int count) {
+  if (index < _s.length()) {
+    _s.erase(index, count);
+  }
+}
+
+void String::toLowerCase() {
+  for (char &c : _s) {
+    c = tolower((unsigned char)c);
+  }
+}
+
+void String::toUpperCase() {
+  for (char &c : _s) {
+    c = toupper((unsigned char)c);
+  }
+}
+
+void String::trim() {
+  size_t start = 0;
+  while (start < _s.length() && isspace((unsigned char)_s[start])) {
+    start++;
+  }
+  size_t end = _s.length();
+  while (end > start && isspace((unsigned char)_s[end - 1])) {
+    end--;
+  }
+  _s = _s.substr(start, end - start);
+}
+
+long String::toInt() const { return atol(_s.c_str()); }
+
+float String::toFloat() const { return (float)atof(_s.c_str()); }
+
+double String::toDouble() const { return atof(_s.c_str()); }
+
+String operator+(const String &lhs, const String &rhs) {
+  String result(lhs);
+  result.concat(rhs);
+  return result;
+}
+
+String operator+(const String &lhs, const char *rhs) {
+  String result(lhs);
+  result.concat(rhs);
+  return result;
+}
+
+String operator+(const char *lhs, const String &rhs) {
+  String result(lhs);
+  result.concat(rhs);
+  return result;
+}
+
+String operator+(const String &lhs, char rhs) {
+  String result(lhs);
+  result.concat(rhs);
+  return result;
+}
+
+String operator+(const String &lhs, int rhs) { return lhs + String(rhs); }
+
+String operator+(const String &lhs, unsigned int rhs) {
+  return lhs + String(rhs);
+}
+
+String operator+(const String &lhs, long rhs) { return lhs + String(rhs); }
+
+String operator+(const String &lhs, unsigned long rhs) {
+  return lhs + String(rhs);
+}
+
+String operator+(const String &lhs, long long rhs) {
+  return lhs + String(rhs);
+}
+
+String operator+(const String &lhs, unsigned long long rhs) {
+  return lhs + String(rhs);
+}
+
+String operator+(const String &lhs, float rhs) { return lhs + String(rhs); }
+
+String operator+(const String &lhs, double rhs) { return lhs + String(rhs); }
@@ -0,0 +1,144 @@
+#ifndef HOST_WSTRING_H
+#define HOST_WSTRING_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+/**
+ * @brief Arduino String on top of std::string
+ *
+ * Covers the part of the Arduino API the firmware uses, with the same
+ * out-of-range behaviour: indexOf() returns -1, substring() clamps its
+ * bounds and toInt() returns 0 for text that is not a number.
+ */
+class String {
+public:
+  String(const char *cstr = "") : _s(cstr ? cstr : "") {}
+  String(const char *cstr, unsigned int length) : _s(cstr, length) {}
+  String(const String &other) = default;
+  String(String &&other) = default;
+  explicit String(char c) : _s(1, c) {}
+  explicit String(unsigned char value, unsigned char base = 10);
+  explicit String(int value, unsigned char base = 10);
+  explicit String(unsigned int value, unsigned char base = 10);
+  explicit String(long value, unsigned char base = 10);
+  explicit String(unsigned long value, unsigned char base = 10);
+  explicit String(long long value, unsigned char base = 10);
+  explicit String(unsigned long long value, unsigned char base = 10);
+  explicit String(float value, unsigned int decimals = 2);
+  explicit String(double value, unsigned int decimals = 2);
+
+  String &operator=(const String &other) = default;
+  String &operator=(String &&other) = default;
+  String &operator=(const char *cstr) {
+    _s = cstr ? cstr : "";
+    return *this;
+  }
+
+  bool reserve(unsigned int size) {
+    _s.reserve(size);
+    return true;
+  }
+  unsigned int length() const { return _s.length(); }
+  bool isEmpty() const { return _s.empty(); }
+  const char *c_str() const { return _s.c_str(); }
+  char *begin() { return &_s[0]; }
+  char *end() { return &_s[0] + _s.length(); }
+  const char *begin() const { return _s.data(); }
+  const char *end() const { return _s.data() + _s.length(); }
+
+  bool concat(const String &other) {
+    _s += other._s;
+    return true;
+  }
+  bool concat(const char *cstr, unsigned int length) {
+    _s.append(cstr, length);
+    return true;
+  }
+  bool concat(const char *cstr) {
+    _s += cstr ? cstr : "";
+    return true;
+  }
+  bool concat(char c) {
+    _s += c;
+    return true;
+  }
+  template <typename T> bool concat(T value) { return concat(String(value)); }
+
+  template <typename T> String &operator+=(const T &value) {
+    concat(value);
+    return *this;
+  }
+
+  int compareTo(const String &other) const { return _s.compare(other._s); }
+  bool equals(const String &other) const { return _s == other._s; }
+  bool equals(const char *cstr) const { return _s == (cstr ? cstr : ""); }
+  bool equalsIgnoreCase(const String &other) const;
+  bool startsWith(const String &prefix) const;
+  bool startsWith(const String &prefix, unsigned int offset) const;
+  bool endsWith(const String &suffix) const;
+  bool operator==(const String &other) const { return equals(other); }
+  bool operator==(const char *cstr) const { return equals(cstr); }
+  bool operator!=(const String &other) const { return !equals(other); }
+  bool operator!=(const char *cstr) const { return !equals(cstr); }
+  bool operator<(const String &other) const { return _s < other._s; }
+
+  char charAt(unsigned int index) const { return (*this)[index]; }
+  void setCharAt(unsigned int index, char c) {
+    if (index < _s.length()) {
+      _s[index] = c;
+    }
+  }
+  char operator[](unsigned int index) const {
+    return index < _s.length() ? _s[index] : 0;
+  }
+  char &operator[](unsigned int index);
+
+  int indexOf(char c, unsigned int from = 0) const;
+  int indexOf(const String &str, unsigned int from = 0) const;
+  int lastIndexOf(char c) const;
+  int lastIndexOf(char c, unsigned int from) const;
+  int lastIndexOf(const String &str) const;
+  String substring(unsigned int from) const { return substring(from, length()); }
+  String substring(unsigned int from, unsigned int to) const;
+
+  void replace(char find, char replacement);
+  void replace(const String &find, const String &replacement);
+  void remove(unsigned int index) { remove(index, (unsigned int)-1); }
+  void remove(unsigned int index, unsigned int count);
+  void toLowerCase();
+  void toUpperCase();
+  void trim();
+
+  long toInt() const;
+  float toFloat() const;
+  double toDouble() const;
+
+  /// Arduino Strings are true unless an allocation failed
+  explicit operator bool() const { return true; }
+
+private:
+  std::string _s;
+};
+
+/// Result type of + in the Arduino core, ArduinoJson adapts it like String
+class StringSumHelper : public String {
+public:
+  using String::String;
+};
+
+String operator+(const String &lhs, const String &rhs);
+String operator+(const String &lhs, const char *rhs);
+String operator+(const char *lhs, const String &rhs);
+String operator+(const String &lhs, char rhs);
+String operator+(const String &lhs, int rhs);
+String operator+(const String &lhs, unsigned int rhs);
+String operator+(const String &lhs, long rhs);
+String operator+(const String &lhs, unsigned long rhs);
+String operator+(const String &lhs, long long rhs);
+String operator+(const String &lhs, unsigned long long rhs);
+String operator+(const String &lhs, float rhs);
+String operator+(const String &lhs, double rhs);
+
+#endif // HOST_WSTRING_H
@@ -0,0 +1,49 @@
+#ifndef HOST_WIFI_H
+#define HOST_WIFI_H
+
+#include "Arduino.h"
+#include "NetworkClient.h"
+
+typedef enum {
+  WL_IDLE_STATUS = 0,
+  WL_NO_SSID_AVAIL = 1,
+  WL_CONNECTED = 3,
+  WL_CONNECT_FAILED = 4,
+  WL_DISCONNECTED = 6
+} wl_status_t;
+
+typedef enum { WIFI_OFF = 0, WIFI_STA = 1, WIFI_AP = 2 } wifi_mode_t;
+
+/**
+ * @brief Station stand-in, the host network counts as joined
+ */
+class WiFiClass {
+public:
+  wl_status_t status() { return _status; }
+  bool mode(wifi_mode_t mode) { return true; }
+  wl_status_t begin(const char *ssid, const char *password) {
+    _ssid = ssid;
+    _status = WL_CONNECTED;
+    return _status;
+  }
+  bool disconnect() {
+    _status = WL_DISCONNECTED;
+    return true;
+  }
+  int16_t scanNetworks() { return 1; }
+  String SSID() { return _ssid; }
+  String SSID(uint8_t index) { return "host"; }
+  IPAddress localIP() { return IPAddress(127, 0, 0, 1); }
+  int hostByName(const char *host, IPAddress &address);
+
+private:
+  wl_status_t _status = WL_CONNECTED;
+  String _ssid = "host";
+};
+
+extern WiFiClass WiFi;
+
+typedef NetworkClient WiFiClient;
+typedef NetworkServer WiFiServer;
+
+#endif // HOST_WIFI_H
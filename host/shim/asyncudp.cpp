@@ -0,0 +1,63 @@
+// AsyncUDP stand-in
+
+#include "AsyncUDP.h"
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+AsyncUDPPacket::AsyncUDPPacket(const uint8_t *data, size_t length,
+                               IPAddress remoteIP, uint16_t remotePort)
+    : _payload(std::make_shared<std::vector<uint8_t>>(data, data + length)),
+      _replies(std::make_shared<HostUdpReplies>()), _remoteIP(remoteIP),
+      _remotePort(remotePort) {}
+
+size_t AsyncUDPPacket::write(const uint8_t *data, size_t length) {
+  {
+    std::lock_guard<std::mutex> lock(_replies->mutex);
+    _replies->datagrams.emplace_back((const char *)data, length);
+  }
+  _replies->written.notify_all();
+  return length;
+}
+
+int AsyncUDPPacket::read() {
+  return _readPos < _payload->size() ? (*_payload)[_readPos++] : -1;
+}
+
+int AsyncUDPPacket::peek() {
+  return _readPos < _payload->size() ? (*_payload)[_readPos] : -1;
+}
+
+AsyncUDP::~AsyncUDP() {
+  if (_fd >= 0) {
+    ::close(_fd);
+  }
+}
+
+bool AsyncUDP::listen(uint16_t port) {
+  _listening = true;
+  return true;
+}
+
+size_t AsyncUDP::writeTo(const uint8_t *data, size_t length,
+                         const IPAddress &address, uint16_t port) {
+  if (_fd < 0) {
+    _fd = socket(AF_INET, SOCK_DGRAM, 0);
+  }
+  struct sockaddr_in target = {};
+  target.sin_family = AF_INET;
+  target.sin_addr.s_addr = (uint32_t)address;
+  target.sin_port = htons(port);
+  ssize_t n = sendto(_fd, data, length, 0, (struct sockaddr *)&target,
+                     sizeof(target));
+  return n < 0 ? 0 : n;
+}
+
+/**
+ * @brief Deliver a datagram to the onPacket() handler, as lwIP would
+ */
+void AsyncUDP::hostReceive(AsyncUDPPacket &packet) {
+  if (_listening && _handler) {
+    _handler(packet);
+  }
+}
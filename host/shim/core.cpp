@@ -0,0 +1,201 @@
+// Print, Stream, IPAddress and the UART stand-in
+
+#include "Arduino.h"
+#include <chrono>
+
+size_t Print::write(const uint8_t *buffer, size_t size) {
+  size_t n = 0;
+  while (size--) {
+    if (!write(*buffer++)) {
+      break;
+    }
+    n++;
+  }
+  return n;
+}
+
+size_t Print::printf(const char *format, ...) {
+  char small[128];
+  va_list args;
+  va_start(args, format);
+  int length = vsnprintf(small, sizeof(small), format, args);
+  va_end(args);
+  if (length < 0) {
+    return 0;
+  }
+  if ((size_t)length < sizeof(small)) {
+    return write((const uint8_t *)small, length);
+  }
+  std::string large(length + 1, '\0');
+  va_start(args, format);
+  vsnprintf(&large[0], large.size(), format, args);
+  va_end(args);
+  return write((const uint8_t *)large.data(), length);
+}
+
+int Stream::timedRead() {
+  unsigned long start = millis();
+  do {
+    int c = read();
+    if (c >= 0) {
+      return c;
+    }
+    delay(1);
+  } while (millis() - start < _timeout);
+  return -1;
+}
+
+size_t Stream::readBytes(char *buffer, size_t length) {
+  size_t count = 0;
+  while (count < length) {
+    int c = timedRead();
+    if (c < 0) {
+      break;
+    }
+    buffer[count++] = (char)c;
+  }
+  return count;
+}
+
+String Stream::readString() {
+  String result;
+  int c;
+  while ((c = timedRead()) >= 0) {
+    result += (char)c;
+  }
+  return result;
+}
+
+String Stream::readStringUntil(char terminator) {
+  String result;
+  int c;
+  while ((c = timedRead()) >= 0 && c != terminator) {
+    result += (char)c;
+  }
+  return result;
+}
+
+bool Stream::find(const char *target) {
+  size_t length = strlen(target);
+  size_t matched = 0;
+  int c;
+  while (matched < length && (c = timedRead()) >= 0) {
+    matched = c == target[matched] ? matched + 1 : (c == target[0] ? 1 : 0);
+  }
+  return matched == length;
+}
+
+bool IPAddress::fromString(const char *address) {
+  unsigned a, b, c, d;
+  char extra;
+  if (sscanf(address, "%u.%u.%u.%u%c", &a, &b, &c, &d, &extra) != 4 ||
+      a > 255 || b > 255 || c > 255 || d > 255) {
+    return false;
+  }
+  *this = IPAddress(a, b, c, d);
+  return true;
+}
+
+String IPAddress::toString() const {
+  char buf[16];
+  snprintf(buf, sizeof(buf), "%u.%u.%u.%u", (*this)[0], (*this)[1],
+           (*this)[2], (*this)[3]);
+  return String(buf);
+}
+
+HardwareSerial Serial;
+
+void HardwareSerial::onReceive(OnReceiveCb callback, bool onlyOnTimeout) {
+  std::lock_guard<std::mutex> lock(_mutex);
+  _onReceive = callback;
+}
+
+void HardwareSerial::onReceiveError(OnReceiveErrorCb callback) {
+  std::lock_guard<std::mutex> lock(_mutex);
+  _onReceiveError = callback;
+}
+
+int HardwareSerial::available() {
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _rx.size();
+}
+
+int HardwareSerial::read() {
+  std::lock_guard<std::mutex> lock(_mutex);
+  if (_rx.empty()) {
+    return -1;
+  }
+  uint8_t c = _rx.front();
+  _rx.pop_front();
+  return c;
+}
+
+int HardwareSerial::peek() {
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _rx.empty() ? -1 : _rx.front();
+}
+
+size_t HardwareSerial::read(uint8_t *buffer, size_t size) {
+  std::lock_guard<std::mutex> lock(_mutex);
+  size_t count = min(size, _rx.size());
+  std::copy(_rx.begin(), _rx.begin() + count, buffer);
+  _rx.erase(_rx.begin(), _rx.begin() + count);
+  return count;
+}
+
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size) {
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_capture) {
+      _tx.append((const char *)buffer, size);
+    }
+    _txBytes += size;
+  }
+  _written.notify_all();
+  return size;
+}
+
+/**
+ * @brief Send bytes to the firmware as if the Flipper wrote them
+ *
+ * The receive callback runs on the calling thread, which plays the part
+ * of the UART event task.
+ */
+void HardwareSerial::hostInject(const void *data, size_t length) {
+  OnReceiveCb callback;
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    const uint8_t *bytes = (const uint8_t *)data;
+    _rx.insert(_rx.end(), bytes, bytes + length);
+    callback = _onReceive;
+  }
+  if (callback) {
+    callback();
+  }
+}
+
+void HardwareSerial::hostSetCapture(bool capture) {
+  std::lock_guard<std::mutex> lock(_mutex);
+  _capture = capture;
+}
+
+std::string HardwareSerial::hostTakeOutput() {
+  std::lock_guard<std::mutex> lock(_mutex);
+  // Copy instead of swapping, so _tx keeps its capacity and the writer
+  // task does not allocate for the next command's output
+  std::string output(_tx);
+  _tx.clear();
+  return output;
+}
+
+bool HardwareSerial::hostWaitForOutput(const char *text, uint32_t timeout_ms) {
+  std::unique_lock<std::mutex> lock(_mutex);
+  return _written.wait_for(lock, std::chrono::milliseconds(timeout_ms), [&] {
+    return _tx.find(text) != std::string::npos;
+  });
+}
+
+uint64_t HardwareSerial::hostBytesWritten() {
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _txBytes;
+}
@@ -0,0 +1,39 @@
+#ifndef HOST_ESP_HEAP_CAPS_H
+#define HOST_ESP_HEAP_CAPS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define MALLOC_CAP_8BIT (1 << 2)
+#define MALLOC_CAP_INTERNAL (1 << 11)
+#define MALLOC_CAP_DEFAULT (1 << 12)
+
+typedef struct {
+  size_t total_free_bytes;
+  size_t total_allocated_bytes;
+  size_t largest_free_block;
+  size_t minimum_free_bytes;
+  size_t allocated_blocks;
+  size_t free_blocks;
+  size_t total_blocks;
+} multi_heap_info_t;
+
+void heap_caps_get_info(multi_heap_info_t *info, uint32_t caps);
+size_t heap_caps_get_free_size(uint32_t caps);
+size_t heap_caps_get_largest_free_block(uint32_t caps);
+
+/**
+ * @brief Host heap accounting, every malloc() of the process is counted
+ */
+struct HostHeapCounters {
+  uint64_t allocations; ///< malloc / calloc / realloc calls that allocated
+  int64_t liveBlocks;   ///< Blocks allocated and not yet freed
+};
+
+HostHeapCounters hostHeapCounters();
+uint64_t hostThreadAllocations();
+
+/// Heap figures reported to the firmware, defaults match a busy ESP32-S2
+void hostSetHeap(size_t freeBytes, size_t largestFreeBlock);
+
+#endif // HOST_ESP_HEAP_CAPS_H
@@ -0,0 +1,191 @@
+// Arduino core functions, chip information and heap accounting
+
+#include "Arduino.h"
+#include "esp_heap_caps.h"
+#include "esp_random.h"
+#include "esp_rom_crc.h"
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <zlib.h>
+
+using Clock = std::chrono::steady_clock;
+
+static const Clock::time_point bootTime = Clock::now();
+
+unsigned long millis() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() -
+                                                               bootTime)
+      .count();
+}
+
+// The firmware keeps micros() in 32 bits like on the device
+unsigned long micros() {
+  return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(
+             Clock::now() - bootTime)
+      .count();
+}
+
+void delay(unsigned long ms) {
+  std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void yield() { std::this_thread::yield(); }
+
+static std::mutex randomMutex;
+static std::mt19937 randomEngine{std::random_device{}()};
+
+uint32_t esp_random(void) {
+  std::lock_guard<std::mutex> lock(randomMutex);
+  return randomEngine();
+}
+
+void esp_fill_random(void *buf, size_t length) {
+  uint8_t *bytes = (uint8_t *)buf;
+  for (size_t i = 0; i < length; i++) {
+    bytes[i] = esp_random();
+  }
+}
+
+long random(long max) { return max > 0 ? esp_random() % max : 0; }
+
+long random(long min, long max) {
+  return max > min ? min + random(max - min) : min;
+}
+
+uint32_t esp_rom_crc32_le(uint32_t crc, uint8_t const *buf, uint32_t len) {
+  return crc32(crc, buf, len);
+}
+
+uint32_t getCpuFrequencyMhz() { return 1000; }
+
+EspClass ESP;
+
+uint32_t EspClass::getCycleCount() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() -
+                                                              bootTime)
+      .count();
+}
+
+static std::atomic<size_t> heapFree{150 * 1024};
+static std::atomic<size_t> heapLargestBlock{100 * 1024};
+
+void hostSetHeap(size_t freeBytes, size_t largestFreeBlock) {
+  heapFree = freeBytes;
+  heapLargestBlock = largestFreeBlock;
+}
+
+uint32_t EspClass::getFreeHeap() { return heapFree; }
+
+uint32_t EspClass::getMinFreeHeap() { return heapFree; }
+
+uint32_t EspClass::getMaxAllocHeap() { return heapLargestBlock; }
+
+void EspClass::restart() { exit(0); }
+
+size_t heap_caps_get_free_size(uint32_t caps) { return heapFree; }
+
+size_t heap_caps_get_largest_free_block(uint32_t caps) {
+  return heapLargestBlock;
+}
+
+// --- malloc accounting -----------------------------------------------------
+//
+// glibc lets a program replace malloc() and friends; these forward to the
+// real allocator and count calls, so allocated_blocks behaves like on the
+// device and benchmarks can report allocations per command.
+
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+void *__libc_memalign(size_t alignment, size_t size);
+void __libc_free(void *ptr);
+}
+
+static std::atomic<uint64_t> allocationCount{0};
+static std::atomic<int64_t> liveBlockCount{0};
+static thread_local uint64_t threadAllocationCount
+    __attribute__((tls_model("initial-exec"))) = 0;
+
+static inline void countAllocation() {
+  allocationCount.fetch_add(1, std::memory_order_relaxed);
+  liveBlockCount.fetch_add(1, std::memory_order_relaxed);
+  threadAllocationCount++;
+}
+
+extern "C" void *malloc(size_t size) {
+  void *ptr = __libc_malloc(size);
+  if (ptr) {
+    countAllocation();
+  }
+  return ptr;
+}
+
+extern "C" void *calloc(size_t count, size_t size) {
+  void *ptr = __libc_calloc(count, size);
+  if (ptr) {
+    countAllocation();
+  }
+  return ptr;
+}
+
+extern "C" void *realloc(void *ptr, size_t size) {
+  if (!ptr) {
+    return malloc(size);
+  }
+  if (size == 0) {
+    free(ptr);
+    return nullptr;
+  }
+  void *moved = __libc_realloc(ptr, size);
+  if (moved && moved != ptr) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    threadAllocationCount++;
+  }
+  return moved;
+}
+
+extern "C" int posix_memalign(void **out, size_t alignment, size_t size) {
+  void *ptr = __libc_memalign(alignment, size);
+  if (!ptr) {
+    return ENOMEM;
+  }
+  countAllocation();
+  *out = ptr;
+  return 0;
+}
+
+extern "C" void *aligned_alloc(size_t alignment, size_t size) {
+  void *ptr = __libc_memalign(alignment, size);
+  if (ptr) {
+    countAllocation();
+  }
+  return ptr;
+}
+
+extern "C" void *memalign(size_t alignment, size_t size) {
+  return aligned_alloc(alignment, size);
+}
+
+extern "C" void free(void *ptr) {
+  if (ptr) {
+    liveBlockCount.fetch_sub(1, std::memory_order_relaxed);
+    __libc_free(ptr);
+  }
+}
+
+HostHeapCounters hostHeapCounters() {
+  return {allocationCount.load(), liveBlockCount.load()};
+}
+
+uint64_t hostThreadAllocations() { return threadAllocationCount; }
+
+void heap_caps_get_info(multi_heap_info_t *info, uint32_t caps) {
+  memset(info, 0, sizeof(*info));
+  info->total_free_bytes = heapFree;
+  info->largest_free_block = heapLargestBlock;
+  info->minimum_free_bytes = heapFree;
+  info->allocated_blocks = liveBlockCount.load();
+}
@@ -0,0 +1,355 @@
+// FreeRTOS on std::thread: tasks, notifications, queues, semaphores, timers
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "freertos/timers.h"
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+/**
+ * @brief Wait on a condition with a FreeRTOS tick timeout
+ * @return bool Result of the predicate when the wait ended
+ */
+template <typename Predicate>
+static bool waitTicks(std::condition_variable &cv,
+                      std::unique_lock<std::mutex> &lock, TickType_t ticks,
+                      Predicate ready) {
+  if (ticks == portMAX_DELAY) {
+    cv.wait(lock, ready);
+    return true;
+  }
+  return cv.wait_for(lock, std::chrono::milliseconds(ticks), ready);
+}
+
+static std::recursive_mutex criticalLock;
+
+void hostEnterCritical(portMUX_TYPE *) { criticalLock.lock(); }
+
+void hostExitCritical(portMUX_TYPE *) { criticalLock.unlock(); }
+
+// --- Tasks -----------------------------------------------------------------
+
+struct HostTask {
+  std::string name;
+  std::mutex mutex;
+  std::condition_variable notified;
+  uint32_t notifications = 0;
+};
+
+static thread_local HostTask *currentTask = nullptr;
+
+BaseType_t xTaskCreate(TaskFunction_t function, const char *name,
+                       uint32_t stackDepth, void *parameters,
+                       UBaseType_t priority, TaskHandle_t *createdTask) {
+  HostTask *task = new HostTask();
+  task->name = name ? name : "";
+  if (createdTask) {
+    *createdTask = task;
+  }
+  std::thread([task, function, parameters]() {
+    currentTask = task;
+    function(parameters);
+  }).detach();
+  return pdPASS;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char *name,
+                                   uint32_t stackDepth, void *parameters,
+                                   UBaseType_t priority,
+                                   TaskHandle_t *createdTask, BaseType_t core) {
+  return xTaskCreate(function, name, stackDepth, parameters, priority,
+                     createdTask);
+}
+
+// Every task ends with vTaskDelete(NULL) and returns right after, the
+// thread then exits on its own. The handle stays valid for late notifies.
+void vTaskDelete(TaskHandle_t task) {}
+
+void vTaskDelay(TickType_t ticks) {
+  std::this_thread::sleep_for(std::chrono::milliseconds(ticks));
+}
+
+TickType_t xTaskGetTickCount() {
+  static const Clock::time_point start = Clock::now();
+  return std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() -
+                                                               start)
+      .count();
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+  if (!currentTask) {
+    // Threads not started by xTaskCreate (main, tests) adopt a handle
+    currentTask = new HostTask();
+  }
+  return currentTask;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticksToWait) {
+  HostTask *task = xTaskGetCurrentTaskHandle();
+  std::unique_lock<std::mutex> lock(task->mutex);
+  waitTicks(task->notified, lock, ticksToWait,
+            [task] { return task->notifications > 0; });
+  uint32_t value = task->notifications;
+  if (value > 0) {
+    task->notifications = clearOnExit ? 0 : value - 1;
+  }
+  return value;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+  {
+    std::lock_guard<std::mutex> lock(task->mutex);
+    task->notifications++;
+  }
+  task->notified.notify_one();
+  return pdPASS;
+}
+
+// Host threads have megabytes of stack, report a comfortable margin
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) { return 1024; }
+
+// --- Queues ----------------------------------------------------------------
+
+// Storage is allocated once, like a FreeRTOS queue, so sends and receives
+// never touch the heap the PERF_HEAP counters look at
+struct HostQueue {
+  size_t length;
+  size_t itemSize;
+  std::vector<uint8_t> storage;
+  size_t head = 0;
+  size_t count = 0;
+  std::mutex mutex;
+  std::condition_variable changed;
+};
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize) {
+  HostQueue *queue = new HostQueue();
+  queue->length = length;
+  queue->itemSize = itemSize;
+  queue->storage.resize(length * itemSize);
+  return queue;
+}
+
+void vQueueDelete(QueueHandle_t queue) { delete queue; }
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item,
+                      TickType_t ticksToWait) {
+  std::unique_lock<std::mutex> lock(queue->mutex);
+  if (!waitTicks(queue->changed, lock, ticksToWait,
+                 [queue] { return queue->count < queue->length; })) {
+    return pdFALSE;
+  }
+  size_t tail = (queue->head + queue->count) % queue->length;
+  memcpy(&queue->storage[tail * queue->itemSize], item, queue->itemSize);
+  queue->count++;
+  queue->changed.notify_all();
+  return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item,
+                         TickType_t ticksToWait) {
+  std::unique_lock<std::mutex> lock(queue->mutex);
+  if (!waitTicks(queue->changed, lock, ticksToWait,
+                 [queue] { return queue->count > 0; })) {
+    return pdFALSE;
+  }
+  memcpy(item, &queue->storage[queue->head * queue->itemSize],
+         queue->itemSize);
+  queue->head = (queue->head + 1) % queue->length;
+  queue->count--;
+  queue->changed.notify_all();
+  return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+  std::lock_guard<std::mutex> lock(queue->mutex);
+  return queue->count;
+}
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t queue) {
+  std::lock_guard<std::mutex> lock(queue->mutex);
+  return queue->length - queue->count;
+}
+
+// --- Semaphores ------------------------------------------------------------
+
+struct HostSemaphore {
+  UBaseType_t count;
+  UBaseType_t maxCount;
+  bool recursive = false;
+  std::thread::id owner;
+  UBaseType_t depth = 0;
+  std::mutex mutex;
+  std::condition_variable changed;
+};
+
+static SemaphoreHandle_t createSemaphore(UBaseType_t maxCount,
+                                         UBaseType_t initialCount) {
+  HostSemaphore *semaphore = new HostSemaphore();
+  semaphore->count = initialCount;
+  semaphore->maxCount = maxCount;
+  return semaphore;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex() { return createSemaphore(1, 1); }
+
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex() {
+  SemaphoreHandle_t semaphore = createSemaphore(1, 1);
+  semaphore->recursive = true;
+  return semaphore;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary() { return createSemaphore(1, 0); }
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t maxCount,
+                                           UBaseType_t initialCount) {
+  return createSemaphore(maxCount, initialCount);
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t semaphore) { delete semaphore; }
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticksToWait) {
+  std::unique_lock<std::mutex> lock(semaphore->mutex);
+  if (!waitTicks(semaphore->changed, lock, ticksToWait,
+                 [semaphore] { return semaphore->count > 0; })) {
+    return pdFALSE;
+  }
+  semaphore->count--;
+  return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore) {
+  std::lock_guard<std::mutex> lock(semaphore->mutex);
+  if (semaphore->count >= semaphore->maxCount) {
+    return pdFALSE;
+  }
+  semaphore->count++;
+  semaphore->changed.notify_one();
+  return pdTRUE;
+}
+
+BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t semaphore,
+                                   TickType_t ticksToWait) {
+  std::thread::id self = std::this_thread::get_id();
+  std::unique_lock<std::mutex> lock(semaphore->mutex);
+  if (semaphore->depth > 0 && semaphore->owner == self) {
+    semaphore->depth++;
+    return pdTRUE;
+  }
+  if (!waitTicks(semaphore->changed, lock, ticksToWait,
+                 [semaphore] { return semaphore->depth == 0; })) {
+    return pdFALSE;
+  }
+  semaphore->owner = self;
+  semaphore->depth = 1;
+  return pdTRUE;
+}
+
+BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t semaphore) {
+  std::lock_guard<std::mutex> lock(semaphore->mutex);
+  if (semaphore->depth == 0 ||
+      semaphore->owner != std::this_thread::get_id()) {
+    return pdFALSE;
+  }
+  if (--semaphore->depth == 0) {
+    semaphore->changed.notify_one();
+  }
+  return pdTRUE;
+}
+
+// --- Software timers -------------------------------------------------------
+
+struct HostTimer {
+  TickType_t period;
+  bool autoReload;
+  void *id;
+  TimerCallbackFunction_t callback;
+  bool active = false;
+  Clock::time_point expiry;
+};
+
+static std::mutex timerMutex;
+static std::condition_variable timerChanged;
+static std::vector<HostTimer *> timers;
+
+/**
+ * @brief Timer daemon, runs expired timer callbacks one after another
+ */
+static void timerDaemon() {
+  std::unique_lock<std::mutex> lock(timerMutex);
+  for (;;) {
+    HostTimer *next = nullptr;
+    for (HostTimer *timer : timers) {
+      if (timer->active && (!next || timer->expiry < next->expiry)) {
+        next = timer;
+      }
+    }
+    if (!next) {
+      timerChanged.wait(lock);
+      continue;
+    }
+    if (Clock::now() < next->expiry) {
+      timerChanged.wait_until(lock, next->expiry);
+      continue;
+    }
+    if (next->autoReload) {
+      next->expiry += std::chrono::milliseconds(next->period);
+    } else {
+      next->active = false;
+    }
+    lock.unlock();
+    next->callback(next);
+    lock.lock();
+  }
+}
+
+TimerHandle_t xTimerCreate(const char *name, TickType_t period,
+                           UBaseType_t autoReload, void *timerId,
+                           TimerCallbackFunction_t callback) {
+  static std::once_flag daemonStarted;
+  std::call_once(daemonStarted, [] { std::thread(timerDaemon).detach(); });
+
+  HostTimer *timer = new HostTimer();
+  timer->period = period;
+  timer->autoReload = autoReload;
+  timer->id = timerId;
+  timer->callback = callback;
+  std::lock_guard<std::mutex> lock(timerMutex);
+  timers.push_back(timer);
+  return timer;
+}
+
+BaseType_t xTimerStart(TimerHandle_t timer, TickType_t ticksToWait) {
+  return xTimerReset(timer, ticksToWait);
+}
+
+BaseType_t xTimerStop(TimerHandle_t timer, TickType_t ticksToWait) {
+  std::lock_guard<std::mutex> lock(timerMutex);
+  timer->active = false;
+  timerChanged.notify_all();
+  return pdPASS;
+}
+
+BaseType_t xTimerReset(TimerHandle_t timer, TickType_t ticksToWait) {
+  std::lock_guard<std::mutex> lock(timerMutex);
+  timer->active = true;
+  timer->expiry = Clock::now() + std::chrono::milliseconds(timer->period);
+  timerChanged.notify_all();
+  return pdPASS;
+}
+
+BaseType_t xTimerIsTimerActive(TimerHandle_t timer) {
+  std::lock_guard<std::mutex> lock(timerMutex);
+  return timer->active;
+}
+
+void *pvTimerGetTimerID(TimerHandle_t timer) { return timer->id; }
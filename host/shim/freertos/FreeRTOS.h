@@ -0,0 +1,33 @@
+#ifndef HOST_FREERTOS_H
+#define HOST_FREERTOS_H
+
+#include <stdint.h>
+
+// One tick is one millisecond, as configured for the Arduino core
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+
+#define portMAX_DELAY ((TickType_t)0xffffffffUL)
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS pdTRUE
+#define pdFAIL pdFALSE
+#define tskNO_AFFINITY 0x7fffffff
+
+/// Critical sections share one host lock, they only guard a few stores
+typedef struct {
+  int unused;
+} portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED {0}
+
+void hostEnterCritical(portMUX_TYPE *mux);
+void hostExitCritical(portMUX_TYPE *mux);
+#define taskENTER_CRITICAL(mux) hostEnterCritical(mux)
+#define taskEXIT_CRITICAL(mux) hostExitCritical(mux)
+#define portENTER_CRITICAL(mux) hostEnterCritical(mux)
+#define portEXIT_CRITICAL(mux) hostExitCritical(mux)
+
+#endif // HOST_FREERTOS_H
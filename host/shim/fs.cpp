@@ -0,0 +1,181 @@
+// FS / LittleFS on std::filesystem
+
+#include "LittleFS.h"
+#include <filesystem>
+#include <stdio.h>
+#include <unistd.h>
+#include <vector>
+
+namespace stdfs = std::filesystem;
+
+namespace fs {
+
+struct FileImpl {
+  FILE *file = nullptr;
+  std::string path;
+  std::string name;
+  bool directory = false;
+  std::string hostPath;
+  std::vector<std::string> entries;
+  size_t nextEntry = 0;
+
+  ~FileImpl() {
+    if (file) {
+      fclose(file);
+    }
+  }
+};
+
+size_t File::write(const uint8_t *buf, size_t size) {
+  return _impl && _impl->file ? fwrite(buf, 1, size, _impl->file) : 0;
+}
+
+int File::available() {
+  return _impl && _impl->file ? (int)(size() - position()) : 0;
+}
+
+int File::read() {
+  uint8_t c;
+  return read(&c, 1) == 1 ? c : -1;
+}
+
+size_t File::read(uint8_t *buf, size_t size) {
+  return _impl && _impl->file ? fread(buf, 1, size, _impl->file) : 0;
+}
+
+int File::peek() {
+  if (!_impl || !_impl->file) {
+    return -1;
+  }
+  int c = fgetc(_impl->file);
+  if (c != EOF) {
+    ungetc(c, _impl->file);
+  }
+  return c == EOF ? -1 : c;
+}
+
+void File::flush() {
+  if (_impl && _impl->file) {
+    fflush(_impl->file);
+  }
+}
+
+bool File::seek(uint32_t position) {
+  return _impl && _impl->file && fseek(_impl->file, position, SEEK_SET) == 0;
+}
+
+size_t File::position() const {
+  return _impl && _impl->file ? ftell(_impl->file) : 0;
+}
+
+size_t File::size() const {
+  if (!_impl || !_impl->file) {
+    return 0;
+  }
+  fflush(_impl->file);
+  std::error_code error;
+  uintmax_t length = stdfs::file_size(_impl->hostPath, error);
+  return error ? 0 : length;
+}
+
+void File::close() { _impl.reset(); }
+
+const char *File::path() const { return _impl ? _impl->path.c_str() : ""; }
+
+const char *File::name() const { return _impl ? _impl->name.c_str() : ""; }
+
+bool File::isDirectory() const { return _impl && _impl->directory; }
+
+File File::openNextFile(const char *mode) {
+  if (!_impl || !_impl->directory ||
+      _impl->nextEntry >= _impl->entries.size()) {
+    return File();
+  }
+  std::string path = _impl->path;
+  if (path.empty() || path.back() != '/') {
+    path += '/';
+  }
+  path += _impl->entries[_impl->nextEntry++];
+  return LittleFS.open(path.c_str(), mode);
+}
+
+File FS::open(const char *path, const char *mode, bool create) {
+  auto impl = std::make_shared<FileImpl>();
+  impl->path = path;
+  impl->name = stdfs::path(path).filename().string();
+  impl->hostPath = hostPath(path);
+  std::error_code error;
+  if (stdfs::is_directory(impl->hostPath, error)) {
+    impl->directory = true;
+    for (const auto &entry : stdfs::directory_iterator(impl->hostPath, error)) {
+      impl->entries.push_back(entry.path().filename().string());
+    }
+    return File(impl);
+  }
+  std::string hostMode = mode;
+  if (hostMode.find('b') == std::string::npos) {
+    hostMode += 'b';
+  }
+  impl->file = fopen(impl->hostPath.c_str(), hostMode.c_str());
+  return impl->file ? File(impl) : File();
+}
+
+bool FS::exists(const char *path) {
+  std::error_code error;
+  return stdfs::exists(hostPath(path), error);
+}
+
+bool FS::remove(const char *path) {
+  std::error_code error;
+  return stdfs::remove(hostPath(path), error);
+}
+
+bool FS::rename(const char *from, const char *to) {
+  std::error_code error;
+  stdfs::rename(hostPath(from), hostPath(to), error);
+  return !error;
+}
+
+bool FS::mkdir(const char *path) {
+  std::error_code error;
+  return stdfs::create_directory(hostPath(path), error);
+}
+
+bool FS::rmdir(const char *path) {
+  std::error_code error;
+  return stdfs::remove(hostPath(path), error);
+}
+
+} // namespace fs
+
+LittleFSFS LittleFS;
+
+bool LittleFSFS::begin(bool formatOnFail, const char *basePath,
+                       uint8_t maxOpenFiles, const char *partitionLabel) {
+  if (_root.empty()) {
+    _root = (stdfs::temp_directory_path() /
+             ("postman-littlefs-" + std::to_string(getpid())))
+                .string();
+  }
+  std::error_code error;
+  stdfs::create_directories(_root, error);
+  return !error;
+}
+
+bool LittleFSFS::format() {
+  std::error_code error;
+  stdfs::remove_all(_root, error);
+  return begin();
+}
+
+size_t LittleFSFS::usedBytes() {
+  size_t used = 0;
+  std::error_code error;
+  for (const auto &entry :
+       stdfs::recursive_directory_iterator(_root, error)) {
+    if (entry.is_regular_file(error)) {
+      used += entry.file_size(error);
+    }
+  }
+  return used;
+}
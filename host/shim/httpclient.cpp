@@ -0,0 +1,310 @@
+// HTTPClient on NetworkClient
+
+#include "HTTPClient.h"
+#include <poll.h>
+#include <strings.h>
+
+HTTPClient::~HTTPClient() {
+  if (_client) {
+    _client->stop();
+  }
+}
+
+/**
+ * @brief Split a URL into scheme, host, port and path
+ */
+static bool parseUrl(const String &url, bool &secure, String &host,
+                     uint16_t &port, String &uri) {
+  int schemeEnd = url.indexOf("://");
+  if (schemeEnd < 0) {
+    return false;
+  }
+  String scheme = url.substring(0, schemeEnd);
+  if (scheme == "https") {
+    secure = true;
+    port = 443;
+  } else if (scheme == "http") {
+    secure = false;
+    port = 80;
+  } else {
+    return false;
+  }
+  String rest = url.substring(schemeEnd + 3);
+  int pathStart = rest.indexOf('/');
+  String authority = pathStart < 0 ? rest : rest.substring(0, pathStart);
+  uri = pathStart < 0 ? String("/") : rest.substring(pathStart);
+  int at = authority.indexOf('@');
+  if (at >= 0) {
+    authority = authority.substring(at + 1);
+  }
+  int colon = authority.indexOf(':');
+  if (colon >= 0) {
+    port = authority.substring(colon + 1).toInt();
+    authority = authority.substring(0, colon);
+  }
+  host = authority;
+  return !host.isEmpty();
+}
+
+bool HTTPClient::begin(String url) {
+  if (!parseUrl(url, _secure, _host, _port, _uri)) {
+    return false;
+  }
+  if (!_client) {
+    _ownClient.reset(new NetworkClient());
+    _client = _ownClient.get();
+  }
+  return true;
+}
+
+bool HTTPClient::begin(NetworkClient &client, String url) {
+  if (!parseUrl(url, _secure, _host, _port, _uri)) {
+    return false;
+  }
+  _client = &client;
+  return true;
+}
+
+void HTTPClient::disconnect() {
+  if (!_client) {
+    return;
+  }
+  if (_reuse && _canReuse && _client->connected()) {
+    // Unread body bytes would be taken for the next response
+    _client->clear();
+    return;
+  }
+  _client->stop();
+}
+
+void HTTPClient::end() {
+  disconnect();
+  _headers.clear();
+  _requestHeaders.clear();
+  _location = "";
+  _returnCode = 0;
+  _size = -1;
+  _transferEncoding = HTTPC_TE_IDENTITY;
+}
+
+bool HTTPClient::connected() {
+  return _client && (_client->available() > 0 || _client->connected());
+}
+
+void HTTPClient::addHeader(const String &name, const String &value, bool first,
+                           bool replace) {
+  if (replace) {
+    for (RequestArgument &header : _requestHeaders) {
+      if (header.key.equalsIgnoreCase(name)) {
+        header.value = value;
+        return;
+      }
+    }
+  }
+  RequestArgument header = {name, value};
+  if (first) {
+    _requestHeaders.insert(_requestHeaders.begin(), header);
+  } else {
+    _requestHeaders.push_back(header);
+  }
+}
+
+bool HTTPClient::connect() {
+  if (_client->connected()) {
+    return true;
+  }
+  return _client->connect(_host.c_str(), _port, _connectTimeout);
+}
+
+bool HTTPClient::readLine(String &line) {
+  line = "";
+  uint32_t start = millis();
+  for (;;) {
+    int c = _client->read();
+    if (c >= 0) {
+      if (c == '\n') {
+        if (line.length() && line[line.length() - 1] == '\r') {
+          line.remove(line.length() - 1);
+        }
+        return true;
+      }
+      line += (char)c;
+      continue;
+    }
+    if (!_client->connected()) {
+      return false;
+    }
+    uint32_t elapsed = millis() - start;
+    if (elapsed >= _tcpTimeout) {
+      return false;
+    }
+    struct pollfd pfd = {_client->fd(), POLLIN, 0};
+    poll(&pfd, 1, _tcpTimeout - elapsed);
+  }
+}
+
+int HTTPClient::handleHeaderResponse() {
+  String line;
+  _size = -1;
+  _transferEncoding = HTTPC_TE_IDENTITY;
+  _canReuse = _reuse;
+  for (RequestArgument &header : _headers) {
+    header.value = "";
+  }
+
+  // 1xx interim responses are skipped until the final status line
+  for (;;) {
+    if (!readLine(line)) {
+      return _client->connected() ? HTTPC_ERROR_READ_TIMEOUT
+                                  : HTTPC_ERROR_CONNECTION_LOST;
+    }
+    if (!line.startsWith("HTTP/1.")) {
+      return HTTPC_ERROR_NO_HTTP_SERVER;
+    }
+    _returnCode = line.substring(9, 12).toInt();
+    if (line.startsWith("HTTP/1.0")) {
+      _canReuse = false;
+    }
+    if (_returnCode >= 200) {
+      break;
+    }
+    while (readLine(line) && line.length() > 0) {
+    }
+  }
+
+  while (readLine(line) && line.length() > 0) {
+    int colon = line.indexOf(':');
+    if (colon > 0) {
+      String name = line.substring(0, colon);
+      String value = line.substring(colon + 1);
+      value.trim();
+      if (name.equalsIgnoreCase("Content-Length")) {
+        _size = value.toInt();
+      } else if (name.equalsIgnoreCase("Transfer-Encoding")) {
+        String lower = value;
+        lower.toLowerCase();
+        if (lower.indexOf("chunked") >= 0) {
+          _transferEncoding = HTTPC_TE_CHUNKED;
+        }
+      } else if (name.equalsIgnoreCase("Connection")) {
+        String lower = value;
+        lower.toLowerCase();
+        if (lower.indexOf("close") >= 0) {
+          _canReuse = false;
+        }
+      } else if (name.equalsIgnoreCase("Location")) {
+        _location = value;
+      }
+      for (RequestArgument &header : _headers) {
+        if (header.key.equalsIgnoreCase(name)) {
+          header.value = header.value.isEmpty() ? value
+                                                : header.value + "," + value;
+        }
+      }
+    }
+  }
+  if (_transferEncoding == HTTPC_TE_CHUNKED) {
+    _size = -1;
+  }
+  return _returnCode;
+}
+
+int HTTPClient::sendRequest(const char *type, uint8_t *payload, size_t size) {
+  if (!_client) {
+    return HTTPC_ERROR_NOT_CONNECTED;
+  }
+  if (!connect()) {
+    return HTTPC_ERROR_CONNECTION_REFUSED;
+  }
+
+  String request = String(type) + " " + _uri + " HTTP/1.1\r\nHost: " + _host;
+  if (_port != (_secure ? 443 : 80)) {
+    request += ":" + String(_port);
+  }
+  request += "\r\nUser-Agent: ESP32HTTPClient\r\nConnection: ";
+  request += _reuse ? "keep-alive" : "close";
+  request += "\r\n";
+  if (_reuse) {
+    request += "Keep-Alive: 300\r\n";
+  }
+  request += "Accept-Encoding: " + _acceptEncoding + "\r\n";
+  if (payload && size > 0) {
+    request += "Content-Length: " + String((unsigned int)size) + "\r\n";
+  }
+  for (const RequestArgument &header : _requestHeaders) {
+    request += header.key + ": " + header.value + "\r\n";
+  }
+  request += "\r\n";
+
+  if (_client->write((const uint8_t *)request.c_str(), request.length()) !=
+      request.length()) {
+    return HTTPC_ERROR_SEND_HEADER_FAILED;
+  }
+  if (payload && size > 0 && _client->write(payload, size) != size) {
+    return HTTPC_ERROR_SEND_PAYLOAD_FAILED;
+  }
+  return handleHeaderResponse();
+}
+
+void HTTPClient::collectHeaders(const char *headerKeys[],
+                                const size_t headerKeysCount) {
+  _headers.clear();
+  for (size_t i = 0; i < headerKeysCount; i++) {
+    _headers.push_back({headerKeys[i], ""});
+  }
+}
+
+String HTTPClient::header(const char *name) {
+  for (const RequestArgument &header : _headers) {
+    if (header.key.equalsIgnoreCase(name)) {
+      return header.value;
+    }
+  }
+  return String();
+}
+
+String HTTPClient::header(size_t index) {
+  return index < _headers.size() ? _headers[index].value : String();
+}
+
+String HTTPClient::headerName(size_t index) {
+  return index < _headers.size() ? _headers[index].key : String();
+}
+
+bool HTTPClient::hasHeader(const char *name) {
+  for (const RequestArgument &header : _headers) {
+    if (header.key.equalsIgnoreCase(name) && header.value.length() > 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+String HTTPClient::errorToString(int error) {
+  switch (error) {
+  case HTTPC_ERROR_CONNECTION_REFUSED:
+    return "connection refused";
+  case HTTPC_ERROR_SEND_HEADER_FAILED:
+    return "send header failed";
+  case HTTPC_ERROR_SEND_PAYLOAD_FAILED:
+    return "send payload failed";
+  case HTTPC_ERROR_NOT_CONNECTED:
+    return "not connected";
+  case HTTPC_ERROR_CONNECTION_LOST:
+    return "connection lost";
+  case HTTPC_ERROR_NO_STREAM:
+    return "no stream";
+  case HTTPC_ERROR_NO_HTTP_SERVER:
+    return "no HTTP server";
+  case HTTPC_ERROR_TOO_LESS_RAM:
+    return "too less ram";
+  case HTTPC_ERROR_ENCODING:
+    return "Transfer-Encoding not supported";
+  case HTTPC_ERROR_STREAM_WRITE:
+    return "Stream write error";
+  case HTTPC_ERROR_READ_TIMEOUT:
+    return "read Timeout";
+  default:
+    return String();
+  }
+}
@@ -0,0 +1,104 @@
+// The two mbedTLS helpers the WebSocket handshake needs
+
+#include "mbedtls/base64.h"
+#include "mbedtls/sha1.h"
+#include <stdint.h>
+#include <string.h>
+
+static uint32_t rotateLeft(uint32_t value, int bits) {
+  return (value << bits) | (value >> (32 - bits));
+}
+
+static void sha1Block(uint32_t state[5], const unsigned char block[64]) {
+  uint32_t w[80];
+  for (int i = 0; i < 16; i++) {
+    w[i] = (uint32_t)block[i * 4] << 24 | (uint32_t)block[i * 4 + 1] << 16 |
+           (uint32_t)block[i * 4 + 2] << 8 | block[i * 4 + 3];
+  }
+  for (int i = 16; i < 80; i++) {
+    w[i] = rotateLeft(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+  }
+  uint32_t a = state[0], b = state[1], c = state[2], d = state[3],
+           e = state[4];
+  for (int i = 0; i < 80; i++) {
+    uint32_t f, k;
+    if (i < 20) {
+      f = (b & c) | (~b & d);
+      k = 0x5A827999;
+    } else if (i < 40) {
+      f = b ^ c ^ d;
+      k = 0x6ED9EBA1;
+    } else if (i < 60) {
+      f = (b & c) | (b & d) | (c & d);
+      k = 0x8F1BBCDC;
+    } else {
+      f = b ^ c ^ d;
+      k = 0xCA62C1D6;
+    }
+    uint32_t t = rotateLeft(a, 5) + f + e + k + w[i];
+    e = d;
+    d = c;
+    c = rotateLeft(b, 30);
+    b = a;
+    a = t;
+  }
+  state[0] += a;
+  state[1] += b;
+  state[2] += c;
+  state[3] += d;
+  state[4] += e;
+}
+
+int mbedtls_sha1(const unsigned char *input, size_t ilen,
+                 unsigned char output[20]) {
+  uint32_t state[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476,
+                       0xC3D2E1F0};
+  size_t full = ilen & ~(size_t)63;
+  for (size_t i = 0; i < full; i += 64) {
+    sha1Block(state, input + i);
+  }
+  unsigned char tail[128] = {0};
+  size_t rest = ilen - full;
+  memcpy(tail, input + full, rest);
+  tail[rest] = 0x80;
+  size_t tailLength = rest < 56 ? 64 : 128;
+  uint64_t bits = (uint64_t)ilen * 8;
+  for (int i = 0; i < 8; i++) {
+    tail[tailLength - 1 - i] = bits >> (i * 8);
+  }
+  for (size_t i = 0; i < tailLength; i += 64) {
+    sha1Block(state, tail + i);
+  }
+  for (int i = 0; i < 20; i++) {
+    output[i] = state[i / 4] >> (24 - (i % 4) * 8);
+  }
+  return 0;
+}
+
+int mbedtls_base64_encode(unsigned char *dst, size_t dlen, size_t *olen,
+                          const unsigned char *src, size_t slen) {
+  static const char alphabet[] =
+      "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  size_t needed = (slen + 2) / 3 * 4 + 1;
+  *olen = needed;
+  if (dlen < needed) {
+    return MBEDTLS_ERR_BASE64_BUFFER_TOO_SMALL;
+  }
+  size_t out = 0;
+  for (size_t i = 0; i < slen; i += 3) {
+    uint32_t group = (uint32_t)src[i] << 16;
+    if (i + 1 < slen) {
+      group |= (uint32_t)src[i + 1] << 8;
+    }
+    if (i + 2 < slen) {
+      group |= src[i + 2];
+    }
+    dst[out++] = alphabet[(group >> 18) & 63];
+    dst[out++] = alphabet[(group >> 12) & 63];
+    dst[out++] = i + 1 < slen ? alphabet[(group >> 6) & 63] : '=';
+    dst[out++] = i + 2 < slen ? alphabet[group & 63] : '=';
+  }
+  dst[out] = '\0';
+  *olen = out;
+  return 0;
+}
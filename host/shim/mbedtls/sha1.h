@@ -0,0 +1,9 @@
+#ifndef HOST_MBEDTLS_SHA1_H
+#define HOST_MBEDTLS_SHA1_H
+
+#include <stddef.h>
+
+int mbedtls_sha1(const unsigned char *input, size_t ilen,
+                 unsigned char output[20]);
+
+#endif // HOST_MBEDTLS_SHA1_H
@@ -0,0 +1,57 @@
+// tinfl_decompress() on top of zlib
+
+#include "rom/miniz.h"
+
+static voidpf arenaAlloc(voidpf opaque, uInt items, uInt size) {
+  tinfl_decompressor *r = (tinfl_decompressor *)opaque;
+  size_t bytes = ((size_t)items * size + 15) & ~(size_t)15;
+  if (r->arenaUsed + bytes > sizeof(r->arena)) {
+    return Z_NULL;
+  }
+  void *ptr = r->arena + r->arenaUsed;
+  r->arenaUsed += bytes;
+  return ptr;
+}
+
+static void arenaFree(voidpf opaque, voidpf address) {}
+
+tinfl_status tinfl_decompress(tinfl_decompressor *r,
+                              const mz_uint8 *pIn_buf_next,
+                              size_t *pIn_buf_size, mz_uint8 *pOut_buf_start,
+                              mz_uint8 *pOut_buf_next, size_t *pOut_buf_size,
+                              const mz_uint32 decomp_flags) {
+  if (r->m_state == 0) {
+    r->arenaUsed = 0;
+    r->stream = z_stream();
+    r->stream.zalloc = arenaAlloc;
+    r->stream.zfree = arenaFree;
+    r->stream.opaque = r;
+    int windowBits = (decomp_flags & TINFL_FLAG_PARSE_ZLIB_HEADER) ? 15 : -15;
+    if (inflateInit2(&r->stream, windowBits) != Z_OK) {
+      return TINFL_STATUS_FAILED;
+    }
+    r->m_state = 1;
+  } else if (r->m_state == 2) {
+    *pIn_buf_size = 0;
+    *pOut_buf_size = 0;
+    return TINFL_STATUS_DONE;
+  }
+
+  r->stream.next_in = (Bytef *)pIn_buf_next;
+  r->stream.avail_in = *pIn_buf_size;
+  r->stream.next_out = pOut_buf_next;
+  r->stream.avail_out = *pOut_buf_size;
+  int ret = inflate(&r->stream, Z_NO_FLUSH);
+  *pIn_buf_size -= r->stream.avail_in;
+  *pOut_buf_size -= r->stream.avail_out;
+
+  if (ret == Z_STREAM_END) {
+    r->m_state = 2;
+    return TINFL_STATUS_DONE;
+  }
+  if (ret != Z_OK && ret != Z_BUF_ERROR) {
+    return TINFL_STATUS_FAILED;
+  }
+  return r->stream.avail_out == 0 ? TINFL_STATUS_HAS_MORE_OUTPUT
+                                  : TINFL_STATUS_NEEDS_MORE_INPUT;
+}
@@ -0,0 +1,241 @@
+// NetworkClient / NetworkServer on POSIX sockets
+
+#include "NetworkClient.h"
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+/// Receive buffer size, one TCP segment like the Arduino client
+const size_t HOST_SOCKET_BUFFER = 1436;
+
+struct HostSocket {
+  int fd;
+  uint8_t buffer[HOST_SOCKET_BUFFER];
+  size_t start = 0;
+  size_t end = 0;
+
+  explicit HostSocket(int socket) : fd(socket) {}
+  ~HostSocket() { close(fd); }
+
+  /// Move whatever the kernel has into the buffer without blocking
+  bool fill() {
+    if (start < end) {
+      return true;
+    }
+    ssize_t n = recv(fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+    if (n <= 0) {
+      return false;
+    }
+    start = 0;
+    end = n;
+    return true;
+  }
+};
+
+NetworkClient::NetworkClient() {}
+
+NetworkClient::NetworkClient(int fd) : _socket(std::make_shared<HostSocket>(fd)) {}
+
+NetworkClient::~NetworkClient() {}
+
+int NetworkClient::connect(IPAddress ip, uint16_t port) {
+  return connect(ip, port, 3000);
+}
+
+int NetworkClient::connect(IPAddress ip, uint16_t port, int32_t timeout_ms) {
+  return connect(ip.toString().c_str(), port, timeout_ms);
+}
+
+int NetworkClient::connect(const char *host, uint16_t port) {
+  return connect(host, port, 3000);
+}
+
+int NetworkClient::connect(const char *host, uint16_t port, int32_t timeout_ms) {
+  stop();
+  struct addrinfo hints = {};
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+  struct addrinfo *result;
+  if (getaddrinfo(host, String(port).c_str(), &hints, &result) != 0) {
+    return 0;
+  }
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0) {
+    freeaddrinfo(result);
+    return 0;
+  }
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+  int ret = ::connect(fd, result->ai_addr, result->ai_addrlen);
+  freeaddrinfo(result);
+  if (ret < 0 && errno == EINPROGRESS) {
+    struct pollfd pfd = {fd, POLLOUT, 0};
+    int error = 0;
+    socklen_t length = sizeof(error);
+    if (poll(&pfd, 1, timeout_ms) == 1 &&
+        getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &length) == 0 &&
+        error == 0) {
+      ret = 0;
+    }
+  }
+  if (ret < 0) {
+    close(fd);
+    return 0;
+  }
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+  _socket = std::make_shared<HostSocket>(fd);
+  return 1;
+}
+
+size_t NetworkClient::write(const uint8_t *buf, size_t size) {
+  if (!_socket) {
+    return 0;
+  }
+  size_t sent = 0;
+  while (sent < size) {
+    ssize_t n = send(_socket->fd, buf + sent, size - sent, MSG_NOSIGNAL);
+    if (n <= 0) {
+      break;
+    }
+    sent += n;
+  }
+  return sent;
+}
+
+int NetworkClient::available() {
+  if (!_socket) {
+    return 0;
+  }
+  int pending = 0;
+  ioctl(_socket->fd, FIONREAD, &pending);
+  return (_socket->end - _socket->start) + pending;
+}
+
+int NetworkClient::read() {
+  uint8_t c;
+  return read(&c, 1) == 1 ? c : -1;
+}
+
+int NetworkClient::read(uint8_t *buf, size_t size) {
+  if (!_socket || !_socket->fill()) {
+    return -1;
+  }
+  size_t n = min(size, _socket->end - _socket->start);
+  memcpy(buf, _socket->buffer + _socket->start, n);
+  _socket->start += n;
+  return n;
+}
+
+int NetworkClient::peek() {
+  if (!_socket || !_socket->fill()) {
+    return -1;
+  }
+  return _socket->buffer[_socket->start];
+}
+
+void NetworkClient::stop() { _socket.reset(); }
+
+uint8_t NetworkClient::connected() {
+  if (!_socket) {
+    return 0;
+  }
+  if (_socket->start < _socket->end) {
+    return 1;
+  }
+  uint8_t c;
+  ssize_t n = recv(_socket->fd, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+  if (n > 0 || (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))) {
+    return 1;
+  }
+  return 0;
+}
+
+int NetworkClient::fd() const { return _socket ? _socket->fd : -1; }
+
+int NetworkClient::setTimeout(uint32_t seconds) {
+  Stream::setTimeout(seconds * 1000);
+  return 0;
+}
+
+int NetworkClient::setNoDelay(bool nodelay) {
+  int flag = nodelay;
+  return _socket ? setsockopt(_socket->fd, IPPROTO_TCP, TCP_NODELAY, &flag,
+                              sizeof(flag))
+                 : -1;
+}
+
+IPAddress NetworkClient::remoteIP() const {
+  struct sockaddr_in address = {};
+  socklen_t length = sizeof(address);
+  if (!_socket ||
+      getpeername(_socket->fd, (struct sockaddr *)&address, &length) != 0) {
+    return IPAddress();
+  }
+  return IPAddress(address.sin_addr.s_addr);
+}
+
+uint16_t NetworkClient::remotePort() const {
+  struct sockaddr_in address = {};
+  socklen_t length = sizeof(address);
+  if (!_socket ||
+      getpeername(_socket->fd, (struct sockaddr *)&address, &length) != 0) {
+    return 0;
+  }
+  return ntohs(address.sin_port);
+}
+
+void NetworkClient::clear() {
+  uint8_t discard[256];
+  while (read(discard, sizeof(discard)) > 0) {
+  }
+}
+
+void NetworkServer::begin(uint16_t port) {
+  if (port) {
+    _port = port;
+  }
+  _fd = socket(AF_INET, SOCK_STREAM, 0);
+  int reuse = 1;
+  setsockopt(_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+  struct sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port = htons(_port);
+  if (bind(_fd, (struct sockaddr *)&address, sizeof(address)) != 0 ||
+      listen(_fd, _maxClients) != 0) {
+    close(_fd);
+    _fd = -1;
+    return;
+  }
+  fcntl(_fd, F_SETFL, fcntl(_fd, F_GETFL) | O_NONBLOCK);
+}
+
+NetworkClient NetworkServer::accept() {
+  if (_fd < 0) {
+    return NetworkClient();
+  }
+  int fd = ::accept(_fd, nullptr, nullptr);
+  if (fd < 0) {
+    return NetworkClient();
+  }
+  NetworkClient client(fd);
+  client.setNoDelay(_noDelay);
+  return client;
+}
+
+bool NetworkServer::hasClient() {
+  struct pollfd pfd = {_fd, POLLIN, 0};
+  return _fd >= 0 && poll(&pfd, 1, 0) == 1;
+}
+
+void NetworkServer::end() {
+  if (_fd >= 0) {
+    close(_fd);
+    _fd = -1;
+  }
+}
@@ -0,0 +1,20 @@
+// WiFi stand-in
+
+#include "WiFi.h"
+#include <arpa/inet.h>
+#include <netdb.h>
+
+WiFiClass WiFi;
+
+int WiFiClass::hostByName(const char *host, IPAddress &address) {
+  struct addrinfo hints = {};
+  hints.ai_family = AF_INET;
+  struct addrinfo *result;
+  if (getaddrinfo(host, nullptr, &hints, &result) != 0) {
+    return 0;
+  }
+  address = IPAddress(
+      ((struct sockaddr_in *)result->ai_addr)->sin_addr.s_addr);
+  freeaddrinfo(result);
+  return 1;
+}
@@ -0,0 +1,2 @@
+// The sketch itself, setup() and loop() are driven by the harness
+#include "flipper-postman-esp32s2.ino"
@@ -0,0 +1,91 @@
+/**
+ * @file stand_ins.cpp
+ * @brief Host replacements for the modules that need device-only libraries
+ *
+ * tls_session.cpp needs mbedTLS, json_filter.cpp needs ArduinoJson and
+ * led.cpp drives the LEDC peripheral. On the host the TLS client is a plain
+ * TCP client (the loopback server speaks http) and the LED does nothing.
+ * The real json_filter.cpp is built when ArduinoJson was found, otherwise
+ * JSON filters report that they are unavailable.
+ */
+
+#include "http_utils.h"
+#include "json_filter.h"
+#include "led.h"
+#include "tls_session.h"
+
+TlsSessionClient::TlsSessionClient() {}
+
+TlsSessionClient::~TlsSessionClient() { stop(); }
+
+int TlsSessionClient::connect(IPAddress ip, uint16_t port) {
+  return NetworkClient::connect(ip, port);
+}
+
+int TlsSessionClient::connect(IPAddress ip, uint16_t port, int32_t timeout) {
+  return NetworkClient::connect(ip, port, timeout);
+}
+
+int TlsSessionClient::connect(const char *host, uint16_t port) {
+  return NetworkClient::connect(host, port);
+}
+
+int TlsSessionClient::connect(const char *host, uint16_t port,
+                              int32_t timeout) {
+  return NetworkClient::connect(host, port, timeout);
+}
+
+size_t TlsSessionClient::write(uint8_t data) {
+  return NetworkClient::write(data);
+}
+
+size_t TlsSessionClient::write(const uint8_t *buf, size_t size) {
+  return NetworkClient::write(buf, size);
+}
+
+int TlsSessionClient::available() { return NetworkClient::available(); }
+
+int TlsSessionClient::read() { return NetworkClient::read(); }
+
+int TlsSessionClient::read(uint8_t *buf, size_t size) {
+  return NetworkClient::read(buf, size);
+}
+
+int TlsSessionClient::peek() { return NetworkClient::peek(); }
+
+void TlsSessionClient::flush() { NetworkClient::flush(); }
+
+void TlsSessionClient::stop() { NetworkClient::stop(); }
+
+uint8_t TlsSessionClient::connected() { return NetworkClient::connected(); }
+
+void printTlsStats(AsyncUDPPacket *packet) {
+  printResponse("TLS_SESSIONS: unavailable in the host build", packet);
+}
+
+#ifndef HOST_ARDUINOJSON
+bool isValidJsonFilter(const String &paths) { return false; }
+
+size_t printJsonSelection(HttpBodyReader &body, const String &paths,
+                          bool keyValue, AsyncUDPPacket *packet, Print *copy) {
+  body.abandon();
+  return 0;
+}
+
+size_t printJsonSelection(File &file, const String &paths, bool keyValue,
+                          AsyncUDPPacket *packet) {
+  return 0;
+}
+#endif
+
+void led_init() {}
+
+void led_set(uint8_t red, uint8_t green, uint8_t blue) {}
+
+void led_set_red(uint8_t value) {}
+
+void led_set_green(uint8_t value) {}
+
+void led_set_blue(uint8_t value) {}
+
+void led_error() {}
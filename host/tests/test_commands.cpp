@@ -0,0 +1,317 @@
+// Command framing, dispatch and a plain GET through the UART and UDP paths
+
+#include "harness.h"
+#include "loopback_server.h"
+#include "tcp_server.h"
+#include "version.h"
+#include <arpa/inet.h>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+static void testVersion() {
+  std::string output = harnessCommand("VERSION\n", "VERSION:");
+  CHECK(output.find("VERSION: " + std::string(version)) != std::string::npos);
+}
+
+static void testUnknownCommand() {
+  std::string output = harnessCommand("NO_SUCH_COMMAND\n", "Unknown command");
+  CHECK(!output.empty());
+}
+
+static void testBackToBackCommands() {
+  // Two lines in one receive are two commands, answered in order
+  std::string output =
+      harnessCommand("VERSION\nNO_SUCH_COMMAND\n", "Unknown command");
+  size_t version = output.find("VERSION:");
+  CHECK(version != std::string::npos);
+  CHECK(output.find("Unknown command") > version);
+}
+
+static void testLineWithoutNewline() {
+  // A line without terminator is dispatched once the sender goes quiet
+  std::string output = harnessCommand("VERSION", "VERSION:", 2000);
+  CHECK(!output.empty());
+}
+
+static void testOverlongLine() {
+  std::string line(3000, 'A');
+  std::string output =
+      harnessCommand(line + "\n", "ERROR: Command exceeds 2048 bytes");
+  CHECK(!output.empty());
+  CHECK(!harnessCommand("VERSION\n", "VERSION:").empty());
+}
+
+static void testOverlongUdpCommand() {
+  // Rejected as too long, not reported as a full queue, and counted
+  auto replies = harnessUdp(std::string(3000, 'A'));
+  std::string reply = harnessUdpWait(replies, "ERROR:");
+  CHECK(reply.find("ERROR: Command exceeds 2048 bytes") != std::string::npos);
+  std::string stats = harnessCommand("QUEUE_STATS\n", "QUEUE_COMMANDS:");
+  CHECK(stats.find("too_long=2") != std::string::npos);
+}
+
+static void testGet() {
+  LoopbackHttpServer server(
+      [](const LoopbackRequest &request, LoopbackConnection &connection) {
+        connection.respond(200, "hello " + request.target,
+                           "Cache-Control: no-store\r\n");
+      });
+  std::string output = harnessCommand("GET " + server.url("/get") + "\n",
+                                      "RESPONSE_END");
+  CHECK(output.find("STATUS: 200") != std::string::npos);
+  CHECK(output.find("hello /get") != std::string::npos);
+}
+
+static void testRevalidatedChangeDropsCacheEntry() {
+  // 1: cacheable 200, 2: conditional request answered with an uncacheable
+  // 200, 3: must go out unconditional instead of revalidating a stale body
+  std::vector<std::string> conditions;
+  LoopbackHttpServer server([&conditions](const LoopbackRequest &request,
+                                          LoopbackConnection &connection) {
+    conditions.push_back(request.header("if-none-match"));
+    if (conditions.size() == 1) {
+      connection.respond(200, "first", "ETag: \"v1\"\r\n");
+    } else {
+      connection.respond(200, "second", "Cache-Control: no-store\r\n");
+    }
+  });
+  std::string line = "GET " + server.url("/cached") + "\n";
+  CHECK(harnessCommand(line, "RESPONSE_END").find("first") !=
+        std::string::npos);
+  CHECK(harnessCommand(line, "RESPONSE_END").find("second") !=
+        std::string::npos);
+  CHECK(harnessCommand(line, "RESPONSE_END").find("second") !=
+        std::string::npos);
+  CHECK(conditions.size() == 3);
+  CHECK(conditions[1] == "\"v1\"");
+  CHECK(conditions[2].empty());
+}
+
+static void testGetStream() {
+  std::string body(100000, 'x');
+  LoopbackHttpServer server(
+      [&body](const LoopbackRequest &request, LoopbackConnection &connection) {
+        connection.respond(200, body);
+      });
+  std::string output = harnessCommand(
+      "GET_STREAM " + server.url("/stream") + "\n", "STREAM_END");
+  size_t start = output.find("STREAM: ");
+  size_t end = output.find("\nSTREAM_END");
+  CHECK(start != std::string::npos && end != std::string::npos);
+  CHECK(output.find(body) != std::string::npos);
+}
+
+#ifdef HOST_ARDUINOJSON
+static void testJsonFilterPaths() {
+  CHECK(!harnessCommand("BUILD_HTTP_JSON_FILTER a..b\n",
+                        "HTTP_ERROR: Invalid JSON filter")
+             .empty());
+  CHECK(!harnessCommand("BUILD_HTTP_JSON_FILTER list[\n",
+                        "HTTP_ERROR: Invalid JSON filter")
+             .empty());
+  CHECK(!harnessCommand("BUILD_HTTP_JSON_FILTER name,\n",
+                        "HTTP_ERROR: Invalid JSON filter")
+             .empty());
+  CHECK(!harnessCommand("BUILD_HTTP_JSON_FILTER a.b,[].c\n",
+                        "HTTP_SET_JSON_FILTER: a.b,[].c")
+             .empty());
+}
+
+static void testJsonFilterOutput() {
+  LoopbackHttpServer server(
+      [](const LoopbackRequest &request, LoopbackConnection &connection) {
+        if (request.target == "/text") {
+          connection.respond(200, "not json", "Cache-Control: no-store\r\n");
+          return;
+        }
+        connection.respond(
+            200,
+            "{\"name\":\"Berlin\",\"main\":{\"temp\":12.5,\"humidity\":80},"
+            "\"weather\":[{\"id\":1,\"description\":\"rain\"},"
+            "{\"id\":2,\"description\":\"wind\"}],\"extra\":true}",
+            "Cache-Control: no-store\r\nContent-Type: application/json\r\n");
+      });
+  std::string get = "GET " + server.url("/weather") + "\n";
+  CHECK(!harnessCommand("BUILD_HTTP_JSON_FILTER name,main.temp,"
+                        "weather[].description,missing.field\n",
+                        "HTTP_SET_JSON_FILTER:")
+             .empty());
+
+  // Nested paths and every array element, missing fields are left out
+  std::string output = harnessCommand(get, "RESPONSE_END");
+  CHECK(output.find("{\"name\":\"Berlin\",\"main\":{\"temp\":12.5},"
+                    "\"weather\":[{\"description\":\"rain\"},"
+                    "{\"description\":\"wind\"}]}") != std::string::npos);
+  CHECK(output.find("humidity") == std::string::npos);
+  CHECK(output.find("missing") == std::string::npos);
+
+  CHECK(!harnessCommand("BUILD_HTTP_JSON_FORMAT KEY_VALUE\n",
+                        "HTTP_SET_JSON_FORMAT:")
+             .empty());
+  output = harnessCommand(get, "RESPONSE_END");
+  CHECK(output.find("name=Berlin") != std::string::npos);
+  CHECK(output.find("main.temp=12.5") != std::string::npos);
+  CHECK(output.find("weather[0].description=rain") != std::string::npos);
+  CHECK(output.find("weather[1].description=wind") != std::string::npos);
+  CHECK(output.find("weather[0].id") == std::string::npos);
+  CHECK(output.find("missing") == std::string::npos);
+
+  output = harnessCommand("GET " + server.url("/text") + "\n", "RESPONSE_END");
+  CHECK(output.find("JSON_ERROR: ") != std::string::npos);
+  CHECK(!harnessCommand("RESET_HTTP_CONFIG\n", "HTTP_CONFIG_REST:").empty());
+}
+#endif
+
+static void testStalledAsyncBodyLetsOthersPrint() {
+  std::mutex mutex;
+  std::condition_variable released;
+  bool release = false;
+  LoopbackHttpServer server([&](const LoopbackRequest &request,
+                                LoopbackConnection &connection) {
+    connection.send("HTTP/1.1 200 OK\r\nContent-Length: 8\r\n\r\npart");
+    std::unique_lock<std::mutex> lock(mutex);
+    released.wait_for(lock, std::chrono::seconds(5), [&] { return release; });
+    connection.send("rest");
+  });
+  CHECK(!harnessCommand("ASYNC 7 GET_STREAM " + server.url("/slow") + "\n",
+                        "#7 STREAM:")
+             .empty());
+  // The text body is open but idle, so the reply doesn't wait for it
+  CHECK(!harnessCommand("VERSION\n", "VERSION:", 800).empty());
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    release = true;
+  }
+  released.notify_all();
+  std::string output = harnessCommand("", "STREAM_END", 5000);
+  CHECK(output.find("rest\n#7 STREAM_END") != std::string::npos);
+}
+
+static void testFileStreamErrors() {
+  LoopbackHttpServer server(
+      [](const LoopbackRequest &request, LoopbackConnection &connection) {
+        if (request.target == "/missing") {
+          connection.respond(404, "not here");
+          return;
+        }
+        // Drops the connection halfway, without a validator to resume
+        connection.send("HTTP/1.1 200 OK\r\nContent-Length: 10\r\n\r\n"
+                        "hello");
+        connection.close();
+      });
+  std::string output = harnessCommand(
+      "FILE_STREAM " + server.url("/missing") + "\n", "HTTP_ERROR:");
+  CHECK(output.find("HTTP_ERROR: Unexpected status 404") != std::string::npos);
+  CHECK(output.find("not here") == std::string::npos);
+  output = harnessCommand("FILE_STREAM " + server.url("/cut") + "\n",
+                          "RANGE_ERROR:");
+  CHECK(output.find("hello\nRANGE_ERROR: Connection lost") !=
+        std::string::npos);
+}
+
+static void testFileStreamOverUdp() {
+  LoopbackHttpServer server(
+      [](const LoopbackRequest &request, LoopbackConnection &connection) {
+        connection.respond(200, "file body");
+      });
+  auto replies = harnessUdp("FILE_STREAM " + server.url("/file"));
+  CHECK(!harnessUdpWait(replies, "file body").empty());
+}
+
+static void testBaudFallback() {
+  // Without the echo the board goes back to 115200 by itself
+  CHECK(!harnessCommand("UART_BAUD 230400\n", "UART_BAUD_PROBE:").empty());
+  std::string output = harnessCommand("", "UART_BAUD_FAILED:", 4000);
+  CHECK(output.find("no echo, reverted to 115200") != std::string::npos);
+  output = harnessCommand("UART_STATUS\n", "UART_ERRORS:");
+  CHECK(output.find("baud=115200") != std::string::npos);
+  CHECK(output.find("fallbacks=1") != std::string::npos);
+  // The next negotiation is accepted
+  CHECK(!harnessCommand("UART_BAUD 230400\n", "UART_BAUD_PROBE:").empty());
+  CHECK(!harnessCommand("", "UART_BAUD_FAILED:", 4000).empty());
+}
+
+static void testFlowStallWaitsForReceiver() {
+  CHECK(!harnessCommand("UART_FLOW XONXOFF\n", "UART_FLOW: XONXOFF").empty());
+  // After XOFF the reply is held back, also past the stall timeout
+  CHECK(harnessCommand("\x13VERSION\n", "VERSION:", 6000).empty());
+  // UART_FLOW is applied although the executor waits for the receiver
+  std::string output = harnessCommand("UART_FLOW OFF\n", "UART_FLOW: OFF");
+  CHECK(output.find("VERSION:") != std::string::npos);
+  output = harnessCommand("UART_TX_STATS\n", "UART_TX_STALLS:");
+  CHECK(output.find("flow_timeouts=1") != std::string::npos);
+}
+
+/**
+ * @brief Send lines over a TCP session and read until a marker arrives
+ * @return std::string Everything received, empty if the marker never came
+ */
+static std::string tcpSession(const std::string &lines, const char *marker) {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  struct sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port = htons(TCP_SERVER_PORT);
+  struct timeval timeout = {5, 0};
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  std::string output;
+  if (connect(fd, (struct sockaddr *)&address, sizeof(address)) == 0 &&
+      send(fd, lines.data(), lines.size(), 0) == (ssize_t)lines.size()) {
+    char buf[512];
+    ssize_t n;
+    while (output.find(marker) == std::string::npos &&
+           (n = recv(fd, buf, sizeof(buf), 0)) > 0) {
+      output.append(buf, n);
+    }
+  }
+  close(fd);
+  return output.find(marker) == std::string::npos ? std::string() : output;
+}
+
+static void testTcpSession() {
+  CHECK(!harnessCommand("WIFI_CONNECT host secret\n", "WIFI_SUCCESS:").empty());
+  // Session commands run on the executor, answered on the session in order
+  std::string output = tcpSession("VERSION\nQUEUE_STATS\n", "QUEUE_COMMANDS:");
+  size_t versionLine = output.find("VERSION: " + std::string(version));
+  CHECK(versionLine != std::string::npos);
+  CHECK(output.find("QUEUE_DEPTH:") > versionLine);
+  // Nothing of it reaches the UART
+  CHECK(harnessCommand("", "VERSION:", 200).empty());
+}
+
+static void testUdpCommand() {
+  auto replies = harnessUdp("VERSION");
+  CHECK(harnessUdpWait(replies, "VERSION:").find(version) !=
+        std::string::npos);
+}
+
+int main() {
+  harnessBoot();
+  testVersion();
+  testUnknownCommand();
+  testBackToBackCommands();
+  testLineWithoutNewline();
+  testOverlongLine();
+  testOverlongUdpCommand();
+  testGet();
+  testRevalidatedChangeDropsCacheEntry();
+  testGetStream();
+#ifdef HOST_ARDUINOJSON
+  testJsonFilterPaths();
+  testJsonFilterOutput();
+#else
+  printf("JSON filter tests skipped, ArduinoJson not found\n");
+#endif
+  testStalledAsyncBodyLetsOthersPrint();
+  testFileStreamErrors();
+  testFileStreamOverUdp();
+  testUdpCommand();
+  testTcpSession();
+  testFlowStallWaitsForReceiver();
+  testBaudFallback();
+  return harnessResult();
+}
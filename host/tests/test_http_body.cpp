@@ -0,0 +1,186 @@
+// HttpBodyReader framing against a loopback server: chunked bodies split
+// across segments, chunk extensions, trailers, truncated bodies and
+// responses that have no body, and when compression is offered
+
+#include "harness.h"
+#include "loopback_server.h"
+#include <chrono>
+#include <esp_heap_caps.h>
+#include <vector>
+
+static const char CHUNKED_HEADERS[] =
+    "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n"
+    "Cache-Control: no-store\r\n\r\n";
+
+/**
+ * @brief Run a command and return its output with the time it took
+ */
+static std::string timedCommand(const std::string &line, const char *marker,
+                                uint32_t &elapsed_ms) {
+  auto start = std::chrono::steady_clock::now();
+  std::string output = harnessCommand(line, marker, 10000);
+  elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                   std::chrono::steady_clock::now() - start)
+                   .count();
+  return output;
+}
+
+/**
+ * @brief Body printed between RESPONSE: and RESPONSE_END
+ */
+static std::string callBody(const std::string &output) {
+  size_t start = output.find("RESPONSE:");
+  size_t end = output.find("RESPONSE_END");
+  if (start == std::string::npos || end == std::string::npos) {
+    return "<no response>";
+  }
+  start = output.find_first_not_of("\r\n", start + strlen("RESPONSE:"));
+  std::string body = output.substr(start, end - start);
+  while (!body.empty() && (body.back() == '\n' || body.back() == '\r')) {
+    body.pop_back();
+  }
+  return body;
+}
+
+static void testSplitChunkSizeLines() {
+  // Every line of framing is cut in the middle, the decoder has to carry
+  // its state across reads
+  LoopbackHttpServer server(
+      [](const LoopbackRequest &request, LoopbackConnection &connection) {
+        connection.send(CHUNKED_HEADERS);
+        const char *pieces[] = {"1", "0\r", "\nabcdefgh", "ijklmnop\r",
+                                "\n", "3\r\nxyz", "\r\n0", "\r", "\n\r", "\n"};
+        for (const char *piece : pieces) {
+          connection.pause(5);
+          connection.send(piece);
+        }
+      });
+  std::string output =
+      harnessCommand("GET " + server.url("/split") + "\n", "RESPONSE_END");
+  CHECK(callBody(output) == "abcdefghijklmnopxyz");
+}
+
+static void testChunkExtensions() {
+  LoopbackHttpServer server(
+      [](const LoopbackRequest &request, LoopbackConnection &connection) {
+        connection.send(std::string(CHUNKED_HEADERS) +
+                        "5;name=value\r\nhello\r\n"
+                        "6 ; quoted=\"a;b\"\r\n world\r\n"
+                        "0;last\r\n\r\n");
+      });
+  std::string output =
+      harnessCommand("GET " + server.url("/ext") + "\n", "RESPONSE_END");
+  CHECK(callBody(output) == "hello world");
+}
+
+static void testTrailers() {
+  // The trailers must be consumed exactly, so the connection is reused
+  LoopbackHttpServer server(
+      [](const LoopbackRequest &request, LoopbackConnection &connection) {
+        connection.send(std::string(CHUNKED_HEADERS) +
+                        "5\r\nhello\r\n0\r\n");
+        connection.pause(5);
+        connection.send("X-Checksum: abc\r\nX-Other: 1\r\n\r\n");
+      });
+  std::string line = "GET " + server.url("/trailers") + "\n";
+  uint32_t elapsed;
+  CHECK(callBody(timedCommand(line, "RESPONSE_END", elapsed)) == "hello");
+  CHECK(elapsed < 1000);
+  CHECK(callBody(harnessCommand(line, "RESPONSE_END")) == "hello");
+  CHECK(server.connections() == 1);
+  CHECK(server.requests() == 2);
+}
+
+static void testTruncatedFinalChunk() {
+  // The server dies inside a chunk: the received part is printed, the
+  // command ends and the broken connection is not reused
+  LoopbackHttpServer server(
+      [](const LoopbackRequest &request, LoopbackConnection &connection) {
+        connection.send(std::string(CHUNKED_HEADERS) +
+                        "5\r\nhello\r\n8\r\nwor");
+        connection.close();
+      });
+  std::string line = "GET " + server.url("/truncated") + "\n";
+  uint32_t elapsed;
+  std::string output = timedCommand(line, "RESPONSE_END", elapsed);
+  CHECK(callBody(output) == "hellowor");
+  CHECK(elapsed < 2000);
+  harnessCommand(line, "RESPONSE_END");
+  CHECK(server.connections() == 2);
+}
+
+static void testHeadWithContentLength() {
+  // A HEAD response announces the length of the body it does not send
+  LoopbackHttpServer server(
+      [](const LoopbackRequest &request, LoopbackConnection &connection) {
+        connection.send("HTTP/1.1 200 OK\r\nContent-Length: 100000\r\n\r\n");
+      });
+  harnessCommand("RESET_HTTP_CONFIG\n", "HTTP_CONFIG_REST");
+  harnessCommand("BUILD_HTTP_METHOD HEAD\n", "HTTP_SET_METHOD");
+  harnessCommand("BUILD_HTTP_URL " + server.url("/head") + "\n",
+                 "HTTP_URL");
+  uint32_t elapsed;
+  std::string output =
+      timedCommand("EXECUTE_HTTP_CALL\n", "RESPONSE_END", elapsed);
+  CHECK(output.find("STATUS: 200") != std::string::npos);
+  CHECK(elapsed < 1000);
+  // The connection is clean and goes back to the pool
+  timedCommand("EXECUTE_HTTP_CALL\n", "RESPONSE_END", elapsed);
+  CHECK(elapsed < 1000);
+  CHECK(server.connections() == 1);
+  harnessCommand("RESET_HTTP_CONFIG\n", "HTTP_CONFIG_REST");
+}
+
+static void testStatusWithoutBody(int status) {
+  // Neither 204 nor 304 has a body, even without Content-Length on a
+  // keep-alive connection
+  LoopbackHttpServer server(
+      [status](const LoopbackRequest &request,
+               LoopbackConnection &connection) {
+        connection.send("HTTP/1.1 " + std::to_string(status) +
+                        " Status\r\nETag: \"x\"\r\n\r\n");
+      });
+  uint32_t elapsed;
+  std::string output = timedCommand(
+      "GET_STREAM " + server.url("/empty") + "\n", "STREAM_END", elapsed);
+  CHECK(!output.empty());
+  CHECK(elapsed < 1000);
+}
+
+static void testCompressionNeedsHeap() {
+  // gzip is only offered while an inflater fits the largest free block
+  std::vector<std::string> offered;
+  LoopbackHttpServer server(
+      [&offered](const LoopbackRequest &request,
+                 LoopbackConnection &connection) {
+        offered.push_back(request.header("accept-encoding"));
+        connection.respond(200, "plain");
+      });
+  std::string line = "GET_STREAM " + server.url("/plain") + "\n";
+  CHECK(!harnessCommand("HTTP_COMPRESSION true\n", "HTTP_COMPRESSION:")
+             .empty());
+  hostSetHeap(150 * 1024, 30 * 1024);
+  CHECK(harnessCommand(line, "STREAM_END").find("plain") != std::string::npos);
+  hostSetHeap(150 * 1024, 100 * 1024);
+  CHECK(harnessCommand(line, "STREAM_END").find("plain") != std::string::npos);
+  CHECK(!harnessCommand("HTTP_COMPRESSION false\n", "HTTP_COMPRESSION:")
+             .empty());
+  CHECK(offered.size() == 2);
+  if (offered.size() == 2) {
+    CHECK(offered[0].find("gzip") == std::string::npos);
+    CHECK(offered[1].find("gzip") != std::string::npos);
+  }
+}
+
+int main() {
+  harnessBoot();
+  testSplitChunkSizeLines();
+  testChunkExtensions();
+  testTrailers();
+  testTruncatedFinalChunk();
+  testHeadWithContentLength();
+  testStatusWithoutBody(204);
+  testStatusWithoutBody(304);
+  testCompressionNeedsHeap();
+  return harnessResult();
+}
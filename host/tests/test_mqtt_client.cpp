@@ -0,0 +1,177 @@
+// MQTT client against a loopback broker: packet lengths split across
+// segments, PUBACK for QoS 1 messages and packets above MQTT_MAX_PACKET
+
+#include "harness.h"
+#include "loopback_server.h"
+#include "mqtt_client.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+typedef std::function<void(int, LoopbackConnection &)> BrokerScript;
+
+/**
+ * @brief Broker on 127.0.0.1 that runs a script on its first connection
+ *
+ * MQTT isn't HTTP, so LoopbackHttpServer can't parse it. The script gets
+ * the raw socket for reading and a LoopbackConnection for writing.
+ */
+class LoopbackBroker {
+public:
+  explicit LoopbackBroker(BrokerScript script) {
+    _listenFd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(_listenFd, (struct sockaddr *)&address, sizeof(address));
+    listen(_listenFd, 1);
+    socklen_t length = sizeof(address);
+    getsockname(_listenFd, (struct sockaddr *)&address, &length);
+    _port = ntohs(address.sin_port);
+    _thread = std::thread([this, script] {
+      int fd = accept(_listenFd, nullptr, nullptr);
+      if (fd < 0) {
+        return;
+      }
+      LoopbackConnection connection(fd);
+      script(fd, connection);
+      close(fd);
+    });
+  }
+
+  ~LoopbackBroker() {
+    shutdown(_listenFd, SHUT_RDWR);
+    _thread.join();
+    close(_listenFd);
+  }
+
+  std::string url() const {
+    return "mqtt://127.0.0.1:" + std::to_string(_port);
+  }
+
+private:
+  int _listenFd = -1;
+  uint16_t _port = 0;
+  std::thread _thread;
+};
+
+/**
+ * @brief Read bytes from the client
+ * @return bool False on timeout or when the client went away
+ */
+static bool readBytes(int fd, std::string &packet, size_t count,
+                      uint32_t timeout_ms) {
+  char buf[256];
+  while (count > 0) {
+    struct pollfd pfd = {fd, POLLIN, 0};
+    if (poll(&pfd, 1, timeout_ms) <= 0) {
+      return false;
+    }
+    ssize_t n = recv(fd, buf, count < sizeof(buf) ? count : sizeof(buf), 0);
+    if (n <= 0) {
+      return false;
+    }
+    packet.append(buf, n);
+    count -= n;
+  }
+  return true;
+}
+
+/**
+ * @brief Read one complete control packet
+ * @return std::string Header, remaining length and body, empty on timeout
+ */
+static std::string readPacket(int fd, uint32_t timeout_ms = 2000) {
+  std::string packet;
+  if (!readBytes(fd, packet, 2, timeout_ms)) {
+    return std::string();
+  }
+  size_t length = packet[1] & 0x7F;
+  for (int shift = 7; packet.back() & 0x80; shift += 7) {
+    if (packet.size() == 5 || !readBytes(fd, packet, 1, timeout_ms)) {
+      return std::string();
+    }
+    length |= (size_t)(packet.back() & 0x7F) << shift;
+  }
+  return readBytes(fd, packet, length, timeout_ms) ? packet : std::string();
+}
+
+/**
+ * @brief Accept the CONNECT of the client
+ * @return bool False if the first packet was no CONNECT
+ */
+static bool acceptConnect(int fd, LoopbackConnection &connection) {
+  std::string connect = readPacket(fd);
+  if (connect.empty() || (uint8_t)connect[0] != 0x10) {
+    return false;
+  }
+  return connection.send(std::string("\x20\x02\x00\x00", 4));
+}
+
+static void testSplitLengthAndPuback() {
+  std::string payload(200, 'p');
+  std::string puback;
+  bool connected = false;
+  LoopbackBroker broker([&](int fd, LoopbackConnection &connection) {
+    connected = acceptConnect(fd, connection);
+    // QoS 0 PUBLISH with a two byte remaining length, split between them
+    std::string body = std::string("\x00\x05t/big", 7) + payload;
+    connection.pause(50);
+    connection.send(std::string("\x30", 1) +
+                    (char)((body.size() & 0x7F) | 0x80));
+    connection.pause(50);
+    connection.send(std::string(1, (char)(body.size() >> 7)) +
+                    body.substr(0, 10));
+    connection.pause(50);
+    connection.send(body.substr(10));
+    // Retained QoS 1 PUBLISH with packet identifier 0x1234
+    connection.pause(50);
+    connection.send(std::string("\x33\x0a\x00\x03t/q\x12\x34one", 12));
+    puback = readPacket(fd);
+    connection.pause(100);
+  });
+  std::string output = harnessCommand(
+      "MQTT_CONNECT " + broker.url() + " host-test\n", "MQTT_CLOSED:", 5000);
+  size_t start = output.find("MQTT_CONNECTED: 127.0.0.1:");
+  size_t big = output.find("MQTT_MESSAGE: topic=t/big payload=" + payload +
+                           "\r\n");
+  size_t qos1 =
+      output.find("MQTT_MESSAGE: topic=t/q retained payload=one\r\n");
+  CHECK(start != std::string::npos);
+  CHECK(output.find("client_id=host-test") != std::string::npos);
+  CHECK(big != std::string::npos && big > start);
+  CHECK(qos1 != std::string::npos && qos1 > big);
+  CHECK(output.find("MQTT_CLOSED: reason=connection lost") !=
+        std::string::npos);
+  CHECK(connected);
+  CHECK(puback == std::string("\x40\x02\x12\x34", 4));
+}
+
+static void testOversizePacketCloses() {
+  LoopbackBroker broker([](int fd, LoopbackConnection &connection) {
+    acceptConnect(fd, connection);
+    // Only the header: the length alone ends the connection
+    size_t length = MQTT_MAX_PACKET + 1;
+    connection.pause(50);
+    connection.send(std::string("\x30", 1) + (char)((length & 0x7F) | 0x80) +
+                    (char)(length >> 7));
+    connection.pause(2000);
+  });
+  std::string output = harnessCommand(
+      "MQTT_CONNECT " + broker.url() + "\n", "MQTT_CLOSED:", 5000);
+  CHECK(output.find("MQTT_CONNECTED:") != std::string::npos);
+  CHECK(output.find("MQTT_MESSAGE:") == std::string::npos);
+  CHECK(output.find("MQTT_CLOSED: reason=packet too big") !=
+        std::string::npos);
+  CHECK(!harnessCommand("MQTT_STATUS\n", "MQTT_STATUS: disconnected")
+             .empty());
+}
+
+int main() {
+  harnessBoot();
+  testSplitLengthAndPuback();
+  testOversizePacketCloses();
+  return harnessResult();
+}
@@ -0,0 +1,103 @@
+// Server-Sent Events against a loopback server: line endings split across
+// reads, multi-line data, retry: and Last-Event-ID on reconnect, and events
+// larger than SSE_MAX_EVENT
+
+#include "harness.h"
+#include "loopback_server.h"
+#include "sse_client.h"
+
+/// Response head of an event stream that ends when the connection closes
+static const char *STREAM_HEAD =
+    "HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\n\r\n";
+
+static void testParserAndReconnect() {
+  std::mutex mutex;
+  std::vector<std::string> lastEventIds;
+  LoopbackHttpServer server([&](const LoopbackRequest &request,
+                                LoopbackConnection &connection) {
+    size_t attempt;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      lastEventIds.push_back(request.header("last-event-id"));
+      attempt = lastEventIds.size();
+    }
+    if (attempt > 1) {
+      // No content ends the subscription for good
+      connection.respond(204, "");
+      connection.close();
+      return;
+    }
+    connection.send(STREAM_HEAD);
+    // CRLF split over two reads
+    connection.pause(50);
+    connection.send("data: one\r");
+    connection.pause(50);
+    connection.send("\nid: 7\r\n\r\n");
+    // LF endings and two data lines, split inside a field name
+    connection.pause(50);
+    connection.send("event: tick\ndata: two\nda");
+    connection.pause(50);
+    connection.send("ta: lines\n\n");
+    // CR endings, a comment and a retry: for the reconnect
+    connection.pause(50);
+    connection.send(": keep-alive\rdata: three\r\rretry: 100\r\r");
+    connection.pause(100);
+    connection.close();
+  });
+  std::string output = harnessCommand(
+      "SSE_CONNECT " + server.url("/events") + "\n", "SSE_CLOSED:", 5000);
+  size_t one = output.find("SSE_EVENT: event=message id=7 data=one\r\n");
+  size_t two = output.find("SSE_EVENT: event=tick id=7 data=two\\nlines\r\n");
+  size_t three = output.find("SSE_EVENT: event=message id=7 data=three\r\n");
+  CHECK(one != std::string::npos);
+  CHECK(two != std::string::npos && two > one);
+  CHECK(three != std::string::npos && three > two);
+  CHECK(output.find("keep-alive") == std::string::npos);
+  CHECK(output.find("SSE_RECONNECT: in_ms=100 reason=stream ended") !=
+        std::string::npos);
+  CHECK(output.find("SSE_CLOSED: reason=HTTP 204") != std::string::npos);
+
+  std::lock_guard<std::mutex> lock(mutex);
+  CHECK(lastEventIds.size() == 2);
+  if (lastEventIds.size() == 2) {
+    CHECK(lastEventIds[0].empty());
+    CHECK(lastEventIds[1] == "7");
+  }
+}
+
+static void testOversizeEventIsDropped() {
+  LoopbackHttpServer server([](const LoopbackRequest &request,
+                               LoopbackConnection &connection) {
+    connection.send(STREAM_HEAD);
+    // One data line over the limit, then data lines that only add up to it
+    connection.send("data: " + std::string(SSE_MAX_EVENT + 100, 'x') +
+                    "\n\n");
+    std::string half(SSE_MAX_EVENT / 2, 'y');
+    connection.send("event: big\ndata: " + half + "\ndata: " + half +
+                    "\n\n");
+    connection.send("data: after\n\n");
+    connection.pause(2000);
+    connection.close();
+  });
+  std::string output = harnessCommand(
+      "SSE_CONNECT " + server.url("/events") + "\n", "data=after", 5000);
+  size_t first = output.find(
+      "SSE_DROPPED: event=message reason=larger than " +
+      std::to_string(SSE_MAX_EVENT) + " bytes");
+  size_t second = output.find("SSE_DROPPED: event=big");
+  CHECK(first != std::string::npos);
+  CHECK(second != std::string::npos && second > first);
+  CHECK(output.find("xxxx") == std::string::npos);
+  CHECK(output.find("SSE_EVENT: event=message data=after") !=
+        std::string::npos);
+
+  CHECK(!harnessCommand("SSE_CLOSE\n", "SSE_CLOSED: reason=closed").empty());
+  CHECK(!harnessCommand("SSE_STATUS\n", "SSE_STATUS: disconnected").empty());
+}
+
+int main() {
+  harnessBoot();
+  testParserAndReconnect();
+  testOversizeEventIsDropped();
+  return harnessResult();
+}
@@ -0,0 +1,134 @@
+// Coalesced UDP replies: datagram headers and sequence numbers, replies
+// spanning several datagrams, the flush timer and output for a packet
+// without an open reply
+
+#include "harness.h"
+#include "loopback_server.h"
+#include "udp_reply.h"
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+/**
+ * @brief Wait until a datagram with the last flag arrived
+ * @return std::vector<std::string> Datagrams received so far, empty on timeout
+ */
+static std::vector<std::string>
+waitForLast(const std::shared_ptr<HostUdpReplies> &replies,
+            uint32_t timeout_ms = 5000) {
+  std::unique_lock<std::mutex> lock(replies->mutex);
+  bool last = replies->written.wait_for(
+      lock, std::chrono::milliseconds(timeout_ms), [&replies] {
+        for (const std::string &datagram : replies->datagrams) {
+          if (!datagram.empty() && (datagram[0] & UDP_REPLY_LAST)) {
+            return true;
+          }
+        }
+        return false;
+      });
+  return last ? replies->datagrams : std::vector<std::string>();
+}
+
+/**
+ * @brief Check the headers of one reply and return its payload
+ * @param datagrams Datagrams of the reply, in the order they were sent
+ * @param channel Expected request ID
+ */
+static std::string checkReply(const std::vector<std::string> &datagrams,
+                              uint8_t channel) {
+  std::string payload;
+  CHECK(!datagrams.empty());
+  for (size_t i = 0; i < datagrams.size(); i++) {
+    const std::string &datagram = datagrams[i];
+    CHECK(datagram.size() >= UDP_REPLY_HEADER);
+    CHECK(datagram.size() <= UDP_REPLY_DATAGRAM);
+    if (datagram.size() < UDP_REPLY_HEADER) {
+      continue;
+    }
+    bool last = i + 1 == datagrams.size();
+    CHECK(((uint8_t)datagram[0] & UDP_REPLY_LAST) == (last ? 1 : 0));
+    CHECK((uint8_t)datagram[1] == channel);
+    CHECK(((uint8_t)datagram[2] | (uint8_t)datagram[3] << 8) == (int)i);
+    payload += datagram.substr(UDP_REPLY_HEADER);
+  }
+  return payload;
+}
+
+static void testEnableCoalescing() {
+  // The switch itself is answered in the coalesced format
+  std::vector<std::string> datagrams =
+      waitForLast(harnessUdp("UDP_COALESCE true"));
+  CHECK(checkReply(datagrams, 1) == "UDP_COALESCE: true\n");
+}
+
+static void testReplyOverSeveralDatagrams() {
+  std::vector<std::string> datagrams = waitForLast(harnessUdp("HELP"));
+  std::string payload = checkReply(datagrams, 1);
+  CHECK(datagrams.size() > 1);
+  CHECK(payload.find("VERSION") != std::string::npos);
+  // Only the last datagram may be partly filled
+  for (size_t i = 0; i + 1 < datagrams.size(); i++) {
+    CHECK(datagrams[i].size() == UDP_REPLY_DATAGRAM);
+  }
+}
+
+static void testTimerSendsWaitingOutput() {
+  // The status line goes out while the body is still on its way
+  std::mutex mutex;
+  std::condition_variable released;
+  bool release = false;
+  LoopbackHttpServer server([&](const LoopbackRequest &request,
+                                LoopbackConnection &connection) {
+    connection.send("HTTP/1.1 200 OK\r\nContent-Length: 4\r\n\r\n");
+    std::unique_lock<std::mutex> lock(mutex);
+    released.wait_for(lock, std::chrono::seconds(5), [&] { return release; });
+    connection.send("body");
+  });
+  auto replies = harnessUdp("GET_STREAM " + server.url("/slow"));
+  std::string early = harnessUdpWait(replies, "STATUS: 200", 1000);
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    release = true;
+  }
+  released.notify_all();
+  CHECK(!early.empty());
+
+  std::string payload = checkReply(waitForLast(replies), 1);
+  CHECK(payload.find("STATUS: 200") < payload.find("body"));
+  CHECK(payload.find("STREAM_END") != std::string::npos);
+  std::string stats = checkReply(waitForLast(harnessUdp("UDP_STATS")), 1);
+  CHECK(stats.find("timer_flushes=0") == std::string::npos);
+}
+
+static void testUnbufferedBodyIsOneReply() {
+  // No reply is open on this thread, so the body goes out unbuffered
+  std::string body(2 * (UDP_REPLY_DATAGRAM - UDP_REPLY_HEADER) + 100, 'b');
+  AsyncUDPPacket packet((const uint8_t *)"X", 1);
+  udpReplyBody((const uint8_t *)body.data(), body.size(), &packet);
+  std::vector<std::string> datagrams = waitForLast(packet.replies());
+  CHECK(datagrams.size() == 3);
+  CHECK(checkReply(datagrams, 1) == body);
+}
+
+static void testUnbufferedLine() {
+  AsyncUDPPacket packet((const uint8_t *)"X", 1);
+  udpReplyLine("ASYNC_ERROR: test", &packet);
+  CHECK(checkReply(waitForLast(packet.replies()), 1) ==
+        "ASYNC_ERROR: test\n");
+}
+
+static void testDisableCoalescing() {
+  auto replies = harnessUdp("UDP_COALESCE false");
+  CHECK(checkReply(waitForLast(replies), 1) == "UDP_COALESCE: false\n");
+}
+
+int main() {
+  harnessBoot();
+  testEnableCoalescing();
+  testReplyOverSeveralDatagrams();
+  testTimerSendsWaitingOutput();
+  testUnbufferedBodyIsOneReply();
+  testUnbufferedLine();
+  testDisableCoalescing();
+  return harnessResult();
+}
@@ -0,0 +1,79 @@
+// WebSocket client against a loopback server: upgrade handshake, the
+// receiver task forwarding frames split across segments, the close
+// handshake and one connection at a time
+
+#include "harness.h"
+#include "loopback_server.h"
+#include <mbedtls/base64.h>
+#include <mbedtls/sha1.h>
+
+/**
+ * @brief Accept the upgrade request, as a WebSocket server would
+ */
+static void acceptUpgrade(const LoopbackRequest &request,
+                          LoopbackConnection &connection) {
+  std::string challenge = request.header("sec-websocket-key") +
+                          "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+  unsigned char digest[20];
+  mbedtls_sha1((const unsigned char *)challenge.data(), challenge.size(),
+               digest);
+  unsigned char accept[32];
+  size_t acceptLength = 0;
+  mbedtls_base64_encode(accept, sizeof(accept), &acceptLength, digest,
+                        sizeof(digest));
+  connection.send("HTTP/1.1 101 Switching Protocols\r\n"
+                  "Upgrade: websocket\r\nConnection: Upgrade\r\n"
+                  "Sec-WebSocket-Accept: " +
+                  std::string((const char *)accept, acceptLength) +
+                  "\r\n\r\n");
+}
+
+static void testMessageAndClose() {
+  LoopbackHttpServer server([](const LoopbackRequest &request,
+                               LoopbackConnection &connection) {
+    acceptUpgrade(request, connection);
+    // One text frame in two segments, then a close with code 1000
+    connection.pause(50);
+    connection.send(std::string("\x81\x05hel", 5));
+    connection.pause(50);
+    connection.send("lo");
+    connection.pause(50);
+    connection.send(std::string("\x88\x02\x03\xe8", 4));
+    connection.pause(200);
+    connection.close();
+  });
+  std::string url = server.url("/socket");
+  url.replace(0, 4, "ws");
+  std::string output =
+      harnessCommand("WS_CONNECT " + url + "\n", "WS_CLOSED:", 5000);
+  size_t connected = output.find("WS_CONNECTED:");
+  size_t message = output.find("WS_MESSAGE: hello");
+  CHECK(connected != std::string::npos);
+  CHECK(message != std::string::npos && message > connected);
+  CHECK(output.find("WS_CLOSED: code=1000") != std::string::npos);
+}
+
+static void testOneConnectionAtATime() {
+  LoopbackHttpServer server([](const LoopbackRequest &request,
+                               LoopbackConnection &connection) {
+    acceptUpgrade(request, connection);
+    connection.pause(500);
+    connection.close();
+  });
+  std::string url = server.url("/socket");
+  url.replace(0, 4, "ws");
+  CHECK(!harnessCommand("WS_CONNECT " + url + "\n", "WS_CONNECTED:").empty());
+  CHECK(!harnessCommand("WS_CONNECT " + url + "\n", "WS_ERROR: Already")
+             .empty());
+  // The receiver releases the connection when the server goes away
+  std::string output = harnessCommand("", "WS_CLOSED:", 5000);
+  CHECK(output.find("reason=connection lost") != std::string::npos);
+  CHECK(!harnessCommand("WS_STATUS\n", "WS_STATUS: disconnected").empty());
+}
+
+int main() {
+  harnessBoot();
+  testMessageAndClose();
+  testOneConnectionAtATime();
+  return harnessResult();
+}
@@ -0,0 +1,240 @@
+/**
+ * @file http_body.cpp
+ * @brief Incremental HTTP response body reader
+ *
+ * This file contains the body reader used by the streaming response paths.
+ * It decodes chunked transfer encoding on the fly (chunk-size lines never
+ * reach the output) and reports the exact end of the body, which lets the
+ * connection go back to the keep-alive pool right away. Compressed bodies
+ * are passed through HttpInflater on the way out.
+ */
+
+#include "http_body.h"
+#include "socket_utils.h"
+
+/// Chunk sizes above 2^28 are rejected as malformed
+const uint8_t MAX_CHUNK_SIZE_DIGITS = 7;
+
+/**
+ * @brief Prepare reading the body of a response whose headers were read
+ * @param http Client the request was sent with
+ */
+HttpBodyReader::HttpBodyReader(PooledHTTPClient &http)
+    : _http(http), _stream(http.getStreamPtr()) {
+  if (!http.hasBody()) {
+    _remaining = 0;
+    finish(true);
+  } else if (http.isChunked()) {
+    _state = STATE_SIZE;
+    _remaining = 0;
+  } else {
+    _state = STATE_IDENTITY;
+    _remaining = http.getSize();
+    if (_remaining == 0) {
+      finish(true);
+    }
+  }
+  if (!_stream) {
+    finish(false);
+  }
+
+  if (_state != STATE_DONE && http.acceptsCompressed()) {
+    String encoding = http.header("Content-Encoding");
+    encoding.trim();
+    encoding.toLowerCase();
+    bool gzip = encoding == "gzip" || encoding == "x-gzip";
+    if (gzip || encoding == "deflate") {
+      _inflater = HttpInflater::create(gzip);
+      if (!_inflater) {
+        log_e("Not enough memory to inflate the response");
+        _inflateUnavailable = true;
+        finish(false);
+      }
+    }
+  }
+}
+
+/**
+ * @brief Release the inflater
+ */
+HttpBodyReader::~HttpBodyReader() { delete _inflater; }
+
+/**
+ * @brief Mark the end of the body
+ * @param complete True if the whole body was received
+ */
+void HttpBodyReader::finish(bool complete) {
+  _state = STATE_DONE;
+  _complete = complete;
+  if (!complete) {
+    // Unread or garbled data would corrupt the next request
+    _http.setReuse(false);
+  }
+}
+
+/**
+ * @brief Stop reading, the rest of the body is discarded with the connection
+ */
+void HttpBodyReader::abandon() {
+  if (_state != STATE_DONE) {
+    finish(false);
+  }
+}
+
+/**
+ * @brief Block until the connection has data or closes
+ * @param timeout_ms Maximum time to wait
+ * @return bool False if nothing arrived within the timeout
+ */
+bool HttpBodyReader::waitForData(uint32_t timeout_ms) {
+  return _state == STATE_DONE || waitForClient(*_stream, timeout_ms);
+}
+
+/**
+ * @brief Feed one byte of chunk framing to the decoder
+ * @param c Byte from the connection
+ * @return bool False if the framing is malformed
+ */
+bool HttpBodyReader::parseChunkByte(uint8_t c) {
+  switch (_state) {
+  case STATE_SIZE:
+    if (isxdigit(c)) {
+      if (++_sizeDigits > MAX_CHUNK_SIZE_DIGITS) {
+        return false;
+      }
+      _remaining = _remaining * 16 +
+                   (isdigit(c) ? c - '0' : (tolower(c) - 'a') + 10);
+      return true;
+    }
+    if (c == ';' || c == ' ' || c == '\t') {
+      _state = STATE_EXTENSION;
+      return _sizeDigits > 0;
+    }
+    if (c == '\r') {
+      return _sizeDigits > 0;
+    }
+    if (c != '\n' || _sizeDigits == 0) {
+      return false;
+    }
+    [[fallthrough]]; // end of the size line
+  case STATE_EXTENSION:
+    if (c == '\n') {
+      _sizeDigits = 0;
+      _lineLength = 0;
+      _state = _remaining > 0 ? STATE_DATA : STATE_TRAILER;
+    }
+    return true;
+  case STATE_DATA_END:
+    if (c == '\n') {
+      _remaining = 0;
+      _state = STATE_SIZE;
+    }
+    return c == '\r' || c == '\n';
+  case STATE_TRAILER:
+    if (c == '\n') {
+      if (_lineLength == 0) {
+        finish(true);
+      }
+      _lineLength = 0;
+    } else if (c != '\r') {
+      _lineLength++;
+    }
+    return true;
+  default:
+    return false;
+  }
+}
+
+/**
+ * @brief Read the next part of the body
+ *
+ * Never blocks: returns 0 when no body bytes are available yet. Check
+ * finished() to tell this apart from the end of the body.
+ *
+ * @param buf Destination buffer
+ * @param size Size of the destination buffer
+ * @return int Number of body bytes copied to buf, inflated if compressed
+ */
+int HttpBodyReader::read(uint8_t *buf, size_t size) {
+  if (!_inflater) {
+    return readRaw(buf, size);
+  }
+  while (true) {
+    int c = _inflater->read(buf, size);
+    if (c > 0) {
+      return c;
+    }
+    if (_inflater->failed()) {
+      abandon();
+      return 0;
+    }
+    if (_inflater->finished()) {
+      // Bytes after the compressed stream are dropped with the body
+      while (readRaw(buf, size) > 0) {
+      }
+      return 0;
+    }
+
+    size_t space;
+    uint8_t *input = _inflater->inputSpace(space);
+    int n = space > 0 ? readRaw(input, space) : 0;
+    if (n > 0) {
+      _inflater->inputAdded(n);
+    } else if (_state == STATE_DONE) {
+      _inflater->endOfInput();
+    } else {
+      return 0;
+    }
+  }
+}
+
+/**
+ * @brief Read the next part of the body as sent by the server
+ * @param buf Destination buffer
+ * @param size Size of the destination buffer
+ * @return int Number of body bytes copied to buf
+ */
+int HttpBodyReader::readRaw(uint8_t *buf, size_t size) {
+  while (_state != STATE_DONE) {
+    int available = _stream->available();
+    if (available <= 0) {
+      if (!_http.connected()) {
+        // Without a length the body ends with the connection
+        finish(_state == STATE_IDENTITY && _remaining < 0);
+      }
+      return 0;
+    }
+
+    if (_state == STATE_IDENTITY || _state == STATE_DATA) {
+      size_t chunk = min((size_t)available, size);
+      if (_remaining > 0) {
+        chunk = min(chunk, (size_t)_remaining);
+      }
+      int c = _stream->read(buf, chunk);
+      if (c <= 0) {
+        return 0;
+      }
+      if (_remaining > 0) {
+        _remaining -= c;
+        if (_remaining == 0) {
+          if (_state == STATE_IDENTITY) {
+            finish(true);
+          } else {
+            _state = STATE_DATA_END;
+          }
+        }
+      }
+      return c;
+    }
+
+    int c = _stream->read();
+    if (c < 0) {
+      return 0;
+    }
+    if (!parseChunkByte(c)) {
+      log_e("Malformed chunked response");
+      finish(false);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,67 @@
+#ifndef HTTP_BODY_H
+#define HTTP_BODY_H
+
+#include "http_inflate.h"
+#include "http_pool.h"
+#include <Arduino.h>
+
+/**
+ * @brief Incremental reader for an HTTP response body
+ *
+ * Reads exactly Content-Length bytes, or decodes chunked transfer encoding
+ * and stops at the terminating zero-size chunk, so the end of the body is
+ * known without waiting for the server to close the connection. Only when
+ * neither is available does the body end with the connection. Responses to
+ * HEAD and 204 / 304 responses end with their headers. If the client
+ * offered compression, gzip and deflate bodies are inflated on the fly.
+ */
+class HttpBodyReader {
+public:
+  explicit HttpBodyReader(PooledHTTPClient &http);
+  ~HttpBodyReader();
+  HttpBodyReader(const HttpBodyReader &) = delete;
+  HttpBodyReader &operator=(const HttpBodyReader &) = delete;
+  int read(uint8_t *buf, size_t size);
+  bool waitForData(uint32_t timeout_ms);
+  void abandon();
+
+  /// Body fully read, or the connection failed
+  bool finished() const {
+    return _state == STATE_DONE && (!_inflater || _inflater->finished());
+  }
+
+  /// Whole body received
+  bool complete() const { return finished() && _complete && !decodeFailed(); }
+
+  /// Compressed body could not be inflated
+  bool decodeFailed() const {
+    return _inflateUnavailable || (_inflater && _inflater->failed());
+  }
+
+private:
+  enum State {
+    STATE_IDENTITY,  ///< Plain body, Content-Length or until close
+    STATE_SIZE,      ///< Chunk size digits
+    STATE_EXTENSION, ///< Chunk extension after ';', ignored
+    STATE_DATA,      ///< Chunk payload
+    STATE_DATA_END,  ///< CRLF after the payload
+    STATE_TRAILER,   ///< Trailer lines after the last chunk
+    STATE_DONE       ///< End of body
+  };
+
+  int readRaw(uint8_t *buf, size_t size);
+  bool parseChunkByte(uint8_t c);
+  void finish(bool complete);
+
+  PooledHTTPClient &_http;
+  NetworkClient *_stream;
+  State _state;
+  int _remaining;          ///< Bytes left in the body or current chunk
+  uint8_t _sizeDigits = 0; ///< Hex digits seen in the chunk size
+  size_t _lineLength = 0;  ///< Length of the current trailer line
+  bool _complete = false;
+  HttpInflater *_inflater = nullptr; ///< Set for gzip / deflate bodies
+  bool _inflateUnavailable = false;  ///< No memory for the inflater
+};
+
+#endif // HTTP_BODY_H
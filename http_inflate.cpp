@@ -0,0 +1,260 @@
+/**
+ * @file http_inflate.cpp
+ * @brief Streaming gzip / deflate decoder for HTTP response bodies
+ *
+ * This file contains the decoder for Content-Encoding: gzip and deflate.
+ * The gzip header and trailer are parsed here, the compressed data is
+ * inflated by the ROM tinfl inflater into a 32 KB ring window (the largest
+ * distance a deflate stream may refer back to), and inflated bytes are
+ * handed out straight from that window, so the body is never held whole.
+ */
+
+#include "http_inflate.h"
+#include <esp_rom_crc.h>
+#include <rom/miniz.h>
+
+/// Compressed bytes buffered between the connection and the inflater
+const size_t INFLATE_INPUT_SIZE = 1024;
+
+/// gzip header flags (RFC 1952)
+const uint8_t GZIP_FHCRC = 0x02;
+const uint8_t GZIP_FEXTRA = 0x04;
+const uint8_t GZIP_FNAME = 0x08;
+const uint8_t GZIP_FCOMMENT = 0x10;
+const uint8_t GZIP_FRESERVED = 0xE0;
+
+/**
+ * @struct InflateBuffers
+ * @brief Memory of one decoder, allocated in one piece
+ */
+struct InflateBuffers {
+  tinfl_decompressor decompressor;    ///< ROM inflater state
+  uint8_t window[TINFL_LZ_DICT_SIZE]; ///< Inflated data ring
+  uint8_t input[INFLATE_INPUT_SIZE];  ///< Compressed data not yet inflated
+};
+
+/**
+ * @brief Allocate a decoder
+ * @param gzip True for gzip, false for deflate (zlib wrapped or raw)
+ * @return HttpInflater* Decoder, nullptr if out of memory
+ */
+HttpInflater *HttpInflater::create(bool gzip) {
+  InflateBuffers *buffers = (InflateBuffers *)malloc(sizeof(InflateBuffers));
+  if (!buffers) {
+    return nullptr;
+  }
+  return new HttpInflater(buffers, gzip);
+}
+
+/**
+ * @brief Heap one decoder allocates
+ * @return size_t Size of the block create() asks for
+ */
+size_t HttpInflater::heapNeeded() { return sizeof(InflateBuffers); }
+
+/**
+ * @brief Construct a decoder on allocated buffers
+ * @param buffers Buffers, owned by the decoder
+ * @param gzip True for gzip, false for deflate
+ */
+HttpInflater::HttpInflater(InflateBuffers *buffers, bool gzip)
+    : _buffers(buffers), _stage(gzip ? STAGE_GZIP_HEADER : STAGE_DETECT),
+      _gzip(gzip) {
+  tinfl_init(&_buffers->decompressor);
+}
+
+/**
+ * @brief Free the buffers
+ */
+HttpInflater::~HttpInflater() { free(_buffers); }
+
+/**
+ * @brief Get the free part of the input buffer
+ * @param size Set to the number of bytes that fit
+ * @return uint8_t* Where the next compressed bytes go
+ */
+uint8_t *HttpInflater::inputSpace(size_t &size) {
+  if (_inStart > 0) {
+    memmove(_buffers->input, _buffers->input + _inStart, _inEnd - _inStart);
+    _inEnd -= _inStart;
+    _inStart = 0;
+  }
+  size = INFLATE_INPUT_SIZE - _inEnd;
+  return _buffers->input + _inEnd;
+}
+
+/**
+ * @brief Announce compressed bytes written to inputSpace()
+ * @param length Number of bytes written
+ */
+void HttpInflater::inputAdded(size_t length) { _inEnd += length; }
+
+/**
+ * @brief Announce the end of the body, a stream that is not done is truncated
+ */
+void HttpInflater::endOfInput() {
+  if (_stage != STAGE_DONE) {
+    log_e("Compressed response ended early");
+    _stage = STAGE_FAILED;
+  }
+}
+
+/**
+ * @brief Continue with the next gzip header field present in FLG
+ */
+void HttpInflater::nextHeaderField() {
+  _fieldLength = 0;
+  if (_headerFlags & GZIP_FEXTRA) {
+    _headerFlags &= ~GZIP_FEXTRA;
+    _stage = STAGE_GZIP_EXTRA;
+  } else if (_headerFlags & GZIP_FNAME) {
+    _headerFlags &= ~GZIP_FNAME;
+    _stage = STAGE_GZIP_NAME;
+  } else if (_headerFlags & GZIP_FCOMMENT) {
+    _headerFlags &= ~GZIP_FCOMMENT;
+    _stage = STAGE_GZIP_COMMENT;
+  } else if (_headerFlags & GZIP_FHCRC) {
+    _headerFlags &= ~GZIP_FHCRC;
+    _stage = STAGE_GZIP_HCRC;
+  } else {
+    _stage = STAGE_INFLATE;
+  }
+}
+
+/**
+ * @brief Feed one byte of the gzip header or trailer to the parser
+ * @param c Compressed stream byte
+ * @return bool False if the header or trailer is invalid
+ */
+bool HttpInflater::parseByte(uint8_t c) {
+  switch (_stage) {
+  case STAGE_GZIP_HEADER:
+    _field[_fieldLength++] = c;
+    if (_fieldLength < 10) {
+      return true;
+    }
+    if (_field[0] != 0x1f || _field[1] != 0x8b || _field[2] != 8 ||
+        (_field[3] & GZIP_FRESERVED)) {
+      log_e("Invalid gzip header");
+      return false;
+    }
+    _headerFlags = _field[3];
+    nextHeaderField();
+    return true;
+  case STAGE_GZIP_EXTRA:
+    if (_fieldLength < 2) {
+      _field[_fieldLength++] = c;
+      if (_fieldLength == 2) {
+        _skip = _field[0] | (_field[1] << 8);
+        if (_skip == 0) {
+          nextHeaderField();
+        }
+      }
+    } else if (--_skip == 0) {
+      nextHeaderField();
+    }
+    return true;
+  case STAGE_GZIP_NAME:
+  case STAGE_GZIP_COMMENT:
+    if (c == 0) {
+      nextHeaderField();
+    }
+    return true;
+  case STAGE_GZIP_HCRC:
+    if (++_fieldLength == 2) {
+      nextHeaderField();
+    }
+    return true;
+  case STAGE_GZIP_TRAILER:
+    _field[_fieldLength++] = c;
+    if (_fieldLength == 8) {
+      uint32_t crc = _field[0] | (_field[1] << 8) | (_field[2] << 16) |
+                     ((uint32_t)_field[3] << 24);
+      uint32_t size = _field[4] | (_field[5] << 8) | (_field[6] << 16) |
+                      ((uint32_t)_field[7] << 24);
+      if (crc != _crc || size != _size) {
+        log_e("gzip checksum mismatch");
+        return false;
+      }
+      _stage = STAGE_DONE;
+    }
+    return true;
+  default:
+    return false;
+  }
+}
+
+/**
+ * @brief Inflate buffered input into the free part of the window
+ * @return bool False if no input was consumed and no output produced
+ */
+bool HttpInflater::inflate() {
+  size_t inBytes = _inEnd - _inStart;
+  size_t outBytes = TINFL_LZ_DICT_SIZE - _windowPos;
+  tinfl_status status = tinfl_decompress(
+      &_buffers->decompressor, _buffers->input + _inStart, &inBytes,
+      _buffers->window, _buffers->window + _windowPos, &outBytes,
+      _flags | TINFL_FLAG_HAS_MORE_INPUT);
+  _inStart += inBytes;
+
+  _outStart = _windowPos;
+  _outEnd = _windowPos + outBytes;
+  if (_gzip) {
+    _crc = esp_rom_crc32_le(_crc, _buffers->window + _windowPos, outBytes);
+    _size += outBytes;
+  }
+  _windowPos = (_windowPos + outBytes) & (TINFL_LZ_DICT_SIZE - 1);
+
+  if (status == TINFL_STATUS_DONE) {
+    _fieldLength = 0;
+    _stage = _gzip ? STAGE_GZIP_TRAILER : STAGE_DONE;
+  } else if (status < 0) {
+    log_e("Corrupt compressed response (%d)", status);
+    _stage = STAGE_FAILED;
+  }
+  return inBytes > 0 || outBytes > 0;
+}
+
+/**
+ * @brief Read inflated data
+ *
+ * Returns 0 when more input is needed, check finished() to tell this apart
+ * from the end of the stream.
+ *
+ * @param buf Destination buffer
+ * @param size Size of the destination buffer
+ * @return int Number of inflated bytes copied to buf
+ */
+int HttpInflater::read(uint8_t *buf, size_t size) {
+  size_t copied = 0;
+  while (copied < size) {
+    if (_outStart < _outEnd) {
+      size_t n = min(size - copied, _outEnd - _outStart);
+      memcpy(buf + copied, _buffers->window + _outStart, n);
+      _outStart += n;
+      copied += n;
+      continue;
+    }
+    if (_inStart == _inEnd || _stage == STAGE_DONE || failed()) {
+      break;
+    }
+
+    if (_stage == STAGE_INFLATE) {
+      if (!inflate()) {
+        break;
+      }
+    } else if (_stage == STAGE_DETECT) {
+      // Servers send deflate both zlib wrapped (RFC 1950) and raw
+      if (_inEnd - _inStart < 2) {
+        break;
+      }
+      const uint8_t *in = _buffers->input + _inStart;
+      bool zlib = (in[0] & 0x0F) == 8 && ((in[0] << 8) | in[1]) % 31 == 0;
+      _flags = zlib ? TINFL_FLAG_PARSE_ZLIB_HEADER : 0;
+      _stage = STAGE_INFLATE;
+    } else if (!parseByte(_buffers->input[_inStart++])) {
+      _stage = STAGE_FAILED;
+    }
+  }
+  return copied;
+}
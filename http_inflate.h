@@ -0,0 +1,71 @@
+#ifndef HTTP_INFLATE_H
+#define HTTP_INFLATE_H
+
+#include <Arduino.h>
+
+struct InflateBuffers;
+
+/**
+ * @brief Streaming decoder for gzip and deflate content encoding
+ *
+ * Compressed body bytes are written into inputSpace() and announced with
+ * inputAdded(), read() returns the inflated bytes. Uses the inflater in the
+ * ESP32 ROM, so only the window and input buffers take RAM, and only while
+ * a compressed response is being read.
+ */
+class HttpInflater {
+public:
+  static HttpInflater *create(bool gzip);
+  static size_t heapNeeded();
+  ~HttpInflater();
+
+  uint8_t *inputSpace(size_t &size);
+  void inputAdded(size_t length);
+  void endOfInput();
+  int read(uint8_t *buf, size_t size);
+
+  /// All inflated data read, or the stream is corrupt
+  bool finished() const {
+    return (_stage == STAGE_DONE && _outStart == _outEnd) || failed();
+  }
+
+  /// Stream is corrupt or ended early
+  bool failed() const { return _stage == STAGE_FAILED; }
+
+private:
+  enum Stage {
+    STAGE_GZIP_HEADER,  ///< Fixed 10 byte gzip header
+    STAGE_GZIP_EXTRA,   ///< Optional extra field
+    STAGE_GZIP_NAME,    ///< Optional zero-terminated file name
+    STAGE_GZIP_COMMENT, ///< Optional zero-terminated comment
+    STAGE_GZIP_HCRC,    ///< Optional header CRC
+    STAGE_DETECT,       ///< deflate: zlib wrapped or raw
+    STAGE_INFLATE,      ///< Compressed data
+    STAGE_GZIP_TRAILER, ///< CRC-32 and size of the inflated data
+    STAGE_DONE,         ///< End of the compressed stream
+    STAGE_FAILED        ///< Corrupt or truncated stream
+  };
+
+  explicit HttpInflater(InflateBuffers *buffers, bool gzip);
+  bool parseByte(uint8_t c);
+  void nextHeaderField();
+  bool inflate();
+
+  InflateBuffers *_buffers;
+  Stage _stage;
+  bool _gzip;
+  uint32_t _flags = 0;      ///< tinfl flags of the compressed data
+  uint8_t _headerFlags = 0; ///< gzip FLG fields still to skip
+  uint8_t _field[10];       ///< Bytes of the gzip header or trailer
+  size_t _fieldLength = 0;  ///< Bytes collected in _field
+  size_t _skip = 0;         ///< Extra field bytes left to skip
+  size_t _inStart = 0;      ///< First unconsumed input byte
+  size_t _inEnd = 0;        ///< End of the buffered input
+  size_t _windowPos = 0;    ///< Where the next inflated byte goes
+  size_t _outStart = 0;     ///< First inflated byte not yet read
+  size_t _outEnd = 0;       ///< End of the inflated bytes not yet read
+  uint32_t _crc = 0;        ///< CRC-32 of the inflated data (gzip)
+  uint32_t _size = 0;       ///< Inflated size modulo 2^32 (gzip)
+};
+
+#endif // HTTP_INFLATE_H
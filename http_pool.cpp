@@ -0,0 +1,359 @@
+/**
+ * @file http_pool.cpp
+ * @brief Keep-alive connection pool for HTTP requests
+ *
+ * This file contains a small LRU pool of persistent connections keyed by
+ * scheme, host and port. Requests to a host that was used recently reuse
+ * the open TCP (and TLS) connection instead of connecting and handshaking
+ * again. Idle connections are closed after HTTP_POOL_IDLE_MS. The pool is
+ * shared by the executor and the ASYNC workers, poolMutex guards it.
+ */
+
+#include "http_pool.h"
+#include "http_inflate.h"
+#include "http_utils.h"
+#include "tls_session.h"
+#include <mutex>
+#include <vector>
+
+/// Maximum number of pooled connections, each TLS connection costs ~40 KB
+const size_t HTTP_POOL_SIZE = 2;
+
+/// Idle connections older than this are closed
+const uint32_t HTTP_POOL_IDLE_MS = 30000;
+
+/**
+ * @struct PooledConnection
+ * @brief One persistent connection and the origin it belongs to
+ */
+struct PooledConnection {
+  NetworkClient *client; ///< Connection, TlsSessionClient for https
+  String host;           ///< Host the connection was opened for
+  uint16_t port;         ///< Port the connection was opened for
+  bool secure;           ///< True for https
+  bool inUse;            ///< Borrowed by a PooledHTTPClient
+  uint32_t lastUsed;     ///< millis() when the connection was returned
+};
+
+/**
+ * @struct HttpPoolStats
+ * @brief Pool hit / miss counters
+ */
+struct HttpPoolStats {
+  uint32_t hits;      ///< Requests sent on an already open connection
+  uint32_t misses;    ///< Requests that had to connect first
+  uint32_t evictions; ///< Connections closed for idleness or LRU
+  uint32_t bypassed;  ///< Requests made outside the pool (pool exhausted)
+};
+
+static PooledConnection pool[HTTP_POOL_SIZE];
+static HttpPoolStats poolStats;
+static std::mutex poolMutex;
+
+/**
+ * @brief Split the origin out of a URL
+ * @param url URL starting with http:// or https://
+ * @param host Host name
+ * @param port Explicit port or the scheme default
+ * @param secure True for https
+ * @return bool False if the URL has no http(s) scheme or host
+ */
+static bool parseOrigin(const String &url, String &host, uint16_t &port,
+                        bool &secure) {
+  int hostStart;
+  if (url.startsWith("https://")) {
+    secure = true;
+    port = 443;
+    hostStart = 8;
+  } else if (url.startsWith("http://")) {
+    secure = false;
+    port = 80;
+    hostStart = 7;
+  } else {
+    return false;
+  }
+
+  int hostEnd = hostStart;
+  while (hostEnd < (int)url.length() && url[hostEnd] != '/' &&
+         url[hostEnd] != '?' && url[hostEnd] != '#') {
+    hostEnd++;
+  }
+  host = url.substring(hostStart, hostEnd);
+  int portIndex = host.indexOf(':');
+  if (portIndex != -1) {
+    port = host.substring(portIndex + 1).toInt();
+    host = host.substring(0, portIndex);
+  }
+  return !host.isEmpty();
+}
+
+/**
+ * @brief Close and free a pooled connection
+ * @param connection Connection to close
+ */
+static void closeConnection(PooledConnection &connection) {
+  if (connection.client) {
+    connection.client->stop();
+    delete connection.client;
+    connection.client = nullptr;
+  }
+  connection.host = "";
+}
+
+/**
+ * @brief Close idle connections that timed out or were closed by the server
+ *
+ * Caller holds poolMutex.
+ */
+static void evictIdleLocked() {
+  uint32_t now = millis();
+  for (PooledConnection &connection : pool) {
+    if (connection.client && !connection.inUse &&
+        (now - connection.lastUsed > HTTP_POOL_IDLE_MS ||
+         !connection.client->connected())) {
+      closeConnection(connection);
+      poolStats.evictions++;
+    }
+  }
+}
+
+/**
+ * @brief Close idle connections that timed out or were closed by the server
+ */
+void httpPoolEvictIdle() {
+  std::lock_guard<std::mutex> lock(poolMutex);
+  evictIdleLocked();
+}
+
+/**
+ * @brief Create a connection for the given scheme
+ * @param secure True for https
+ * @return NetworkClient* New unconnected client
+ */
+static NetworkClient *createClient(bool secure) {
+  if (secure) {
+    return new TlsSessionClient();
+  }
+  return new NetworkClient();
+}
+
+/**
+ * @brief Reserve a pooled connection to an origin
+ *
+ * Prefers an idle connection to the same origin, then an empty slot, then
+ * replaces the least recently used idle connection.
+ *
+ * @param host Host name
+ * @param port Port
+ * @param secure True for https
+ * @return int Pool slot marked in use, -1 if every connection is busy
+ */
+static int borrowConnection(const String &host, uint16_t port, bool secure) {
+  std::lock_guard<std::mutex> lock(poolMutex);
+  evictIdleLocked();
+
+  // Prefer an idle connection to the same origin
+  int slot = -1;
+  for (size_t i = 0; i < HTTP_POOL_SIZE; i++) {
+    PooledConnection &connection = pool[i];
+    if (connection.client && !connection.inUse &&
+        connection.secure == secure && connection.port == port &&
+        connection.host == host) {
+      slot = i;
+      break;
+    }
+  }
+
+  if (slot >= 0) {
+    if (pool[slot].client->connected()) {
+      poolStats.hits++;
+    } else {
+      poolStats.misses++;
+    }
+  } else {
+    // Take an empty slot, or the least recently used idle connection
+    for (size_t i = 0; i < HTTP_POOL_SIZE; i++) {
+      PooledConnection &connection = pool[i];
+      if (connection.inUse) {
+        continue;
+      }
+      if (!connection.client) {
+        slot = i;
+        break;
+      }
+      if (slot < 0 || connection.lastUsed < pool[slot].lastUsed) {
+        slot = i;
+      }
+    }
+    if (slot < 0) {
+      poolStats.bypassed++;
+      return -1;
+    }
+
+    PooledConnection &connection = pool[slot];
+    if (connection.client) {
+      closeConnection(connection);
+      poolStats.evictions++;
+    }
+    connection.client = createClient(secure);
+    connection.host = host;
+    connection.port = port;
+    connection.secure = secure;
+    poolStats.misses++;
+  }
+
+  pool[slot].inUse = true;
+  return slot;
+}
+
+/**
+ * @brief Close any pooled connection still open on destruction
+ */
+PooledHTTPClient::~PooledHTTPClient() {
+  if (_poolSlot >= 0 || _ownedClient) {
+    end();
+  }
+}
+
+/**
+ * @brief Begin a request on a pooled connection to the URL's origin
+ * @param url URL for the request
+ * @return bool True if the request was set up
+ */
+bool PooledHTTPClient::begin(const String &url) {
+  _headRequest = false;
+  String host;
+  uint16_t port;
+  bool secure;
+  if (!parseOrigin(url, host, port, secure)) {
+    return HTTPClient::begin(url);
+  }
+
+  int slot = borrowConnection(host, port, secure);
+  if (slot < 0) {
+    // Private connection, still resuming TLS sessions from the cache
+    _ownedClient = createClient(secure);
+    setReuse(false);
+    if (!HTTPClient::begin(*_ownedClient, url)) {
+      end();
+      return false;
+    }
+    return true;
+  }
+
+  _poolSlot = slot;
+  setReuse(true);
+  if (!HTTPClient::begin(*pool[slot].client, url)) {
+    end();
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief Finish the request and return the connection to the pool
+ *
+ * The connection stays open only if the server allowed keep-alive and no
+ * redirect moved it to a different origin.
+ */
+void PooledHTTPClient::end() {
+  HTTPClient::end();
+  if (_ownedClient) {
+    _ownedClient->stop();
+    delete _ownedClient;
+    _ownedClient = nullptr;
+    _client = nullptr;
+  }
+  if (_poolSlot < 0) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(poolMutex);
+  PooledConnection &connection = pool[_poolSlot];
+  if (!connection.client->connected() || _host != connection.host ||
+      _port != connection.port) {
+    connection.client->stop();
+  }
+  connection.inUse = false;
+  connection.lastUsed = millis();
+  _poolSlot = -1;
+
+  // The connection belongs to the pool, keep ~HTTPClient from closing it
+  _client = nullptr;
+}
+
+/**
+ * @brief Collect response headers, Content-Encoding is always collected
+ * @param headerKeys Names of the headers to keep
+ * @param headerKeysCount Number of names
+ */
+void PooledHTTPClient::collectHeaders(const char *headerKeys[],
+                                      size_t headerKeysCount) {
+  std::vector<const char *> keys(headerKeys, headerKeys + headerKeysCount);
+  keys.push_back("Content-Encoding");
+  HTTPClient::collectHeaders(keys.data(), keys.size());
+}
+
+/**
+ * @brief Offer gzip and deflate content encoding to the server
+ *
+ * Not offered while the largest free heap block can't hold an inflater, so
+ * the server sends the body plain instead of one that can't be read.
+ */
+void PooledHTTPClient::acceptCompressed() {
+  if (ESP.getMaxAllocHeap() < HttpInflater::heapNeeded()) {
+    log_w("Not enough memory to inflate, compression not offered");
+    return;
+  }
+  setAcceptEncoding("gzip, deflate");
+  _acceptCompressed = true;
+  collectHeaders(nullptr, 0);
+}
+
+/**
+ * @brief Send a HEAD request
+ * @return int HTTP status code or negative HTTPClient error
+ */
+int PooledHTTPClient::HEAD() {
+  _headRequest = true;
+  return sendRequest("HEAD");
+}
+
+/**
+ * @brief Check whether the response carries a body
+ *
+ * Responses to HEAD and 1xx, 204 and 304 responses end with their headers,
+ * whatever Content-Length or Transfer-Encoding say (RFC 9112 section 6.3).
+ *
+ * @return bool False if there is no body to read
+ */
+bool PooledHTTPClient::hasBody() const {
+  return !_headRequest && _returnCode >= 200 &&
+         _returnCode != HTTP_CODE_NO_CONTENT &&
+         _returnCode != HTTP_CODE_NOT_MODIFIED;
+}
+
+/**
+ * @brief Print keep-alive pool counters
+ * @param packet Pointer to AsyncUDPPacket for response
+ */
+void printHttpPoolStats(AsyncUDPPacket *packet) {
+  size_t open = 0;
+  HttpPoolStats stats;
+  {
+    std::lock_guard<std::mutex> lock(poolMutex);
+    evictIdleLocked();
+    for (const PooledConnection &connection : pool) {
+      if (connection.client && connection.client->connected()) {
+        open++;
+      }
+    }
+    stats = poolStats;
+  }
+  printResponse("HTTP_POOL: open=" + String(open) + "/" +
+                    String(HTTP_POOL_SIZE) + " hits=" + String(stats.hits) +
+                    " misses=" + String(stats.misses) +
+                    " evictions=" + String(stats.evictions) +
+                    " bypassed=" + String(stats.bypassed),
+                packet);
+}
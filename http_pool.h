@@ -0,0 +1,42 @@
+#ifndef HTTP_POOL_H
+#define HTTP_POOL_H
+
+#include <Arduino.h>
+#include <AsyncUDP.h>
+#include <HTTPClient.h>
+
+/**
+ * @brief HTTPClient that borrows its connection from the keep-alive pool
+ *
+ * begin() takes an idle connection to the same scheme, host and port from
+ * the pool (or opens a new one), end() hands it back if the server kept it
+ * open. Falls back to a private connection when the pool is exhausted.
+ * HTTPS connections use TlsSessionClient and resume cached TLS sessions.
+ */
+class PooledHTTPClient : public HTTPClient {
+public:
+  ~PooledHTTPClient();
+  bool begin(const String &url);
+  void end();
+  void collectHeaders(const char *headerKeys[], size_t headerKeysCount);
+  void acceptCompressed();
+  int HEAD();
+  bool hasBody() const;
+
+  /// Response body uses chunked transfer encoding
+  bool isChunked() const { return _transferEncoding == HTTPC_TE_CHUNKED; }
+
+  /// gzip / deflate was offered, a compressed body has to be inflated
+  bool acceptsCompressed() const { return _acceptCompressed; }
+
+private:
+  int _poolSlot = -1;
+  bool _acceptCompressed = false;
+  bool _headRequest = false;
+  NetworkClient *_ownedClient = nullptr;
+};
+
+void httpPoolEvictIdle();
+void printHttpPoolStats(AsyncUDPPacket *packet);
+
+#endif // HTTP_POOL_H
@@ -7,13 +7,45 @@
  */
 
 #include "http_utils.h"
+#include "http_body.h"
+#include "http_pool.h"
+#include "json_filter.h"
 #include "led.h"
+#include "perf_utils.h"
+#include "response_cache.h"
+#include "uart_compress.h"
+#include "uart_frame.h"
+#include "uart_tx.h"
 #include "uart_utils.h"
+#include "udp_reply.h"
 #include <HTTPClient.h>
 #include <WiFi.h>
+#include <atomic>
+#include <mutex>
 
-/// Maximum content length for HTTP responses
-const int MAX_CONTENT_LENGTH = 512 * 1024;
+/// Smallest buffer response bodies are copied through
+const size_t RESPONSE_BUFFER_MIN = 512;
+
+/// Largest buffer response bodies are copied through
+const size_t RESPONSE_BUFFER_MAX = 8192;
+
+/// The body buffer is sized to hold this much data at the measured rate
+const uint32_t RESPONSE_BUFFER_TARGET_MS = 20;
+
+/// Window over which the link rate is measured
+const uint32_t RESPONSE_RATE_WINDOW_MS = 100;
+
+/// A body transfer without data for this long is given up
+const uint32_t RESPONSE_IDLE_TIMEOUT_MS = 5000;
+
+/// Largest body piece sent in one UDP datagram, keeps replies unfragmented
+const size_t RESPONSE_UDP_CHUNK = 1024;
+
+/// Attempts in a row without progress before a range download gives up
+const uint8_t RANGE_MAX_ATTEMPTS = 5;
+
+/// Wait before resuming a range download, doubled after each failed attempt
+const uint32_t RANGE_RETRY_DELAY_MS = 500;
 
 /**
  * @struct HttpCallConfig
@@ -26,6 +58,8 @@ struct HttpCallConfig {
     std::vector<std::pair<String, String>> headers; ///< HTTP headers
     String payload;                                 ///< Request payload
     bool showResponseHeaders;                       ///< Flag to show response headers
+    String jsonFilter;                              ///< JSON paths to extract, empty for the whole body
+    String jsonFormat;                              ///< Output of extracted fields ("JSON" or "KEY_VALUE")
 
   void reset() {                                    ///< Reset the configuration
     method = "";
@@ -34,6 +68,8 @@ struct HttpCallConfig {
     headers.clear();
     payload = "";
     showResponseHeaders = false;
+    jsonFilter = "";
+    jsonFormat = "JSON";
   }
 
   void removeHeader(String name) {                 ///< Remove a specific header
@@ -48,22 +84,79 @@ struct HttpCallConfig {
 /// Global HTTP call configuration
 HttpCallConfig httpCallConfig;
 
+/// Configuration of the request running on this task, see HttpCallSnapshot
+static thread_local const HttpCallConfig *taskCallConfig = nullptr;
+
+/// Offer gzip / deflate to servers and inflate compressed responses
+static std::atomic<bool> httpCompression{false};
+
+/**
+ * @brief State of a download that resumes where it stopped
+ */
+struct RangeDownload {
+  String url;
+  uint32_t next = 0;      ///< Offset of the next byte to deliver
+  int64_t last = -1;      ///< Last byte wanted, -1 for the end of the object
+  String validator;       ///< ETag or Last-Modified sent as If-Range
+  int64_t total = -1;     ///< Size of the object, -1 while unknown
+  uint32_t delivered = 0; ///< Bytes written to the output
+  uint32_t resumes = 0;   ///< Requests that continued a dropped transfer
+  bool messages = false;  ///< Print RANGE: and RANGE_END around the body
+  bool started = false;   ///< A response was accepted
+};
+
+enum RangeResult { RANGE_DONE, RANGE_RETRY, RANGE_FAILED };
+
+/// Validator of the last object fetched by range, for the next window
+static String rangeUrl;
+static String rangeValidator;
+static std::mutex rangeMutex;
+
 /**
  * @brief Print response to UART or UDP packet
  * @param response The response string to print
  * @param packet Pointer to AsyncUDPPacket, can be null for UART output
  */
 void printResponse(String response, AsyncUDPPacket *packet) {
+  uint32_t printStart = perfStart();
   if (response.isEmpty()) {
     response = "empty";
   }
   if (packet) {
-    packet->printf("%s", response.c_str());
+    udpReplyLine(response, packet);
   } else {
-    UART0.println(response);
+    uartWriteLine(response);
   }
+  perfRecord(PERF_PRINT, printStart);
 }
 
+/**
+ * @brief Configuration the HTTP requests of this task are built from
+ * @return const HttpCallConfig& Snapshot of an ASYNC request, else the shared
+ *         configuration
+ */
+static const HttpCallConfig &callConfig() {
+  return taskCallConfig ? *taskCallConfig : httpCallConfig;
+}
+
+/**
+ * @brief Copy the current HTTP builder configuration
+ */
+HttpCallSnapshot::HttpCallSnapshot()
+    : _config(new HttpCallConfig(httpCallConfig)) {}
+
+HttpCallSnapshot::~HttpCallSnapshot() {
+  if (taskCallConfig == _config) {
+    taskCallConfig = nullptr;
+  }
+  delete _config;
+}
+
+/**
+ * @brief Use the copy for the requests made by the calling task
+ */
+void HttpCallSnapshot::use() { taskCallConfig = _config; }
+
 /**
  * @brief Set flag to show response headers
  * @param show Boolean flag to show or hide headers
@@ -76,6 +169,17 @@ void setShowResponseHeaders(bool show, AsyncUDPPacket *packet) {
                 packet);
 }
 
+/**
+ * @brief Enable or disable compressed transfer for all HTTP requests
+ * @param enable Boolean flag to offer gzip / deflate
+ * @param packet Pointer to AsyncUDPPacket for response
+ */
+void setHttpCompression(bool enable, AsyncUDPPacket *packet) {
+  httpCompression = enable;
+  printResponse("HTTP_COMPRESSION: " + String(enable ? "true" : "false"),
+                packet);
+}
+
 /**
  * @brief Get and print current HTTP builder configuration
  * @param packet Pointer to AsyncUDPPacket for response
@@ -87,6 +191,8 @@ void getHttpBuilderConfig(AsyncUDPPacket *packet) {
   printResponse("HTTP_PAYLOAD: " + httpCallConfig.payload, packet);
   printResponse("HTTP_IMPLEMENTATION: " + httpCallConfig.implementation,
                 packet);
+  printResponse("HTTP_JSON_FILTER: " + httpCallConfig.jsonFilter, packet);
+  printResponse("HTTP_JSON_FORMAT: " + httpCallConfig.jsonFormat, packet);
   printResponse("HTTP_HEADERS: ", packet);
   for (const auto &header : httpCallConfig.headers) {
     printResponse(header.first + ": " + header.second, packet);
@@ -180,113 +286,316 @@ void setHttpImplementation(String implementation, AsyncUDPPacket *packet) {
 }
 
 /**
- * @brief Get the content length of a resource at the given URL
- * @param url URL to check
- * @return int Content length or -1 if error
+ * @brief Set the JSON paths extracted from CALL responses
+ * @param paths Comma-separated paths, empty to print whole bodies
+ * @param packet Pointer to AsyncUDPPacket for response
  */
-int getContentLength(String url) {
-  HTTPClient http;
-  http.begin(url);
-  int httpResponseCode = http.sendRequest("HEAD");
+void setHttpJsonFilter(String paths, AsyncUDPPacket *packet) {
+  paths.trim();
+  if (!paths.isEmpty() && !isValidJsonFilter(paths)) {
+    printResponse("HTTP_ERROR: Invalid JSON filter, use paths like "
+                  "name,main.temp,weather[].description",
+                  packet);
+    return;
+  }
+  httpCallConfig.jsonFilter = paths;
+  printResponse("HTTP_SET_JSON_FILTER: " + paths, packet);
+}
 
-  if (httpResponseCode > 0) {
-    int contentLength = http.getSize();
-    http.end();
-    return contentLength;
+/**
+ * @brief Set the output format of extracted JSON fields
+ * @param format JSON or KEY_VALUE
+ * @param packet Pointer to AsyncUDPPacket for response
+ */
+void setHttpJsonFormat(String format, AsyncUDPPacket *packet) {
+  format.toUpperCase();
+  if (format != "JSON" && format != "KEY_VALUE") {
+    printResponse("HTTP_ERROR: Invalid JSON format. Supported formats: JSON, "
+                  "KEY_VALUE",
+                  packet);
+    return;
+  }
+  httpCallConfig.jsonFormat = format;
+  printResponse("HTTP_SET_JSON_FORMAT: " + format, packet);
+}
+
+/**
+ * @brief Body buffer size for a measured link rate
+ * @param bytesPerSecond Rate measured over the last window
+ * @return size_t Power of two between RESPONSE_BUFFER_MIN and the heap limit
+ */
+static size_t responseBufferSize(uint32_t bytesPerSecond) {
+  // Never take more than a quarter of the largest free block
+  size_t limit = min(RESPONSE_BUFFER_MAX, (size_t)ESP.getMaxAllocHeap() / 4);
+  size_t wanted = (uint64_t)bytesPerSecond * RESPONSE_BUFFER_TARGET_MS / 1000;
+  size_t size = RESPONSE_BUFFER_MIN;
+  while (size < wanted && size * 2 <= limit) {
+    size *= 2;
+  }
+  return size;
+}
+
+/**
+ * @brief Write body bytes to UDP, the UART compressor or the UART
+ * @param data Body bytes
+ * @param length Number of bytes
+ * @param packet Pointer to AsyncUDPPacket, can be null for UART output
+ * @param compressor Compressor for UART output, can be null
+ */
+static void writeBody(const uint8_t *data, size_t length,
+                      AsyncUDPPacket *packet, UartCompressor *compressor) {
+  if (packet) {
+    udpReplyBody(data, length, packet);
+  } else if (compressor) {
+    compressor->write(data, length);
   } else {
-    http.end();
-    return -1; // Indicate an error
+    uartWriteBody(data, length);
   }
 }
 
 /**
- * @brief Handle streaming HTTP response
- * @param http HTTPClient object
- * @param packet Pointer to AsyncUDPPacket for response
+ * @brief Print the size and rate of a body sent compressed over the UART
+ *
+ * Waits until the UART has sent the body, so the rate is what the Flipper
+ * actually received.
+ *
+ * @param compressor Compressor the body went through, already ended
+ * @param streamStart micros() when the body transfer started
  */
-void handleStreamResponse(HTTPClient &http, AsyncUDPPacket *packet) {
-  int len = http.getSize();
-  const size_t bufferSize = 512; // Buffer size for reading data
-  uint8_t buff[bufferSize + 1] = {0}; // Buffer with space for null-terminator
+static void printCompressionTrailer(const UartCompressor &compressor,
+                                    uint32_t streamStart) {
+  uartTxFlush();
+  uint32_t elapsed = micros() - streamStart;
+  size_t in = compressor.bytesIn();
+  size_t out = compressor.bytesOut();
+  uint32_t rate = elapsed ? (uint64_t)in * 1000000 / elapsed : 0;
+  printResponse("COMPRESSION: in=" + String(in) + " out=" + String(out) +
+                    " ratio=" + String(out ? (float)in / out : 0.0f, 2) +
+                    " bytes_per_s=" + String(rate),
+                nullptr);
+}
 
-  NetworkClient *stream = http.getStreamPtr();
+/**
+ * @brief Copy the response body to UART or UDP
+ *
+ * Reads exactly Content-Length bytes or up to the last chunk of a chunked
+ * response, so chunk framing never reaches the output. Between reads the
+ * task sleeps on the socket instead of polling. The buffer grows with the
+ * measured link rate as far as free heap allows, and data is written to
+ * the sink straight from it.
+ *
+ * @param body Reader of the response body
+ * @param packet Pointer to AsyncUDPPacket, can be null for UART output
+ * @param copy Optional second destination for the body
+ * @param compressor Compressor for UART output, ended when the body ends
+ * @return size_t Number of body bytes copied
+ */
+static size_t streamResponseBody(HttpBodyReader &body, AsyncUDPPacket *packet,
+                                 Print *copy = nullptr,
+                                 UartCompressor *compressor = nullptr) {
+  size_t capacity = RESPONSE_BUFFER_MIN;
+  uint8_t *buff = (uint8_t *)malloc(capacity);
+  if (!buff) {
+    if (compressor) {
+      compressor->end();
+    }
+    printResponse("HTTP_ERROR: Not enough memory to read the response",
+                  packet);
+    body.abandon();
+    return 0;
+  }
 
-  printResponse("STREAM: ", packet);
-  while (http.connected() && (len > 0 || len  == -1) ) {
-    size_t size = stream->available();
-    if (size) {
-      int c = stream->readBytes(buff, min(size, bufferSize - 1)); // Adjust for null terminator
-      buff[c] = '\0'; // Null-terminate the buffer
-      if (packet) {
-        packet->write(buff, c);
-      } else {
-        UART0.write(buff, c);
+  size_t total = 0;
+  size_t windowBytes = 0;
+  uint32_t windowStart = millis();
+  while (!body.finished()) {
+    int c = body.read(buff, packet ? min(capacity, RESPONSE_UDP_CHUNK)
+                                   : capacity);
+    if (c <= 0) {
+      if (compressor) {
+        // Send what is buffered before waiting on the network
+        compressor->flush();
       }
-      if (len > 0) {
-        len -= c;
+      if (!body.waitForData(RESPONSE_IDLE_TIMEOUT_MS)) {
+        body.abandon();
       }
-    } 
-    delay(1); // Yield control to the system
+      continue;
+    }
+    writeBody(buff, c, packet, compressor);
+    if (copy) {
+      copy->write(buff, c);
+    }
+    total += c;
+    windowBytes += c;
+
+    uint32_t elapsed = millis() - windowStart;
+    if (elapsed >= RESPONSE_RATE_WINDOW_MS) {
+      size_t size = responseBufferSize(windowBytes * 1000 / elapsed);
+      if (size != capacity) {
+        uint8_t *resized = (uint8_t *)realloc(buff, size);
+        if (resized) {
+          buff = resized;
+          capacity = size;
+        }
+      }
+      windowBytes = 0;
+      windowStart = millis();
+    }
+  }
+  free(buff);
+  if (compressor) {
+    compressor->end();
+  }
+  if (body.decodeFailed()) {
+    printResponse("HTTP_ERROR: Could not decompress the response", packet);
   }
-  printResponse("\nSTREAM_END", packet);
+  return total;
 }
 
 /**
- * @brief Handle file streaming HTTP response
- * @param http HTTPClient object
+ * @brief Handle streaming HTTP response
+ * @param http PooledHTTPClient object
  * @param packet Pointer to AsyncUDPPacket for response
+ * @param perfStream Stream path to account the transfer to
  */
-void handleFileStreamResponse(HTTPClient &http, AsyncUDPPacket *packet) {
-  int len = http.getSize();
-  uint8_t buff[512] = {0};
+void handleStreamResponse(PooledHTTPClient &http, AsyncUDPPacket *packet,
+                          PerfStream perfStream) {
+  uint32_t streamStart = micros();
+  HttpBodyReader body(http);
+  UartCompressor compressor;
+  UartCompressor *uartCompressor =
+      !packet && uartCompressionEnabled() ? &compressor : nullptr;
+  printResponse("STREAM: ", packet);
+  size_t total = streamResponseBody(body, packet, nullptr, uartCompressor);
+  perfRecordStream(perfStream, total, streamStart);
+  if (!packet && (uartCompressor || uartFramingEnabled())) {
+    uartEndBody();
+    if (uartCompressor) {
+      printCompressionTrailer(compressor, streamStart);
+    }
+    printResponse("STREAM_END", packet);
+  } else {
+    printResponse("\nSTREAM_END", packet);
+  }
+}
 
-  NetworkClient *stream = http.getStreamPtr();
+/**
+ * @brief Handle file streaming HTTP response
+ * @param http PooledHTTPClient object
+ * @param packet Pointer to AsyncUDPPacket for response
+ * @param perfStream Stream path to account the transfer to
+ */
+void handleFileStreamResponse(PooledHTTPClient &http, AsyncUDPPacket *packet,
+                              PerfStream perfStream) {
+  uint32_t streamStart = micros();
+  HttpBodyReader body(http);
+  size_t total = streamResponseBody(body, nullptr);
+  uartEndBody();
+  perfRecordStream(perfStream, total, streamStart);
+}
 
-  while (http.connected() && (len > 0 || len == -1)) {
-    size_t size = stream->available();
-    if (size) {
-      int c = stream->readBytes(buff, ((size > sizeof(buff)) ? sizeof(buff) : size));
-      UART0.write(buff, c);
-      if (len > 0) {
-        len -= c;
-      }
+/**
+ * @brief Close a RESPONSE: framed body
+ * @param total Number of body bytes printed
+ * @param packet Pointer to AsyncUDPPacket for response
+ * @param compressor Compressor the body went through, can be null
+ * @param streamStart micros() when the body transfer started
+ */
+static void endCallResponse(size_t total, AsyncUDPPacket *packet,
+                            const UartCompressor *compressor,
+                            uint32_t streamStart) {
+  if (!packet && (compressor || uartFramingEnabled())) {
+    uartEndBody();
+    if (compressor) {
+      printCompressionTrailer(*compressor, streamStart);
     }
-    delay(1); // Yield control to the system
+  } else if (total == 0) {
+    printResponse("", packet);
+  } else if (!packet) {
+    uartWriteBody((const uint8_t *)"\r\n", 2);
   }
+  printResponse("RESPONSE_END", packet);
 }
 
 /**
- * @brief Handle HTTP response as a string
- * @param http HTTPClient object
+ * @brief Handle HTTP response framed by RESPONSE: / RESPONSE_END
+ *
+ * The body is copied through a fixed buffer instead of being collected in
+ * a String, so responses of any size fit in memory. With a JSON filter set,
+ * only the selected fields are printed.
+ *
+ * @param http PooledHTTPClient object
  * @param packet Pointer to AsyncUDPPacket for response
+ * @param cacheWriter Optional cache entry the body is copied into
  */
-void handleGetStringResponse(HTTPClient &http, AsyncUDPPacket *packet) {
-  // Check available heap memory
-  size_t freeHeap = ESP.getFreeHeap();
-  const size_t minHeapThreshold = 1024; // Minimum heap space to avoid overflow
-
-  if (freeHeap < minHeapThreshold) {
-    printResponse("WIFI_ERROR: Not enough memory to process the response.",
-                  packet);
+void handleCallResponse(PooledHTTPClient &http, AsyncUDPPacket *packet,
+                        ResponseCacheWriter *cacheWriter = nullptr) {
+  const HttpCallConfig &config = callConfig();
+  uint32_t streamStart = micros();
+  HttpBodyReader body(http);
+  if (!config.jsonFilter.isEmpty()) {
+    printResponse("RESPONSE:", packet);
+    size_t total = printJsonSelection(body, config.jsonFilter,
+                                      config.jsonFormat == "KEY_VALUE", packet,
+                                      cacheWriter);
+    perfRecordStream(PERF_STREAM_CALL, total, streamStart);
+    if (cacheWriter) {
+      cacheWriter->commit(body.complete());
+    }
+    printResponse("RESPONSE_END", packet);
     return;
   }
 
-  String payload = http.getString();
-  if (payload.isEmpty()) {
-    payload = "empty";
+  UartCompressor compressor;
+  UartCompressor *uartCompressor =
+      !packet && uartCompressionEnabled() ? &compressor : nullptr;
+  printResponse("RESPONSE:", packet);
+  size_t total =
+      streamResponseBody(body, packet, cacheWriter, uartCompressor);
+  perfRecordStream(PERF_STREAM_CALL, total, streamStart);
+  if (cacheWriter) {
+    cacheWriter->commit(body.complete());
   }
+  endCallResponse(total, packet, uartCompressor, streamStart);
+}
 
-  // Check again after getting the payload
-  freeHeap = ESP.getFreeHeap();
-  if (freeHeap < minHeapThreshold) {
-    printResponse("WIFI_ERROR: Not enough memory to process the full response.",
-                  packet);
+/**
+ * @brief Replay a cached body framed by RESPONSE: / RESPONSE_END
+ * @param file Cached body, positioned at its start
+ * @param packet Pointer to AsyncUDPPacket for response
+ */
+void handleCachedResponse(File &file, AsyncUDPPacket *packet) {
+  const HttpCallConfig &config = callConfig();
+  uint32_t streamStart = micros();
+  if (!config.jsonFilter.isEmpty()) {
+    printResponse("RESPONSE:", packet);
+    size_t total = printJsonSelection(
+        file, config.jsonFilter, config.jsonFormat == "KEY_VALUE", packet);
+    perfRecordStream(PERF_STREAM_CALL, total, streamStart);
+    printResponse("RESPONSE_END", packet);
     return;
   }
 
+  size_t total = 0;
+  uint8_t buff[RESPONSE_BUFFER_MIN];
+  UartCompressor compressor;
+  UartCompressor *uartCompressor =
+      !packet && uartCompressionEnabled() ? &compressor : nullptr;
+
   printResponse("RESPONSE:", packet);
-  printResponse(payload, packet);
-  printResponse("RESPONSE_END", packet);
+  while (file.available()) {
+    size_t c = file.read(buff, sizeof(buff));
+    if (c == 0) {
+      break;
+    }
+    writeBody(buff, c, packet, uartCompressor);
+    total += c;
+  }
+  if (uartCompressor) {
+    uartCompressor->end();
+  }
+  perfRecordStream(PERF_STREAM_CALL, total, streamStart);
+  endCallResponse(total, packet, uartCompressor, streamStart);
 }
 
 /**
@@ -296,40 +605,48 @@ void handleGetStringResponse(HTTPClient &http, AsyncUDPPacket *packet) {
  */
 void makeHttpRequest(String url, AsyncUDPPacket *packet) {
   if (WiFi.status() == WL_CONNECTED) {
-    int contentLength = getContentLength(url);
-
-    if (contentLength > MAX_CONTENT_LENGTH) {
-      String warnMsg = "WARNING: Content of " + String(contentLength) +
-                       " exceeds maximum length of " +
-                       String(MAX_CONTENT_LENGTH) +
-                       " bytes for simple calls. Using stream,  if"
-                       "the blue light stays on, reset the board.";
-      printResponse(warnMsg, packet);
-    }
-
-    if (contentLength == -1) {
-      String warnMsg =
-          "WARNING: Content-Length is unknown (-1). These calls tend to crash "
-          "to board. If the blue light stays on, reset the board.";
-      printResponse(warnMsg, packet);
-    }
-
-    HTTPClient http;
+    PooledHTTPClient http;
     led_set_blue(255);
     http.setFollowRedirects(HTTPC_STRICT_FOLLOW_REDIRECTS);
     http.begin(url);
+    if (httpCompression) {
+      http.acceptCompressed();
+    }
+
+    const char *cacheHeaders[] = {"ETag", "Last-Modified", "Cache-Control"};
+    http.collectHeaders(cacheHeaders, 3);
+    bool revalidating = responseCacheAddValidators(url, http);
 
     int httpResponseCode = http.GET();
 
-    if (httpResponseCode > 0) {
+    if (revalidating && httpResponseCode == HTTP_CODE_NOT_MODIFIED) {
+      File cached = responseCacheOpen(url);
+      if (!cached) {
+        // Cache file lost, fetch the full response again
+        http.end();
+        responseCacheRemove(url);
+        makeHttpRequest(url, packet);
+        return;
+      }
+      printResponse("STATUS: " + String(HTTP_CODE_OK) + "\n", packet);
+      handleCachedResponse(cached, packet);
+      cached.close();
+    } else if (httpResponseCode > 0) {
       String response = "STATUS: " + String(httpResponseCode) + "\n";
       printResponse(response, packet);
 
-      if (contentLength == -1 || contentLength > MAX_CONTENT_LENGTH) {
-        handleStreamResponse(http, packet);
-      } else {
-        handleGetStringResponse(http, packet);
+      ResponseCacheWriter cacheWriter;
+      bool cacheable = httpResponseCode == HTTP_CODE_OK &&
+                       http.header("Cache-Control").indexOf("no-store") == -1 &&
+                       cacheWriter.begin(url, http.header("ETag"),
+                                         http.header("Last-Modified"),
+                                         http.getSize());
+      if (revalidating && !cacheable) {
+        // The server answered the conditional request with something the
+        // cache must not keep serving on a later 304
+        responseCacheRemove(url);
       }
+      handleCallResponse(http, packet, cacheable ? &cacheWriter : nullptr);
     } else {
       String errorMsg = "HTTP_ERROR: " + getHttpErrorMessage(httpResponseCode);
       printResponse(errorMsg, packet);
@@ -345,27 +662,302 @@ void makeHttpRequest(String url, AsyncUDPPacket *packet) {
   }
 }
 
+/**
+ * @brief Pick the validator an If-Range header can use
+ *
+ * If-Range needs a strong validator, so a weak ETag falls back to
+ * Last-Modified.
+ *
+ * @param http Client whose response headers were collected
+ * @return String ETag or Last-Modified, empty if the response has neither
+ */
+static String responseValidator(PooledHTTPClient &http) {
+  String etag = http.header("ETag");
+  if (!etag.isEmpty() && !etag.startsWith("W/")) {
+    return etag;
+  }
+  return http.header("Last-Modified");
+}
+
+/**
+ * @brief Parse a Content-Range header such as "bytes 100-199/1000"
+ * @param header Header value
+ * @param first Receives the offset of the first byte sent
+ * @param total Receives the size of the object, -1 for "*"
+ * @return bool False if the header is malformed
+ */
+static bool parseContentRange(const String &header, uint32_t &first,
+                              int64_t &total) {
+  int dash = header.indexOf('-');
+  int slash = header.indexOf('/');
+  if (!header.startsWith("bytes ") || dash < 0 || slash < dash) {
+    return false;
+  }
+  first = strtoul(header.c_str() + 6, nullptr, 10);
+  String size = header.substring(slash + 1);
+  total = size == "*" ? -1 : (int64_t)strtoull(size.c_str(), nullptr, 10);
+  return true;
+}
+
+/**
+ * @brief Send one request of a range download and copy its body
+ *
+ * Asks for the bytes from d.next on, with If-Range so a changed object is
+ * refused instead of spliced into the output. A server that ignores Range
+ * answers 200 with the whole object, whose bytes before d.next are skipped.
+ *
+ * @param d Download state, advanced by the bytes delivered
+ * @param packet Pointer to AsyncUDPPacket, can be null for UART output
+ * @param error Receives the reason if the request did not finish the range
+ * @return RangeResult RANGE_RETRY if the transfer dropped and can resume
+ */
+static RangeResult requestRange(RangeDownload &d, AsyncUDPPacket *packet,
+                                String &error) {
+  PooledHTTPClient http;
+  http.setFollowRedirects(HTTPC_STRICT_FOLLOW_REDIRECTS);
+  http.begin(d.url);
+  // Offsets count bytes of the encoded body, so never offer compression
+  const char *rangeHeaders[] = {"ETag", "Last-Modified", "Content-Range"};
+  http.collectHeaders(rangeHeaders, 3);
+  if (d.next > 0 || d.last >= 0) {
+    String range = "bytes=" + String(d.next) + "-";
+    if (d.last >= 0) {
+      range += String((uint32_t)d.last);
+    }
+    http.addHeader("Range", range);
+    if (!d.validator.isEmpty()) {
+      http.addHeader("If-Range", d.validator);
+    }
+  }
+
+  int httpResponseCode = http.GET();
+  if (httpResponseCode <= 0) {
+    error = "HTTP_ERROR: " + getHttpErrorMessage(httpResponseCode);
+    http.end();
+    return RANGE_RETRY;
+  }
+
+  String validator = responseValidator(http);
+  uint32_t skip = 0;
+  if (httpResponseCode == HTTP_CODE_PARTIAL_CONTENT) {
+    uint32_t first = 0;
+    if (!parseContentRange(http.header("Content-Range"), first, d.total) ||
+        first != d.next) {
+      error = "RANGE_ERROR: Unexpected Content-Range " +
+              http.header("Content-Range");
+      http.end();
+      return RANGE_FAILED;
+    }
+  } else if (httpResponseCode == HTTP_CODE_OK) {
+    if (!d.validator.isEmpty() && validator != d.validator) {
+      // If-Range did not match: bytes already delivered belong to an older
+      // version of the object
+      std::lock_guard<std::mutex> lock(rangeMutex);
+      rangeUrl = "";
+      rangeValidator = "";
+      error = "RANGE_ERROR: Resource changed";
+      http.end();
+      return RANGE_FAILED;
+    }
+    skip = d.next;
+    int size = http.getSize();
+    d.total = size >= 0 ? size : -1;
+  } else if (httpResponseCode == HTTP_CODE_RANGE_NOT_SATISFIABLE) {
+    error = "RANGE_ERROR: Range not satisfiable";
+    http.end();
+    return RANGE_FAILED;
+  } else {
+    error = "HTTP_ERROR: Unexpected status " + String(httpResponseCode);
+    http.end();
+    return RANGE_FAILED;
+  }
+
+  if (d.validator.isEmpty()) {
+    d.validator = validator;
+  }
+  {
+    std::lock_guard<std::mutex> lock(rangeMutex);
+    rangeUrl = d.url;
+    rangeValidator = d.validator;
+  }
+  if (!d.started) {
+    d.started = true;
+    if (d.messages) {
+      int64_t last = d.total >= 0 ? d.total - 1 : d.last;
+      if (d.last >= 0 && d.last < last) {
+        last = d.last;
+      }
+      printResponse("RANGE: " + String(d.next) + "-" +
+                        (last >= 0 ? String((uint32_t)last) : String("*")) +
+                        "/" +
+                        (d.total >= 0 ? String((uint32_t)d.total)
+                                      : String("*")),
+                    packet);
+    }
+  }
+
+  uint8_t *buff = (uint8_t *)malloc(RESPONSE_UDP_CHUNK);
+  if (!buff) {
+    error = "HTTP_ERROR: Not enough memory to read the response";
+    http.end();
+    return RANGE_FAILED;
+  }
+  HttpBodyReader body(http);
+  while (!body.finished()) {
+    int c = body.read(buff, RESPONSE_UDP_CHUNK);
+    if (c <= 0) {
+      if (!body.waitForData(RESPONSE_IDLE_TIMEOUT_MS)) {
+        body.abandon();
+      }
+      continue;
+    }
+    size_t offset = min((size_t)c, (size_t)skip);
+    size_t length = c - offset;
+    skip -= offset;
+    if (d.last >= 0) {
+      length = min(length, (size_t)(d.last + 1 - d.next));
+    }
+    if (length > 0) {
+      writeBody(buff + offset, length, packet, nullptr);
+      d.next += length;
+      d.delivered += length;
+    }
+    if (d.last >= 0 && (int64_t)d.next > d.last) {
+      body.abandon(); // The server sent more than the window
+    }
+  }
+  free(buff);
+  bool complete = body.complete();
+  http.end();
+
+  if ((d.last >= 0 && (int64_t)d.next > d.last) ||
+      (d.total >= 0 && (int64_t)d.next >= d.total)) {
+    return RANGE_DONE;
+  }
+  if (complete && httpResponseCode == HTTP_CODE_OK) {
+    if (skip > 0) {
+      error = "RANGE_ERROR: Range not satisfiable";
+      return RANGE_FAILED;
+    }
+    return RANGE_DONE;
+  }
+  if (d.validator.isEmpty()) {
+    error = "RANGE_ERROR: Connection lost, no ETag or Last-Modified to resume";
+    return RANGE_FAILED;
+  }
+  error = "HTTP_ERROR: Connection lost";
+  return RANGE_RETRY;
+}
+
+/**
+ * @brief Run a range download, resuming it from the last byte delivered
+ *
+ * A dropped transfer is requested again from where it stopped. It gives up
+ * after RANGE_MAX_ATTEMPTS attempts in a row that deliver nothing, waiting
+ * twice as long before each one.
+ *
+ * @param d Download state
+ * @param packet Pointer to AsyncUDPPacket, can be null for UART output
+ */
+static void downloadRange(RangeDownload &d, AsyncUDPPacket *packet) {
+  uint32_t streamStart = micros();
+  uint8_t failures = 0;
+  String error;
+  RangeResult result;
+  while (true) {
+    uint32_t delivered = d.delivered;
+    result = requestRange(d, packet, error);
+    if (result != RANGE_RETRY || !d.started) {
+      break;
+    }
+    failures = d.delivered != delivered ? 0 : failures + 1;
+    if (failures >= RANGE_MAX_ATTEMPTS) {
+      break;
+    }
+    log_w("%s, resuming at byte %u", error.c_str(), d.next);
+    delay(RANGE_RETRY_DELAY_MS << failures);
+    d.resumes++;
+  }
+  perfRecordStream(PERF_STREAM_FILE, d.delivered, streamStart);
+
+  if (!d.started) {
+    printResponse(error, packet);
+    return;
+  }
+  String separator = "\n";
+  if (!packet && uartFramingEnabled()) {
+    uartEndBody();
+    separator = "";
+  }
+  if (result != RANGE_DONE) {
+    // Without messages this line is the only sign the body is incomplete
+    printResponse(separator + error, packet);
+    separator = "";
+  }
+  if (!d.messages) {
+    uartReleaseBody();
+    return;
+  }
+  printResponse(separator + "RANGE_END: bytes=" + String(d.delivered) +
+                    " resumes=" + String(d.resumes),
+                packet);
+}
+
 /**
  * @brief Make an HTTP GET request for file streaming
+ *
+ * The body is sent without messages. A dropped transfer resumes with a
+ * Range request if the server sent an ETag or Last-Modified. A request
+ * that fails ends with an error line instead, on a line of its own.
+ *
  * @param url URL for the request
  * @param packet Pointer to AsyncUDPPacket for response
  */
 void makeHttpFileRequest(String url, AsyncUDPPacket *packet) {
   if (WiFi.status() == WL_CONNECTED) {
-    HTTPClient http;
     led_set_blue(255);
-    http.setFollowRedirects(HTTPC_STRICT_FOLLOW_REDIRECTS);
-    http.begin(url);
-
-
-    int httpResponseCode = http.GET();
+    RangeDownload download;
+    download.url = url;
+    downloadRange(download, packet);
+    led_set_blue(0);
+  } else {
+    led_error();
+    printResponse("HTTP_ERROR: WiFi Disconnected", packet);
+  }
+}
 
-    if (httpResponseCode > 0) {
-      handleFileStreamResponse(http, packet);
+/**
+ * @brief Make an HTTP GET request for a byte window of a resource
+ *
+ * Sends If-Range with the validator of the previous range request to the
+ * same URL, so consecutive windows come from the same version.
+ *
+ * @param url URL for the request
+ * @param start Offset of the first byte
+ * @param length Number of bytes, 0 for the rest of the resource
+ * @param packet Pointer to AsyncUDPPacket for response
+ */
+void makeHttpRangeRequest(String url, uint32_t start, uint32_t length,
+                          AsyncUDPPacket *packet) {
+  if (WiFi.status() == WL_CONNECTED) {
+    led_set_blue(255);
+    RangeDownload download;
+    download.url = url;
+    download.next = start;
+    download.last = length > 0 ? (int64_t)start + length - 1 : -1;
+    download.messages = true;
+    {
+      std::lock_guard<std::mutex> lock(rangeMutex);
+      if (rangeUrl == url) {
+        download.validator = rangeValidator;
+      }
     }
-
-    http.end();
+    downloadRange(download, packet);
     led_set_blue(0);
+  } else {
+    led_set_blue(0);
+    led_error();
+    printResponse("HTTP_ERROR: WiFi Disconnected", packet);
   }
 }
 
@@ -376,28 +968,12 @@ void makeHttpFileRequest(String url, AsyncUDPPacket *packet) {
  */
 void makeHttpRequestStream(String url, AsyncUDPPacket *packet) {
   if (WiFi.status() == WL_CONNECTED) {
-    HTTPClient http;
+    PooledHTTPClient http;
     led_set_blue(255);
     http.setFollowRedirects(HTTPC_STRICT_FOLLOW_REDIRECTS);
     http.begin(url);
-
-    int contentLength = getContentLength(url);
-
-    if (contentLength > MAX_CONTENT_LENGTH) {
-      String warnMsg = "WARNING: Content of " + String(contentLength) +
-                       " exceeds maximum length for stream of." +
-                       String(MAX_CONTENT_LENGTH) +
-                       " bytes. If"
-                       "the blue light stays on,"
-                       "reset the board.";
-      printResponse(warnMsg, packet);
-    }
-
-    if (contentLength == -1) {
-      String warnMsg =
-          "WARNING: Content-Length is unknown (-1). These calls tend to crash "
-          "to board. If the blue light stays on, reset the board.";
-      printResponse(warnMsg, packet);
+    if (httpCompression) {
+      http.acceptCompressed();
     }
 
     int httpResponseCode = http.GET();
@@ -405,7 +981,7 @@ void makeHttpRequestStream(String url, AsyncUDPPacket *packet) {
     if (httpResponseCode > 0) {
       String response = "STATUS: " + String(httpResponseCode) + "\n";
       printResponse(response, packet);
-      handleStreamResponse(http, packet);
+      handleStreamResponse(http, packet, PERF_STREAM_GET);
     } else {
       String errorMsg =
           "HTTP_ERROR: " + HTTPClient::errorToString(httpResponseCode) +
@@ -433,8 +1009,11 @@ void makeHttpPostRequest(String url, String jsonPayload,
                          AsyncUDPPacket *packet) {
   if (WiFi.status() == WL_CONNECTED) {
     led_set_blue(255);
-    HTTPClient http;
+    PooledHTTPClient http;
     http.begin(url);
+    if (httpCompression) {
+      http.acceptCompressed();
+    }
     http.addHeader("Content-Type", "application/json");
 
     int httpResponseCode = http.POST(jsonPayload);
@@ -442,7 +1021,7 @@ void makeHttpPostRequest(String url, String jsonPayload,
     if (httpResponseCode > 0) {
       String response = "STATUS: " + String(httpResponseCode) + "\n";
       printResponse(response, packet);
-      handleGetStringResponse(http, packet);
+      handleCallResponse(http, packet);
     } else {
       String errorMsg = "HTTP_ERROR: " + getHttpErrorMessage(httpResponseCode);
       printResponse(errorMsg, packet);
@@ -467,16 +1046,19 @@ void makeHttpPostRequest(String url, String jsonPayload,
  */
 void makeHttpPostFileRequest(String url, String jsonPayload, AsyncUDPPacket *packet) {
   if (WiFi.status() == WL_CONNECTED) {
-    HTTPClient http;
+    PooledHTTPClient http;
     led_set_blue(255);
     http.setFollowRedirects(HTTPC_STRICT_FOLLOW_REDIRECTS);
     http.begin(url);
+    if (httpCompression) {
+      http.acceptCompressed();
+    }
     http.addHeader("Content-Type", "application/json");
 
     int httpResponseCode = http.POST(jsonPayload);
 
     if (httpResponseCode > 0) {
-      handleFileStreamResponse(http, packet);
+      handleFileStreamResponse(http, packet, PERF_STREAM_POST);
     }
 
     http.end();
@@ -490,7 +1072,8 @@ void makeHttpPostFileRequest(String url, String jsonPayload, AsyncUDPPacket *pac
  */
 
 void executeHttpCall(AsyncUDPPacket *packet) {
-  if (httpCallConfig.url.isEmpty() || httpCallConfig.method.isEmpty()) {
+  const HttpCallConfig &config = callConfig();
+  if (config.url.isEmpty() || config.method.isEmpty()) {
     String errorMsg = "HTTP URL or Method not set";
     printResponse(errorMsg, packet);
     return;
@@ -498,11 +1081,14 @@ void executeHttpCall(AsyncUDPPacket *packet) {
 
   if (WiFi.status() == WL_CONNECTED) {
     led_set_blue(255);
-    HTTPClient http;
+    PooledHTTPClient http;
     http.setFollowRedirects(HTTPC_STRICT_FOLLOW_REDIRECTS);
-    http.begin(httpCallConfig.url);
+    http.begin(config.url);
+    if (httpCompression) {
+      http.acceptCompressed();
+    }
 
-    for (const auto &header : httpCallConfig.headers) {
+    for (const auto &header : config.headers) {
       http.addHeader(header.first, header.second);
     }
 
@@ -515,20 +1101,20 @@ void executeHttpCall(AsyncUDPPacket *packet) {
     String response;
     int httpResponseCode;
 
-    if (httpCallConfig.method == "GET") {
+    if (config.method == "GET") {
       httpResponseCode = http.GET();
-    } else if (httpCallConfig.method == "POST") {
-      httpResponseCode = http.POST(httpCallConfig.payload);
-    } else if (httpCallConfig.method == "PATCH") {
-      httpResponseCode = http.PATCH(httpCallConfig.payload);
-    } else if (httpCallConfig.method == "PUT") {
-      httpResponseCode = http.PUT(httpCallConfig.payload);
-    } else if (httpCallConfig.method == "DELETE") {
-      httpResponseCode = http.sendRequest("DELETE", httpCallConfig.payload);
-    } else if (httpCallConfig.method == "HEAD") {
-      httpResponseCode = http.sendRequest("HEAD");
+    } else if (config.method == "POST") {
+      httpResponseCode = http.POST(config.payload);
+    } else if (config.method == "PATCH") {
+      httpResponseCode = http.PATCH(config.payload);
+    } else if (config.method == "PUT") {
+      httpResponseCode = http.PUT(config.payload);
+    } else if (config.method == "DELETE") {
+      httpResponseCode = http.sendRequest("DELETE", config.payload);
+    } else if (config.method == "HEAD") {
+      httpResponseCode = http.HEAD();
     } else {
-      String errorMsg = "Unsupported HTTP method: " + httpCallConfig.method;
+      String errorMsg = "Unsupported HTTP method: " + config.method;
       printResponse(errorMsg, packet);
       http.end();
       led_set_blue(0);
@@ -539,7 +1125,7 @@ void executeHttpCall(AsyncUDPPacket *packet) {
       response = "STATUS: " + String(httpResponseCode) + "\n";
       printResponse(response, packet);
 
-      if (httpCallConfig.showResponseHeaders) {
+      if (config.showResponseHeaders) {
         printResponse("HEADERS:", packet);
         // Get the header count
         int headerCount = http.headers();
@@ -552,10 +1138,10 @@ void executeHttpCall(AsyncUDPPacket *packet) {
         }
       }
 
-      if (httpCallConfig.implementation == "STREAM") {
-        handleStreamResponse(http, packet);
+      if (config.implementation == "STREAM") {
+        handleStreamResponse(http, packet, PERF_STREAM_GET);
       } else {
-        handleGetStringResponse(http, packet);
+        handleCallResponse(http, packet);
       }
     } else {
       String errorMsg = "HTTP_ERROR: " + getHttpErrorMessage(httpResponseCode);
@@ -7,6 +7,27 @@
 #include <WiFi.h>
 #include <vector>
 
+struct HttpCallConfig;
+
+/**
+ * @brief Copy of the HTTP builder configuration for a request run later
+ *
+ * ASYNC requests run on worker tasks while BUILD_HTTP_* commands keep
+ * changing the shared configuration. use() makes the copy the one the
+ * calling task's requests read.
+ */
+class HttpCallSnapshot {
+public:
+  HttpCallSnapshot();
+  ~HttpCallSnapshot();
+  HttpCallSnapshot(const HttpCallSnapshot &) = delete;
+  HttpCallSnapshot &operator=(const HttpCallSnapshot &) = delete;
+  void use();
+
+private:
+  HttpCallConfig *_config;
+};
+
 // HTTP utility functions
 void makeHttpRequest(String url, AsyncUDPPacket *packet);
 void makeHttpRequestStream(String url, AsyncUDPPacket *packet);
@@ -20,13 +41,18 @@ void setHttpUrl(String url, AsyncUDPPacket *packet);
 void addHttpHeader(String header, AsyncUDPPacket *packet);
 void setHttpPayload(String payload, AsyncUDPPacket *packet);
 void setHttpImplementation(String implementation, AsyncUDPPacket *packet);
+void setHttpJsonFilter(String paths, AsyncUDPPacket *packet);
+void setHttpJsonFormat(String format, AsyncUDPPacket *packet);
 void removeHttpHeader(String name, AsyncUDPPacket *packet);
 void resetHttpConfig(AsyncUDPPacket *packet);
 void executeHttpCall(AsyncUDPPacket *packet);
 void getHttpBuilderConfig(AsyncUDPPacket *packet);
 void makeHttpFileRequest(String url, AsyncUDPPacket *packet);
+void makeHttpRangeRequest(String url, uint32_t start, uint32_t length,
+                          AsyncUDPPacket *packet);
 // HTTP Helper functions
 void setShowResponseHeaders(bool show, AsyncUDPPacket *packet);
+void setHttpCompression(bool enable, AsyncUDPPacket *packet);
 String getHttpErrorMessage(int httpCode);
 void printResponse(String response, AsyncUDPPacket *packet);
 
@@ -0,0 +1,295 @@
+/**
+ * @file json_filter.cpp
+ * @brief Field extraction from JSON response bodies
+ *
+ * This file contains the JSON filter mode of the CALL responses. The body
+ * is deserialized straight from the connection with an ArduinoJson filter
+ * document built from the configured paths, so only the selected fields are
+ * kept in memory, and they are printed as compact JSON or key=value lines.
+ *
+ * Paths are comma-separated, e.g. "name,main.temp,weather[].description",
+ * where [] selects the field in every element of an array.
+ */
+
+#include "json_filter.h"
+#include "http_utils.h"
+#include <ArduinoJson.h>
+#include <vector>
+
+/// A body without data for this long is given up, as in the body loop
+const uint32_t JSON_IDLE_TIMEOUT_MS = 5000;
+
+/**
+ * @brief ArduinoJson reader on top of an HTTP body
+ *
+ * Blocks until the next byte arrives, and copies everything it reads to an
+ * optional second destination (the response cache).
+ */
+class BodyJsonReader {
+public:
+  BodyJsonReader(HttpBodyReader &body, Print *copy)
+      : _body(body), _copy(copy) {}
+
+  /**
+   * @brief Read one byte
+   * @return int The byte, -1 at the end of the body
+   */
+  int read() {
+    while (_pos == _length) {
+      if (_body.finished()) {
+        return -1;
+      }
+      int c = _body.read(_buffer, sizeof(_buffer));
+      if (c > 0) {
+        if (_copy) {
+          _copy->write(_buffer, c);
+        }
+        _total += c;
+        _pos = 0;
+        _length = c;
+      } else if (!_body.waitForData(JSON_IDLE_TIMEOUT_MS)) {
+        _body.abandon();
+      }
+    }
+    return _buffer[_pos++];
+  }
+
+  /**
+   * @brief Read several bytes
+   * @param buffer Destination buffer
+   * @param length Number of bytes wanted
+   * @return size_t Number of bytes read, less at the end of the body
+   */
+  size_t readBytes(char *buffer, size_t length) {
+    size_t n = 0;
+    while (n < length) {
+      int c = read();
+      if (c < 0) {
+        break;
+      }
+      buffer[n++] = c;
+    }
+    return n;
+  }
+
+  /**
+   * @brief Read the rest of the body, e.g. whitespace after the JSON value
+   */
+  void drain() {
+    while (read() >= 0) {
+      _pos = _length;
+    }
+  }
+
+  /// Body bytes read
+  size_t total() const { return _total; }
+
+private:
+  HttpBodyReader &_body;
+  Print *_copy;
+  uint8_t _buffer[256];
+  size_t _pos = 0;
+  size_t _length = 0;
+  size_t _total = 0;
+};
+
+/**
+ * @brief Split one path into field names and "[]" array steps
+ * @param path Path such as "weather[].description"
+ * @param segments Receives the steps
+ * @return bool False if the path is malformed
+ */
+static bool parseJsonPath(String path, std::vector<String> &segments) {
+  path.trim();
+  size_t i = 0;
+  size_t length = path.length();
+  if (length == 0) {
+    return false;
+  }
+  while (i < length) {
+    if (path[i] == '[') {
+      if (i + 1 >= length || path[i + 1] != ']') {
+        return false;
+      }
+      segments.push_back("[]");
+      i += 2;
+      if (i < length && path[i] != '.' && path[i] != '[') {
+        return false;
+      }
+    } else {
+      size_t end = i;
+      while (end < length && path[end] != '.' && path[end] != '[') {
+        end++;
+      }
+      if (end == i) {
+        return false;
+      }
+      segments.push_back(path.substring(i, end));
+      i = end;
+    }
+    if (i < length && path[i] == '.') {
+      if (++i == length) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief Get or create the filter node for the next path step
+ * @param node Current filter node
+ * @param segment Field name or "[]"
+ * @return JsonVariant Child node
+ */
+static JsonVariant filterChild(JsonVariant node, const String &segment) {
+  if (segment == "[]") {
+    JsonArray items =
+        node.is<JsonArray>() ? node.as<JsonArray>() : node.to<JsonArray>();
+    if (items.size() == 0) {
+      return items.add<JsonVariant>();
+    }
+    JsonVariant first = items[0];
+    return first;
+  }
+  JsonObject members =
+      node.is<JsonObject>() ? node.as<JsonObject>() : node.to<JsonObject>();
+  JsonVariant child = members[segment];
+  return child.isNull() ? members[segment].to<JsonVariant>() : child;
+}
+
+/**
+ * @brief Build an ArduinoJson filter document from comma-separated paths
+ * @param paths Comma-separated paths
+ * @param filter Receives the filter
+ * @return bool False if a path is malformed
+ */
+static bool buildJsonFilter(const String &paths, JsonDocument &filter) {
+  int start = 0;
+  while (start <= (int)paths.length()) {
+    int comma = paths.indexOf(',', start);
+    int end = comma < 0 ? paths.length() : comma;
+    std::vector<String> segments;
+    if (!parseJsonPath(paths.substring(start, end), segments)) {
+      return false;
+    }
+
+    JsonVariant node = filter.as<JsonVariant>();
+    for (const String &segment : segments) {
+      if (node.is<bool>()) {
+        break; // A shorter path already selects the whole value
+      }
+      node = filterChild(node, segment);
+    }
+    node.set(true);
+    start = end + 1;
+  }
+  return true;
+}
+
+/**
+ * @brief Check comma-separated filter paths
+ * @param paths Comma-separated paths
+ * @return bool True if every path is well formed
+ */
+bool isValidJsonFilter(const String &paths) {
+  JsonDocument filter;
+  return buildJsonFilter(paths, filter);
+}
+
+/**
+ * @brief Print a value as path=value lines, one per scalar
+ * @param value Value to print
+ * @param path Path of the value
+ * @param packet Pointer to AsyncUDPPacket for response
+ */
+static void printKeyValues(JsonVariantConst value, const String &path,
+                           AsyncUDPPacket *packet) {
+  if (value.is<JsonObjectConst>()) {
+    for (JsonPairConst member : value.as<JsonObjectConst>()) {
+      String key = member.key().c_str();
+      printKeyValues(member.value(), path.isEmpty() ? key : path + "." + key,
+                     packet);
+    }
+  } else if (value.is<JsonArrayConst>()) {
+    size_t index = 0;
+    for (JsonVariantConst item : value.as<JsonArrayConst>()) {
+      printKeyValues(item, path + "[" + String(index++) + "]", packet);
+    }
+  } else {
+    String text;
+    if (value.is<const char *>()) {
+      text = value.as<const char *>();
+    } else {
+      serializeJson(value, text);
+    }
+    printResponse(path + "=" + text, packet);
+  }
+}
+
+/**
+ * @brief Print the selected fields, or the parse error
+ * @param doc Filtered document
+ * @param error Result of the deserialization
+ * @param keyValue True for key=value lines, false for compact JSON
+ * @param packet Pointer to AsyncUDPPacket for response
+ */
+static void printSelection(JsonDocument &doc, DeserializationError error,
+                           bool keyValue, AsyncUDPPacket *packet) {
+  if (error) {
+    printResponse("JSON_ERROR: " + String(error.c_str()), packet);
+    return;
+  }
+  if (keyValue) {
+    printKeyValues(doc.as<JsonVariantConst>(), "", packet);
+  } else {
+    String json;
+    serializeJson(doc, json);
+    printResponse(json, packet);
+  }
+}
+
+/**
+ * @brief Extract and print the selected fields of a JSON response body
+ *
+ * The whole body is read, so the connection can be reused and the optional
+ * copy is complete.
+ *
+ * @param body Reader of the response body
+ * @param paths Comma-separated paths to extract
+ * @param keyValue True for key=value lines, false for compact JSON
+ * @param packet Pointer to AsyncUDPPacket for response
+ * @param copy Optional destination of the unfiltered body
+ * @return size_t Number of body bytes read
+ */
+size_t printJsonSelection(HttpBodyReader &body, const String &paths,
+                          bool keyValue, AsyncUDPPacket *packet, Print *copy) {
+  JsonDocument filter;
+  buildJsonFilter(paths, filter);
+  BodyJsonReader reader(body, copy);
+  JsonDocument doc;
+  DeserializationError error =
+      deserializeJson(doc, reader, DeserializationOption::Filter(filter));
+  reader.drain();
+  printSelection(doc, error, keyValue, packet);
+  return reader.total();
+}
+
+/**
+ * @brief Extract and print the selected fields of a cached JSON body
+ * @param file Cached body, positioned at its start
+ * @param paths Comma-separated paths to extract
+ * @param keyValue True for key=value lines, false for compact JSON
+ * @param packet Pointer to AsyncUDPPacket for response
+ * @return size_t Size of the cached body
+ */
+size_t printJsonSelection(File &file, const String &paths, bool keyValue,
+                          AsyncUDPPacket *packet) {
+  JsonDocument filter;
+  buildJsonFilter(paths, filter);
+  JsonDocument doc;
+  DeserializationError error =
+      deserializeJson(doc, file, DeserializationOption::Filter(filter));
+  printSelection(doc, error, keyValue, packet);
+  return file.size();
+}
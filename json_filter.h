@@ -0,0 +1,16 @@
+#ifndef JSON_FILTER_H
+#define JSON_FILTER_H
+
+#include "http_body.h"
+#include <Arduino.h>
+#include <AsyncUDP.h>
+#include <FS.h>
+
+bool isValidJsonFilter(const String &paths);
+size_t printJsonSelection(HttpBodyReader &body, const String &paths,
+                          bool keyValue, AsyncUDPPacket *packet,
+                          Print *copy = nullptr);
+size_t printJsonSelection(File &file, const String &paths, bool keyValue,
+                          AsyncUDPPacket *packet);
+
+#endif // JSON_FILTER_H
@@ -0,0 +1,736 @@
+/**
+ * @file mqtt_client.cpp
+ * @brief MQTT 3.1.1 client forwarding received publishes to the UART
+ *
+ * This file contains an MQTT client for one broker connection at a time.
+ * MQTT_CONNECT opens the socket (TlsSessionClient for mqtts://, so TLS
+ * sessions are resumed), sends CONNECT with a clean session and waits for
+ * CONNACK. A receiver task then sleeps in select() on the socket and
+ * forwards every PUBLISH as an MQTT_MESSAGE event, acknowledging QoS 1
+ * messages. Acknowledgements of our own packets are printed as events too.
+ *
+ * Subscriptions are granted at most QoS 1, so the broker never sends QoS 2.
+ * The receiver sends PINGREQ when nothing was sent for MQTT_KEEPALIVE_S and
+ * drops the connection if the broker stays silent for MQTT_PING_TIMEOUT_MS
+ * after it. Packets above MQTT_MAX_PACKET close the connection.
+ *
+ * The receiver and the commands share the socket under mqttMutex, see
+ * socket_utils.cpp.
+ */
+
+#include "mqtt_client.h"
+#include "http_utils.h"
+#include "socket_utils.h"
+#include "tls_session.h"
+#include "uart_frame.h"
+#include <NetworkClient.h>
+#include <esp_random.h>
+#include <mutex>
+#include <vector>
+
+/// Broker port of mqtt:// URLs without one
+const uint16_t MQTT_DEFAULT_PORT = 1883;
+
+/// Broker port of mqtts:// URLs without one
+const uint16_t MQTTS_DEFAULT_PORT = 8883;
+
+/// Time allowed for the connection and the CONNACK
+const uint32_t MQTT_CONNECT_TIMEOUT_MS = 10000;
+
+/// Longest sleep of the receiver, so MQTT_DISCONNECT is noticed quickly
+const uint32_t MQTT_POLL_MS = 1000;
+
+/// Stack size of the receiver task, it decrypts and parses packets
+const uint32_t MQTT_RECEIVER_STACK_SIZE = 6 * 1024;
+
+/// Receiver priority, same as the executor
+const UBaseType_t MQTT_RECEIVER_PRIORITY = 2;
+
+/// Largest fixed header: type byte and 4 bytes of remaining length
+const size_t MQTT_MAX_HEADER = 5;
+
+/**
+ * @brief Control packet types
+ */
+enum MqttPacketType : uint8_t {
+  MQTT_PKT_CONNECT = 1,
+  MQTT_PKT_CONNACK = 2,
+  MQTT_PKT_PUBLISH = 3,
+  MQTT_PKT_PUBACK = 4,
+  MQTT_PKT_SUBSCRIBE = 8,
+  MQTT_PKT_SUBACK = 9,
+  MQTT_PKT_UNSUBSCRIBE = 10,
+  MQTT_PKT_UNSUBACK = 11,
+  MQTT_PKT_PINGREQ = 12,
+  MQTT_PKT_PINGRESP = 13,
+  MQTT_PKT_DISCONNECT = 14
+};
+
+/**
+ * @struct MqttConnection
+ * @brief An open broker connection and the state of its receiver
+ */
+struct MqttConnection {
+  NetworkClient *client = nullptr;
+  String broker;              ///< host:port
+  String clientId;
+  uint32_t connectedAt = 0;   ///< millis() when CONNACK arrived
+  uint32_t lastReceiveMs = 0; ///< millis() of the last received byte
+  uint32_t lastSendMs = 0;    ///< millis() of the last sent packet
+  uint32_t pingSentMs = 0;    ///< millis() of the unanswered ping, 0 if none
+  bool disconnecting = false; ///< DISCONNECT sent
+
+  uint8_t *rx = nullptr;      ///< Received bytes not parsed yet
+  size_t rxLength = 0;
+  uint16_t nextPacketId = 1;
+  uint16_t inflight = 0;      ///< QoS 1 publishes waiting for PUBACK
+
+  uint32_t messagesIn = 0;
+  uint32_t messagesOut = 0;
+  uint32_t bytesIn = 0;
+  uint32_t bytesOut = 0;
+  uint32_t pings = 0;
+
+  ~MqttConnection() {
+    delete client;
+    free(rx);
+  }
+};
+
+/// Guards current and every operation on its socket
+static std::mutex mqttMutex;
+static MqttConnection *current = nullptr;
+
+/**
+ * @brief Append a big-endian 16-bit value to a packet body
+ * @param body Packet body
+ * @param value Value to append
+ */
+static void putUint16(std::vector<uint8_t> &body, uint16_t value) {
+  body.push_back(value >> 8);
+  body.push_back(value & 0xFF);
+}
+
+/**
+ * @brief Append a length-prefixed UTF-8 string to a packet body
+ * @param body Packet body
+ * @param text String to append, at most 65535 bytes
+ */
+static void putString(std::vector<uint8_t> &body, const String &text) {
+  putUint16(body, text.length());
+  body.insert(body.end(), text.c_str(), text.c_str() + text.length());
+}
+
+/**
+ * @brief Send one control packet
+ * @param mq Connection, mqttMutex held by the caller once it is current
+ * @param header First byte: packet type and flags
+ * @param body Variable header and payload
+ * @return bool False if the packet could not be sent completely
+ */
+static bool sendPacketLocked(MqttConnection &mq, uint8_t header,
+                             const std::vector<uint8_t> &body) {
+  // One write per packet, on mqtts every write is a TLS record
+  std::vector<uint8_t> packet;
+  packet.reserve(MQTT_MAX_HEADER + body.size());
+  packet.push_back(header);
+  size_t remaining = body.size();
+  do {
+    uint8_t digit = remaining % 128;
+    remaining /= 128;
+    packet.push_back(remaining > 0 ? digit | 0x80 : digit);
+  } while (remaining > 0);
+  packet.insert(packet.end(), body.begin(), body.end());
+
+  if (mq.client->write(packet.data(), packet.size()) != packet.size()) {
+    return false;
+  }
+  mq.bytesOut += packet.size();
+  mq.lastSendMs = millis();
+  return true;
+}
+
+/**
+ * @brief Take the next packet identifier, never 0
+ * @param mq Connection, mqttMutex held by the caller
+ * @return uint16_t Packet identifier
+ */
+static uint16_t nextPacketIdLocked(MqttConnection &mq) {
+  uint16_t id = mq.nextPacketId++;
+  if (mq.nextPacketId == 0) {
+    mq.nextPacketId = 1;
+  }
+  return id;
+}
+
+/**
+ * @brief Print an event line on the events channel
+ * @param prefix Text before the detail, e.g. "MQTT_PUBACK: "
+ * @param detail Event detail
+ */
+static void printMqttEvent(const char *prefix, const String &detail) {
+  uartWriteEvent(prefix, (const uint8_t *)detail.c_str(), detail.length());
+}
+
+/**
+ * @brief Forward a received message to the UART
+ * @param mq Connection the message came from
+ * @param topic Topic name
+ * @param topicLength Topic length
+ * @param payload Message payload
+ * @param length Payload length
+ * @param retained True if the broker sent a retained message
+ */
+static void deliverMessage(MqttConnection &mq, const uint8_t *topic,
+                           size_t topicLength, const uint8_t *payload,
+                           size_t length, bool retained) {
+  static const char TOPIC[] = "topic=";
+  static const char RETAINED[] = " retained";
+  static const char PAYLOAD[] = " payload=";
+  std::vector<uint8_t> detail;
+  detail.reserve(sizeof(TOPIC) + topicLength + sizeof(RETAINED) +
+                 sizeof(PAYLOAD) + length);
+  detail.insert(detail.end(), TOPIC, TOPIC + sizeof(TOPIC) - 1);
+  detail.insert(detail.end(), topic, topic + topicLength);
+  if (retained) {
+    detail.insert(detail.end(), RETAINED, RETAINED + sizeof(RETAINED) - 1);
+  }
+  detail.insert(detail.end(), PAYLOAD, PAYLOAD + sizeof(PAYLOAD) - 1);
+  detail.insert(detail.end(), payload, payload + length);
+  mq.messagesIn++;
+  uartWriteEvent("MQTT_MESSAGE: ", detail.data(), detail.size());
+}
+
+/**
+ * @brief Handle one complete packet from the broker
+ * @param mq Connection the packet came from
+ * @param type Packet type
+ * @param flags Low four bits of the first byte
+ * @param body Variable header and payload
+ * @param length Body length
+ * @param reason Set to the reason when the connection has to end
+ * @return bool False when the connection has to end
+ */
+static bool handlePacket(MqttConnection &mq, uint8_t type, uint8_t flags,
+                         const uint8_t *body, size_t length, String &reason) {
+  uint16_t id = length >= 2 ? (body[0] << 8) | body[1] : 0;
+  switch (type) {
+  case MQTT_PKT_PUBLISH: {
+    uint8_t qos = (flags >> 1) & 0x03;
+    if (qos > 1) {
+      reason = "QoS 2 not supported";
+      return false;
+    }
+    // A PUBLISH starts with the topic length where other packets have an ID
+    size_t topicLength = id;
+    size_t offset = 2 + topicLength;
+    if (length < 2 || offset + (qos ? 2 : 0) > length) {
+      reason = "malformed PUBLISH";
+      return false;
+    }
+    if (qos == 1) {
+      uint16_t messageId = (body[offset] << 8) | body[offset + 1];
+      offset += 2;
+      std::vector<uint8_t> ack;
+      putUint16(ack, messageId);
+      std::lock_guard<std::mutex> lock(mqttMutex);
+      sendPacketLocked(mq, MQTT_PKT_PUBACK << 4, ack);
+    }
+    deliverMessage(mq, body + 2, topicLength, body + offset, length - offset,
+                   flags & 0x01);
+    return true;
+  }
+  case MQTT_PKT_PUBACK: {
+    {
+      std::lock_guard<std::mutex> lock(mqttMutex);
+      if (mq.inflight > 0) {
+        mq.inflight--;
+      }
+    }
+    printMqttEvent("MQTT_PUBACK: ", "id=" + String(id));
+    return true;
+  }
+  case MQTT_PKT_SUBACK: {
+    if (length < 3) {
+      reason = "malformed SUBACK";
+      return false;
+    }
+    printMqttEvent("MQTT_SUBACK: ", "id=" + String(id) +
+                                        (body[2] == 0x80
+                                             ? String(" failed")
+                                             : " qos=" + String(body[2])));
+    return true;
+  }
+  case MQTT_PKT_UNSUBACK:
+    printMqttEvent("MQTT_UNSUBACK: ", "id=" + String(id));
+    return true;
+  case MQTT_PKT_PINGRESP:
+    return true;
+  default:
+    reason = "unexpected packet type " + String(type);
+    return false;
+  }
+}
+
+/**
+ * @brief Parse and handle every complete packet in the receive buffer
+ * @param mq Connection to parse
+ * @param reason Set to the reason when the connection has to end
+ * @return bool False when the connection has to end
+ */
+static bool parsePackets(MqttConnection &mq, String &reason) {
+  size_t offset = 0;
+  bool open = true;
+  while (open && mq.rxLength - offset >= 2) {
+    uint8_t *packet = mq.rx + offset;
+    size_t available = mq.rxLength - offset;
+    size_t length = 0;
+    size_t headerLength = 1;
+    bool lengthComplete = false;
+    while (headerLength < available) {
+      uint8_t digit = packet[headerLength];
+      length |= (size_t)(digit & 0x7F) << (7 * (headerLength - 1));
+      headerLength++;
+      if (!(digit & 0x80)) {
+        lengthComplete = true;
+        break;
+      }
+      if (headerLength == MQTT_MAX_HEADER) {
+        reason = "malformed packet length";
+        return false;
+      }
+    }
+    if (!lengthComplete) {
+      break;
+    }
+    if (length > MQTT_MAX_PACKET) {
+      reason = "packet too big";
+      return false;
+    }
+    if (available < headerLength + length) {
+      break;
+    }
+    open = handlePacket(mq, packet[0] >> 4, packet[0] & 0x0F,
+                        packet + headerLength, length, reason);
+    offset += headerLength + length;
+  }
+  memmove(mq.rx, mq.rx + offset, mq.rxLength - offset);
+  mq.rxLength -= offset;
+  return open;
+}
+
+/**
+ * @brief Time the receiver may sleep before the next keepalive check
+ * @param mq Connection
+ * @param now Current millis()
+ * @return uint32_t Milliseconds until a ping or a timeout is due
+ */
+static uint32_t keepaliveDelay(const MqttConnection &mq, uint32_t now) {
+  uint32_t deadline = mq.pingSentMs
+                          ? mq.pingSentMs + MQTT_PING_TIMEOUT_MS
+                          : mq.lastSendMs + MQTT_KEEPALIVE_S * 1000;
+  return min(millisUntil(deadline, now), MQTT_POLL_MS);
+}
+
+/**
+ * @brief Receiver task, forwards messages until the connection ends
+ * @param parameter The MqttConnection
+ */
+static void mqttReceiverTask(void *parameter) {
+  MqttConnection *mq = (MqttConnection *)parameter;
+  String reason;
+
+  for (;;) {
+    uint32_t now = millis();
+    bool disconnecting;
+    {
+      std::lock_guard<std::mutex> lock(mqttMutex);
+      disconnecting = mq->disconnecting;
+      if (!disconnecting && !mq->pingSentMs &&
+          now - mq->lastSendMs >= MQTT_KEEPALIVE_S * 1000) {
+        sendPacketLocked(*mq, MQTT_PKT_PINGREQ << 4, {});
+        mq->pingSentMs = now;
+        mq->pings++;
+      }
+    }
+    if (disconnecting) {
+      reason = "disconnected";
+      break;
+    }
+    if (mq->pingSentMs && now - mq->pingSentMs >= MQTT_PING_TIMEOUT_MS) {
+      reason = "ping timeout";
+      break;
+    }
+
+    int n = socketReceive(mqttMutex, *mq->client, mq->rx + mq->rxLength,
+                          MQTT_MAX_HEADER + MQTT_MAX_PACKET - mq->rxLength,
+                          keepaliveDelay(*mq, now));
+    if (n < 0) {
+      reason = "connection lost";
+      break;
+    }
+    if (n > 0) {
+      mq->rxLength += n;
+      mq->bytesIn += n;
+      mq->lastReceiveMs = millis();
+      mq->pingSentMs = 0; // Anything received proves the broker is alive
+      if (!parsePackets(*mq, reason)) {
+        break;
+      }
+    }
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mqttMutex);
+    current = nullptr;
+    mq->client->stop();
+  }
+  printMqttEvent("MQTT_CLOSED: ", "reason=" + reason);
+  delete mq;
+  vTaskDelete(NULL);
+}
+
+/**
+ * @brief Split a broker URL
+ * @param url mqtt:// or mqtts:// URL, mqtt:// if no scheme is given
+ * @param host Host name
+ * @param port Explicit port or the scheme default
+ * @param user User name, empty if none
+ * @param password Password, empty if none
+ * @param secure True for mqtts
+ * @return bool False if the URL has no host
+ */
+static bool parseMqttUrl(String url, String &host, uint16_t &port,
+                         String &user, String &password, bool &secure) {
+  int schemeEnd = url.indexOf("://");
+  String scheme = schemeEnd < 0 ? "mqtt" : url.substring(0, schemeEnd);
+  scheme.toLowerCase();
+  if (scheme == "mqtts") {
+    secure = true;
+    port = MQTTS_DEFAULT_PORT;
+  } else if (scheme == "mqtt") {
+    secure = false;
+    port = MQTT_DEFAULT_PORT;
+  } else {
+    return false;
+  }
+
+  int hostStart = schemeEnd < 0 ? 0 : schemeEnd + 3;
+  int pathStart = url.indexOf('/', hostStart);
+  String authority =
+      url.substring(hostStart, pathStart < 0 ? url.length() : pathStart);
+  int at = authority.lastIndexOf('@');
+  if (at != -1) {
+    String credentials = authority.substring(0, at);
+    authority = authority.substring(at + 1);
+    int colon = credentials.indexOf(':');
+    user = colon < 0 ? credentials : credentials.substring(0, colon);
+    password = colon < 0 ? String() : credentials.substring(colon + 1);
+  }
+  host = authority;
+  int portIndex = host.indexOf(':');
+  if (portIndex != -1) {
+    port = host.substring(portIndex + 1).toInt();
+    host = host.substring(0, portIndex);
+  }
+  return !host.isEmpty() && port != 0;
+}
+
+/**
+ * @brief Wait for the CONNACK of a new connection
+ * @param client Connected client
+ * @return String Error message, empty if the broker accepted the connection
+ */
+static String readConnack(NetworkClient &client) {
+  static const char *const REFUSED[] = {
+      "",
+      "unacceptable protocol version",
+      "client ID rejected",
+      "server unavailable",
+      "bad user name or password",
+      "not authorized"};
+
+  uint8_t connack[4];
+  size_t received = 0;
+  uint32_t deadline = millis() + MQTT_CONNECT_TIMEOUT_MS;
+  while (received < sizeof(connack)) {
+    int n = client.available() > 0
+                ? client.read(connack + received, sizeof(connack) - received)
+                : 0;
+    if (n > 0) {
+      received += n;
+      continue;
+    }
+    if (!client.connected()) {
+      return "Connection closed by the broker";
+    }
+    if ((int32_t)(deadline - millis()) <= 0) {
+      return "No CONNACK from the broker";
+    }
+    waitForClient(client, 50);
+  }
+  if (connack[0] != MQTT_PKT_CONNACK << 4 || connack[1] != 2) {
+    return "Unexpected response, not an MQTT broker?";
+  }
+  if (connack[3] != 0) {
+    return "Connection refused: " +
+           String(connack[3] <= 5 ? REFUSED[connack[3]] : "unknown reason");
+  }
+  return String();
+}
+
+/**
+ * @brief Connect to a broker and start forwarding its messages to the UART
+ * @param url mqtt:// or mqtts:// URL, with optional user:password@
+ * @param clientId Client identifier, a random one if empty
+ * @param packet Pointer to AsyncUDPPacket for response
+ */
+void connectMqtt(String url, String clientId, AsyncUDPPacket *packet) {
+  {
+    std::lock_guard<std::mutex> lock(mqttMutex);
+    if (current) {
+      printResponse("MQTT_ERROR: Already connected, send MQTT_DISCONNECT "
+                    "first",
+                    packet);
+      return;
+    }
+  }
+
+  String host;
+  String user;
+  String password;
+  uint16_t port = 0;
+  bool secure = false;
+  if (!parseMqttUrl(url, host, port, user, password, secure)) {
+    printResponse("MQTT_ERROR: Invalid URL", packet);
+    return;
+  }
+  if (clientId.isEmpty()) {
+    clientId = "flipper-" + String(esp_random() & 0xFFFFFF, HEX);
+  }
+
+  MqttConnection *mq = new MqttConnection();
+  mq->broker = host + ":" + String(port);
+  mq->clientId = clientId;
+  mq->client = secure ? new TlsSessionClient() : new NetworkClient();
+  mq->rx = (uint8_t *)malloc(MQTT_MAX_HEADER + MQTT_MAX_PACKET);
+  if (!mq->rx) {
+    delete mq;
+    printResponse("MQTT_ERROR: Not enough memory", packet);
+    return;
+  }
+  if (!mq->client->connect(host.c_str(), port, MQTT_CONNECT_TIMEOUT_MS)) {
+    delete mq;
+    printResponse("MQTT_ERROR: Connection to " + host + " failed", packet);
+    return;
+  }
+  mq->client->setNoDelay(true);
+
+  std::vector<uint8_t> body;
+  putString(body, "MQTT");
+  body.push_back(4); // Protocol level of 3.1.1
+  uint8_t flags = 0x02; // Clean session
+  if (!user.isEmpty()) {
+    flags |= 0x80;
+    if (!password.isEmpty()) {
+      flags |= 0x40;
+    }
+  }
+  body.push_back(flags);
+  putUint16(body, MQTT_KEEPALIVE_S);
+  putString(body, clientId);
+  if (flags & 0x80) {
+    putString(body, user);
+  }
+  if (flags & 0x40) {
+    putString(body, password);
+  }
+
+  String error = sendPacketLocked(*mq, MQTT_PKT_CONNECT << 4, body)
+                     ? readConnack(*mq->client)
+                     : String("Could not send CONNECT");
+  if (!error.isEmpty()) {
+    mq->client->stop();
+    delete mq;
+    printResponse("MQTT_ERROR: " + error, packet);
+    return;
+  }
+
+  mq->connectedAt = millis();
+  mq->lastReceiveMs = mq->connectedAt;
+  if (!claimConnection(mqttMutex, current, mq)) {
+    mq->client->stop();
+    delete mq;
+    printResponse("MQTT_ERROR: Already connected, send MQTT_DISCONNECT first",
+                  packet);
+    return;
+  }
+  // Report the connection before the receiver can forward a message
+  printResponse("MQTT_CONNECTED: " + mq->broker + " client_id=" + clientId,
+                packet);
+  if (!startReceiver(mqttReceiverTask, "mqtt_receiver",
+                     MQTT_RECEIVER_STACK_SIZE, MQTT_RECEIVER_PRIORITY,
+                     mqttMutex, current, mq)) {
+    printResponse("MQTT_ERROR: Could not start the receiver", packet);
+  }
+}
+
+/**
+ * @brief Send a packet that is answered with an acknowledgement event
+ * @param header First byte of the packet
+ * @param body Packet body after the packet identifier
+ * @param id Receives the packet identifier
+ * @return String Error message, empty on success
+ */
+static String sendAcknowledgedPacket(uint8_t header,
+                                     const std::vector<uint8_t> &body,
+                                     uint16_t &id) {
+  std::lock_guard<std::mutex> lock(mqttMutex);
+  if (!current || current->disconnecting) {
+    return "Not connected";
+  }
+  id = nextPacketIdLocked(*current);
+  std::vector<uint8_t> packet;
+  putUint16(packet, id);
+  packet.insert(packet.end(), body.begin(), body.end());
+  return sendPacketLocked(*current, header, packet) ? String()
+                                                    : "Send failed";
+}
+
+/**
+ * @brief Subscribe to a topic filter, MQTT_SUBACK follows
+ * @param topic Topic filter, may contain + and # wildcards
+ * @param qos Maximum QoS of the forwarded messages, 0 or 1
+ * @param packet Pointer to AsyncUDPPacket for response
+ */
+void subscribeMqtt(String topic, uint8_t qos, AsyncUDPPacket *packet) {
+  if (topic.isEmpty()) {
+    printResponse("MQTT_ERROR: Topic required", packet);
+    return;
+  }
+  std::vector<uint8_t> body;
+  putString(body, topic);
+  body.push_back(qos);
+  uint16_t id = 0;
+  String error =
+      sendAcknowledgedPacket((MQTT_PKT_SUBSCRIBE << 4) | 0x02, body, id);
+  printResponse(error.isEmpty() ? "MQTT_SUBSCRIBING: id=" + String(id) + " " +
+                                      topic
+                                : "MQTT_ERROR: " + error,
+                packet);
+}
+
+/**
+ * @brief Unsubscribe from a topic filter, MQTT_UNSUBACK follows
+ * @param topic Topic filter as subscribed
+ * @param packet Pointer to AsyncUDPPacket for response
+ */
+void unsubscribeMqtt(String topic, AsyncUDPPacket *packet) {
+  if (topic.isEmpty()) {
+    printResponse("MQTT_ERROR: Topic required", packet);
+    return;
+  }
+  std::vector<uint8_t> body;
+  putString(body, topic);
+  uint16_t id = 0;
+  String error =
+      sendAcknowledgedPacket((MQTT_PKT_UNSUBSCRIBE << 4) | 0x02, body, id);
+  printResponse(error.isEmpty() ? "MQTT_UNSUBSCRIBING: id=" + String(id) +
+                                      " " + topic
+                                : "MQTT_ERROR: " + error,
+                packet);
+}
+
+/**
+ * @brief Publish a message, MQTT_PUBACK follows for QoS 1
+ * @param topic Topic name, without wildcards
+ * @param payload Message payload
+ * @param qos 0 or 1
+ * @param packet Pointer to AsyncUDPPacket for response
+ */
+void publishMqtt(String topic, String payload, uint8_t qos,
+                 AsyncUDPPacket *packet) {
+  if (topic.isEmpty() || topic.indexOf('+') != -1 ||
+      topic.indexOf('#') != -1) {
+    printResponse("MQTT_ERROR: Invalid topic", packet);
+    return;
+  }
+  std::vector<uint8_t> body;
+  putString(body, topic);
+  bool connected;
+  bool sent = false;
+  uint16_t id = 0;
+  {
+    std::lock_guard<std::mutex> lock(mqttMutex);
+    connected = current && !current->disconnecting;
+    if (connected) {
+      if (qos == 1) {
+        id = nextPacketIdLocked(*current);
+        putUint16(body, id);
+      }
+      body.insert(body.end(), payload.c_str(),
+                  payload.c_str() + payload.length());
+      sent = sendPacketLocked(*current, (MQTT_PKT_PUBLISH << 4) | (qos << 1),
+                              body);
+      current->messagesOut += sent;
+      current->inflight += sent && qos == 1;
+    }
+  }
+  if (!connected) {
+    printResponse("MQTT_ERROR: Not connected", packet);
+  } else if (!sent) {
+    printResponse("MQTT_ERROR: Send failed", packet);
+  } else if (qos == 1) {
+    printResponse("MQTT_PUBLISHED: id=" + String(id) +
+                      " bytes=" + String(payload.length()),
+                  packet);
+  } else {
+    printResponse("MQTT_PUBLISHED: bytes=" + String(payload.length()),
+                  packet);
+  }
+}
+
+/**
+ * @brief Disconnect from the broker, MQTT_CLOSED follows
+ * @param packet Pointer to AsyncUDPPacket for response
+ */
+void disconnectMqtt(AsyncUDPPacket *packet) {
+  bool connected;
+  {
+    std::lock_guard<std::mutex> lock(mqttMutex);
+    connected = current && !current->disconnecting;
+    if (connected) {
+      sendPacketLocked(*current, MQTT_PKT_DISCONNECT << 4, {});
+      current->disconnecting = true;
+    }
+  }
+  printResponse(connected ? "MQTT_DISCONNECTING" : "MQTT_ERROR: Not connected",
+                packet);
+}
+
+/**
+ * @brief Print the state and counters of the broker connection
+ * @param packet Pointer to AsyncUDPPacket for response
+ */
+void printMqttStatus(AsyncUDPPacket *packet) {
+  String status;
+  {
+    std::lock_guard<std::mutex> lock(mqttMutex);
+    if (current) {
+      uint32_t now = millis();
+      status = "MQTT_STATUS: connected broker=" + current->broker +
+               " client_id=" + current->clientId +
+               " up_s=" + String((now - current->connectedAt) / 1000) +
+               " idle_ms=" + String(now - current->lastReceiveMs) +
+               " in=" + String(current->messagesIn) + "/" +
+               String(current->bytesIn) +
+               " out=" + String(current->messagesOut) + "/" +
+               String(current->bytesOut) +
+               " inflight=" + String(current->inflight) +
+               " pings=" + String(current->pings);
+    } else {
+      status = "MQTT_STATUS: disconnected";
+    }
+  }
+  printResponse(status, packet);
+}
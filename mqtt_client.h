@@ -0,0 +1,24 @@
+#ifndef MQTT_CLIENT_H
+#define MQTT_CLIENT_H
+
+#include <Arduino.h>
+#include <AsyncUDP.h>
+
+/// Keepalive announced to the broker, a ping is sent after this much silence
+const uint16_t MQTT_KEEPALIVE_S = 60;
+
+/// Time the broker gets to answer a ping before the connection is dropped
+const uint32_t MQTT_PING_TIMEOUT_MS = 10000;
+
+/// Largest packet accepted from the broker, e.g. a PUBLISH with its topic
+const size_t MQTT_MAX_PACKET = 8192;
+
+void connectMqtt(String url, String clientId, AsyncUDPPacket *packet);
+void subscribeMqtt(String topic, uint8_t qos, AsyncUDPPacket *packet);
+void unsubscribeMqtt(String topic, AsyncUDPPacket *packet);
+void publishMqtt(String topic, String payload, uint8_t qos,
+                 AsyncUDPPacket *packet);
+void disconnectMqtt(AsyncUDPPacket *packet);
+void printMqttStatus(AsyncUDPPacket *packet);
+
+#endif // MQTT_CLIENT_H
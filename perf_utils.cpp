@@ -0,0 +1,234 @@
+/**
+ * @file perf_utils.cpp
+ * @brief On-device performance counters for the command engine
+ *
+ * This file contains lightweight timing and heap counters for command
+ * parsing, dispatch, handler execution, response formatting and the HTTP
+ * body transfer loops. The counters are read back over UART or UDP with the
+ * PERF_STATS command, so performance changes can be measured on the board.
+ * The executor and the ASYNC workers record concurrently, perfLock keeps
+ * the samples consistent.
+ */
+
+#include "perf_utils.h"
+#include "http_utils.h"
+#include <atomic>
+#include <esp_heap_caps.h>
+
+/**
+ * @struct PerfStat
+ * @brief Accumulated duration samples for one metric
+ */
+struct PerfStat {
+  uint32_t count;   ///< Number of samples
+  uint64_t totalNs; ///< Sum of all samples in nanoseconds
+  uint64_t maxNs;   ///< Longest sample in nanoseconds
+
+  void add(uint64_t ns) {                          ///< Add a sample
+    count++;
+    totalNs += ns;
+    if (ns > maxNs) {
+      maxNs = ns;
+    }
+  }
+};
+
+/**
+ * @struct PerfStreamStat
+ * @brief Accumulated body transfers for one stream path
+ */
+struct PerfStreamStat {
+  uint32_t count;   ///< Number of transfers
+  uint64_t bytes;   ///< Total bytes delivered to the sink
+  uint64_t micros;  ///< Total transfer time in microseconds
+};
+
+/// Display names for PerfMetric
+static const char *perfMetricNames[PERF_METRIC_COUNT] = {"PARSE", "DISPATCH",
+                                                         "HANDLER", "PRINT"};
+
+/// Display names for PerfStream
+static const char *perfStreamNames[PERF_STREAM_COUNT] = {"CALL", "GET_STREAM",
+                                                         "FILE_STREAM",
+                                                         "POST_STREAM"};
+
+static PerfStat perfStats[PERF_METRIC_COUNT];
+static PerfStreamStat perfStreamStats[PERF_STREAM_COUNT];
+static portMUX_TYPE perfLock = portMUX_INITIALIZER_UNLOCKED;
+
+/// Heap block accounting walks the heap, so it is off by default
+static std::atomic<bool> perfHeapTracking{false};
+static uint32_t perfHeldSamples = 0; ///< Guarded by perfLock
+static int64_t perfHeldBlocks = 0;   ///< Guarded by perfLock
+
+/// Mark of the command the calling task is running, the executor and TCP
+/// sessions run commands at the same time
+static thread_local int32_t perfHeldMark = -1;
+
+/**
+ * @brief Start a short timed section
+ * @return uint32_t Current CPU cycle count
+ */
+uint32_t perfStart() { return ESP.getCycleCount(); }
+
+/**
+ * @brief Record a short timed section started with perfStart()
+ * @param metric Metric to record into
+ * @param startCycles Value returned by perfStart()
+ */
+void perfRecord(PerfMetric metric, uint32_t startCycles) {
+  uint32_t cycles = ESP.getCycleCount() - startCycles;
+  uint64_t ns = (uint64_t)cycles * 1000 / getCpuFrequencyMhz();
+  taskENTER_CRITICAL(&perfLock);
+  perfStats[metric].add(ns);
+  taskEXIT_CRITICAL(&perfLock);
+}
+
+/**
+ * @brief Record a long timed section started with micros()
+ *
+ * Used for sections that may outlast the 32-bit cycle counter, such as
+ * command handlers that perform network requests.
+ *
+ * @param metric Metric to record into
+ * @param startMicros Value of micros() at the start of the section
+ */
+void perfRecordMicros(PerfMetric metric, uint32_t startMicros) {
+  uint64_t ns = (uint64_t)(micros() - startMicros) * 1000;
+  taskENTER_CRITICAL(&perfLock);
+  perfStats[metric].add(ns);
+  taskEXIT_CRITICAL(&perfLock);
+}
+
+/**
+ * @brief Get the number of allocated heap blocks
+ *
+ * Receivers take this mark when a command arrives, before anything is
+ * allocated for it, and hand it to the executor with the command. The
+ * count is heap-wide, so allocations of other tasks in between show up
+ * as well.
+ *
+ * @return int32_t Allocated block count, or -1 if heap tracking is disabled
+ */
+int32_t perfHeapMark() {
+  if (!perfHeapTracking.load(std::memory_order_relaxed)) {
+    return -1;
+  }
+  multi_heap_info_t info;
+  heap_caps_get_info(&info, MALLOC_CAP_DEFAULT);
+  return info.allocated_blocks;
+}
+
+/**
+ * @brief Set the mark the next perfRecordHeldBlocks() compares against
+ * @param mark Value of perfHeapMark() taken when the command arrived
+ */
+void perfMarkHeldBlocks(int32_t mark) { perfHeldMark = mark; }
+
+/**
+ * @brief Record the change in allocated heap blocks since perfMarkHeldBlocks()
+ *
+ * Called right before the command handler runs, so the sample covers the
+ * receive path, the queue, parsing and dispatch. A UDP command holds the
+ * packet copy taken in the AsyncUDP callback, one block. This is the number
+ * of blocks the path still holds, not the number of malloc() calls: a block
+ * allocated and freed in between does not show up.
+ */
+void perfRecordHeldBlocks() {
+  int32_t blocks = perfHeapMark();
+  if (perfHeldMark < 0 || blocks < 0) {
+    perfHeldMark = -1;
+    return;
+  }
+  taskENTER_CRITICAL(&perfLock);
+  perfHeldSamples++;
+  perfHeldBlocks += blocks - perfHeldMark;
+  taskEXIT_CRITICAL(&perfLock);
+  perfHeldMark = -1;
+}
+
+/**
+ * @brief Record a completed body transfer
+ * @param stream Stream path the transfer went through
+ * @param bytes Bytes delivered to the sink
+ * @param startMicros Value of micros() when the transfer started
+ */
+void perfRecordStream(PerfStream stream, size_t bytes, uint32_t startMicros) {
+  uint32_t elapsed = micros() - startMicros;
+  taskENTER_CRITICAL(&perfLock);
+  perfStreamStats[stream].count++;
+  perfStreamStats[stream].bytes += bytes;
+  perfStreamStats[stream].micros += elapsed;
+  taskEXIT_CRITICAL(&perfLock);
+}
+
+/**
+ * @brief Print all performance counters
+ * @param packet Pointer to AsyncUDPPacket for response
+ */
+void printPerfStats(AsyncUDPPacket *packet) {
+  PerfStat stats[PERF_METRIC_COUNT];
+  PerfStreamStat streamStats[PERF_STREAM_COUNT];
+  taskENTER_CRITICAL(&perfLock);
+  memcpy(stats, perfStats, sizeof(stats));
+  memcpy(streamStats, perfStreamStats, sizeof(streamStats));
+  uint32_t heldSamples = perfHeldSamples;
+  int64_t heldBlocks = perfHeldBlocks;
+  taskEXIT_CRITICAL(&perfLock);
+
+  printResponse("PERF_STATS:", packet);
+  for (int i = 0; i < PERF_METRIC_COUNT; i++) {
+    const PerfStat &stat = stats[i];
+    uint64_t avg = stat.count ? stat.totalNs / stat.count : 0;
+    printResponse("PERF_" + String(perfMetricNames[i]) +
+                      ": count=" + String(stat.count) +
+                      " avg_ns=" + String(avg) + " max_ns=" + String(stat.maxNs),
+                  packet);
+  }
+
+  if (heldSamples) {
+    printResponse("PERF_HELD_BLOCKS: per_command=" +
+                      String((float)heldBlocks / heldSamples, 2) +
+                      " samples=" + String(heldSamples),
+                  packet);
+  } else {
+    printResponse("PERF_HELD_BLOCKS: disabled (PERF_HEAP true)", packet);
+  }
+
+  for (int i = 0; i < PERF_STREAM_COUNT; i++) {
+    const PerfStreamStat &stat = streamStats[i];
+    uint32_t rate = stat.micros ? stat.bytes * 1000000ULL / stat.micros : 0;
+    printResponse("PERF_" + String(perfStreamNames[i]) +
+                      ": count=" + String(stat.count) +
+                      " bytes=" + String((uint32_t)stat.bytes) +
+                      " bytes_per_s=" + String(rate),
+                  packet);
+  }
+  printResponse("PERF_HEAP_FREE: " + String(ESP.getFreeHeap()) +
+                    " min=" + String(ESP.getMinFreeHeap()),
+                packet);
+}
+
+/**
+ * @brief Reset all performance counters
+ * @param packet Pointer to AsyncUDPPacket for response
+ */
+void resetPerfStats(AsyncUDPPacket *packet) {
+  taskENTER_CRITICAL(&perfLock);
+  memset(perfStats, 0, sizeof(perfStats));
+  memset(perfStreamStats, 0, sizeof(perfStreamStats));
+  perfHeldSamples = 0;
+  perfHeldBlocks = 0;
+  taskEXIT_CRITICAL(&perfLock);
+  printResponse("PERF_RESET: All counters reset", packet);
+}
+
+/**
+ * @brief Enable or disable heap block accounting per command
+ * @param enabled Boolean flag to enable or disable accounting
+ * @param packet Pointer to AsyncUDPPacket for response
+ */
+void setPerfHeapTracking(bool enabled, AsyncUDPPacket *packet) {
+  perfHeapTracking.store(enabled, std::memory_order_relaxed);
+  printResponse("PERF_HEAP: " + String(enabled ? "true" : "false"), packet);
+}
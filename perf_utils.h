@@ -0,0 +1,38 @@
+#ifndef PERF_UTILS_H
+#define PERF_UTILS_H
+
+#include <Arduino.h>
+#include <AsyncUDP.h>
+
+// Timed sections of the command path
+enum PerfMetric {
+  PERF_PARSE,    ///< Splitting the received line into command and argument
+  PERF_DISPATCH, ///< Looking up the command handler
+  PERF_HANDLER,  ///< Running the command handler
+  PERF_PRINT,    ///< Formatting and writing a response line
+  PERF_METRIC_COUNT
+};
+
+// Body transfer paths measured in bytes per second
+enum PerfStream {
+  PERF_STREAM_CALL, ///< GET / POST / EXECUTE_HTTP_CALL (CALL)
+  PERF_STREAM_GET,  ///< GET_STREAM / EXECUTE_HTTP_CALL (STREAM)
+  PERF_STREAM_FILE, ///< FILE_STREAM / FILE_RANGE / FILE_PAGE
+  PERF_STREAM_POST, ///< POST_STREAM
+  PERF_STREAM_COUNT
+};
+
+uint32_t perfStart();
+void perfRecord(PerfMetric metric, uint32_t startCycles);
+void perfRecordMicros(PerfMetric metric, uint32_t startMicros);
+int32_t perfHeapMark();
+void perfMarkHeldBlocks(int32_t mark);
+void perfRecordHeldBlocks();
+void perfRecordStream(PerfStream stream, size_t bytes, uint32_t startMicros);
+
+// Performance commands
+void printPerfStats(AsyncUDPPacket *packet);
+void resetPerfStats(AsyncUDPPacket *packet);
+void setPerfHeapTracking(bool enabled, AsyncUDPPacket *packet);
+
+#endif // PERF_UTILS_H
@@ -0,0 +1,389 @@
+/**
+ * @file response_cache.cpp
+ * @brief Conditional response cache on LittleFS
+ *
+ * This file contains a flash backed cache for GET responses that carry an
+ * ETag or Last-Modified header. A small index in RAM maps URLs to files in
+ * /cache; the next request for a cached URL is sent with If-None-Match /
+ * If-Modified-Since and a 304 answer is served from flash. Every file starts
+ * with its URL and validators, so the index is rebuilt from flash on boot.
+ * ASYNC workers use the cache in parallel, indexMutex guards the index.
+ */
+
+#include "response_cache.h"
+#include "http_utils.h"
+#include <LittleFS.h>
+#include <mutex>
+
+/// Directory holding the cached responses
+const char *const RESPONSE_CACHE_DIR = "/cache";
+
+/// First line of every cache file
+const char *const RESPONSE_CACHE_MAGIC = "PMC1";
+
+/**
+ * @struct CacheEntry
+ * @brief Index entry of one cached response
+ */
+struct CacheEntry {
+  String url;          ///< Request URL
+  String etag;         ///< ETag of the cached response
+  String lastModified; ///< Last-Modified of the cached response
+  size_t bodyOffset;   ///< Size of the metadata header in the file
+  size_t bodySize;     ///< Size of the cached body
+  uint32_t lastUsed;   ///< millis() of the last store or hit
+  bool valid;          ///< Entry is in use
+};
+
+/**
+ * @struct ResponseCacheStats
+ * @brief Cache counters
+ */
+struct ResponseCacheStats {
+  uint32_t hits;          ///< 304 answers served from flash
+  uint32_t misses;        ///< Requests without a cached response
+  uint32_t revalidations; ///< Conditional requests sent
+  uint32_t changed;       ///< Revalidations answered with a new body
+  uint32_t evictions;     ///< Entries dropped to stay within budget
+};
+
+static CacheEntry cacheIndex[RESPONSE_CACHE_ENTRIES];
+static ResponseCacheStats cacheStats;
+static bool cacheReady = false;
+static std::mutex indexMutex;
+
+/**
+ * @brief File name of a URL's cache entry
+ * @param url Request URL
+ * @param suffix Appended to the name, used for temporary files
+ * @return String Path below RESPONSE_CACHE_DIR
+ */
+static String cachePath(const String &url, const char *suffix = "") {
+  // FNV-1a keeps names short and stable across reboots
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0; i < url.length(); i++) {
+    hash = (hash ^ (uint8_t)url[i]) * 16777619u;
+  }
+  char name[24];
+  snprintf(name, sizeof(name), "/%08lx%s", (unsigned long)hash, suffix);
+  return String(RESPONSE_CACHE_DIR) + name;
+}
+
+/**
+ * @brief Find the index entry of a URL
+ * @param url Request URL
+ * @return CacheEntry* Entry or nullptr
+ */
+static CacheEntry *findEntry(const String &url) {
+  for (CacheEntry &entry : cacheIndex) {
+    if (entry.valid && entry.url == url) {
+      return &entry;
+    }
+  }
+  return nullptr;
+}
+
+/**
+ * @brief Delete an entry and its file
+ * @param entry Entry to delete
+ */
+static void removeEntry(CacheEntry &entry) {
+  LittleFS.remove(cachePath(entry.url));
+  entry = CacheEntry();
+}
+
+/**
+ * @brief Flash used by all entries
+ * @return size_t Bytes including metadata headers
+ */
+static size_t cacheBytes() {
+  size_t total = 0;
+  for (const CacheEntry &entry : cacheIndex) {
+    if (entry.valid) {
+      total += entry.bodyOffset + entry.bodySize;
+    }
+  }
+  return total;
+}
+
+/**
+ * @brief Evict least recently used entries until a new one fits
+ * @param bytes Size of the new entry
+ * @return CacheEntry* Free index slot
+ */
+static CacheEntry *makeRoom(size_t bytes) {
+  while (true) {
+    CacheEntry *freeSlot = nullptr;
+    CacheEntry *oldest = nullptr;
+    for (CacheEntry &entry : cacheIndex) {
+      if (!entry.valid) {
+        freeSlot = freeSlot ? freeSlot : &entry;
+      } else if (!oldest || entry.lastUsed < oldest->lastUsed) {
+        oldest = &entry;
+      }
+    }
+    if (freeSlot && cacheBytes() + bytes <= RESPONSE_CACHE_MAX_BYTES) {
+      return freeSlot;
+    }
+    removeEntry(*oldest);
+    cacheStats.evictions++;
+  }
+}
+
+/**
+ * @brief Mount LittleFS and rebuild the index from the cached files
+ * @return bool False if the file system can't be mounted, caching is off
+ */
+bool initResponseCache() {
+  if (!LittleFS.begin(true)) {
+    return false;
+  }
+  if (!LittleFS.exists(RESPONSE_CACHE_DIR)) {
+    LittleFS.mkdir(RESPONSE_CACHE_DIR);
+  }
+
+  File dir = LittleFS.open(RESPONSE_CACHE_DIR);
+  size_t count = 0;
+  for (File file = dir.openNextFile(); file; file = dir.openNextFile()) {
+    String path = file.path();
+    String magic = file.readStringUntil('\n');
+    String url = file.readStringUntil('\n');
+    String etag = file.readStringUntil('\n');
+    String lastModified = file.readStringUntil('\n');
+    size_t headerSize =
+        magic.length() + url.length() + etag.length() + lastModified.length() + 4;
+    size_t fileSize = file.size();
+    file.close();
+
+    // Unfinished writes, foreign files and overflow are dropped
+    if (magic != RESPONSE_CACHE_MAGIC || fileSize < headerSize ||
+        path != cachePath(url) || count == RESPONSE_CACHE_ENTRIES) {
+      LittleFS.remove(path);
+      continue;
+    }
+    CacheEntry &entry = cacheIndex[count++];
+    entry.url = url;
+    entry.etag = etag;
+    entry.lastModified = lastModified;
+    entry.bodyOffset = headerSize;
+    entry.bodySize = fileSize - headerSize;
+    entry.lastUsed = 0;
+    entry.valid = true;
+  }
+  dir.close();
+
+  cacheReady = true;
+  return true;
+}
+
+/**
+ * @brief Add If-None-Match / If-Modified-Since for a cached URL
+ * @param url Request URL
+ * @param http HTTPClient the request is built on
+ * @return bool True if the request was made conditional
+ */
+bool responseCacheAddValidators(const String &url, HTTPClient &http) {
+  if (!cacheReady) {
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(indexMutex);
+  CacheEntry *entry = findEntry(url);
+  if (!entry) {
+    cacheStats.misses++;
+    return false;
+  }
+  if (!entry->etag.isEmpty()) {
+    http.addHeader("If-None-Match", entry->etag);
+  }
+  if (!entry->lastModified.isEmpty()) {
+    http.addHeader("If-Modified-Since", entry->lastModified);
+  }
+  cacheStats.revalidations++;
+  return true;
+}
+
+/**
+ * @brief Open the cached body of a URL after a 304
+ * @param url Request URL
+ * @return File Positioned at the start of the body, invalid if not cached
+ */
+File responseCacheOpen(const String &url) {
+  std::lock_guard<std::mutex> lock(indexMutex);
+  CacheEntry *entry = cacheReady ? findEntry(url) : nullptr;
+  if (!entry) {
+    return File();
+  }
+  File file = LittleFS.open(cachePath(url), FILE_READ);
+  if (!file || !file.seek(entry->bodyOffset)) {
+    removeEntry(*entry);
+    return File();
+  }
+  entry->lastUsed = millis();
+  cacheStats.hits++;
+  return file;
+}
+
+/**
+ * @brief Drop the cached response of a URL
+ * @param url Request URL
+ */
+void responseCacheRemove(const String &url) {
+  std::lock_guard<std::mutex> lock(indexMutex);
+  CacheEntry *entry = cacheReady ? findEntry(url) : nullptr;
+  if (entry) {
+    removeEntry(*entry);
+  }
+}
+
+ResponseCacheWriter::~ResponseCacheWriter() { abort(); }
+
+/**
+ * @brief Start caching a 200 response
+ * @param url Request URL
+ * @param etag ETag header of the response, may be empty
+ * @param lastModified Last-Modified header of the response, may be empty
+ * @param contentLength Content-Length of the response, -1 if unknown
+ * @return bool True if the body will be cached
+ */
+bool ResponseCacheWriter::begin(const String &url, const String &etag,
+                                const String &lastModified,
+                                int contentLength) {
+  if (!cacheReady || (etag.isEmpty() && lastModified.isEmpty()) ||
+      contentLength > (int)RESPONSE_CACHE_MAX_ENTRY_BYTES) {
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(indexMutex);
+  if (LittleFS.exists(cachePath(url, ".tmp"))) {
+    return false; // Another request is caching the same URL
+  }
+  _file = LittleFS.open(cachePath(url, ".tmp"), FILE_WRITE);
+  if (!_file) {
+    return false;
+  }
+  _url = url;
+  _etag = etag;
+  _lastModified = lastModified;
+  _headerSize = _file.print(String(RESPONSE_CACHE_MAGIC) + "\n" + url + "\n" +
+                            etag + "\n" + lastModified + "\n");
+  _bodySize = 0;
+  _active = true;
+  return true;
+}
+
+size_t ResponseCacheWriter::write(uint8_t data) { return write(&data, 1); }
+
+size_t ResponseCacheWriter::write(const uint8_t *buf, size_t size) {
+  if (!_active) {
+    return size;
+  }
+  if (_bodySize + size > RESPONSE_CACHE_MAX_ENTRY_BYTES ||
+      _file.write(buf, size) != size) {
+    abort();
+    return size;
+  }
+  _bodySize += size;
+  return size;
+}
+
+/**
+ * @brief Publish the cached body, or discard it if the transfer broke off
+ * @param complete True if the whole body was received
+ */
+void ResponseCacheWriter::commit(bool complete) {
+  if (!_active) {
+    return;
+  }
+  if (!complete) {
+    abort();
+    return;
+  }
+  _file.close();
+  _active = false;
+
+  std::lock_guard<std::mutex> lock(indexMutex);
+  String path = cachePath(_url);
+  for (CacheEntry &entry : cacheIndex) {
+    if (entry.valid && cachePath(entry.url) == path) {
+      // Same URL, or a different one whose name collides
+      if (entry.url == _url) {
+        cacheStats.changed++;
+      }
+      removeEntry(entry);
+    }
+  }
+  CacheEntry *entry = makeRoom(_headerSize + _bodySize);
+  if (!LittleFS.rename(cachePath(_url, ".tmp"), path)) {
+    LittleFS.remove(cachePath(_url, ".tmp"));
+    return;
+  }
+  entry->url = _url;
+  entry->etag = _etag;
+  entry->lastModified = _lastModified;
+  entry->bodyOffset = _headerSize;
+  entry->bodySize = _bodySize;
+  entry->lastUsed = millis();
+  entry->valid = true;
+}
+
+/**
+ * @brief Stop caching and delete the temporary file
+ */
+void ResponseCacheWriter::abort() {
+  if (_active) {
+    _file.close();
+    LittleFS.remove(cachePath(_url, ".tmp"));
+    _active = false;
+  }
+}
+
+/**
+ * @brief Delete all cached responses
+ * @param packet Pointer to AsyncUDPPacket for response
+ */
+void clearResponseCache(AsyncUDPPacket *packet) {
+  {
+    std::lock_guard<std::mutex> lock(indexMutex);
+    for (CacheEntry &entry : cacheIndex) {
+      if (entry.valid) {
+        removeEntry(entry);
+      }
+    }
+  }
+  printResponse("CACHE_CLEARED", packet);
+}
+
+/**
+ * @brief Print response cache counters
+ * @param packet Pointer to AsyncUDPPacket for response
+ */
+void printResponseCacheStats(AsyncUDPPacket *packet) {
+  if (!cacheReady) {
+    printResponse("CACHE_ERROR: LittleFS not mounted, caching disabled",
+                  packet);
+    return;
+  }
+  size_t entries = 0;
+  size_t bytes;
+  ResponseCacheStats stats;
+  {
+    std::lock_guard<std::mutex> lock(indexMutex);
+    for (const CacheEntry &entry : cacheIndex) {
+      if (entry.valid) {
+        entries++;
+      }
+    }
+    bytes = cacheBytes();
+    stats = cacheStats;
+  }
+  printResponse("CACHE: entries=" + String(entries) + "/" +
+                    String(RESPONSE_CACHE_ENTRIES) +
+                    " bytes=" + String(bytes) + "/" +
+                    String(RESPONSE_CACHE_MAX_BYTES),
+                packet);
+  printResponse("CACHE_REQUESTS: hits=" + String(stats.hits) +
+                    " misses=" + String(stats.misses) +
+                    " revalidations=" + String(stats.revalidations) +
+                    " changed=" + String(stats.changed) +
+                    " evictions=" + String(stats.evictions),
+                packet);
+}
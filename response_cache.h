@@ -0,0 +1,54 @@
+#ifndef RESPONSE_CACHE_H
+#define RESPONSE_CACHE_H
+
+#include <Arduino.h>
+#include <AsyncUDP.h>
+#include <FS.h>
+#include <HTTPClient.h>
+
+/// Maximum number of cached responses
+const size_t RESPONSE_CACHE_ENTRIES = 16;
+
+/// Flash budget for all cached responses
+const size_t RESPONSE_CACHE_MAX_BYTES = 256 * 1024;
+
+/// Larger responses are not cached
+const size_t RESPONSE_CACHE_MAX_ENTRY_BYTES = 64 * 1024;
+
+/**
+ * @brief Copies a response body into the cache while it is streamed
+ *
+ * begin() opens a temporary file, write() appends body bytes (the body is
+ * dropped silently once it outgrows RESPONSE_CACHE_MAX_ENTRY_BYTES) and
+ * commit() moves the file into the cache if the whole body arrived. The
+ * previous entry for the URL stays valid until then.
+ */
+class ResponseCacheWriter : public Print {
+public:
+  ~ResponseCacheWriter();
+  bool begin(const String &url, const String &etag, const String &lastModified,
+             int contentLength);
+  size_t write(uint8_t data) override;
+  size_t write(const uint8_t *buf, size_t size) override;
+  void commit(bool complete);
+
+private:
+  void abort();
+
+  File _file;
+  String _url;
+  String _etag;
+  String _lastModified;
+  size_t _headerSize = 0;
+  size_t _bodySize = 0;
+  bool _active = false;
+};
+
+bool initResponseCache();
+bool responseCacheAddValidators(const String &url, HTTPClient &http);
+File responseCacheOpen(const String &url);
+void responseCacheRemove(const String &url);
+void clearResponseCache(AsyncUDPPacket *packet);
+void printResponseCacheStats(AsyncUDPPacket *packet);
+
+#endif // RESPONSE_CACHE_H
@@ -0,0 +1,81 @@
+#ifndef RING_BUFFER_H
+#define RING_BUFFER_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Lock-free single-producer / single-consumer ring buffer
+ *
+ * One task (or callback) may push while another pops without locking.
+ * Capacity must be a power of two; one slot is never used so that a full
+ * buffer can be told apart from an empty one.
+ *
+ * @tparam T Element type
+ * @tparam Capacity Number of slots, power of two
+ */
+template <typename T, size_t Capacity> class SpscRing {
+  static_assert((Capacity & (Capacity - 1)) == 0,
+                "SpscRing capacity must be a power of two");
+
+public:
+  /// Push one element, returns false if the buffer is full
+  bool push(const T &value) {
+    size_t head = _head.load(std::memory_order_relaxed);
+    size_t next = (head + 1) & (Capacity - 1);
+    if (next == _tail.load(std::memory_order_acquire)) {
+      return false;
+    }
+    _slots[head] = value;
+    _head.store(next, std::memory_order_release);
+    return true;
+  }
+
+  /// Push up to count elements, returns the number pushed
+  size_t push(const T *values, size_t count) {
+    size_t pushed = 0;
+    while (pushed < count && push(values[pushed])) {
+      pushed++;
+    }
+    return pushed;
+  }
+
+  /// Pop one element, returns false if the buffer is empty
+  bool pop(T &value) {
+    size_t tail = _tail.load(std::memory_order_relaxed);
+    if (tail == _head.load(std::memory_order_acquire)) {
+      return false;
+    }
+    value = _slots[tail];
+    _tail.store((tail + 1) & (Capacity - 1), std::memory_order_release);
+    return true;
+  }
+
+  /// Pop up to count elements, returns the number popped
+  size_t pop(T *values, size_t count) {
+    size_t popped = 0;
+    while (popped < count && pop(values[popped])) {
+      popped++;
+    }
+    return popped;
+  }
+
+  /// Number of elements waiting (approximate when called concurrently)
+  size_t size() const {
+    return (_head.load(std::memory_order_acquire) -
+            _tail.load(std::memory_order_acquire)) &
+           (Capacity - 1);
+  }
+
+  bool empty() const { return size() == 0; }
+
+  static constexpr size_t capacity() { return Capacity - 1; }
+
+private:
+  T _slots[Capacity];
+  std::atomic<size_t> _head{0};
+  std::atomic<size_t> _tail{0};
+};
+
+#endif // RING_BUFFER_H
@@ -0,0 +1,100 @@
+/**
+ * @file socket_utils.cpp
+ * @brief Waiting on sockets and reading for long-lived connections
+ *
+ * This file contains the helpers shared by the TCP sessions, the HTTP body
+ * reader and the MQTT and WebSocket receivers. Tasks sleep in select() on
+ * the connection's socket instead of polling, so they wake up as soon as
+ * the next segment arrives.
+ *
+ * A TLS context can't be used by two tasks at once. A receiver therefore
+ * only touches its client under the connection's mutex, and only for
+ * non-blocking reads; writers take the same mutex. socketReceive() drops
+ * the mutex before it sleeps, so a writer is never held up by an idle
+ * connection.
+ */
+
+#include "socket_utils.h"
+#include <lwip/sockets.h>
+
+/**
+ * @brief Block until the socket has data, closes or the timeout expires
+ * @param socket Socket of the connection
+ * @param timeout_ms Maximum time to wait
+ * @return bool False if nothing happened within the timeout
+ */
+bool waitForSocket(int socket, uint32_t timeout_ms) {
+  if (socket < 0) {
+    return false;
+  }
+  fd_set readable;
+  FD_ZERO(&readable);
+  FD_SET(socket, &readable);
+  struct timeval tv;
+  tv.tv_sec = timeout_ms / 1000;
+  tv.tv_usec = (timeout_ms % 1000) * 1000;
+  return select(socket + 1, &readable, nullptr, nullptr, &tv) > 0;
+}
+
+/**
+ * @brief Block until the client has data or closes
+ *
+ * Data the client already buffered (decrypted TLS records, for one) does
+ * not show on the socket, so it is checked first. Only for a client no
+ * other task uses at the same time.
+ *
+ * @param client Client connection
+ * @param timeout_ms Maximum time to wait
+ * @return bool False if nothing happened within the timeout
+ */
+bool waitForClient(NetworkClient &client, uint32_t timeout_ms) {
+  if (client.available() > 0) {
+    return true;
+  }
+  return waitForSocket(client.fd(), timeout_ms);
+}
+
+/**
+ * @brief One step of a receiver loop: read what arrived or wait for it
+ *
+ * Reads what the client has buffered under mutex. If there is nothing,
+ * sleeps in select() without the mutex for up to wait_ms.
+ *
+ * @param mutex Mutex guarding the connection
+ * @param client Client connection
+ * @param buf Destination buffer
+ * @param size Free space in buf
+ * @param wait_ms Longest sleep, until the receiver's next timer is due
+ * @return int Bytes read, 0 if none arrived, -1 if the connection closed
+ */
+int socketReceive(std::mutex &mutex, NetworkClient &client, uint8_t *buf,
+                  size_t size, uint32_t wait_ms) {
+  int n;
+  bool connected;
+  int socket;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    n = client.available() > 0 ? client.read(buf, size) : 0;
+    connected = n > 0 || client.connected();
+    socket = client.fd();
+  }
+  if (n > 0) {
+    return n;
+  }
+  if (!connected) {
+    return -1;
+  }
+  waitForSocket(socket, wait_ms);
+  return 0;
+}
+
+/**
+ * @brief Time left until a deadline
+ * @param deadline millis() value
+ * @param now Current millis()
+ * @return uint32_t Milliseconds until the deadline, 0 if it passed
+ */
+uint32_t millisUntil(uint32_t deadline, uint32_t now) {
+  int32_t remaining = (int32_t)(deadline - now);
+  return remaining > 0 ? remaining : 0;
+}
@@ -0,0 +1,69 @@
+#ifndef SOCKET_UTILS_H
+#define SOCKET_UTILS_H
+
+#include <Arduino.h>
+#include <NetworkClient.h>
+#include <mutex>
+
+bool waitForSocket(int socket, uint32_t timeout_ms);
+bool waitForClient(NetworkClient &client, uint32_t timeout_ms);
+int socketReceive(std::mutex &mutex, NetworkClient &client, uint8_t *buf,
+                  size_t size, uint32_t wait_ms);
+uint32_t millisUntil(uint32_t deadline, uint32_t now);
+
+/**
+ * @brief Make a new connection the current one unless another is open
+ *
+ * Connecting and the handshake run without the mutex, so another session
+ * may have connected in the meantime.
+ *
+ * @param mutex Mutex guarding current
+ * @param current Open connection of the client, null if none
+ * @param connection Connection that finished its handshake
+ * @return bool False if another connection is open, connection is then
+ *         still the caller's
+ */
+template <typename Connection>
+bool claimConnection(std::mutex &mutex, Connection *&current,
+                     Connection *connection) {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (current != nullptr) {
+    return false;
+  }
+  current = connection;
+  return true;
+}
+
+/**
+ * @brief Start the receiver task of a claimed connection
+ *
+ * If the task can't be created the connection is released again: it stops
+ * being current, is closed and deleted.
+ *
+ * @param task Receiver task, gets the connection as its parameter
+ * @param name Task name
+ * @param stackSize Task stack size
+ * @param priority Task priority
+ * @param mutex Mutex guarding current
+ * @param current Open connection of the client
+ * @param connection Connection passed to claimConnection()
+ * @return bool False if the task could not be created
+ */
+template <typename Connection>
+bool startReceiver(TaskFunction_t task, const char *name, uint32_t stackSize,
+                   UBaseType_t priority, std::mutex &mutex,
+                   Connection *&current, Connection *connection) {
+  if (xTaskCreate(task, name, stackSize, connection, priority, NULL) ==
+      pdPASS) {
+    return true;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    current = nullptr;
+    connection->client->stop();
+  }
+  delete connection;
+  return false;
+}
+
+#endif // SOCKET_UTILS_H
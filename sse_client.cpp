@@ -0,0 +1,509 @@
+/**
+ * @file sse_client.cpp
+ * @brief Server-Sent Events subscription forwarding events to the UART
+ *
+ * This file contains an EventSource client for one text/event-stream at a
+ * time. SSE_CONNECT starts a task that opens the stream with the same
+ * PooledHTTPClient and HttpBodyReader as GET_STREAM, so chunked and
+ * close-delimited streams are both read incrementally, and parses the body
+ * into events as it arrives. Each event is forwarded as one line:
+ *
+ *   SSE_EVENT: event=<type> id=<id> data=<data>
+ *
+ * Multi-line data is joined with an escaped "\n" so an event never spans
+ * lines. When the stream ends or stays silent for SSE_IDLE_TIMEOUT_MS, the
+ * task waits the retry: delay of the server and reopens it, sending the
+ * last seen ID as Last-Event-ID so the server can resume where it left off.
+ */
+
+#include "sse_client.h"
+#include "http_body.h"
+#include "http_pool.h"
+#include "http_utils.h"
+#include "uart_frame.h"
+#include <WiFi.h>
+#include <atomic>
+#include <mutex>
+
+/// Stack size of the stream task, HTTPS needs the same as the executor
+const uint32_t SSE_TASK_STACK_SIZE = 12 * 1024;
+
+/// Stream task priority, same as the executor
+const UBaseType_t SSE_TASK_PRIORITY = 2;
+
+/// Longest wait on the socket, so SSE_CLOSE is noticed quickly
+const uint32_t SSE_POLL_MS = 250;
+
+/**
+ * @struct SseSubscription
+ * @brief The open event stream, the state kept across reconnects and counters
+ *
+ * The task is the only writer; other tasks read under sseMutex. Strings
+ * are only changed under sseMutex, counters may be seen half updated.
+ */
+struct SseSubscription {
+  String url;
+  String filter;                 ///< Event type to forward, empty for all
+  String lastEventId;            ///< Sent as Last-Event-ID on reconnect
+  uint32_t retryMs = SSE_DEFAULT_RETRY_MS;
+  std::atomic<bool> stop{false}; ///< Set by SSE_CLOSE
+
+  bool open = false;             ///< Stream is being read
+  uint32_t startedAt = 0;        ///< millis() of SSE_CONNECT
+  uint32_t lastReceiveMs = 0;    ///< millis() of the last received byte
+  uint32_t connects = 0;         ///< Streams opened
+  uint32_t events = 0;           ///< Events forwarded
+  uint32_t filtered = 0;         ///< Events skipped by the filter
+  uint32_t dropped = 0;          ///< Events above SSE_MAX_EVENT
+  uint32_t bytesIn = 0;          ///< Body bytes received
+};
+
+/**
+ * @brief Incremental text/event-stream parser
+ *
+ * Lines end with CRLF, LF or CR, also when the terminator is split over two
+ * reads. Fields follow the EventSource rules: a blank line dispatches the
+ * event, lines starting with ':' are comments (keepalives), unknown fields
+ * are ignored and the event is not dispatched when it has no data.
+ */
+class SseParser {
+public:
+  SseParser(SseSubscription &subscription, const String &lastEventId)
+      : _sub(subscription), _idBuffer(lastEventId) {}
+  void feed(const uint8_t *data, size_t length);
+
+private:
+  void appendLine(const uint8_t *data, size_t length);
+  void processLine();
+  void processField(const String &field, const String &value);
+  void dispatch();
+
+  SseSubscription &_sub;
+  String _line;
+  String _eventType;
+  String _data;
+  String _idBuffer;      ///< Last event ID buffer of the stream
+  bool _lineOverflow = false;
+  bool _eventOverflow = false;
+  bool _afterCR = false; ///< Previous byte ended a line with CR
+  bool _started = false; ///< Past the optional byte order mark
+};
+
+/// Guards current, the lifetime of the subscription and its strings
+static std::mutex sseMutex;
+static SseSubscription *current = nullptr;
+
+/**
+ * @brief Print an event line on the events channel
+ * @param prefix Text before the detail, e.g. "SSE_OPEN: "
+ * @param detail Event detail
+ */
+static void printSseEvent(const char *prefix, const String &detail) {
+  uartWriteEvent(prefix, (const uint8_t *)detail.c_str(), detail.length());
+}
+
+/**
+ * @brief Parse received body bytes, dispatching every complete event
+ * @param data Body bytes
+ * @param length Number of bytes
+ */
+void SseParser::feed(const uint8_t *data, size_t length) {
+  size_t i = 0;
+  if (!_started && length > 0) {
+    _started = true;
+    if (length >= 3 && data[0] == 0xEF && data[1] == 0xBB && data[2] == 0xBF) {
+      i = 3;
+    }
+  }
+  while (i < length) {
+    if (_afterCR) {
+      _afterCR = false;
+      if (data[i] == '\n') {
+        i++;
+        continue;
+      }
+    }
+    size_t end = i;
+    while (end < length && data[end] != '\n' && data[end] != '\r') {
+      end++;
+    }
+    appendLine(data + i, end - i);
+    if (end == length) {
+      return; // Line continues in the next read
+    }
+    _afterCR = data[end] == '\r';
+    processLine();
+    i = end + 1;
+  }
+}
+
+/**
+ * @brief Add bytes to the line being received
+ * @param data Line bytes
+ * @param length Number of bytes
+ */
+void SseParser::appendLine(const uint8_t *data, size_t length) {
+  if (length == 0 || _lineOverflow) {
+    return;
+  }
+  if (_line.length() + length > SSE_MAX_EVENT) {
+    _lineOverflow = true;
+    _line = String();
+    return;
+  }
+  _line.concat((const char *)data, length);
+}
+
+/**
+ * @brief Handle a complete line
+ */
+void SseParser::processLine() {
+  if (_lineOverflow) {
+    // Only data lines grow that long, so the event is lost either way
+    _lineOverflow = false;
+    _eventOverflow = true;
+    return;
+  }
+  if (_line.isEmpty()) {
+    dispatch();
+    return;
+  }
+  if (_line[0] != ':') {
+    int colon = _line.indexOf(':');
+    if (colon < 0) {
+      processField(_line, String());
+    } else {
+      int valueStart = colon + 1;
+      if (valueStart < (int)_line.length() && _line[valueStart] == ' ') {
+        valueStart++;
+      }
+      processField(_line.substring(0, colon), _line.substring(valueStart));
+    }
+  }
+  _line = String();
+}
+
+/**
+ * @brief Apply one field of the event being received
+ * @param field Field name
+ * @param value Field value without the leading space
+ */
+void SseParser::processField(const String &field, const String &value) {
+  if (field == "data") {
+    if (_data.length() + value.length() + 1 > SSE_MAX_EVENT) {
+      _eventOverflow = true;
+      _data = String();
+    } else if (!_eventOverflow) {
+      _data += value;
+      _data += '\n';
+    }
+  } else if (field == "event") {
+    _eventType = value;
+  } else if (field == "id") {
+    _idBuffer = value;
+  } else if (field == "retry") {
+    bool digits = !value.isEmpty();
+    for (size_t i = 0; i < value.length() && digits; i++) {
+      digits = isdigit((unsigned char)value[i]);
+    }
+    if (digits) {
+      uint32_t retry = min((uint32_t)value.toInt(), SSE_MAX_RETRY_MS);
+      std::lock_guard<std::mutex> lock(sseMutex);
+      _sub.retryMs = retry;
+    }
+  }
+}
+
+/**
+ * @brief Forward the received event and start the next one
+ */
+void SseParser::dispatch() {
+  {
+    std::lock_guard<std::mutex> lock(sseMutex);
+    _sub.lastEventId = _idBuffer;
+  }
+  String type = _eventType.isEmpty() ? String("message") : _eventType;
+  bool overflow = _eventOverflow;
+  String data = _data;
+  _eventType = String();
+  _data = String();
+  _eventOverflow = false;
+
+  if (overflow) {
+    _sub.dropped++;
+    printSseEvent("SSE_DROPPED: ",
+                  "event=" + type + " reason=larger than " +
+                      String(SSE_MAX_EVENT) + " bytes");
+    return;
+  }
+  if (data.isEmpty()) {
+    return;
+  }
+  if (!_sub.filter.isEmpty() && type != _sub.filter) {
+    _sub.filtered++;
+    return;
+  }
+
+  // Drop the newline after the last data line, escape the others
+  data.remove(data.length() - 1);
+  String line;
+  line.reserve(type.length() + _idBuffer.length() + data.length() + 24);
+  line = "event=" + type;
+  if (!_idBuffer.isEmpty()) {
+    line += " id=" + _idBuffer;
+  }
+  line += " data=";
+  for (size_t i = 0; i < data.length(); i++) {
+    char c = data[i];
+    if (c == '\n') {
+      line += "\\n";
+    } else if (c == '\\') {
+      line += "\\\\";
+    } else {
+      line += c;
+    }
+  }
+  _sub.events++;
+  printSseEvent("SSE_EVENT: ", line);
+}
+
+/**
+ * @brief Open the stream once and read it until it ends
+ * @param sub Subscription to read
+ * @param fatal Set when the stream must not be reopened
+ * @return String Why the stream ended
+ */
+static String readEventStream(SseSubscription &sub, bool &fatal) {
+  if (WiFi.status() != WL_CONNECTED) {
+    return "WiFi not connected";
+  }
+
+  String url;
+  String lastEventId;
+  {
+    std::lock_guard<std::mutex> lock(sseMutex);
+    url = sub.url;
+    lastEventId = sub.lastEventId;
+  }
+
+  PooledHTTPClient http;
+  http.setFollowRedirects(HTTPC_STRICT_FOLLOW_REDIRECTS);
+  if (!http.begin(url)) {
+    fatal = true;
+    return "invalid URL";
+  }
+  http.addHeader("Accept", "text/event-stream");
+  http.addHeader("Cache-Control", "no-cache");
+  if (!lastEventId.isEmpty()) {
+    http.addHeader("Last-Event-ID", lastEventId);
+  }
+  const char *headers[] = {"Content-Type"};
+  http.collectHeaders(headers, 1);
+
+  int code = http.GET();
+  if (code <= 0) {
+    return HTTPClient::errorToString(code);
+  }
+  if (code == 204) {
+    // The server's way of saying the stream is over for good
+    fatal = true;
+    return "HTTP 204";
+  }
+  if (code != HTTP_CODE_OK) {
+    // Server errors are often a restart in progress, worth another try
+    fatal = code < 500;
+    return "HTTP " + String(code);
+  }
+  String contentType = http.header("Content-Type");
+  contentType.toLowerCase();
+  if (!contentType.startsWith("text/event-stream")) {
+    fatal = true;
+    return "not an event stream: " + contentType;
+  }
+
+  sub.connects++;
+  sub.lastReceiveMs = millis();
+  {
+    std::lock_guard<std::mutex> lock(sseMutex);
+    sub.open = true;
+  }
+  printSseEvent("SSE_OPEN: ", url);
+
+  HttpBodyReader body(http);
+  SseParser parser(sub, lastEventId);
+  uint8_t chunk[512];
+  String reason = "stream ended";
+  while (!body.finished()) {
+    if (sub.stop.load()) {
+      body.abandon();
+      break;
+    }
+    int n = body.read(chunk, sizeof(chunk));
+    if (n > 0) {
+      sub.bytesIn += n;
+      sub.lastReceiveMs = millis();
+      parser.feed(chunk, n);
+    } else if (!body.waitForData(SSE_POLL_MS)) {
+      if (!http.connected()) {
+        body.abandon();
+      } else if (millis() - sub.lastReceiveMs >= SSE_IDLE_TIMEOUT_MS) {
+        reason = "idle timeout";
+        body.abandon();
+      }
+    }
+  }
+  {
+    std::lock_guard<std::mutex> lock(sseMutex);
+    sub.open = false;
+  }
+  return reason;
+}
+
+/**
+ * @brief Stream task, keeps the stream open until SSE_CLOSE or a fatal error
+ * @param parameter The SseSubscription
+ */
+static void sseTask(void *parameter) {
+  SseSubscription *sub = (SseSubscription *)parameter;
+  uint32_t failures = 0;
+  String reason;
+  for (;;) {
+    uint32_t connectsBefore = sub->connects;
+    bool fatal = false;
+    reason = readEventStream(*sub, fatal);
+    if (sub->stop.load()) {
+      reason = "closed";
+      break;
+    }
+    if (fatal) {
+      break;
+    }
+
+    // Back off while the stream can't be opened, the retry: delay otherwise
+    failures = sub->connects != connectsBefore ? 0 : failures + 1;
+    uint32_t delay;
+    {
+      std::lock_guard<std::mutex> lock(sseMutex);
+      delay = sub->retryMs;
+    }
+    for (uint32_t i = 0; i < failures && delay < SSE_MAX_RETRY_MS; i++) {
+      delay *= 2;
+    }
+    delay = min(delay, SSE_MAX_RETRY_MS);
+    printSseEvent("SSE_RECONNECT: ",
+                  "in_ms=" + String(delay) + " reason=" + reason);
+
+    uint32_t waitStart = millis();
+    while (!sub->stop.load() && millis() - waitStart < delay) {
+      vTaskDelay(pdMS_TO_TICKS(SSE_POLL_MS));
+    }
+    if (sub->stop.load()) {
+      reason = "closed";
+      break;
+    }
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(sseMutex);
+    current = nullptr;
+  }
+  printSseEvent("SSE_CLOSED: ", "reason=" + reason);
+  delete sub;
+  vTaskDelete(NULL);
+}
+
+/**
+ * @brief Subscribe to an event stream, its events are forwarded as events
+ * @param url http:// or https:// URL of the stream
+ * @param eventType Only forward events of this type, empty for all
+ * @param packet Pointer to AsyncUDPPacket for response
+ */
+void connectEventSource(String url, String eventType, AsyncUDPPacket *packet) {
+  if (!url.startsWith("http://") && !url.startsWith("https://")) {
+    printResponse("SSE_ERROR: Invalid URL", packet);
+    return;
+  }
+  if (WiFi.status() != WL_CONNECTED) {
+    printResponse("SSE_ERROR: WiFi not connected", packet);
+    return;
+  }
+
+  SseSubscription *sub = new SseSubscription();
+  sub->url = url;
+  sub->filter = eventType;
+  sub->startedAt = millis();
+  sub->lastReceiveMs = sub->startedAt;
+  {
+    std::lock_guard<std::mutex> lock(sseMutex);
+    if (current) {
+      delete sub;
+      sub = nullptr;
+    } else {
+      current = sub;
+    }
+  }
+  if (!sub) {
+    printResponse("SSE_ERROR: Already subscribed, send SSE_CLOSE first",
+                  packet);
+    return;
+  }
+  // Report the subscription before the task can forward an event
+  printResponse("SSE_CONNECTING: " + url, packet);
+  if (xTaskCreate(sseTask, "sse_stream", SSE_TASK_STACK_SIZE, sub,
+                  SSE_TASK_PRIORITY, NULL) != pdPASS) {
+    {
+      std::lock_guard<std::mutex> lock(sseMutex);
+      current = nullptr;
+    }
+    delete sub;
+    printResponse("SSE_ERROR: Could not start the stream task", packet);
+  }
+}
+
+/**
+ * @brief End the subscription, SSE_CLOSED follows when the task stops
+ * @param packet Pointer to AsyncUDPPacket for response
+ */
+void closeEventSource(AsyncUDPPacket *packet) {
+  bool subscribed;
+  {
+    std::lock_guard<std::mutex> lock(sseMutex);
+    subscribed = current != nullptr;
+    if (subscribed) {
+      current->stop.store(true);
+    }
+  }
+  printResponse(subscribed ? "SSE_CLOSING" : "SSE_ERROR: Not subscribed",
+                packet);
+}
+
+/**
+ * @brief Print the state and counters of the event stream
+ * @param packet Pointer to AsyncUDPPacket for response
+ */
+void printEventSourceStatus(AsyncUDPPacket *packet) {
+  String status;
+  {
+    std::lock_guard<std::mutex> lock(sseMutex);
+    if (current) {
+      uint32_t now = millis();
+      status = "SSE_STATUS: " +
+               String(current->open ? "open" : "reconnecting") +
+               " url=" + current->url +
+               " up_s=" + String((now - current->startedAt) / 1000) +
+               " idle_ms=" + String(now - current->lastReceiveMs) +
+               " connects=" + String(current->connects) +
+               " events=" + String(current->events) +
+               " filtered=" + String(current->filtered) +
+               " dropped=" + String(current->dropped) +
+               " bytes=" + String(current->bytesIn) +
+               " retry_ms=" + String(current->retryMs);
+      if (!current->lastEventId.isEmpty()) {
+        status += " last_id=" + current->lastEventId;
+      }
+    } else {
+      status = "SSE_STATUS: disconnected";
+    }
+  }
+  printResponse(status, packet);
+}
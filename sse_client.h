@@ -0,0 +1,23 @@
+#ifndef SSE_CLIENT_H
+#define SSE_CLIENT_H
+
+#include <Arduino.h>
+#include <AsyncUDP.h>
+
+/// Largest event (data lines included) accepted from the server
+const size_t SSE_MAX_EVENT = 8192;
+
+/// Reconnection delay until the server sends a retry: field
+const uint32_t SSE_DEFAULT_RETRY_MS = 3000;
+
+/// Upper bound of the reconnection delay, also caps retry: values
+const uint32_t SSE_MAX_RETRY_MS = 60000;
+
+/// Silence after which the stream is considered dead and reopened
+const uint32_t SSE_IDLE_TIMEOUT_MS = 120000;
+
+void connectEventSource(String url, String eventType, AsyncUDPPacket *packet);
+void closeEventSource(AsyncUDPPacket *packet);
+void printEventSourceStatus(AsyncUDPPacket *packet);
+
+#endif // SSE_CLIENT_H
@@ -0,0 +1,340 @@
+/**
+ * @file tcp_server.cpp
+ * @brief Persistent TCP command sessions next to the UDP listener
+ *
+ * This file contains a TCP server on the UDP command port. Every session
+ * gets its own task that reads command lines and queues them for the
+ * executor with the session as console, then waits until the command
+ * finished. Commands of all channels thus run one at a time. Responses take
+ * the same path as UART output, so bodies leave the stream loop in large
+ * writes, and a client that reads slowly holds the body loop back through
+ * the TCP window instead of losing data.
+ */
+
+#include "tcp_server.h"
+#include "command_queue.h"
+#include "http_utils.h"
+#include "perf_utils.h"
+#include "socket_utils.h"
+#include "uart_frame.h"
+#include "uart_utils.h"
+#include <NetworkClient.h>
+#include <WiFi.h>
+#include <mutex>
+
+/// Stack size of a session task, commands run on the executor
+const uint32_t TCP_SESSION_STACK_SIZE = 4 * 1024;
+
+/// Stack size of the listener task, it only accepts connections
+const uint32_t TCP_LISTENER_STACK_SIZE = 4 * 1024;
+
+/// Session and listener priority, same as the executor
+const UBaseType_t TCP_TASK_PRIORITY = 2;
+
+/// How often the listener checks for new connections
+const uint32_t TCP_ACCEPT_POLL_MS = 100;
+
+/// How often an idle session checks that its client is still connected
+const uint32_t TCP_IDLE_CHECK_MS = 30000;
+
+/**
+ * @brief One client connection and its counters
+ *
+ * Counters are written by the session task only; other tasks read them
+ * under sessionsMutex, which keeps the session alive but may see a
+ * command half accounted.
+ */
+class TcpSession : public Print {
+public:
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t *data, size_t length) override;
+
+  NetworkClient client;
+  uint8_t id;                    ///< 1-based session number
+  IPAddress remoteIP;
+  uint16_t remotePort;
+  uint32_t connectedAt;          ///< millis() when the session opened
+  /// Command line being received
+  char line[MAX_COMMAND_LENGTH + 1];
+  size_t lineLength = 0;
+  bool lineOverflow = false;
+
+  uint32_t commands = 0;         ///< Commands run
+  uint32_t bytesIn = 0;          ///< Bytes received
+  uint32_t bytesOut = 0;         ///< Bytes sent
+  uint32_t commandStartUs = 0;   ///< micros() when the command arrived
+  bool waitingFirstByte = false; ///< No output yet for this command
+  uint64_t totalFirstByteUs = 0; ///< Sum of times to the first output byte
+  uint64_t totalCommandUs = 0;   ///< Sum of command run times
+  uint32_t maxCommandUs = 0;     ///< Longest command
+  uint64_t commandBytesOut = 0;  ///< Bytes sent while commands ran
+};
+
+static NetworkServer server(TCP_SERVER_PORT, TCP_MAX_SESSIONS);
+static bool serverStarted = false;
+
+/// Guards sessions[] and the lifetime of the sessions in it
+static std::mutex sessionsMutex;
+static TcpSession *sessions[TCP_MAX_SESSIONS];
+static uint32_t acceptedSessions = 0;
+static uint32_t rejectedSessions = 0;
+
+/**
+ * @brief Send output to the client, waiting while its receive window is full
+ * @param data Output bytes
+ * @param length Number of bytes
+ * @return size_t Bytes sent, less if the client went away
+ */
+size_t TcpSession::write(const uint8_t *data, size_t length) {
+  if (waitingFirstByte && length > 0) {
+    waitingFirstByte = false;
+    totalFirstByteUs += micros() - commandStartUs;
+  }
+  size_t sent = 0;
+  while (sent < length && client.connected()) {
+    size_t n = client.write(data + sent, length - sent);
+    if (n == 0) {
+      break; // The client stopped reading for the whole write timeout
+    }
+    sent += n;
+  }
+  bytesOut += sent;
+  return sent;
+}
+
+/**
+ * @brief Run one received command line on the executor and wait for it
+ *
+ * The executor writes to the session while this task waits, so the
+ * counters keep a single writer at a time.
+ *
+ * @param session Session the line came from
+ */
+static void runSessionLine(TcpSession &session) {
+  const char *line = session.line;
+  size_t length = session.lineLength;
+  while (length > 0 && isspace((unsigned char)line[0])) {
+    line++;
+    length--;
+  }
+  while (length > 0 && isspace((unsigned char)line[length - 1])) {
+    length--;
+  }
+  if (length == 0) {
+    return;
+  }
+
+  uint32_t bytesBefore = session.bytesOut;
+  session.commandStartUs = micros();
+  session.waitingFirstByte = true;
+  EnqueueResult result =
+      enqueueCommand(line, length, nullptr, perfHeapMark(), &session,
+                     xTaskGetCurrentTaskHandle());
+  if (result != ENQUEUE_OK) {
+    session.waitingFirstByte = false;
+    reportEnqueueFailure(result, nullptr);
+    return;
+  }
+  ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+  uint32_t elapsed = micros() - session.commandStartUs;
+  session.waitingFirstByte = false;
+  session.commands++;
+  session.totalCommandUs += elapsed;
+  session.commandBytesOut += session.bytesOut - bytesBefore;
+  if (elapsed > session.maxCommandUs) {
+    session.maxCommandUs = elapsed;
+  }
+}
+
+/**
+ * @brief Add received bytes to the command line, running complete lines
+ * @param session Session the bytes came from
+ * @param data Received bytes
+ * @param length Number of bytes
+ */
+static void receiveSessionBytes(TcpSession &session, const uint8_t *data,
+                                size_t length) {
+  session.bytesIn += length;
+  for (size_t i = 0; i < length; i++) {
+    char c = data[i];
+    if (c == '\n') {
+      if (session.lineOverflow) {
+        printResponse("ERROR: Command exceeds " + String(MAX_COMMAND_LENGTH) +
+                          " bytes",
+                      nullptr);
+      } else {
+        runSessionLine(session);
+      }
+      session.lineLength = 0;
+      session.lineOverflow = false;
+    } else if (session.lineLength < MAX_COMMAND_LENGTH) {
+      session.line[session.lineLength++] = c;
+    } else {
+      session.lineOverflow = true;
+    }
+  }
+}
+
+/**
+ * @brief Session task, runs the commands of one client until it disconnects
+ * @param parameter The TcpSession
+ */
+static void tcpSessionTask(void *parameter) {
+  TcpSession *session = (TcpSession *)parameter;
+  uartRedirectTask(session);
+
+  uint8_t chunk[256];
+  while (session->client.connected()) {
+    if (!waitForClient(session->client, TCP_IDLE_CHECK_MS)) {
+      continue;
+    }
+    int n = session->client.read(chunk, sizeof(chunk));
+    if (n > 0) {
+      receiveSessionBytes(*session, chunk, n);
+    } else if (n < 0 || session->client.available() == 0) {
+      // Readable without data means the client closed the connection
+      break;
+    }
+  }
+
+  uartRedirectTask(nullptr);
+  {
+    std::lock_guard<std::mutex> lock(sessionsMutex);
+    sessions[session->id - 1] = nullptr;
+  }
+  session->client.stop();
+  delete session;
+  vTaskDelete(NULL);
+}
+
+/**
+ * @brief Give a new connection a session, or turn it away when all are busy
+ * @param client Accepted connection
+ */
+static void admitClient(NetworkClient &client) {
+  TcpSession *session = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(sessionsMutex);
+    for (uint8_t i = 0; i < TCP_MAX_SESSIONS; i++) {
+      if (sessions[i] == nullptr) {
+        session = new TcpSession();
+        session->id = i + 1;
+        sessions[i] = session;
+        acceptedSessions++;
+        break;
+      }
+    }
+    if (!session) {
+      rejectedSessions++;
+    }
+  }
+  if (!session) {
+    client.print("ERROR: Too many TCP sessions\r\n");
+    client.stop();
+    return;
+  }
+
+  client.setNoDelay(true);
+  session->client = client;
+  session->remoteIP = client.remoteIP();
+  session->remotePort = client.remotePort();
+  session->connectedAt = millis();
+  if (xTaskCreate(tcpSessionTask, "tcp_session", TCP_SESSION_STACK_SIZE,
+                  session, TCP_TASK_PRIORITY, NULL) != pdPASS) {
+    {
+      std::lock_guard<std::mutex> lock(sessionsMutex);
+      sessions[session->id - 1] = nullptr;
+    }
+    session->client.print("ERROR: Not enough memory for a TCP session\r\n");
+    session->client.stop();
+    delete session;
+  }
+}
+
+/**
+ * @brief Listener task, accepts new connections
+ * @param parameter Unused
+ */
+static void tcpListenerTask(void *parameter) {
+  for (;;) {
+    NetworkClient client = server.accept();
+    if (client) {
+      admitClient(client);
+    } else {
+      vTaskDelay(pdMS_TO_TICKS(TCP_ACCEPT_POLL_MS));
+    }
+  }
+}
+
+/**
+ * @brief Start listening for TCP command sessions
+ *
+ * Safe to call again after a WiFi reconnect, the server keeps running.
+ *
+ * @return bool False if the listener task could not be created
+ */
+bool startTcpServer() {
+  if (serverStarted) {
+    return true;
+  }
+  server.begin();
+  serverStarted = xTaskCreate(tcpListenerTask, "tcp_listener",
+                              TCP_LISTENER_STACK_SIZE, NULL, TCP_TASK_PRIORITY,
+                              NULL) == pdPASS;
+  if (!serverStarted) {
+    server.end();
+  }
+  return serverStarted;
+}
+
+/**
+ * @brief Print the server state and the throughput and latency per session
+ * @param packet Pointer to AsyncUDPPacket for response
+ */
+void printTcpStatus(AsyncUDPPacket *packet) {
+  String lines[TCP_MAX_SESSIONS];
+  uint8_t active = 0;
+  uint32_t accepted;
+  uint32_t rejected;
+  {
+    std::lock_guard<std::mutex> lock(sessionsMutex);
+    uint32_t now = millis();
+    for (TcpSession *session : sessions) {
+      if (!session) {
+        continue;
+      }
+      uint32_t commands = session->commands;
+      uint64_t busyUs = session->totalCommandUs;
+      uint32_t rate =
+          busyUs ? session->commandBytesOut * 1000000 / busyUs : 0;
+      lines[active++] =
+          "TCP_SESSION: id=" + String(session->id) +
+          " remote=" + session->remoteIP.toString() + ":" +
+          String(session->remotePort) +
+          " up_s=" + String((now - session->connectedAt) / 1000) +
+          " commands=" + String(commands) +
+          " in=" + String(session->bytesIn) +
+          " out=" + String(session->bytesOut) +
+          " bytes_per_s=" + String(rate) + " avg_ms=" +
+          String(commands ? (uint32_t)(busyUs / commands / 1000) : 0) +
+          " max_ms=" + String(session->maxCommandUs / 1000) +
+          " first_byte_ms=" +
+          String(commands ? (uint32_t)(session->totalFirstByteUs / commands /
+                                       1000)
+                          : 0);
+    }
+    accepted = acceptedSessions;
+    rejected = rejectedSessions;
+  }
+
+  printResponse("TCP_SERVER: port=" + String(TCP_SERVER_PORT) +
+                    " listening=" + String(serverStarted ? "true" : "false") +
+                    " sessions=" + String(active) + "/" +
+                    String(TCP_MAX_SESSIONS) + " accepted=" +
+                    String(accepted) + " rejected=" + String(rejected),
+                packet);
+  for (uint8_t i = 0; i < active; i++) {
+    printResponse(lines[i], packet);
+  }
+}
@@ -0,0 +1,16 @@
+#ifndef TCP_SERVER_H
+#define TCP_SERVER_H
+
+#include <Arduino.h>
+#include <AsyncUDP.h>
+
+/// TCP port of the command server, the same number as the UDP port
+const uint16_t TCP_SERVER_PORT = 1234;
+
+/// Sessions served at once, each needs a task with an HTTPS sized stack
+const uint8_t TCP_MAX_SESSIONS = 2;
+
+bool startTcpServer();
+void printTcpStatus(AsyncUDPPacket *packet);
+
+#endif // TCP_SERVER_H
@@ -0,0 +1,528 @@
+/**
+ * @file tls_session.cpp
+ * @brief TLS client with a per-host session resumption cache
+ *
+ * This file contains a small TLS client built directly on mbedTLS. The
+ * stock NetworkClientSecure performs setup and handshake in one call, which
+ * leaves no place to offer a saved session. Here every successful handshake
+ * stores its session (ticket or session id) keyed by host and port, and the
+ * next connection to that server offers it before the handshake starts, so
+ * reconnects only pay for an abbreviated handshake. This works whether or
+ * not the previous connection was kept alive. TLS 1.3 servers send their
+ * ticket after the handshake, so for them the session is stored when the
+ * ticket arrives with the first response. Handshakes of ASYNC workers run
+ * in parallel, cacheMutex guards the cache and the counters.
+ */
+
+#include "tls_session.h"
+#include "http_utils.h"
+#include <WiFi.h>
+#include <esp_random.h>
+#include <lwip/sockets.h>
+#include <mbedtls/net_sockets.h>
+#include <mbedtls/ssl.h>
+#include <mutex>
+
+/// Number of servers whose sessions are remembered
+const size_t TLS_SESSION_CACHE_SIZE = 4;
+
+/// Handshake timeout used when the caller gives none
+const int32_t TLS_HANDSHAKE_TIMEOUT_MS = 10000;
+
+/**
+ * @struct TlsContext
+ * @brief mbedTLS state of one connection
+ */
+struct TlsContext {
+  mbedtls_ssl_context ssl; ///< Connection state
+  mbedtls_ssl_config conf; ///< Client configuration
+  int socket;              ///< Socket of the underlying NetworkClient
+  bool closed;             ///< Peer closed or the connection failed
+  String host;             ///< Server host name, cache key for late tickets
+  uint16_t port;           ///< Server port
+};
+
+/**
+ * @struct TlsSessionEntry
+ * @brief Saved session for one server
+ */
+struct TlsSessionEntry {
+  String host;                 ///< Server host name
+  uint16_t port;               ///< Server port
+  mbedtls_ssl_session session; ///< Session to offer on the next handshake
+  bool valid;                  ///< Entry holds a session
+  uint32_t lastUsed;           ///< millis() of the last store or lookup
+};
+
+/**
+ * @struct TlsStats
+ * @brief Handshake counters
+ */
+struct TlsStats {
+  uint32_t full;           ///< Full handshakes
+  uint32_t resumed;        ///< Abbreviated handshakes from a cached session
+  uint32_t failed;         ///< Handshakes that failed or timed out
+  uint32_t fullTotalMs;    ///< Time spent in full handshakes
+  uint32_t resumedTotalMs; ///< Time spent in abbreviated handshakes
+  uint32_t fullMaxMs;      ///< Slowest full handshake
+  uint32_t resumedMaxMs;   ///< Slowest abbreviated handshake
+};
+
+static TlsSessionEntry sessionCache[TLS_SESSION_CACHE_SIZE];
+static TlsStats tlsStats;
+static std::mutex cacheMutex;
+
+/**
+ * @brief Find the cached session for a server
+ * @param host Server host name
+ * @param port Server port
+ * @return TlsSessionEntry* Entry or nullptr
+ */
+static TlsSessionEntry *findSession(const char *host, uint16_t port) {
+  for (TlsSessionEntry &entry : sessionCache) {
+    if (entry.valid && entry.port == port && entry.host == host) {
+      entry.lastUsed = millis();
+      return &entry;
+    }
+  }
+  return nullptr;
+}
+
+/**
+ * @brief Drop a cached session
+ * @param entry Entry to clear
+ */
+static void forgetSession(TlsSessionEntry &entry) {
+  if (entry.valid) {
+    mbedtls_ssl_session_free(&entry.session);
+    entry.valid = false;
+  }
+  entry.host = "";
+}
+
+/**
+ * @brief Save the session of a finished handshake
+ *
+ * Replaces the server's previous entry (the server may have issued a new
+ * ticket) or the least recently used one.
+ *
+ * @param ssl Connection that completed its handshake
+ * @param host Server host name
+ * @param port Server port
+ */
+static void storeSession(const mbedtls_ssl_context *ssl, const char *host,
+                         uint16_t port) {
+  TlsSessionEntry *target = findSession(host, port);
+  if (!target) {
+    for (TlsSessionEntry &entry : sessionCache) {
+      if (!entry.valid) {
+        target = &entry;
+        break;
+      }
+      if (!target || entry.lastUsed < target->lastUsed) {
+        target = &entry;
+      }
+    }
+  }
+
+  forgetSession(*target);
+  mbedtls_ssl_session_init(&target->session);
+  if (mbedtls_ssl_get_session(ssl, &target->session) != 0) {
+    mbedtls_ssl_session_free(&target->session);
+    return;
+  }
+  target->host = host;
+  target->port = port;
+  target->valid = true;
+  target->lastUsed = millis();
+}
+
+/**
+ * @brief Check whether a connection negotiated TLS 1.3
+ * @param ssl Connection that completed its handshake
+ * @return bool True for TLS 1.3
+ */
+static bool isTls13(const mbedtls_ssl_context *ssl) {
+#if defined(MBEDTLS_SSL_PROTO_TLS1_3)
+  return mbedtls_ssl_get_version_number(ssl) == MBEDTLS_SSL_VERSION_TLS1_3;
+#else
+  return false;
+#endif
+}
+
+/**
+ * @brief Read application data, storing TLS 1.3 tickets on the way
+ *
+ * A TLS 1.3 server sends NewSessionTicket after the handshake. mbedTLS
+ * reports it as a read error, the read is then retried.
+ *
+ * @param tls Connection to read from
+ * @param buf Destination, can be null with length 0
+ * @param length Maximum number of bytes
+ * @return int Result of mbedtls_ssl_read()
+ */
+static int tlsRead(TlsContext *tls, unsigned char *buf, size_t length) {
+  for (;;) {
+    int ret = mbedtls_ssl_read(&tls->ssl, buf, length);
+#if defined(MBEDTLS_ERR_SSL_RECEIVED_NEW_SESSION_TICKET)
+    if (ret == MBEDTLS_ERR_SSL_RECEIVED_NEW_SESSION_TICKET) {
+      std::lock_guard<std::mutex> lock(cacheMutex);
+      storeSession(&tls->ssl, tls->host.c_str(), tls->port);
+      continue;
+    }
+#endif
+    return ret;
+  }
+}
+
+/**
+ * @brief Random source for mbedTLS, backed by the hardware RNG
+ */
+static int tlsRandom(void *context, unsigned char *output, size_t length) {
+  esp_fill_random(output, length);
+  return 0;
+}
+
+/**
+ * @brief mbedTLS send callback writing to the socket
+ */
+static int tlsSend(void *context, const unsigned char *buf, size_t length) {
+  int ret = send(*(int *)context, buf, length, 0);
+  if (ret >= 0) {
+    return ret;
+  }
+  if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+    return MBEDTLS_ERR_SSL_WANT_WRITE;
+  }
+  return errno == ECONNRESET ? MBEDTLS_ERR_NET_CONN_RESET
+                             : MBEDTLS_ERR_NET_SEND_FAILED;
+}
+
+/**
+ * @brief mbedTLS receive callback, never blocks
+ */
+static int tlsRecv(void *context, unsigned char *buf, size_t length) {
+  int ret = recv(*(int *)context, buf, length, MSG_DONTWAIT);
+  if (ret >= 0) {
+    return ret;
+  }
+  if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+    return MBEDTLS_ERR_SSL_WANT_READ;
+  }
+  return errno == ECONNRESET ? MBEDTLS_ERR_NET_CONN_RESET
+                             : MBEDTLS_ERR_NET_RECV_FAILED;
+}
+
+/**
+ * @brief Wait until the socket is readable or writable
+ * @param socket Socket to wait on
+ * @param forWrite Wait for writability instead of readability
+ * @param timeout_ms Maximum time to wait
+ */
+static void waitSocket(int socket, bool forWrite, uint32_t timeout_ms) {
+  fd_set fds;
+  FD_ZERO(&fds);
+  FD_SET(socket, &fds);
+  struct timeval tv;
+  tv.tv_sec = timeout_ms / 1000;
+  tv.tv_usec = (timeout_ms % 1000) * 1000;
+  select(socket + 1, forWrite ? nullptr : &fds, forWrite ? &fds : nullptr,
+         nullptr, &tv);
+}
+
+/**
+ * @brief Free the mbedTLS state of a connection
+ * @param tls Context to free
+ */
+static void freeTls(TlsContext *tls) {
+  mbedtls_ssl_free(&tls->ssl);
+  mbedtls_ssl_config_free(&tls->conf);
+  delete tls;
+}
+
+TlsSessionClient::TlsSessionClient() {}
+
+TlsSessionClient::~TlsSessionClient() { stop(); }
+
+int TlsSessionClient::connect(IPAddress ip, uint16_t port) {
+  return connect(ip, port, TLS_HANDSHAKE_TIMEOUT_MS);
+}
+
+int TlsSessionClient::connect(IPAddress ip, uint16_t port, int32_t timeout) {
+  stop();
+  if (!NetworkClient::connect(ip, port, timeout)) {
+    return 0;
+  }
+  return startTls(ip.toString().c_str(), port, timeout) ? 1 : 0;
+}
+
+int TlsSessionClient::connect(const char *host, uint16_t port) {
+  return connect(host, port, TLS_HANDSHAKE_TIMEOUT_MS);
+}
+
+int TlsSessionClient::connect(const char *host, uint16_t port,
+                              int32_t timeout) {
+  stop();
+  IPAddress ip;
+  if (!WiFi.hostByName(host, ip) || !NetworkClient::connect(ip, port, timeout)) {
+    return 0;
+  }
+  return startTls(host, port, timeout) ? 1 : 0;
+}
+
+/**
+ * @brief Run the TLS handshake on the connected socket
+ *
+ * Offers the cached session for host:port if there is one. A session the
+ * server refused to resume is replaced by the new one; a session that made
+ * the handshake fail is dropped.
+ *
+ * @param host Server host name, used for SNI and as cache key
+ * @param port Server port
+ * @param timeout Handshake timeout in ms
+ * @return bool True if the handshake completed
+ */
+bool TlsSessionClient::startTls(const char *host, uint16_t port,
+                                int32_t timeout) {
+  if (timeout <= 0) {
+    timeout = TLS_HANDSHAKE_TIMEOUT_MS;
+  }
+
+  _tls = new TlsContext();
+  _tls->socket = fd();
+  _tls->closed = false;
+  _tls->host = host;
+  _tls->port = port;
+  mbedtls_ssl_init(&_tls->ssl);
+  mbedtls_ssl_config_init(&_tls->conf);
+
+  if (mbedtls_ssl_config_defaults(&_tls->conf, MBEDTLS_SSL_IS_CLIENT,
+                                  MBEDTLS_SSL_TRANSPORT_STREAM,
+                                  MBEDTLS_SSL_PRESET_DEFAULT) != 0) {
+    stop();
+    return false;
+  }
+  mbedtls_ssl_conf_authmode(&_tls->conf, MBEDTLS_SSL_VERIFY_NONE);
+  mbedtls_ssl_conf_rng(&_tls->conf, tlsRandom, nullptr);
+#if defined(MBEDTLS_SSL_SESSION_TICKETS)
+  mbedtls_ssl_conf_session_tickets(&_tls->conf,
+                                   MBEDTLS_SSL_SESSION_TICKETS_ENABLED);
+#if defined(MBEDTLS_SSL_TLS1_3_SIGNAL_NEW_SESSION_TICKETS_ENABLED)
+  // Have mbedtls_ssl_read() report TLS 1.3 tickets so tlsRead() stores them
+  mbedtls_ssl_conf_tls13_enable_signal_new_session_tickets(
+      &_tls->conf, MBEDTLS_SSL_TLS1_3_SIGNAL_NEW_SESSION_TICKETS_ENABLED);
+#endif
+#endif
+  if (mbedtls_ssl_setup(&_tls->ssl, &_tls->conf) != 0 ||
+      mbedtls_ssl_set_hostname(&_tls->ssl, host) != 0) {
+    stop();
+    return false;
+  }
+  mbedtls_ssl_set_bio(&_tls->ssl, &_tls->socket, tlsSend, tlsRecv, nullptr);
+
+  bool offered;
+  {
+    // set_session copies the session, the entry may change afterwards
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    TlsSessionEntry *cached = findSession(host, port);
+    offered =
+        cached && mbedtls_ssl_set_session(&_tls->ssl, &cached->session) == 0;
+  }
+
+  uint32_t start = millis();
+  int ret;
+  while ((ret = mbedtls_ssl_handshake(&_tls->ssl)) != 0) {
+    uint32_t elapsed = millis() - start;
+    if ((ret != MBEDTLS_ERR_SSL_WANT_READ &&
+         ret != MBEDTLS_ERR_SSL_WANT_WRITE) ||
+        elapsed >= (uint32_t)timeout) {
+      break;
+    }
+    waitSocket(_tls->socket, ret == MBEDTLS_ERR_SSL_WANT_WRITE,
+               timeout - elapsed);
+  }
+  uint32_t elapsed = millis() - start;
+
+  std::unique_lock<std::mutex> lock(cacheMutex);
+  if (ret != 0) {
+    log_e("TLS handshake with %s failed: -0x%04x", host, -ret);
+    tlsStats.failed++;
+    TlsSessionEntry *cached = offered ? findSession(host, port) : nullptr;
+    if (cached) {
+      forgetSession(*cached);
+    }
+    lock.unlock();
+    stop();
+    return false;
+  }
+
+  if (offered && mbedtls_ssl_session_reused(&_tls->ssl)) {
+    tlsStats.resumed++;
+    tlsStats.resumedTotalMs += elapsed;
+    tlsStats.resumedMaxMs = max(tlsStats.resumedMaxMs, elapsed);
+  } else {
+    tlsStats.full++;
+    tlsStats.fullTotalMs += elapsed;
+    tlsStats.fullMaxMs = max(tlsStats.fullMaxMs, elapsed);
+  }
+  if (!isTls13(&_tls->ssl)) {
+    // A TLS 1.3 session is only resumable once its ticket arrives
+    storeSession(&_tls->ssl, host, port);
+  }
+  return true;
+}
+
+size_t TlsSessionClient::write(uint8_t data) { return write(&data, 1); }
+
+size_t TlsSessionClient::write(const uint8_t *buf, size_t size) {
+  if (!_tls || _tls->closed) {
+    return 0;
+  }
+  size_t written = 0;
+  uint32_t start = millis();
+  while (written < size) {
+    int ret = mbedtls_ssl_write(&_tls->ssl, buf + written, size - written);
+    if (ret > 0) {
+      written += ret;
+      continue;
+    }
+    if ((ret != MBEDTLS_ERR_SSL_WANT_READ &&
+         ret != MBEDTLS_ERR_SSL_WANT_WRITE) ||
+        millis() - start >= getTimeout()) {
+      _tls->closed = ret != MBEDTLS_ERR_SSL_WANT_READ &&
+                     ret != MBEDTLS_ERR_SSL_WANT_WRITE;
+      break;
+    }
+    waitSocket(_tls->socket, ret == MBEDTLS_ERR_SSL_WANT_WRITE, 10);
+  }
+  return written;
+}
+
+int TlsSessionClient::available() {
+  if (!_tls) {
+    return 0;
+  }
+  int pending = _peeked >= 0 ? 1 : 0;
+  size_t buffered = mbedtls_ssl_get_bytes_avail(&_tls->ssl);
+  if (buffered == 0 && !_tls->closed) {
+    // Decrypt the next record if one has arrived
+    int ret = tlsRead(_tls, nullptr, 0);
+    if (ret < 0 && ret != MBEDTLS_ERR_SSL_WANT_READ &&
+        ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
+      _tls->closed = true;
+    }
+    buffered = mbedtls_ssl_get_bytes_avail(&_tls->ssl);
+  }
+  return pending + buffered;
+}
+
+int TlsSessionClient::read() {
+  uint8_t data;
+  return read(&data, 1) == 1 ? data : -1;
+}
+
+int TlsSessionClient::read(uint8_t *buf, size_t size) {
+  if (!_tls || size == 0) {
+    return -1;
+  }
+  size_t copied = 0;
+  if (_peeked >= 0) {
+    buf[copied++] = _peeked;
+    _peeked = -1;
+    if (size == 1) {
+      return 1;
+    }
+  }
+  if (_tls->closed) {
+    return copied ? copied : -1;
+  }
+
+  int ret = tlsRead(_tls, buf + copied, size - copied);
+  if (ret > 0) {
+    return copied + ret;
+  }
+  if (ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
+    // 0, close notify or a transport error: no more data will follow
+    _tls->closed = true;
+  }
+  return copied ? copied : -1;
+}
+
+int TlsSessionClient::peek() {
+  if (_peeked < 0) {
+    uint8_t data;
+    if (read(&data, 1) == 1) {
+      _peeked = data;
+    }
+  }
+  return _peeked;
+}
+
+void TlsSessionClient::flush() {}
+
+void TlsSessionClient::stop() {
+  if (_tls) {
+    if (!_tls->closed) {
+      mbedtls_ssl_close_notify(&_tls->ssl);
+    }
+    freeTls(_tls);
+    _tls = nullptr;
+  }
+  _peeked = -1;
+  NetworkClient::stop();
+}
+
+uint8_t TlsSessionClient::connected() {
+  if (!_tls) {
+    return 0;
+  }
+  if (_peeked >= 0 || mbedtls_ssl_get_bytes_avail(&_tls->ssl) > 0) {
+    return 1;
+  }
+  if (_tls->closed) {
+    return 0;
+  }
+
+  // A readable socket with nothing to read means the server closed it
+  uint8_t probe;
+  int ret = recv(_tls->socket, &probe, 1, MSG_PEEK | MSG_DONTWAIT);
+  if (ret == 0 || (ret < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+    _tls->closed = true;
+    return 0;
+  }
+  return 1;
+}
+
+/**
+ * @brief Print TLS handshake counters
+ * @param packet Pointer to AsyncUDPPacket for response
+ */
+void printTlsStats(AsyncUDPPacket *packet) {
+  size_t cached = 0;
+  TlsStats stats;
+  {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    for (const TlsSessionEntry &entry : sessionCache) {
+      if (entry.valid) {
+        cached++;
+      }
+    }
+    stats = tlsStats;
+  }
+  uint32_t fullAvg = stats.full ? stats.fullTotalMs / stats.full : 0;
+  uint32_t resumedAvg =
+      stats.resumed ? stats.resumedTotalMs / stats.resumed : 0;
+
+  printResponse("TLS_FULL: count=" + String(stats.full) +
+                    " avg_ms=" + String(fullAvg) +
+                    " max_ms=" + String(stats.fullMaxMs),
+                packet);
+  printResponse("TLS_RESUMED: count=" + String(stats.resumed) +
+                    " avg_ms=" + String(resumedAvg) +
+                    " max_ms=" + String(stats.resumedMaxMs),
+                packet);
+  printResponse("TLS_SESSIONS: cached=" + String(cached) + "/" +
+                    String(TLS_SESSION_CACHE_SIZE) +
+                    " failed=" + String(stats.failed),
+                packet);
+}
@@ -0,0 +1,48 @@
+#ifndef TLS_SESSION_H
+#define TLS_SESSION_H
+
+#include <Arduino.h>
+#include <AsyncUDP.h>
+#include <NetworkClient.h>
+
+struct TlsContext;
+
+/**
+ * @brief TLS client that resumes sessions from a per-host cache
+ *
+ * Runs mbedTLS over the TCP socket of NetworkClient. After every full
+ * handshake the negotiated session (ticket or session id) is stored per
+ * host and port; the next connection to the same server offers it, so the
+ * server can answer with an abbreviated handshake. Like the default
+ * HTTPClient setup, the server certificate is not verified.
+ */
+class TlsSessionClient : public NetworkClient {
+public:
+  TlsSessionClient();
+  ~TlsSessionClient();
+
+  int connect(IPAddress ip, uint16_t port) override;
+  int connect(IPAddress ip, uint16_t port, int32_t timeout) override;
+  int connect(const char *host, uint16_t port) override;
+  int connect(const char *host, uint16_t port, int32_t timeout) override;
+  size_t write(uint8_t data) override;
+  size_t write(const uint8_t *buf, size_t size) override;
+  int available() override;
+  int read() override;
+  int read(uint8_t *buf, size_t size) override;
+  int peek() override;
+  void flush() override;
+  void stop() override;
+  uint8_t connected() override;
+  operator bool() override { return connected(); }
+
+private:
+  bool startTls(const char *host, uint16_t port, int32_t timeout);
+
+  TlsContext *_tls = nullptr;
+  int _peeked = -1;
+};
+
+void printTlsStats(AsyncUDPPacket *packet);
+
+#endif // TLS_SESSION_H
@@ -0,0 +1,155 @@
+/**
+ * @file uart_compress.cpp
+ * @brief Compressed response bodies on the UART
+ *
+ * This file contains a small LZSS compressor for stream and CALL bodies.
+ * The UART is the slowest link between the server and the Flipper, and
+ * JSON and HTML bodies shrink to a fraction of their size. Each group of
+ * up to 8 items starts with a flag byte (LSB first); a 0 bit is a literal
+ * byte, a 1 bit a match of two bytes: offset - 1 and length - 3.
+ * Matches are found by a plain search of the 256 byte window, which is
+ * far faster than the UART drains.
+ */
+
+#include "uart_compress.h"
+#include "http_utils.h"
+#include "uart_frame.h"
+#include <atomic>
+
+/// Shortest match, shorter ones cost more than the literals
+const size_t UART_LZ_MIN_MATCH = 3;
+
+/// Longest match, its length - 3 has to fit in one byte
+const size_t UART_LZ_MAX_MATCH = UART_LZ_MIN_MATCH + 255;
+
+static std::atomic<bool> compression{false};
+
+/**
+ * @brief Check whether bodies are sent compressed
+ * @return bool True if compression is enabled and the calling task writes
+ *         to the UART
+ */
+bool uartCompressionEnabled() {
+  return !uartTaskRedirected() && compression.load(std::memory_order_acquire);
+}
+
+/**
+ * @brief Enable or disable compressed bodies on the UART
+ * @param enable Boolean flag to compress bodies
+ * @param packet Pointer to AsyncUDPPacket for response
+ */
+void setUartCompression(bool enable, AsyncUDPPacket *packet) {
+  compression.store(enable, std::memory_order_release);
+  printResponse("UART_COMPRESSION: " + String(enable ? "true" : "false"),
+                packet);
+}
+
+/**
+ * @brief Compress part of the body
+ *
+ * Full blocks are sent right away, the rest stays buffered until the next
+ * write, flush() or end().
+ *
+ * @param data Body bytes
+ * @param length Number of bytes
+ */
+void UartCompressor::write(const uint8_t *data, size_t length) {
+  // Byte at index i of data, negative indices come from earlier writes
+  auto byteAt = [&](ptrdiff_t i) -> uint8_t {
+    return i >= 0 ? data[i]
+                  : _history[(_position + (uint32_t)i) & (UART_LZ_WINDOW - 1)];
+  };
+
+  size_t i = 0;
+  while (i < length) {
+    size_t bestLength = 0;
+    size_t bestOffset = 0;
+    size_t maxLength = min(length - i, UART_LZ_MAX_MATCH);
+    size_t maxOffset = min((size_t)_position + i, UART_LZ_WINDOW);
+    if (maxLength >= UART_LZ_MIN_MATCH) {
+      for (size_t offset = 1; offset <= maxOffset; offset++) {
+        ptrdiff_t from = (ptrdiff_t)i - (ptrdiff_t)offset;
+        size_t n = 0;
+        while (n < maxLength && byteAt(from + n) == data[i + n]) {
+          n++;
+        }
+        if (n > bestLength) {
+          bestLength = n;
+          bestOffset = offset;
+          if (n == maxLength) {
+            break;
+          }
+        }
+      }
+    }
+
+    if (bestLength >= UART_LZ_MIN_MATCH) {
+      putItem(true, bestOffset - 1, bestLength - UART_LZ_MIN_MATCH);
+      i += bestLength;
+    } else {
+      putItem(false, data[i], 0);
+      i++;
+    }
+  }
+
+  size_t keep = min(length, UART_LZ_WINDOW);
+  for (size_t k = length - keep; k < length; k++) {
+    _history[(_position + k) & (UART_LZ_WINDOW - 1)] = data[k];
+  }
+  _position += length;
+  _bytesIn += length;
+}
+
+/**
+ * @brief Send the last block and the empty block that ends the body
+ */
+void UartCompressor::end() {
+  flush();
+  const uint8_t terminator[2] = {0, 0};
+  uartWriteBody(terminator, sizeof(terminator));
+  _bytesOut += sizeof(terminator);
+}
+
+/**
+ * @brief Append a literal or a match to the block
+ * @param match True for a match, false for a literal
+ * @param first Literal byte, or offset - 1
+ * @param second Length - 3, matches only
+ */
+void UartCompressor::putItem(bool match, uint8_t first, uint8_t second) {
+  size_t needed = (_flagBit == 8 ? 1 : 0) + (match ? 2 : 1);
+  if (_blockLength + needed > sizeof(_block)) {
+    flush();
+  }
+  if (_flagBit == 8) {
+    _flagPos = _blockLength++;
+    _block[_flagPos] = 0;
+    _flagBit = 0;
+  }
+  if (match) {
+    _block[_flagPos] |= 1 << _flagBit;
+  }
+  _flagBit++;
+  _block[_blockLength++] = first;
+  if (match) {
+    _block[_blockLength++] = second;
+  }
+}
+
+/**
+ * @brief Send the block assembled so far, e.g. while the network is idle
+ *
+ * The next block starts a new flag group.
+ */
+void UartCompressor::flush() {
+  if (_blockLength == 2) {
+    return;
+  }
+  size_t length = _blockLength - 2;
+  _block[0] = length & 0xFF;
+  _block[1] = length >> 8;
+  uartWriteBody(_block, _blockLength);
+  _bytesOut += _blockLength;
+  _blockLength = 2;
+  _flagBit = 8;
+}
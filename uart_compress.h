@@ -0,0 +1,48 @@
+#ifndef UART_COMPRESS_H
+#define UART_COMPRESS_H
+
+#include <Arduino.h>
+#include <AsyncUDP.h>
+
+/// History the decoder keeps, matches reach at most this far back
+const size_t UART_LZ_WINDOW = 256;
+
+/// Largest compressed block
+const size_t UART_LZ_BLOCK = 512;
+
+/**
+ * @brief LZSS compressor for response bodies sent over the UART
+ *
+ * Emits the body as length-prefixed blocks followed by an empty block, see
+ * the README for the format. The window is small enough for the Flipper to
+ * decompress with a few hundred bytes of RAM.
+ */
+class UartCompressor {
+public:
+  void write(const uint8_t *data, size_t length);
+  void flush();
+  void end();
+
+  /// Body bytes compressed so far
+  size_t bytesIn() const { return _bytesIn; }
+
+  /// Compressed bytes written so far, including block headers
+  size_t bytesOut() const { return _bytesOut; }
+
+private:
+  void putItem(bool match, uint8_t first, uint8_t second);
+
+  uint8_t _history[UART_LZ_WINDOW];  ///< Last input bytes, by position
+  uint8_t _block[2 + UART_LZ_BLOCK]; ///< Block being assembled
+  size_t _blockLength = 2;           ///< Bytes used in _block
+  size_t _flagPos = 0;               ///< Flag byte of the current group
+  uint8_t _flagBit = 8;              ///< Next flag bit, 8 starts a group
+  uint32_t _position = 0;            ///< Input bytes before this write
+  size_t _bytesIn = 0;
+  size_t _bytesOut = 0;
+};
+
+bool uartCompressionEnabled();
+void setUartCompression(bool enable, AsyncUDPPacket *packet);
+
+#endif // UART_COMPRESS_H
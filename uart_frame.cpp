@@ -0,0 +1,355 @@
+/**
+ * @file uart_frame.cpp
+ * @brief Text and framed UART output modes
+ *
+ * This file contains the output layer between the response code and the
+ * UART TX ring. In text mode (the default) lines are printed with a line
+ * ending and bodies are written raw, as before. In framed mode everything
+ * is sent as frames:
+ *
+ *   0xA5 | type | channel | length (2, LE) | payload | CRC-16 (2, LE)
+ *
+ * The CRC is CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF) over type,
+ * channel, length and payload. Receivers skip payloads by length, bodies
+ * may contain any byte, and events can be interleaved with a running
+ * response because they use their own channel.
+ *
+ * A task running the commands of a TCP session redirects its console
+ * output to the session; that output is always plain text.
+ *
+ * Requests started with ASYNC answer on the channel of their ID. In text
+ * mode their lines start with "#<id> " instead. A raw body can't be tagged,
+ * so while one is being written other tasks hold their output back until
+ * its writer prints the next line. The wait is bounded: a body that stalls
+ * on the network, or keeps others waiting too long, lets them write in
+ * between. No lock is held while a body waits for the network.
+ */
+
+#include "uart_frame.h"
+#include "http_utils.h"
+#include "uart_tx.h"
+#include <atomic>
+
+/// Set on all but the last frame of a TEXT line split over several frames
+const uint8_t UART_FRAME_MORE = 0x80;
+
+static std::atomic<bool> framing{false};
+
+/// Channel that UART_CHANNEL_RESPONSE output of the calling task goes to
+static thread_local uint8_t responseChannel = UART_CHANNEL_RESPONSE;
+
+/// Output of the calling task if it is not the UART, e.g. a TCP session
+static thread_local Print *taskConsole = nullptr;
+
+/// Other output waits for a text body that got data this recently
+const uint32_t UART_TEXT_BODY_IDLE_MS = 100;
+
+/// Longest time other output waits for a text body of another task
+const uint32_t UART_TEXT_BODY_WAIT_MS = 1000;
+
+/// Text mode output lock, held for one line or body write at a time
+static SemaphoreHandle_t textMutex = NULL;
+
+/// Task whose text body is unfinished, guarded by textMutex
+static TaskHandle_t textBodyTask = NULL;
+
+/// millis() of the last write to that body, guarded by textMutex
+static uint32_t textBodyWriteMs = 0;
+
+/// The calling task has an unfinished text body
+static thread_local bool textBodyOpen = false;
+
+/**
+ * @brief Update a CRC-16/CCITT-FALSE with more bytes
+ * @param crc CRC so far, 0xFFFF to start
+ * @param data Bytes to add
+ * @param length Number of bytes
+ * @return uint16_t Updated CRC
+ */
+static uint16_t crc16(uint16_t crc, const uint8_t *data, size_t length) {
+  static const uint16_t nibbleTable[16] = {
+      0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50a5, 0x60c6, 0x70e7,
+      0x8108, 0x9129, 0xa14a, 0xb16b, 0xc18c, 0xd1ad, 0xe1ce, 0xf1ef};
+  for (size_t i = 0; i < length; i++) {
+    crc = (crc << 4) ^ nibbleTable[(crc >> 12) ^ (data[i] >> 4)];
+    crc = (crc << 4) ^ nibbleTable[(crc >> 12) ^ (data[i] & 0x0F)];
+  }
+  return crc;
+}
+
+/**
+ * @brief Create the text mode output lock
+ * @return bool True on success
+ */
+bool initUartFrame() {
+  textMutex = xSemaphoreCreateRecursiveMutex();
+  return textMutex != NULL;
+}
+
+/**
+ * @brief Check whether framed output is active
+ * @return bool True in framed mode
+ */
+bool uartFramingEnabled() {
+  return !taskConsole && framing.load(std::memory_order_acquire);
+}
+
+/**
+ * @brief Send the console output of the calling task somewhere else
+ * @param console Destination, or null for the UART
+ */
+void uartRedirectTask(Print *console) { taskConsole = console; }
+
+/**
+ * @brief Check whether the console output of the calling task is redirected
+ * @return bool True if the task does not write to the UART
+ */
+bool uartTaskRedirected() { return taskConsole != nullptr; }
+
+/**
+ * @brief Send the responses of the calling task to another channel
+ * @param channel Request ID, or UART_CHANNEL_RESPONSE for plain responses
+ */
+void uartSetResponseChannel(uint8_t channel) { responseChannel = channel; }
+
+/**
+ * @brief Get the channel the responses of the calling task go to
+ * @return uint8_t Request ID, or UART_CHANNEL_RESPONSE
+ */
+uint8_t uartResponseChannel() { return responseChannel; }
+
+/**
+ * @brief Resolve the response channel to the one of the calling task
+ * @param channel Channel passed by the caller
+ * @return uint8_t Channel to write to
+ */
+static uint8_t taskChannel(uint8_t channel) {
+  return channel == UART_CHANNEL_RESPONSE ? responseChannel : channel;
+}
+
+/**
+ * @brief Take the text mode output lock
+ *
+ * Held only while output is copied into the TX ring, never while a body
+ * waits for the network.
+ */
+static void lockText() {
+  if (textMutex) {
+    xSemaphoreTakeRecursive(textMutex, portMAX_DELAY);
+  }
+}
+
+/**
+ * @brief Release the text mode output lock
+ */
+static void unlockText() {
+  if (textMutex) {
+    xSemaphoreGiveRecursive(textMutex);
+  }
+}
+
+/**
+ * @brief Take the text mode output lock once no body of another task runs
+ *
+ * Waits while another task's body got data within UART_TEXT_BODY_IDLE_MS,
+ * at most UART_TEXT_BODY_WAIT_MS, so a stalled body delays other output
+ * only briefly.
+ */
+static void lockTextBetweenBodies() {
+  TaskHandle_t self = xTaskGetCurrentTaskHandle();
+  uint32_t start = millis();
+  lockText();
+  while (textBodyTask != NULL && textBodyTask != self &&
+         millis() - textBodyWriteMs < UART_TEXT_BODY_IDLE_MS &&
+         millis() - start < UART_TEXT_BODY_WAIT_MS) {
+    unlockText();
+    delay(1);
+    lockText();
+  }
+}
+
+/**
+ * @brief Let other tasks print again after a body of the calling task
+ */
+void uartReleaseBody() {
+  if (textBodyOpen) {
+    textBodyOpen = false;
+    lockText();
+    if (textBodyTask == xTaskGetCurrentTaskHandle()) {
+      textBodyTask = NULL;
+    }
+    unlockText();
+  }
+}
+
+/**
+ * @brief Send a payload made of two parts as one or more frames
+ *
+ * Each frame is queued with a single write, so frames from different tasks
+ * never interleave.
+ *
+ * @param type Frame type
+ * @param channel Logical channel
+ * @param first First part of the payload
+ * @param firstLength Length of the first part
+ * @param second Second part of the payload
+ * @param secondLength Length of the second part
+ */
+static void writeFrames(UartFrameType type, uint8_t channel,
+                        const uint8_t *first, size_t firstLength,
+                        const uint8_t *second, size_t secondLength) {
+  uint8_t frame[5 + UART_FRAME_MAX_PAYLOAD + 2];
+  size_t remaining = firstLength + secondLength;
+  do {
+    size_t length = min(remaining, UART_FRAME_MAX_PAYLOAD);
+    remaining -= length;
+
+    // Gather the payload from both parts
+    size_t filled = 0;
+    while (filled < length) {
+      if (firstLength > 0) {
+        size_t n = min(firstLength, length - filled);
+        memcpy(frame + 5 + filled, first, n);
+        first += n;
+        firstLength -= n;
+        filled += n;
+      } else {
+        size_t n = min(secondLength, length - filled);
+        memcpy(frame + 5 + filled, second, n);
+        second += n;
+        secondLength -= n;
+        filled += n;
+      }
+    }
+
+    frame[0] = UART_FRAME_SYNC;
+    frame[1] = (type == UART_FRAME_TEXT && remaining > 0)
+                   ? (type | UART_FRAME_MORE)
+                   : type;
+    frame[2] = channel;
+    frame[3] = length & 0xFF;
+    frame[4] = length >> 8;
+    uint16_t crc = crc16(0xFFFF, frame + 1, 4 + length);
+    frame[5 + length] = crc & 0xFF;
+    frame[6 + length] = crc >> 8;
+    uartTx.write(frame, 7 + length);
+  } while (remaining > 0);
+}
+
+/**
+ * @brief Send a payload as one or more frames
+ * @param type Frame type
+ * @param channel Logical channel
+ * @param payload Frame payload
+ * @param length Payload length
+ */
+void uartWriteFrame(UartFrameType type, uint8_t channel, const uint8_t *payload,
+                    size_t length) {
+  writeFrames(type, channel, payload, length, nullptr, 0);
+}
+
+/**
+ * @brief Print one response line
+ * @param line Line without line ending
+ * @param channel Channel used in framed mode
+ */
+void uartWriteLine(const String &line, uint8_t channel) {
+  if (taskConsole) {
+    taskConsole->println(line);
+    return;
+  }
+  channel = taskChannel(channel);
+  if (uartFramingEnabled()) {
+    uartWriteFrame(UART_FRAME_TEXT, channel, (const uint8_t *)line.c_str(),
+                   line.length());
+  } else {
+    lockTextBetweenBodies();
+    const char *text = line.c_str();
+    if (channel > UART_CHANNEL_RESPONSE) {
+      // Newlines that end a body come before the tag
+      while (*text == '\n') {
+        uartTx.write(*text++);
+      }
+      uartTx.print("#" + String(channel) + " ");
+    }
+    uartTx.println(text);
+    unlockText();
+  }
+  // A line after a body ends the body
+  uartReleaseBody();
+}
+
+/**
+ * @brief Print an event line made of a prefix and raw data
+ * @param prefix Text before the data, e.g. "MESSAGE: "
+ * @param data Event data
+ * @param length Data length
+ */
+void uartWriteEvent(const char *prefix, const uint8_t *data, size_t length) {
+  if (uartFramingEnabled()) {
+    writeFrames(UART_FRAME_TEXT, UART_CHANNEL_EVENTS, (const uint8_t *)prefix,
+                strlen(prefix), data, length);
+  } else {
+    lockTextBetweenBodies();
+    uartTx.print(prefix);
+    uartTx.write(data, length);
+    uartTx.println();
+    unlockText();
+  }
+}
+
+/**
+ * @brief Write part of a response body
+ * @param data Body bytes
+ * @param length Number of bytes
+ * @param channel Channel used in framed mode
+ */
+void uartWriteBody(const uint8_t *data, size_t length, uint8_t channel) {
+  if (taskConsole) {
+    taskConsole->write(data, length);
+  } else if (uartFramingEnabled()) {
+    uartWriteFrame(UART_FRAME_DATA, taskChannel(channel), data, length);
+  } else {
+    lockTextBetweenBodies();
+    // Other output waits while the body streams, see uartReleaseBody()
+    textBodyOpen = true;
+    textBodyTask = xTaskGetCurrentTaskHandle();
+    uartTx.write(data, length);
+    textBodyWriteMs = millis();
+    unlockText();
+  }
+}
+
+/**
+ * @brief Mark the end of a response body
+ *
+ * Sends the end frame in framed mode and lets other tasks print again.
+ *
+ * @param channel Channel of the body
+ */
+void uartEndBody(uint8_t channel) {
+  if (uartFramingEnabled()) {
+    uartWriteFrame(UART_FRAME_END, taskChannel(channel), nullptr, 0);
+  }
+  uartReleaseBody();
+}
+
+/**
+ * @brief Switch between text and framed output
+ *
+ * The reply is sent in the mode that was active when the command arrived.
+ *
+ * @param mode TEXT or FRAMED
+ * @param packet Pointer to AsyncUDPPacket for response
+ */
+void setUartOutputMode(String mode, AsyncUDPPacket *packet) {
+  mode.toUpperCase();
+  if (mode != "TEXT" && mode != "FRAMED") {
+    printResponse("UART_ERROR: Invalid output mode. Supported modes: TEXT, "
+                  "FRAMED",
+                  packet);
+    return;
+  }
+  printResponse("UART_MODE: " + mode, packet);
+  framing.store(mode == "FRAMED", std::memory_order_release);
+}
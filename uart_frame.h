@@ -0,0 +1,44 @@
+#ifndef UART_FRAME_H
+#define UART_FRAME_H
+
+#include <Arduino.h>
+#include <AsyncUDP.h>
+
+/// First byte of every frame
+const uint8_t UART_FRAME_SYNC = 0xA5;
+
+/// Largest payload of one frame, longer output is split
+const size_t UART_FRAME_MAX_PAYLOAD = 512;
+
+/// Channel of asynchronous events (incoming UDP data and messages)
+const uint8_t UART_CHANNEL_EVENTS = 0;
+
+/// Channel of command responses
+const uint8_t UART_CHANNEL_RESPONSE = 1;
+
+/**
+ * @brief Frame types of the framed output mode
+ */
+enum UartFrameType : uint8_t {
+  UART_FRAME_TEXT = 0x01, ///< One response line, without line ending
+  UART_FRAME_DATA = 0x02, ///< Part of a response body
+  UART_FRAME_END = 0x03   ///< End of the response body on this channel
+};
+
+bool initUartFrame();
+bool uartFramingEnabled();
+void uartRedirectTask(Print *console);
+bool uartTaskRedirected();
+void uartSetResponseChannel(uint8_t channel);
+uint8_t uartResponseChannel();
+void uartReleaseBody();
+void uartWriteFrame(UartFrameType type, uint8_t channel, const uint8_t *payload,
+                    size_t length);
+void uartWriteLine(const String &line, uint8_t channel = UART_CHANNEL_RESPONSE);
+void uartWriteEvent(const char *prefix, const uint8_t *data, size_t length);
+void uartWriteBody(const uint8_t *data, size_t length,
+                   uint8_t channel = UART_CHANNEL_RESPONSE);
+void uartEndBody(uint8_t channel = UART_CHANNEL_RESPONSE);
+void setUartOutputMode(String mode, AsyncUDPPacket *packet);
+
+#endif // UART_FRAME_H
@@ -0,0 +1,241 @@
+/**
+ * @file uart_link.cpp
+ * @brief UART baud rate negotiation and line error counters
+ *
+ * This file contains the negotiation that moves the Flipper link off the
+ * boot rate of 115200 baud:
+ *
+ *   1. Flipper sends UART_BAUD <rate>, the board answers
+ *      UART_BAUD_SWITCH: <rate> and both sides switch.
+ *   2. At the new rate the board sends UART_BAUD_PROBE: <nonce>.
+ *   3. The Flipper echoes it with UART_BAUD_ECHO <nonce>, the board answers
+ *      UART_BAUD_OK: <rate>.
+ *
+ * If the echo is wrong, is preceded by line errors or does not arrive
+ * within UART_BAUD_CONFIRM_MS, the board falls back to 115200 and prints
+ * UART_BAUD_FAILED; the Flipper falls back when it sees no UART_BAUD_OK.
+ */
+
+#include "uart_link.h"
+#include "http_utils.h"
+#include "uart_frame.h"
+#include "uart_tx.h"
+#include "uart_utils.h"
+#include <atomic>
+#include <freertos/timers.h>
+
+/// Time the Flipper gets to switch before the probe is sent
+const uint32_t UART_BAUD_SETTLE_MS = 100;
+
+/// Time the Flipper gets to echo the probe
+const uint32_t UART_BAUD_CONFIRM_MS = 2000;
+
+/// Rates the board agrees to switch to
+static const uint32_t supportedBaudRates[] = {115200, 230400, 460800, 921600,
+                                              1000000, 1500000, 2000000};
+
+/**
+ * @brief State of the baud rate negotiation
+ */
+enum BaudState {
+  BAUD_IDLE,      ///< Running at a confirmed rate
+  BAUD_PENDING,   ///< Switched, waiting for the echo
+  BAUD_TIMED_OUT, ///< No echo in time, fallback not run yet
+};
+
+/**
+ * @struct UartLinkStats
+ * @brief Negotiation and line error counters
+ */
+struct UartLinkStats {
+  uint32_t negotiations; ///< Switches requested by the Flipper
+  uint32_t fallbacks;    ///< Negotiations that reverted to 115200
+  uint32_t breaks;       ///< Break conditions
+  uint32_t frameErrors;  ///< Frame errors, usually a baud rate mismatch
+  uint32_t parityErrors; ///< Parity errors
+  uint32_t overflows;    ///< RX FIFO or buffer overflows
+};
+
+static UartLinkStats linkStats;
+static std::atomic<BaudState> baudState{BAUD_IDLE};
+static uint32_t baudRate = UART_DEFAULT_BAUD;
+static uint32_t pendingRate = 0;
+static char pendingNonce[9];
+static std::atomic<uint32_t> pendingErrors{0};
+static TimerHandle_t baudTimer = NULL;
+
+/**
+ * @brief UART0 receive error callback, counts line errors
+ * @param error Error reported by the UART driver
+ */
+static void uartErrorCallback(hardwareSerial_error_t error) {
+  switch (error) {
+  case UART_BREAK_ERROR:
+    linkStats.breaks++;
+    break;
+  case UART_FRAME_ERROR:
+    linkStats.frameErrors++;
+    break;
+  case UART_PARITY_ERROR:
+    linkStats.parityErrors++;
+    break;
+  case UART_BUFFER_FULL_ERROR:
+  case UART_FIFO_OVF_ERROR:
+    linkStats.overflows++;
+    break;
+  default:
+    return;
+  }
+  if (baudState.load(std::memory_order_acquire) == BAUD_PENDING) {
+    pendingErrors.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+/**
+ * @brief Switch UART0 to a new rate once pending output has been sent
+ * @param rate New baud rate
+ */
+static void switchBaudRate(uint32_t rate) {
+  uartTxFlush();
+  UART0.updateBaudRate(rate);
+  baudRate = rate;
+}
+
+/**
+ * @brief Go back to the boot rate after a failed negotiation
+ * @param reason Printed with UART_BAUD_FAILED
+ */
+static void fallBack(const char *reason) {
+  switchBaudRate(UART_DEFAULT_BAUD);
+  linkStats.fallbacks++;
+  printResponse("UART_BAUD_FAILED: " + String(reason) + ", reverted to " +
+                    String(UART_DEFAULT_BAUD),
+                nullptr);
+}
+
+/**
+ * @brief Timer callback, the echo did not arrive in time
+ *
+ * Runs in the timer service task, which must not wait for the UART to
+ * drain, so the fallback is left to pollUartLink().
+ *
+ * @param timer Unused
+ */
+static void baudTimeoutCallback(TimerHandle_t timer) {
+  BaudState expected = BAUD_PENDING;
+  if (baudState.compare_exchange_strong(expected, BAUD_TIMED_OUT)) {
+    wakeSerialInput();
+  }
+}
+
+/**
+ * @brief Fall back to the boot rate if the echo timed out
+ *
+ * Called by the task reading UART input, which the timeout wakes up.
+ */
+void pollUartLink() {
+  if (baudState.load(std::memory_order_acquire) == BAUD_TIMED_OUT) {
+    fallBack("no echo");
+    baudState.store(BAUD_IDLE, std::memory_order_release);
+  }
+}
+
+/**
+ * @brief Register the error callback and create the confirmation timer
+ * @return bool False if the timer could not be created
+ */
+bool initUartLink() {
+  UART0.onReceiveError(uartErrorCallback);
+  baudTimer = xTimerCreate("uart_baud", pdMS_TO_TICKS(UART_BAUD_CONFIRM_MS),
+                           pdFALSE, NULL, baudTimeoutCallback);
+  return baudTimer != NULL;
+}
+
+/**
+ * @brief Switch to the rate proposed by the Flipper and send the probe
+ * @param rate Proposed baud rate
+ * @param packet Pointer to AsyncUDPPacket, must be null (UART only)
+ */
+void negotiateUartBaud(String rate, AsyncUDPPacket *packet) {
+  if (packet || uartTaskRedirected()) {
+    printResponse("UART_ERROR: Baud rate can only be negotiated over UART",
+                  packet);
+    return;
+  }
+  uint32_t requested = rate.toInt();
+  bool supported = false;
+  for (uint32_t candidate : supportedBaudRates) {
+    supported = supported || candidate == requested;
+  }
+  if (!supported) {
+    printResponse("UART_ERROR: Unsupported baud rate. Supported rates: "
+                  "115200, 230400, 460800, 921600, 1000000, 1500000, 2000000",
+                  packet);
+    return;
+  }
+  if (baudTimer == NULL ||
+      baudState.load(std::memory_order_acquire) != BAUD_IDLE) {
+    printResponse("UART_ERROR: Baud rate negotiation already in progress",
+                  packet);
+    return;
+  }
+
+  linkStats.negotiations++;
+  snprintf(pendingNonce, sizeof(pendingNonce), "%08lx",
+           (unsigned long)esp_random());
+  pendingRate = requested;
+  pendingErrors.store(0, std::memory_order_relaxed);
+
+  printResponse("UART_BAUD_SWITCH: " + String(requested), packet);
+  switchBaudRate(requested);
+  baudState.store(BAUD_PENDING, std::memory_order_release);
+  delay(UART_BAUD_SETTLE_MS);
+  // Bytes received while both sides were switching are garbage
+  pendingErrors.store(0, std::memory_order_relaxed);
+  xTimerReset(baudTimer, 0);
+  printResponse("UART_BAUD_PROBE: " + String(pendingNonce), packet);
+}
+
+/**
+ * @brief Check the Flipper's echo of the probe
+ * @param nonce Echoed nonce
+ * @param packet Pointer to AsyncUDPPacket for response
+ */
+void confirmUartBaud(String nonce, AsyncUDPPacket *packet) {
+  if (baudState.load(std::memory_order_acquire) != BAUD_PENDING) {
+    printResponse("UART_ERROR: No baud rate negotiation in progress", packet);
+    return;
+  }
+  bool valid = nonce == pendingNonce &&
+               pendingErrors.load(std::memory_order_relaxed) == 0;
+
+  BaudState expected = BAUD_PENDING;
+  if (!baudState.compare_exchange_strong(expected, BAUD_IDLE)) {
+    return; // The timer already reverted
+  }
+  xTimerStop(baudTimer, 0);
+  if (!valid) {
+    fallBack("echo mismatch or line errors");
+    return;
+  }
+  printResponse("UART_BAUD_OK: " + String(pendingRate), packet);
+}
+
+/**
+ * @brief Print the current rate and line error counters
+ * @param packet Pointer to AsyncUDPPacket for response
+ */
+void printUartStatus(AsyncUDPPacket *packet) {
+  printResponse("UART_STATUS: baud=" + String(baudRate) +
+                    " negotiated=" + String(baudRate != UART_DEFAULT_BAUD
+                                                ? "true"
+                                                : "false") +
+                    " negotiations=" + String(linkStats.negotiations) +
+                    " fallbacks=" + String(linkStats.fallbacks),
+                packet);
+  printResponse("UART_ERRORS: frame=" + String(linkStats.frameErrors) +
+                    " parity=" + String(linkStats.parityErrors) +
+                    " break=" + String(linkStats.breaks) +
+                    " overflow=" + String(linkStats.overflows),
+                packet);
+}
@@ -0,0 +1,16 @@
+#ifndef UART_LINK_H
+#define UART_LINK_H
+
+#include <Arduino.h>
+#include <AsyncUDP.h>
+
+/// Baud rate after boot and after a failed negotiation
+const uint32_t UART_DEFAULT_BAUD = 115200;
+
+bool initUartLink();
+void pollUartLink();
+void negotiateUartBaud(String rate, AsyncUDPPacket *packet);
+void confirmUartBaud(String nonce, AsyncUDPPacket *packet);
+void printUartStatus(AsyncUDPPacket *packet);
+
+#endif // UART_LINK_H
@@ -0,0 +1,280 @@
+/**
+ * @file uart_tx.cpp
+ * @brief Buffered UART output with optional flow control
+ *
+ * This file contains the UART transmit pipeline. Producers (command
+ * handlers, response streams) copy their output into a ring buffer and
+ * return to reading the network, while a writer task drains the ring to
+ * UART0 at line speed. The receiver can throttle the writer with XON/XOFF
+ * or with credits; throttling holds output back but never drops bytes.
+ */
+
+#include "uart_tx.h"
+#include "http_utils.h"
+#include "ring_buffer.h"
+#include "uart_utils.h"
+#include <atomic>
+
+/// Stack size of the writer task
+const uint32_t UART_TX_STACK_SIZE = 2048;
+
+/// Writer priority, above the executor so the UART never runs dry
+const UBaseType_t UART_TX_PRIORITY = 3;
+
+/// Bytes handed to UART0 per write
+const size_t UART_TX_CHUNK = 128;
+
+/// A stall without XON or credit for this long is counted as a timeout
+const uint32_t UART_TX_FLOW_TIMEOUT_MS = 5000;
+
+/// Output waiting for the writer task
+static SpscRing<uint8_t, 4096> uart_tx_ring;
+
+/// Serializes producers, the ring itself has a single producer side
+static SemaphoreHandle_t uart_tx_mutex = NULL;
+
+/// Given by the writer whenever it frees space in the ring
+static SemaphoreHandle_t uart_tx_space = NULL;
+
+static TaskHandle_t uart_tx_task = NULL;
+
+static std::atomic<UartFlowMode> flowMode{UART_FLOW_NONE};
+static std::atomic<bool> flowPaused{false};
+static std::atomic<int32_t> flowCredit{0};
+static std::atomic<bool> writerBusy{false};
+
+/**
+ * @struct UartTxStats
+ * @brief Counters for tuning the TX pipeline
+ */
+struct UartTxStats {
+  uint32_t bytes;           ///< Bytes written to UART0
+  uint32_t highWater;       ///< Most bytes waiting in the ring at once
+  uint32_t producerStalls;  ///< Writes that waited for space in the ring
+  uint32_t producerStallMs; ///< Time producers spent waiting
+  uint32_t flowStalls;      ///< Times the receiver held output back
+  uint32_t flowStallMs;     ///< Time output was held back
+  uint32_t flowTimeouts;    ///< Stalls longer than UART_TX_FLOW_TIMEOUT_MS
+};
+
+static UartTxStats txStats;
+
+UartTxStream uartTx;
+
+/**
+ * @brief Check whether the receiver currently holds output back
+ * @return bool True if the writer must wait
+ */
+static bool flowBlocked() {
+  switch (flowMode.load(std::memory_order_acquire)) {
+  case UART_FLOW_XONXOFF:
+    return flowPaused.load(std::memory_order_acquire);
+  case UART_FLOW_CREDITS:
+    return flowCredit.load(std::memory_order_acquire) <= 0;
+  default:
+    return false;
+  }
+}
+
+/**
+ * @brief Writer task, drains the TX ring to UART0
+ * @param parameter Unused
+ */
+static void uartTxTask(void *parameter) {
+  uint8_t chunk[UART_TX_CHUNK];
+  for (;;) {
+    if (uart_tx_ring.empty()) {
+      ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+      continue;
+    }
+
+    if (flowBlocked()) {
+      // Only XON, credit or UART_FLOW end a stall, the receiver may be busy
+      // for a long time and must not get output it didn't ask for
+      txStats.flowStalls++;
+      uint32_t stallStart = millis();
+      bool timedOut = false;
+      while (flowBlocked()) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(UART_TX_FLOW_TIMEOUT_MS));
+        if (!timedOut && flowBlocked() &&
+            millis() - stallStart >= UART_TX_FLOW_TIMEOUT_MS) {
+          timedOut = true;
+          txStats.flowTimeouts++;
+        }
+      }
+      txStats.flowStallMs += millis() - stallStart;
+    }
+
+    size_t allowed = UART_TX_CHUNK;
+    bool credits =
+        flowMode.load(std::memory_order_acquire) == UART_FLOW_CREDITS;
+    if (credits) {
+      int32_t credit = flowCredit.load(std::memory_order_acquire);
+      if (credit > 0 && (size_t)credit < allowed) {
+        allowed = credit;
+      }
+    }
+    writerBusy.store(true, std::memory_order_release);
+    size_t count = uart_tx_ring.pop(chunk, allowed);
+    UART0.write(chunk, count);
+    writerBusy.store(false, std::memory_order_release);
+
+    if (credits) {
+      flowCredit.fetch_sub(count, std::memory_order_acq_rel);
+    }
+    txStats.bytes += count;
+    xSemaphoreGive(uart_tx_space);
+  }
+}
+
+/**
+ * @brief Create the TX ring locks and start the writer task
+ * @return bool True if the writer task is running
+ */
+bool initUartTx() {
+  uart_tx_mutex = xSemaphoreCreateMutex();
+  uart_tx_space = xSemaphoreCreateBinary();
+  if (uart_tx_mutex == NULL || uart_tx_space == NULL) {
+    return false;
+  }
+  return xTaskCreate(uartTxTask, "uart_tx", UART_TX_STACK_SIZE, NULL,
+                     UART_TX_PRIORITY, &uart_tx_task) == pdPASS;
+}
+
+size_t UartTxStream::write(uint8_t data) { return write(&data, 1); }
+
+/**
+ * @brief Queue bytes for the writer task, waiting while the ring is full
+ * @param buf Bytes to send
+ * @param size Number of bytes
+ * @return size_t Always size, output is never dropped
+ */
+size_t UartTxStream::write(const uint8_t *buf, size_t size) {
+  if (uart_tx_task == NULL) {
+    return UART0.write(buf, size);
+  }
+
+  xSemaphoreTake(uart_tx_mutex, portMAX_DELAY);
+  size_t written = 0;
+  bool stalled = false;
+  uint32_t stallStart = 0;
+  while (written < size) {
+    written += uart_tx_ring.push(buf + written, size - written);
+    txStats.highWater = max(txStats.highWater, (uint32_t)uart_tx_ring.size());
+    xTaskNotifyGive(uart_tx_task);
+    if (written < size) {
+      if (!stalled) {
+        stalled = true;
+        stallStart = millis();
+        txStats.producerStalls++;
+      }
+      xSemaphoreTake(uart_tx_space, pdMS_TO_TICKS(10));
+    }
+  }
+  if (stalled) {
+    txStats.producerStallMs += millis() - stallStart;
+  }
+  xSemaphoreGive(uart_tx_mutex);
+  return size;
+}
+
+/**
+ * @brief Wait until all queued output has left the UART
+ */
+void uartTxFlush() {
+  while (!uart_tx_ring.empty() ||
+         writerBusy.load(std::memory_order_acquire)) {
+    delay(1);
+  }
+  UART0.flush();
+}
+
+/**
+ * @brief Take flow control bytes out of received UART data
+ *
+ * Called by the RX callback before framing commands. Only strips bytes of
+ * the active mode, so nothing changes while flow control is off.
+ *
+ * @param data Received bytes, compacted in place
+ * @param length Number of received bytes
+ * @return size_t Number of bytes left for the command parser
+ */
+size_t uartTxFilterFlowControl(uint8_t *data, size_t length) {
+  UartFlowMode mode = flowMode.load(std::memory_order_acquire);
+  if (mode == UART_FLOW_NONE) {
+    return length;
+  }
+
+  size_t kept = 0;
+  bool changed = false;
+  for (size_t i = 0; i < length; i++) {
+    uint8_t c = data[i];
+    if (mode == UART_FLOW_XONXOFF &&
+        (c == UART_FLOW_XON || c == UART_FLOW_XOFF)) {
+      flowPaused.store(c == UART_FLOW_XOFF, std::memory_order_release);
+      changed = true;
+    } else if (mode == UART_FLOW_CREDITS && c == UART_FLOW_CREDIT) {
+      // The writer subtracts concurrently, add with compare-exchange
+      int32_t credit = flowCredit.load(std::memory_order_acquire);
+      while (!flowCredit.compare_exchange_weak(
+          credit, min(credit + (int32_t)UART_TX_CREDIT_BLOCK,
+                      (int32_t)UART_TX_CREDIT_WINDOW),
+          std::memory_order_acq_rel)) {
+      }
+      changed = true;
+    } else {
+      data[kept++] = c;
+    }
+  }
+  if (changed && uart_tx_task) {
+    xTaskNotifyGive(uart_tx_task);
+  }
+  return kept;
+}
+
+/**
+ * @brief Select the UART output flow control mode
+ * @param mode OFF, XONXOFF or CREDITS
+ * @param packet Pointer to AsyncUDPPacket for response
+ */
+void setUartFlowMode(String mode, AsyncUDPPacket *packet) {
+  mode.toUpperCase();
+  if (mode == "OFF") {
+    flowMode.store(UART_FLOW_NONE, std::memory_order_release);
+  } else if (mode == "XONXOFF") {
+    flowPaused.store(false, std::memory_order_release);
+    flowMode.store(UART_FLOW_XONXOFF, std::memory_order_release);
+  } else if (mode == "CREDITS") {
+    flowCredit.store(UART_TX_CREDIT_WINDOW, std::memory_order_release);
+    flowMode.store(UART_FLOW_CREDITS, std::memory_order_release);
+  } else {
+    printResponse("UART_ERROR: Invalid flow mode. Supported modes: OFF, "
+                  "XONXOFF, CREDITS",
+                  packet);
+    return;
+  }
+  if (uart_tx_task) {
+    xTaskNotifyGive(uart_tx_task);
+  }
+  printResponse("UART_FLOW: " + mode, packet);
+}
+
+/**
+ * @brief Print TX pipeline counters
+ * @param packet Pointer to AsyncUDPPacket for response
+ */
+void printUartTxStats(AsyncUDPPacket *packet) {
+  static const char *const modeNames[] = {"OFF", "XONXOFF", "CREDITS"};
+  printResponse("UART_TX: queued=" + String(uart_tx_ring.size()) + "/" +
+                    String(uart_tx_ring.capacity()) +
+                    " high_water=" + String(txStats.highWater) +
+                    " bytes=" + String(txStats.bytes) +
+                    " flow=" + modeNames[flowMode.load()],
+                packet);
+  printResponse("UART_TX_STALLS: producer=" + String(txStats.producerStalls) +
+                    " producer_ms=" + String(txStats.producerStallMs) +
+                    " flow=" + String(txStats.flowStalls) +
+                    " flow_ms=" + String(txStats.flowStallMs) +
+                    " flow_timeouts=" + String(txStats.flowTimeouts),
+                packet);
+}
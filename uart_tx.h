@@ -0,0 +1,53 @@
+#ifndef UART_TX_H
+#define UART_TX_H
+
+#include <Arduino.h>
+#include <AsyncUDP.h>
+
+/// XON, resumes output in XON/XOFF mode
+const uint8_t UART_FLOW_XON = 0x11;
+
+/// XOFF, pauses output in XON/XOFF mode
+const uint8_t UART_FLOW_XOFF = 0x13;
+
+/// ACK, grants UART_TX_CREDIT_BLOCK more bytes in credit mode
+const uint8_t UART_FLOW_CREDIT = 0x06;
+
+/// Bytes granted by one credit byte
+const size_t UART_TX_CREDIT_BLOCK = 256;
+
+/// Credit available after enabling credit mode, and the most that is kept
+const size_t UART_TX_CREDIT_WINDOW = 1024;
+
+/**
+ * @brief UART output flow control modes
+ */
+enum UartFlowMode {
+  UART_FLOW_NONE,    ///< Send as fast as the UART allows
+  UART_FLOW_XONXOFF, ///< Pause on XOFF, resume on XON
+  UART_FLOW_CREDITS  ///< Send only bytes the receiver granted with ACK
+};
+
+/**
+ * @brief Print target that queues output for the UART writer task
+ *
+ * write() copies into the TX ring and returns, the writer task drains the
+ * ring to UART0. When the ring is full the caller waits for space, bytes
+ * are never dropped. Before initUartTx() output goes to UART0 directly.
+ */
+class UartTxStream : public Print {
+public:
+  size_t write(uint8_t data) override;
+  size_t write(const uint8_t *buf, size_t size) override;
+  using Print::write;
+};
+
+extern UartTxStream uartTx;
+
+bool initUartTx();
+void uartTxFlush();
+size_t uartTxFilterFlowControl(uint8_t *data, size_t length);
+void setUartFlowMode(String mode, AsyncUDPPacket *packet);
+void printUartTxStats(AsyncUDPPacket *packet);
+
+#endif // UART_TX_H
@@ -8,25 +8,64 @@
  */
 
 #include "uart_utils.h"
+#include "arg_utils.h"
+#include "async_requests.h"
+#include "command_queue.h"
+#include "http_pool.h"
 #include "http_utils.h"
 #include "led.h"
+#include "mqtt_client.h"
+#include "perf_utils.h"
+#include "response_cache.h"
+#include "ring_buffer.h"
+#include "sse_client.h"
+#include "tcp_server.h"
+#include "tls_session.h"
+#include "uart_compress.h"
+#include "uart_frame.h"
+#include "uart_link.h"
+#include "uart_tx.h"
+#include "udp_inbox.h"
+#include "udp_reply.h"
 #include "version.h"
 #include "wifi_utils.h"
+#include "ws_client.h"
 #include <AsyncUDP.h>
 
 
 /**
- * @brief Buffer to store incoming UART data
+ * @brief Ring buffer filled by the UART receive callback
+ *
+ * The receive callback is the only producer and handleSerialInput() the only
+ * consumer, so no lock is needed between them.
+ */
+static SpscRing<uint8_t, 1024> uart_rx_ring;
+
+/**
+ * @brief Time of the last received byte, written before bytes are pushed
  */
-String uart_buffer = "";
+static std::atomic<uint32_t> uart_last_rx_ms{0};
 
 /**
- * @brief Mutex to protect access to the UART buffer
+ * @brief Bytes dropped because the ring buffer was full
  */
-SemaphoreHandle_t uart_buffer_Mutex = NULL;
+static std::atomic<uint32_t> uart_rx_dropped{0};
 
 /**
- * @brief Timeout for UART communication in milliseconds
+ * @brief Task running handleSerialInput(), notified when bytes arrive
+ */
+static TaskHandle_t uart_rx_task = NULL;
+
+/**
+ * @brief Command line being assembled from the ring buffer
+ */
+static char uart_line[MAX_COMMAND_LENGTH + 1];
+static size_t uart_line_length = 0;
+static bool uart_line_overflow = false;
+
+/**
+ * @brief Inactivity timeout in milliseconds after which a line without a
+ * terminating newline is dispatched anyway
  */
 const uint32_t communicationTimeout_ms = 500;
 
@@ -45,69 +84,315 @@ String ensureHttpsPrefix(String url) {
   return url;
 }
 
-/**
- * @brief Placeholder function for command execution
- * @param argument The argument passed to the command
- * @param packet Pointer to the UDP packet (can be null)
- */
-void placeholderCommand(String argument, AsyncUDPPacket *packet) {}
-
-
 /**
  * @brief Array of available commands
+ *
+ * Name, help text and handler are bound together and the table lives in
+ * flash. The order is the order of the help output.
  */
-Command commands[] = {
-    {"VERSION", "VERSION: Get board version", placeholderCommand},
-    {"WIFI_CONNECT", "WIFI_CONNECT <SSID> <password>", placeholderCommand},
-    {"WIFI_SET_SSID", "WIFI_SET_SSID ssid <ssid>", placeholderCommand},
-    {"WIFI_SET_PASSWORD", "WIFI_SET_PASSWORD password <password>", placeholderCommand},
-    {"WIFI_ACTIVATE", "WIFI_ACTIVATE", placeholderCommand},
-    {"WIFI_DEACTIVATE", "WIFI_DEACTIVATE", placeholderCommand},
-    {"WIFI_LIST", "WIFI_LIST", placeholderCommand},
+static constexpr Command commands[] = {
+    {"VERSION", "VERSION: Get board version", getBoardVersionCommand},
+    {"WIFI_CONNECT", "WIFI_CONNECT <SSID> <password>", connectCommand},
+    {"WIFI_SET_SSID", "WIFI_SET_SSID ssid <ssid>", setSSIDCommand},
+    {"WIFI_SET_PASSWORD", "WIFI_SET_PASSWORD password <password>",
+     setPasswordCommand},
+    {"WIFI_ACTIVATE", "WIFI_ACTIVATE", activateWiFiCommand},
+    {"WIFI_DEACTIVATE", "WIFI_DEACTIVATE", disconnectWiFiCommand},
+    {"WIFI_LIST", "WIFI_LIST", listWiFiCommand},
     {"WIFI_STATUS", "WIFI_STATUS: Show wifi status CONNECTED / DISCONNECTED",
-     placeholderCommand},
+     checkWiFiStatusCommand},
     {"WIFI_GET_ACTIVE_SSID", "WIFI_GET_ACTIVE_SSID: <ssid>",
-     placeholderCommand},
-    {"WIFI_GET_LOCAL_IP", "WIFI_GET_LOCAL_IP", placeholderCommand},
-    {"GET", "GET <url>", placeholderCommand},
-    {"GET_STREAM", "GET_STREAM <url>", placeholderCommand},
-    {"FILE_STREAM", "FILE_STREAM <url>", placeholderCommand},
-    {"POST", "POST <url> <json_payload>", placeholderCommand},
-    {"POST_STREAM", "POST_STREAM <url> <json>", placeholderCommand},
-    {"BUILD_HTTP_METHOD", "BUILD_HTTP_METHOD <method>", placeholderCommand},
-    {"BUILD_HTTP_URL", "BUILD_HTTP_URL <url>", placeholderCommand},
-    {"BUILD_HTTP_HEADER", "BUILD_HTTP_HEADER <key:value>", placeholderCommand},
-    {"BUILD_HTTP_PAYLOAD", "BUILD_HTTP_PAYLOAD <payload>", placeholderCommand},
-    {"REMOVE_HTTP_HEADER", "REMOVE_HTTP_HEADER <key>", placeholderCommand},
-    {"RESET_HTTP_CONFIG", "RESET_HTTP_CONFIG", placeholderCommand},
+     wifiNetworkCommand},
+    {"WIFI_GET_LOCAL_IP", "WIFI_GET_LOCAL_IP", getWifiLocalIp},
+    {"GET", "GET <url>", getCommand},
+    {"GET_STREAM", "GET_STREAM <url>", getStreamCommand},
+    {"FILE_STREAM", "FILE_STREAM <url>", getFileStreamCommand},
+    {"FILE_RANGE", "FILE_RANGE <url> <start> <length>", getFileRangeCommand},
+    {"FILE_PAGE", "FILE_PAGE <url> <page> <page_size>", getFilePageCommand},
+    {"POST", "POST <url> <json_payload>", postCommand},
+    {"POST_STREAM", "POST_STREAM <url> <json>", postStreamCommand},
+    {"BUILD_HTTP_METHOD", "BUILD_HTTP_METHOD <method>", buildHttpMethodCommand},
+    {"BUILD_HTTP_URL", "BUILD_HTTP_URL <url>", buildHttpUrlCommand},
+    {"BUILD_HTTP_HEADER", "BUILD_HTTP_HEADER <key:value>",
+     buildHttpHeaderCommand},
+    {"BUILD_HTTP_PAYLOAD", "BUILD_HTTP_PAYLOAD <payload>",
+     buildHttpPayloadCommand},
+    {"REMOVE_HTTP_HEADER", "REMOVE_HTTP_HEADER <key>", removeHttpHeaderCommand},
+    {"RESET_HTTP_CONFIG", "RESET_HTTP_CONFIG", resetHttpConfigCommand},
     {"BUILD_HTTP_SHOW_RESPONSE_HEADERS",
-     "BUILD_HTTP_SHOW_RESPONSE_HEADERS <true/false>", placeholderCommand},
+     "BUILD_HTTP_SHOW_RESPONSE_HEADERS <true/false>",
+     buildHttpShowResponseHeadersCommand},
     {"BUILD_HTTP_IMPLEMENTATION", "BUILD_HTTP_IMPLEMENTATION <STREAM/CALL>",
-     placeholderCommand},
-    {"EXECUTE_HTTP_CALL", "EXECUTE_HTTP_CALL", placeholderCommand},
+     buildHttpImplementationCommand},
+    {"BUILD_HTTP_JSON_FILTER", "BUILD_HTTP_JSON_FILTER <path,path,...>",
+     buildHttpJsonFilterCommand},
+    {"BUILD_HTTP_JSON_FORMAT", "BUILD_HTTP_JSON_FORMAT <JSON/KEY_VALUE>",
+     buildHttpJsonFormatCommand},
+    {"EXECUTE_HTTP_CALL", "EXECUTE_HTTP_CALL", executeHttpCallCommand},
     {"BUILD_HTTP_SHOW_CONFIG",
      "BUILD_HTTP_SHOW_CONFIG: Show current HTTP configuration",
-     placeholderCommand},
-    {"MESSAGE_UDP", "MESSAGE_UDP <message> <remoteIP> <remotePort>", placeholderCommand},
-    {"?", "type ? to print help", placeholderCommand},
-    {"HELP", "HELP", placeholderCommand}};
+     getHttpBuilderConfigCommand},
+    {"MESSAGE_UDP", "MESSAGE_UDP <message> <remoteIP> <remotePort>",
+     handleMessageUDPCommand},
+    {"PERF_STATS", "PERF_STATS: Show command and stream performance counters",
+     perfStatsCommand},
+    {"PERF_RESET", "PERF_RESET", perfResetCommand},
+    {"PERF_HEAP", "PERF_HEAP <true/false>", perfHeapCommand},
+    {"QUEUE_STATS", "QUEUE_STATS: Show command queue depth and wait time",
+     queueStatsCommand},
+    {"HTTP_POOL_STATS", "HTTP_POOL_STATS: Show keep-alive connection pool",
+     httpPoolStatsCommand},
+    {"TLS_STATS", "TLS_STATS: Show TLS handshake and session cache counters",
+     tlsStatsCommand},
+    {"CACHE_STATS", "CACHE_STATS: Show response cache counters",
+     cacheStatsCommand},
+    {"CACHE_CLEAR", "CACHE_CLEAR: Delete all cached responses",
+     cacheClearCommand},
+    {"UART_FLOW", "UART_FLOW <OFF/XONXOFF/CREDITS>", uartFlowCommand},
+    {"UART_TX_STATS", "UART_TX_STATS: Show UART output buffer counters",
+     uartTxStatsCommand},
+    {"UART_BAUD", "UART_BAUD <rate>: Negotiate a faster UART baud rate",
+     uartBaudCommand},
+    {"UART_BAUD_ECHO", "UART_BAUD_ECHO <nonce>: Confirm the new baud rate",
+     uartBaudEchoCommand},
+    {"UART_STATUS", "UART_STATUS: Show baud rate and line error counters",
+     uartStatusCommand},
+    {"UART_MODE", "UART_MODE <TEXT/FRAMED>: Set the UART output format",
+     uartModeCommand},
+    {"HTTP_COMPRESSION", "HTTP_COMPRESSION <true/false>: gzip/deflate transfer",
+     httpCompressionCommand},
+    {"UART_COMPRESSION", "UART_COMPRESSION <true/false>: Compress UART bodies",
+     uartCompressionCommand},
+    {"UDP_ECHO", "UDP_ECHO <true/false>: Echo UDP packets to the UART",
+     udpEchoCommand},
+    {"UDP_STATS", "UDP_STATS: Show UDP inbox and reply counters",
+     udpStatsCommand},
+    {"UDP_COALESCE", "UDP_COALESCE <true/false>: Pack UDP replies",
+     udpCoalesceCommand},
+    {"TCP_STATUS", "TCP_STATUS: Show TCP sessions, throughput and latency",
+     tcpStatusCommand},
+    {"WS_CONNECT", "WS_CONNECT <url> [protocol]: Open a WebSocket",
+     wsConnectCommand},
+    {"WS_SEND", "WS_SEND <text>", wsSendCommand},
+    {"WS_CLOSE", "WS_CLOSE", wsCloseCommand},
+    {"WS_STATUS", "WS_STATUS: Show WebSocket state and counters",
+     wsStatusCommand},
+    {"SSE_CONNECT", "SSE_CONNECT <url> [event]: Subscribe to an event stream",
+     sseConnectCommand},
+    {"SSE_CLOSE", "SSE_CLOSE", sseCloseCommand},
+    {"SSE_STATUS", "SSE_STATUS: Show event stream state and counters",
+     sseStatusCommand},
+    {"MQTT_CONNECT", "MQTT_CONNECT <url> [client_id]: Connect to a broker",
+     mqttConnectCommand},
+    {"MQTT_SUB", "MQTT_SUB <topic> [qos]", mqttSubCommand},
+    {"MQTT_UNSUB", "MQTT_UNSUB <topic>", mqttUnsubCommand},
+    {"MQTT_PUB", "MQTT_PUB <topic> <qos> <payload>", mqttPubCommand},
+    {"MQTT_DISCONNECT", "MQTT_DISCONNECT", mqttDisconnectCommand},
+    {"MQTT_STATUS", "MQTT_STATUS: Show MQTT connection state and counters",
+     mqttStatusCommand},
+    {"ASYNC", "ASYNC <id> <command> [args]: Run an HTTP command concurrently",
+     asyncCommand},
+    {"ASYNC_MAX", "ASYNC_MAX <1-3>: Set the number of concurrent requests",
+     asyncMaxCommand},
+    {"ASYNC_STATS", "ASYNC_STATS: Show running and queued requests",
+     asyncStatsCommand},
+    {"?", "type ? to print help", helpCommand},
+    {"HELP", "HELP", helpCommand}};
+
+/// Number of registered commands
+constexpr size_t COMMAND_COUNT = sizeof(commands) / sizeof(commands[0]);
+
+/// Smallest power of two not below value
+constexpr size_t nextPowerOfTwo(size_t value) {
+  size_t result = 1;
+  while (result < value) {
+    result <<= 1;
+  }
+  return result;
+}
+
+/// Slots in the perfect hash table, kept at most half full
+constexpr size_t COMMAND_HASH_SLOTS = nextPowerOfTwo(COMMAND_COUNT * 2);
+
+/// First-level buckets, each with its own displacement seed
+constexpr size_t COMMAND_HASH_BUCKETS = nextPowerOfTwo(COMMAND_COUNT / 2 + 1);
+
+/// Marks an unused slot
+constexpr uint8_t COMMAND_SLOT_EMPTY = 0xFF;
+
+static_assert(COMMAND_COUNT < COMMAND_SLOT_EMPTY, "Too many commands");
+
+/**
+ * @brief FNV-1a hash of a command name
+ * @param name Command name, not necessarily null-terminated
+ * @param length Length of the name
+ * @param seed Seed mixed into the initial state
+ */
+constexpr uint32_t commandHash(const char *name, size_t length, uint32_t seed) {
+  uint32_t hash = 2166136261u ^ (seed * 0x9E3779B9u);
+  for (size_t i = 0; i < length; i++) {
+    hash ^= (uint8_t)name[i];
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+/// Length of a null-terminated string at compile time
+constexpr size_t commandNameLength(const char *name) {
+  size_t length = 0;
+  while (name[length] != '\0') {
+    length++;
+  }
+  return length;
+}
+
+/**
+ * @struct CommandHashTable
+ * @brief Perfect hash from command name to index in commands[]
+ *
+ * A name is first hashed with seed 0 to pick a bucket, then hashed again
+ * with that bucket's seed to pick its slot. Seeds are chosen at compile
+ * time so that every command lands in its own slot (hash and displace).
+ */
+struct CommandHashTable {
+  uint16_t bucketSeeds[COMMAND_HASH_BUCKETS];
+  uint8_t slots[COMMAND_HASH_SLOTS];
+  bool valid;
+};
+
+/**
+ * @brief Build the command perfect hash table at compile time
+ * @return CommandHashTable Table with valid set if every command has a slot
+ */
+constexpr CommandHashTable buildCommandHashTable() {
+  CommandHashTable table{};
+  for (size_t i = 0; i < COMMAND_HASH_SLOTS; i++) {
+    table.slots[i] = COMMAND_SLOT_EMPTY;
+  }
+
+  size_t bucketOf[COMMAND_COUNT] = {};
+  size_t bucketSize[COMMAND_HASH_BUCKETS] = {};
+  for (size_t i = 0; i < COMMAND_COUNT; i++) {
+    const char *name = commands[i].name;
+    bucketOf[i] = commandHash(name, commandNameLength(name), 0) &
+                  (COMMAND_HASH_BUCKETS - 1);
+    bucketSize[bucketOf[i]]++;
+  }
+
+  // Place the largest buckets first, they are the hardest to fit
+  bool placed[COMMAND_HASH_BUCKETS] = {};
+  for (size_t round = 0; round < COMMAND_HASH_BUCKETS; round++) {
+    size_t bucket = 0;
+    size_t largest = 0;
+    bool found = false;
+    for (size_t b = 0; b < COMMAND_HASH_BUCKETS; b++) {
+      if (!placed[b] && (!found || bucketSize[b] > largest)) {
+        bucket = b;
+        largest = bucketSize[b];
+        found = true;
+      }
+    }
+    placed[bucket] = true;
+    if (largest == 0) {
+      continue;
+    }
+
+    bool fits = false;
+    for (uint16_t seed = 1; seed != 0 && !fits; seed++) {
+      size_t chosen[COMMAND_COUNT] = {};
+      size_t count = 0;
+      fits = true;
+      for (size_t i = 0; i < COMMAND_COUNT && fits; i++) {
+        if (bucketOf[i] != bucket) {
+          continue;
+        }
+        const char *name = commands[i].name;
+        size_t slot = commandHash(name, commandNameLength(name), seed) &
+                      (COMMAND_HASH_SLOTS - 1);
+        if (table.slots[slot] != COMMAND_SLOT_EMPTY) {
+          fits = false;
+        }
+        for (size_t j = 0; j < count && fits; j++) {
+          if (chosen[j] == slot) {
+            fits = false;
+          }
+        }
+        chosen[count++] = slot;
+      }
+      if (fits) {
+        table.bucketSeeds[bucket] = seed;
+        count = 0;
+        for (size_t i = 0; i < COMMAND_COUNT; i++) {
+          if (bucketOf[i] == bucket) {
+            table.slots[chosen[count++]] = i;
+          }
+        }
+      }
+    }
+    if (!fits) {
+      return table;
+    }
+  }
+  table.valid = true;
+  return table;
+}
+
+/// Command lookup table, built by the compiler and stored in flash
+static constexpr CommandHashTable commandHashTable = buildCommandHashTable();
+
+static_assert(commandHashTable.valid,
+              "Command names must be unique to build the dispatch table");
+
+/**
+ * @brief Find a command by name in constant time
+ * @param name Command name, not necessarily null-terminated
+ * @param length Length of the name
+ * @return const Command* Matching command or nullptr
+ */
+const Command *findCommand(const char *name, size_t length) {
+  uint32_t bucket = commandHash(name, length, 0) & (COMMAND_HASH_BUCKETS - 1);
+  uint32_t slot = commandHash(name, length, commandHashTable.bucketSeeds[bucket]) &
+                  (COMMAND_HASH_SLOTS - 1);
+  uint8_t index = commandHashTable.slots[slot];
+  if (index == COMMAND_SLOT_EMPTY) {
+    return nullptr;
+  }
+  const Command &command = commands[index];
+  if (strncmp(command.name, name, length) != 0 ||
+      command.name[length] != '\0') {
+    return nullptr;
+  }
+  return &command;
+}
 
 /**
  * @brief UART0 receive callback function
  *
- * This function is called when data is available on UART0.
- * It reads the data into the uart_buffer with a timeout.
+ * This function is called from the UART event task when the RX FIFO fills
+ * up or the line goes idle. It moves the received bytes into uart_rx_ring
+ * and returns immediately; line framing happens in handleSerialInput().
  */
 void UART0_RX_CB() {
-  if (xSemaphoreTake(uart_buffer_Mutex, portMAX_DELAY)) {
-    uint32_t now = millis();
-    while ((millis() - now) < communicationTimeout_ms) {
-      if (UART0.available()) {
-        uart_buffer += (char)UART0.read();
-        now = millis();
-      }
+  uint8_t chunk[64];
+  size_t available;
+  while ((available = UART0.available()) > 0) {
+    size_t count = UART0.read(chunk, min(available, sizeof(chunk)));
+    uart_last_rx_ms.store(millis(), std::memory_order_release);
+    count = uartTxFilterFlowControl(chunk, count);
+    size_t pushed = uart_rx_ring.push(chunk, count);
+    if (pushed < count) {
+      uart_rx_dropped.fetch_add(count - pushed, std::memory_order_relaxed);
     }
-    xSemaphoreGive(uart_buffer_Mutex);
+  }
+  wakeSerialInput();
+}
+
+/**
+ * @brief Wake the task blocked in handleSerialInput()
+ */
+void wakeSerialInput() {
+  if (uart_rx_task) {
+    xTaskNotifyGive(uart_rx_task);
   }
 }
 
@@ -117,9 +402,10 @@ void UART0_RX_CB() {
  * @param argument The SSID to set
  * @param packet Pointer to the UDP packet (can be null)
  */
-void setSSIDCommand(String argument, AsyncUDPPacket *packet) {
-  printResponse("WIFI_SSID: " + argument, packet);
-  setSSID(argument);
+void setSSIDCommand(std::string_view argument, AsyncUDPPacket *packet) {
+  String ssid = toString(argument);
+  printResponse("WIFI_SSID: " + ssid, packet);
+  setSSID(ssid);
   led_set_green(255);
   delay(1000);
   led_set_green(0);
@@ -131,9 +417,10 @@ void setSSIDCommand(String argument, AsyncUDPPacket *packet) {
  * This function processes the data in uart_buffer,
  * extracts the command and argument, and calls the appropriate handler.
  */
-void setPasswordCommand(String argument, AsyncUDPPacket *packet) {
-  setPassword(argument);
-  printResponse("WIFI_PASSWORD: " + argument, packet);
+void setPasswordCommand(std::string_view argument, AsyncUDPPacket *packet) {
+  String password = toString(argument);
+  setPassword(password);
+  printResponse("WIFI_PASSWORD: " + password, packet);
   led_set_green(255);
   delay(1000);
   led_set_green(0);
@@ -144,7 +431,7 @@ void setPasswordCommand(String argument, AsyncUDPPacket *packet) {
  * @param argument Unused parameter
  * @param packet Pointer to AsyncUDPPacket, unused in this function
  */
-void activateWiFiCommand(String argument, AsyncUDPPacket *packet) {
+void activateWiFiCommand(std::string_view argument, AsyncUDPPacket *packet) {
   connectToWiFi();
 }
 
@@ -153,7 +440,7 @@ void activateWiFiCommand(String argument, AsyncUDPPacket *packet) {
  * @param argument Unused parameter
  * @param packet Pointer to AsyncUDPPacket for response
  */
-void checkWiFiStatusCommand(String argument, AsyncUDPPacket *packet) {
+void checkWiFiStatusCommand(std::string_view argument, AsyncUDPPacket *packet) {
   if (WiFi.status() == WL_CONNECTED) {
     printResponse("WIFI_STATUS: CONNECTED", packet);
   } else {
@@ -166,7 +453,7 @@ void checkWiFiStatusCommand(String argument, AsyncUDPPacket *packet) {
  * @param argument Unused parameter
  * @param packet Pointer to AsyncUDPPacket, unused in this function
  */
-void disconnectWiFiCommand(String argument, AsyncUDPPacket *packet) {
+void disconnectWiFiCommand(std::string_view argument, AsyncUDPPacket *packet) {
   disconnectFromWiFi();
 }
 
@@ -175,7 +462,7 @@ void disconnectWiFiCommand(String argument, AsyncUDPPacket *packet) {
  * @param argument Unused parameter
  * @param packet Pointer to AsyncUDPPacket for response
  */
-void listWiFiCommand(String argument, AsyncUDPPacket *packet) {
+void listWiFiCommand(std::string_view argument, AsyncUDPPacket *packet) {
   String list = listWiFiNetworks();
   printResponse(list, packet);
 }
@@ -185,7 +472,7 @@ void listWiFiCommand(String argument, AsyncUDPPacket *packet) {
  * @param argument Unused parameter
  * @param packet Pointer to AsyncUDPPacket for response
  */
-void getWifiLocalIp(String argument, AsyncUDPPacket *packet) {
+void getWifiLocalIp(std::string_view argument, AsyncUDPPacket *packet) {
   String ipString = getLocalIpString();
   printResponse(ipString, packet);
 }
@@ -195,10 +482,10 @@ void getWifiLocalIp(String argument, AsyncUDPPacket *packet) {
  * @param argument URL for the GET request
  * @param packet Pointer to AsyncUDPPacket for response
  */
-void getCommand(String argument, AsyncUDPPacket *packet) {
-  argument = ensureHttpsPrefix(argument);
-  printResponse("GET request to: " + argument, packet);
-  makeHttpRequest(argument, packet);
+void getCommand(std::string_view argument, AsyncUDPPacket *packet) {
+  String url = ensureHttpsPrefix(toString(argument));
+  printResponse("GET request to: " + url, packet);
+  makeHttpRequest(url, packet);
 }
 
 /**
@@ -206,10 +493,46 @@ void getCommand(String argument, AsyncUDPPacket *packet) {
  * @param argument URL for the GET request
  * @param packet Pointer to AsyncUDPPacket for response
  */
-void getFileStreamCommand(String argument, AsyncUDPPacket *packet) {
-  argument = ensureHttpsPrefix(argument);
-  (argument, packet);
-  makeHttpFileRequest(argument, packet);
+void getFileStreamCommand(std::string_view argument, AsyncUDPPacket *packet) {
+  String url = ensureHttpsPrefix(toString(argument));
+  makeHttpFileRequest(url, packet);
+}
+
+/**
+ * @brief Perform HTTP GET request for a byte window of a resource
+ * @param argument URL, offset of the first byte and number of bytes
+ *                 (0 for the rest of the resource)
+ * @param packet Pointer to AsyncUDPPacket for response
+ */
+void getFileRangeCommand(std::string_view argument, AsyncUDPPacket *packet) {
+  ArgTokenizer tokens(argument);
+  String url = ensureHttpsPrefix(toString(tokens.next()));
+  uint32_t start = 0;
+  uint32_t length = 0;
+  if (!argToUint32(tokens.next(), start) || !argToUint32(tokens.next(), length)) {
+    printResponse("ERROR: Invalid range", packet);
+    return;
+  }
+  makeHttpRangeRequest(url, start, length, packet);
+}
+
+/**
+ * @brief Perform HTTP GET request for one fixed-size page of a resource
+ * @param argument URL, page number (from 0) and page size in bytes
+ * @param packet Pointer to AsyncUDPPacket for response
+ */
+void getFilePageCommand(std::string_view argument, AsyncUDPPacket *packet) {
+  ArgTokenizer tokens(argument);
+  String url = ensureHttpsPrefix(toString(tokens.next()));
+  uint32_t page = 0;
+  uint32_t pageSize = 0;
+  if (!argToUint32(tokens.next(), page) ||
+      !argToUint32(tokens.next(), pageSize) || pageSize == 0 ||
+      (uint64_t)page * pageSize > UINT32_MAX) {
+    printResponse("ERROR: Invalid page", packet);
+    return;
+  }
+  makeHttpRangeRequest(url, page * pageSize, pageSize, packet);
 }
 
 /**
@@ -217,10 +540,10 @@ void getFileStreamCommand(String argument, AsyncUDPPacket *packet) {
  * @param argument URL for the GET request
  * @param packet Pointer to AsyncUDPPacket for response
  */
-void getStreamCommand(String argument, AsyncUDPPacket *packet) {
-  argument = ensureHttpsPrefix(argument);
-  printResponse("GET_STREAM: " + argument, packet);
-  makeHttpRequestStream(argument, packet);
+void getStreamCommand(std::string_view argument, AsyncUDPPacket *packet) {
+  String url = ensureHttpsPrefix(toString(argument));
+  printResponse("GET_STREAM: " + url, packet);
+  makeHttpRequestStream(url, packet);
 }
 
 /**
@@ -228,10 +551,10 @@ void getStreamCommand(String argument, AsyncUDPPacket *packet) {
  * @param argument String containing URL and JSON payload
  * @param packet Pointer to AsyncUDPPacket for response
  */
-void postCommand(String argument, AsyncUDPPacket *packet) {
-  int jsonStartIndex = argument.indexOf(' ') + 1;
-  String url = argument.substring(0, jsonStartIndex - 1);
-  String jsonPayload = argument.substring(jsonStartIndex);
+void postCommand(std::string_view argument, AsyncUDPPacket *packet) {
+  ArgTokenizer tokens(argument);
+  String url = toString(tokens.next());
+  String jsonPayload = toString(tokens.rest());
   printResponse("POST: " + url, packet);
   printResponse("Payload: " + jsonPayload, packet);
   makeHttpPostRequest(url, jsonPayload, packet);
@@ -243,10 +566,10 @@ void postCommand(String argument, AsyncUDPPacket *packet) {
  * @param argument String containing URL and JSON payload
  * @param packet Pointer to AsyncUDPPacket for response
  */
-void postStreamCommand(String argument, AsyncUDPPacket *packet) {
-  int jsonStartIndex = argument.indexOf(' ') + 1;
-  String url = argument.substring(0, jsonStartIndex - 1);
-  String jsonPayload = argument.substring(jsonStartIndex);
+void postStreamCommand(std::string_view argument, AsyncUDPPacket *packet) {
+  ArgTokenizer tokens(argument);
+  String url = toString(tokens.next());
+  String jsonPayload = toString(tokens.rest());
   makeHttpPostFileRequest(url, jsonPayload, packet);
 }
 
@@ -256,8 +579,8 @@ void postStreamCommand(String argument, AsyncUDPPacket *packet) {
  * @param argument HTTP method to set
  * @param packet Pointer to AsyncUDPPacket for response
  */
-void buildHttpMethodCommand(String argument, AsyncUDPPacket *packet) {
-  setHttpMethod(argument, packet);
+void buildHttpMethodCommand(std::string_view argument, AsyncUDPPacket *packet) {
+  setHttpMethod(toString(argument), packet);
 }
 
 /**
@@ -265,8 +588,8 @@ void buildHttpMethodCommand(String argument, AsyncUDPPacket *packet) {
  * @param argument URL to set
  * @param packet Pointer to AsyncUDPPacket for response
  */
-void buildHttpUrlCommand(String argument, AsyncUDPPacket *packet) {
-  setHttpUrl(argument, packet);
+void buildHttpUrlCommand(std::string_view argument, AsyncUDPPacket *packet) {
+  setHttpUrl(toString(argument), packet);
 }
 
 /**
@@ -274,8 +597,8 @@ void buildHttpUrlCommand(String argument, AsyncUDPPacket *packet) {
  * @param argument Header to add (format: "key:value")
  * @param packet Pointer to AsyncUDPPacket for response
  */
-void buildHttpHeaderCommand(String argument, AsyncUDPPacket *packet) {
-  addHttpHeader(argument, packet);
+void buildHttpHeaderCommand(std::string_view argument, AsyncUDPPacket *packet) {
+  addHttpHeader(toString(argument), packet);
 }
 
 /**
@@ -283,8 +606,8 @@ void buildHttpHeaderCommand(String argument, AsyncUDPPacket *packet) {
  * @param argument Payload to set
  * @param packet Pointer to AsyncUDPPacket for response
  */
-void buildHttpPayloadCommand(String argument, AsyncUDPPacket *packet) {
-  setHttpPayload(argument, packet);
+void buildHttpPayloadCommand(std::string_view argument, AsyncUDPPacket *packet) {
+  setHttpPayload(toString(argument), packet);
 }
 
 /**
@@ -292,8 +615,8 @@ void buildHttpPayloadCommand(String argument, AsyncUDPPacket *packet) {
  * @param argument Header key to remove
  * @param packet Pointer to AsyncUDPPacket for response
  */
-void removeHttpHeaderCommand(String argument, AsyncUDPPacket *packet) {
-  removeHttpHeader(argument, packet);
+void removeHttpHeaderCommand(std::string_view argument, AsyncUDPPacket *packet) {
+  removeHttpHeader(toString(argument), packet);
 }
 
 /**
@@ -301,7 +624,7 @@ void removeHttpHeaderCommand(String argument, AsyncUDPPacket *packet) {
  * @param argument Unused parameter
  * @param packet Pointer to AsyncUDPPacket for response
  */
-void resetHttpConfigCommand(String argument, AsyncUDPPacket *packet) {
+void resetHttpConfigCommand(std::string_view argument, AsyncUDPPacket *packet) {
   resetHttpConfig(packet);
 }
 
@@ -310,7 +633,7 @@ void resetHttpConfigCommand(String argument, AsyncUDPPacket *packet) {
  * @param argument Unused parameter
  * @param packet Pointer to AsyncUDPPacket for response
  */
-void getHttpBuilderConfigCommand(String argument, AsyncUDPPacket *packet) {
+void getHttpBuilderConfigCommand(std::string_view argument, AsyncUDPPacket *packet) {
   getHttpBuilderConfig(packet);
 }
 
@@ -319,7 +642,7 @@ void getHttpBuilderConfigCommand(String argument, AsyncUDPPacket *packet) {
  * @param argument Implementation type ("STREAM" or "CALL")
  * @param packet Pointer to AsyncUDPPacket for response
  */
-void buildHttpImplementationCommand(String argument, AsyncUDPPacket *packet) {
+void buildHttpImplementationCommand(std::string_view argument, AsyncUDPPacket *packet) {
   // Check if argument is a valid string of either STREAM or CALL;
   // if not, print an error message
   if (argument != "STREAM" && argument != "CALL") {
@@ -329,7 +652,27 @@ void buildHttpImplementationCommand(String argument, AsyncUDPPacket *packet) {
         packet);
     return;
   }
-  setHttpImplementation(argument, packet);
+  setHttpImplementation(toString(argument), packet);
+}
+
+/**
+ * @brief Build HTTP JSON filter
+ * @param argument Comma-separated JSON paths, empty to clear the filter
+ * @param packet Pointer to AsyncUDPPacket for response
+ */
+void buildHttpJsonFilterCommand(std::string_view argument,
+                                AsyncUDPPacket *packet) {
+  setHttpJsonFilter(toString(argument), packet);
+}
+
+/**
+ * @brief Build HTTP JSON filter output format
+ * @param argument JSON or KEY_VALUE
+ * @param packet Pointer to AsyncUDPPacket for response
+ */
+void buildHttpJsonFormatCommand(std::string_view argument,
+                                AsyncUDPPacket *packet) {
+  setHttpJsonFormat(toString(argument), packet);
 }
 
 
@@ -338,9 +681,9 @@ void buildHttpImplementationCommand(String argument, AsyncUDPPacket *packet) {
  * @param argument "true" or "false"
  * @param packet Pointer to AsyncUDPPacket for response
  */
-void buildHttpShowResponseHeadersCommand(String argument,
+void buildHttpShowResponseHeadersCommand(std::string_view argument,
                                          AsyncUDPPacket *packet) {
-  setShowResponseHeaders(argument.equalsIgnoreCase("true"), packet);
+  setShowResponseHeaders(argEqualsIgnoreCase(argument, "true"), packet);
 }
 
 /**
@@ -348,7 +691,7 @@ void buildHttpShowResponseHeadersCommand(String argument,
  * @param argument Unused parameter
  * @param packet Pointer to AsyncUDPPacket for response
  */
-void executeHttpCallCommand(String argument, AsyncUDPPacket *packet) {
+void executeHttpCallCommand(std::string_view argument, AsyncUDPPacket *packet) {
   executeHttpCall(packet);
 }
 
@@ -357,7 +700,7 @@ void executeHttpCallCommand(String argument, AsyncUDPPacket *packet) {
  * @param argument Unused parameter
  * @param packet Pointer to AsyncUDPPacket for response
  */
-void wifiNetworkCommand(String argument, AsyncUDPPacket *packet) {
+void wifiNetworkCommand(std::string_view argument, AsyncUDPPacket *packet) {
   if (WiFi.status() == WL_CONNECTED) {
     printResponse("WIFI_GET_ACTIVE_SSID: " + WiFi.SSID(), packet);
   } else {
@@ -371,13 +714,13 @@ void wifiNetworkCommand(String argument, AsyncUDPPacket *packet) {
  * @param argument String containing SSID and password
  * @param packet Pointer to AsyncUDPPacket for response
  */
-void connectCommand(String argument, AsyncUDPPacket *packet) {
-  int spaceIndex = argument.indexOf(' ');
-  if (spaceIndex != -1) {
-    String ssid = argument.substring(0, spaceIndex);
-    String password = argument.substring(spaceIndex + 1);
-    setSSID(ssid);
-    setPassword(password);
+void connectCommand(std::string_view argument, AsyncUDPPacket *packet) {
+  ArgTokenizer tokens(argument);
+  std::string_view ssid = tokens.next();
+  std::string_view password = tokens.rest();
+  if (!ssid.empty() && !password.empty()) {
+    setSSID(toString(ssid));
+    setPassword(toString(password));
     connectToWiFi();
   } else {
     printResponse("WIFI_ERROR: Invalid CONNECT command format. Use: CONNECT "
@@ -387,12 +730,380 @@ void connectCommand(String argument, AsyncUDPPacket *packet) {
 }
 
 
+/**
+ * @brief Print performance counters
+ * @param argument Unused parameter
+ * @param packet Pointer to AsyncUDPPacket for response
+ */
+void perfStatsCommand(std::string_view argument, AsyncUDPPacket *packet) {
+  printPerfStats(packet);
+}
+
+/**
+ * @brief Reset performance counters
+ * @param argument Unused parameter
+ * @param packet Pointer to AsyncUDPPacket for response
+ */
+void perfResetCommand(std::string_view argument, AsyncUDPPacket *packet) {
+  resetPerfStats(packet);
+}
+
+/**
+ * @brief Enable or disable per-command heap block accounting
+ * @param argument "true" or "false"
+ * @param packet Pointer to AsyncUDPPacket for response
+ */
+void perfHeapCommand(std::string_view argument, AsyncUDPPacket *packet) {
+  setPerfHeapTracking(argEqualsIgnoreCase(argument, "true"), packet);
+}
+
+/**
+ * @brief Print command queue counters
+ * @param argument Unused parameter
+ * @param packet Pointer to AsyncUDPPacket for response
+ */
+void queueStatsCommand(std::string_view argument, AsyncUDPPacket *packet) {
+  printCommandQueueStats(packet);
+}
+
+/**
+ * @brief Print keep-alive connection pool counters
+ * @param argument Unused parameter
+ * @param packet Pointer to AsyncUDPPacket for response
+ */
+void httpPoolStatsCommand(std::string_view argument, AsyncUDPPacket *packet) {
+  printHttpPoolStats(packet);
+}
+
+/**
+ * @brief Print TLS handshake counters
+ * @param argument Unused parameter
+ * @param packet Pointer to AsyncUDPPacket for response
+ */
+void tlsStatsCommand(std::string_view argument, AsyncUDPPacket *packet) {
+  printTlsStats(packet);
+}
+
+/**
+ * @brief Print response cache counters
+ * @param argument Unused parameter
+ * @param packet Pointer to AsyncUDPPacket for response
+ */
+void cacheStatsCommand(std::string_view argument, AsyncUDPPacket *packet) {
+  printResponseCacheStats(packet);
+}
+
+/**
+ * @brief Delete all cached responses
+ * @param argument Unused parameter
+ * @param packet Pointer to AsyncUDPPacket for response
+ */
+void cacheClearCommand(std::string_view argument, AsyncUDPPacket *packet) {
+  clearResponseCache(packet);
+}
+
+/**
+ * @brief Set the UART output flow control mode
+ * @param argument OFF, XONXOFF or CREDITS
+ * @param packet Pointer to AsyncUDPPacket for response
+ */
+void uartFlowCommand(std::string_view argument, AsyncUDPPacket *packet) {
+  setUartFlowMode(toString(argument), packet);
+}
+
+/**
+ * @brief Print UART output buffer counters
+ * @param argument Unused parameter
+ * @param packet Pointer to AsyncUDPPacket for response
+ */
+void uartTxStatsCommand(std::string_view argument, AsyncUDPPacket *packet) {
+  printUartTxStats(packet);
+}
+
+/**
+ * @brief Switch to a baud rate proposed by the Flipper
+ * @param argument Proposed baud rate
+ * @param packet Pointer to AsyncUDPPacket for response
+ */
+void uartBaudCommand(std::string_view argument, AsyncUDPPacket *packet) {
+  negotiateUartBaud(toString(argument), packet);
+}
+
+/**
+ * @brief Confirm a negotiated baud rate with the echoed probe
+ * @param argument Nonce from UART_BAUD_PROBE
+ * @param packet Pointer to AsyncUDPPacket for response
+ */
+void uartBaudEchoCommand(std::string_view argument, AsyncUDPPacket *packet) {
+  confirmUartBaud(toString(argument), packet);
+}
+
+/**
+ * @brief Print baud rate and line error counters
+ * @param argument Unused parameter
+ * @param packet Pointer to AsyncUDPPacket for response
+ */
+void uartStatusCommand(std::string_view argument, AsyncUDPPacket *packet) {
+  printUartStatus(packet);
+}
+
+/**
+ * @brief Switch UART output between text and frames
+ * @param argument Output mode, TEXT or FRAMED
+ * @param packet Pointer to AsyncUDPPacket for response
+ */
+void uartModeCommand(std::string_view argument, AsyncUDPPacket *packet) {
+  setUartOutputMode(toString(argument), packet);
+}
+
+/**
+ * @brief Enable or disable compressed HTTP transfer
+ * @param argument "true" to offer gzip / deflate
+ * @param packet Pointer to AsyncUDPPacket for response
+ */
+void httpCompressionCommand(std::string_view argument, AsyncUDPPacket *packet) {
+  setHttpCompression(argEqualsIgnoreCase(argument, "true"), packet);
+}
+
+/**
+ * @brief Enable or disable compressed response bodies on the UART
+ * @param argument "true" to compress bodies
+ * @param packet Pointer to AsyncUDPPacket for response
+ */
+void uartCompressionCommand(std::string_view argument, AsyncUDPPacket *packet) {
+  setUartCompression(argEqualsIgnoreCase(argument, "true"), packet);
+}
+
+/**
+ * @brief Enable or disable the echo of received UDP packets
+ * @param argument "true" to echo packets
+ * @param packet Pointer to AsyncUDPPacket for response
+ */
+void udpEchoCommand(std::string_view argument, AsyncUDPPacket *packet) {
+  setUdpEcho(argEqualsIgnoreCase(argument, "true"), packet);
+}
+
+/**
+ * @brief Print UDP inbox and reply counters
+ * @param argument Unused parameter
+ * @param packet Pointer to AsyncUDPPacket for response
+ */
+void udpStatsCommand(std::string_view argument, AsyncUDPPacket *packet) {
+  printUdpInboxStats(packet);
+  printUdpReplyStats(packet);
+}
+
+/**
+ * @brief Enable or disable coalesced, sequenced UDP replies
+ * @param argument "true" to coalesce replies
+ * @param packet Pointer to AsyncUDPPacket for response
+ */
+void udpCoalesceCommand(std::string_view argument, AsyncUDPPacket *packet) {
+  setUdpCoalescing(argEqualsIgnoreCase(argument, "true"), packet);
+}
+
+/**
+ * @brief Print TCP command server sessions
+ * @param argument Unused parameter
+ * @param packet Pointer to AsyncUDPPacket for response
+ */
+void tcpStatusCommand(std::string_view argument, AsyncUDPPacket *packet) {
+  printTcpStatus(packet);
+}
+
+/**
+ * @brief Open a WebSocket, its messages are forwarded as events
+ * @param argument URL and optional subprotocol
+ * @param packet Pointer to AsyncUDPPacket for response
+ */
+void wsConnectCommand(std::string_view argument, AsyncUDPPacket *packet) {
+  ArgTokenizer tokens(argument);
+  String url = toString(tokens.next());
+  String protocol = toString(tokens.rest());
+  connectWebSocket(url, protocol, packet);
+}
+
+/**
+ * @brief Send a text message on the open WebSocket
+ * @param argument Message text
+ * @param packet Pointer to AsyncUDPPacket for response
+ */
+void wsSendCommand(std::string_view argument, AsyncUDPPacket *packet) {
+  sendWebSocketText(toString(argument), packet);
+}
+
+/**
+ * @brief Close the open WebSocket
+ * @param argument Unused parameter
+ * @param packet Pointer to AsyncUDPPacket for response
+ */
+void wsCloseCommand(std::string_view argument, AsyncUDPPacket *packet) {
+  closeWebSocket(packet);
+}
+
+/**
+ * @brief Print WebSocket state and counters
+ * @param argument Unused parameter
+ * @param packet Pointer to AsyncUDPPacket for response
+ */
+void wsStatusCommand(std::string_view argument, AsyncUDPPacket *packet) {
+  printWebSocketStatus(packet);
+}
+
+/**
+ * @brief Subscribe to a Server-Sent Events stream, its events are forwarded
+ * @param argument URL and optional event type filter
+ * @param packet Pointer to AsyncUDPPacket for response
+ */
+void sseConnectCommand(std::string_view argument, AsyncUDPPacket *packet) {
+  ArgTokenizer tokens(argument);
+  String url = toString(tokens.next());
+  String eventType = toString(tokens.rest());
+  connectEventSource(url, eventType, packet);
+}
+
+/**
+ * @brief End the event stream subscription
+ * @param argument Unused parameter
+ * @param packet Pointer to AsyncUDPPacket for response
+ */
+void sseCloseCommand(std::string_view argument, AsyncUDPPacket *packet) {
+  closeEventSource(packet);
+}
+
+/**
+ * @brief Print event stream state and counters
+ * @param argument Unused parameter
+ * @param packet Pointer to AsyncUDPPacket for response
+ */
+void sseStatusCommand(std::string_view argument, AsyncUDPPacket *packet) {
+  printEventSourceStatus(packet);
+}
+
+/**
+ * @brief Connect to an MQTT broker, received messages are forwarded as events
+ * @param argument Broker URL and optional client ID
+ * @param packet Pointer to AsyncUDPPacket for response
+ */
+void mqttConnectCommand(std::string_view argument, AsyncUDPPacket *packet) {
+  ArgTokenizer tokens(argument);
+  String url = toString(tokens.next());
+  String clientId = toString(tokens.next());
+  connectMqtt(url, clientId, packet);
+}
+
+/**
+ * @brief Parse an MQTT QoS level, only 0 and 1 are supported
+ * @param value Argument text, 0 if empty
+ * @param qos Receives the level
+ * @param packet Pointer to AsyncUDPPacket for response
+ * @return bool False after printing an error
+ */
+static bool parseMqttQos(std::string_view value, uint8_t &qos,
+                         AsyncUDPPacket *packet) {
+  uint32_t level = 0;
+  if (!value.empty() && (!argToUint32(value, level) || level > 1)) {
+    printResponse("MQTT_ERROR: QoS must be 0 or 1", packet);
+    return false;
+  }
+  qos = level;
+  return true;
+}
+
+/**
+ * @brief Subscribe to an MQTT topic filter
+ * @param argument Topic filter and optional QoS
+ * @param packet Pointer to AsyncUDPPacket for response
+ */
+void mqttSubCommand(std::string_view argument, AsyncUDPPacket *packet) {
+  ArgTokenizer tokens(argument);
+  String topic = toString(tokens.next());
+  uint8_t qos;
+  if (parseMqttQos(tokens.next(), qos, packet)) {
+    subscribeMqtt(topic, qos, packet);
+  }
+}
+
+/**
+ * @brief Unsubscribe from an MQTT topic filter
+ * @param argument Topic filter
+ * @param packet Pointer to AsyncUDPPacket for response
+ */
+void mqttUnsubCommand(std::string_view argument, AsyncUDPPacket *packet) {
+  unsubscribeMqtt(toString(ArgTokenizer(argument).next()), packet);
+}
+
+/**
+ * @brief Publish an MQTT message
+ * @param argument Topic, QoS and payload
+ * @param packet Pointer to AsyncUDPPacket for response
+ */
+void mqttPubCommand(std::string_view argument, AsyncUDPPacket *packet) {
+  ArgTokenizer tokens(argument);
+  String topic = toString(tokens.next());
+  std::string_view qosArgument = tokens.next();
+  if (qosArgument.empty()) {
+    printResponse("MQTT_ERROR: Usage: MQTT_PUB <topic> <qos> <payload>",
+                  packet);
+    return;
+  }
+  uint8_t qos;
+  if (parseMqttQos(qosArgument, qos, packet)) {
+    publishMqtt(topic, toString(tokens.rest()), qos, packet);
+  }
+}
+
+/**
+ * @brief Disconnect from the MQTT broker
+ * @param argument Unused parameter
+ * @param packet Pointer to AsyncUDPPacket for response
+ */
+void mqttDisconnectCommand(std::string_view argument, AsyncUDPPacket *packet) {
+  disconnectMqtt(packet);
+}
+
+/**
+ * @brief Print MQTT connection state and counters
+ * @param argument Unused parameter
+ * @param packet Pointer to AsyncUDPPacket for response
+ */
+void mqttStatusCommand(std::string_view argument, AsyncUDPPacket *packet) {
+  printMqttStatus(packet);
+}
+
+/**
+ * @brief Run an HTTP command on a worker task, tagged with a request ID
+ * @param argument Request ID, command and its argument
+ * @param packet Pointer to AsyncUDPPacket for response
+ */
+void asyncCommand(std::string_view argument, AsyncUDPPacket *packet) {
+  submitAsyncRequest(argument, packet);
+}
+
+/**
+ * @brief Set how many asynchronous requests may run at once
+ * @param argument Number of workers
+ * @param packet Pointer to AsyncUDPPacket for response
+ */
+void asyncMaxCommand(std::string_view argument, AsyncUDPPacket *packet) {
+  setAsyncConcurrency(argument, packet);
+}
+
+/**
+ * @brief Print asynchronous request counters
+ * @param argument Unused parameter
+ * @param packet Pointer to AsyncUDPPacket for response
+ */
+void asyncStatsCommand(std::string_view argument, AsyncUDPPacket *packet) {
+  printAsyncStats(packet);
+}
+
 /**
  * @brief Get board version
  * @param argument Unused parameter
  * @param packet Pointer to AsyncUDPPacket for response
  */
-void getBoardVersionCommand(String argument, AsyncUDPPacket *packet) {
+void getBoardVersionCommand(std::string_view argument, AsyncUDPPacket *packet) {
   printResponse("VERSION: " + String(version), packet);
 }
 
@@ -402,10 +1113,10 @@ void getBoardVersionCommand(String argument, AsyncUDPPacket *packet) {
  * @param argument Unused parameter
  * @param packet Pointer to AsyncUDPPacket for response
  */
-void helpCommand(String argument, AsyncUDPPacket *packet) {
+void helpCommand(std::string_view argument, AsyncUDPPacket *packet) {
   printResponse("Available Commands:", packet);
-  for (int i = 0; i < sizeof(commands) / sizeof(commands[0]); i++) {
-    printResponse(commands[i].description, packet);
+  for (const Command &command : commands) {
+    printResponse(command.description, packet);
   }
 }
 
@@ -415,44 +1126,113 @@ void helpCommand(String argument, AsyncUDPPacket *packet) {
  * @param argument Command argument string
  * @param packet Pointer to AsyncUDPPacket for response
  */
-void handleCommand(String command, String argument, AsyncUDPPacket *packet) {
-  for (int i = 0; i < sizeof(commands) / sizeof(commands[0]); i++) {
-    if (commands[i].name == command) {
-      commands[i].execute(argument, packet);
-      return;
-    }
+void handleCommand(std::string_view command, std::string_view argument,
+                   AsyncUDPPacket *packet) {
+  uint32_t dispatchStart = perfStart();
+  const Command *entry = findCommand(command.data(), command.length());
+  perfRecord(PERF_DISPATCH, dispatchStart);
+  perfRecordHeldBlocks();
+
+  if (entry == nullptr) {
+    printResponse("Unknown command", packet);
+    return;
+  }
+  uint32_t handlerStart = micros();
+  entry->execute(argument, packet);
+  perfRecordMicros(PERF_HANDLER, handlerStart);
+}
+
+/**
+ * @brief Apply a UART_FLOW line right away instead of queueing it
+ *
+ * While the Flipper holds output back the executor may be waiting for
+ * space in the TX ring, so a queued UART_FLOW would never run.
+ *
+ * @param line Command line, not null-terminated
+ * @param length Length of the line
+ * @return bool True if the line was a UART_FLOW command
+ */
+static bool applyFlowCommand(const char *line, size_t length) {
+  std::string_view text(line, length);
+  size_t start = text.find_first_not_of(' ');
+  if (start == std::string_view::npos) {
+    return false;
+  }
+  text.remove_prefix(start);
+  size_t space = text.find(' ');
+  if (text.substr(0, space) != "UART_FLOW") {
+    return false;
+  }
+  std::string_view argument;
+  if (space != std::string_view::npos) {
+    argument = text.substr(space + 1);
+    size_t end = argument.find_last_not_of(' ');
+    argument = end == std::string_view::npos ? std::string_view()
+                                             : argument.substr(0, end + 1);
   }
-  printResponse("Unknown command", packet);
+  uartFlowCommand(argument, nullptr);
+  return true;
+}
+
+/**
+ * @brief Queue the command line assembled in uart_line for the executor
+ */
+static void dispatchSerialLine() {
+  if (!uart_line_overflow && applyFlowCommand(uart_line, uart_line_length)) {
+    uart_line_length = 0;
+    return;
+  }
+  int32_t heapMark = perfHeapMark();
+  EnqueueResult result =
+      uart_line_overflow
+          ? ENQUEUE_TOO_LONG
+          : enqueueCommand(uart_line, uart_line_length, nullptr, heapMark);
+  if (result != ENQUEUE_OK) {
+    reportEnqueueFailure(result, nullptr);
+  }
+  uart_line_length = 0;
+  uart_line_overflow = false;
 }
 
 /**
  * @brief Handle the incoming serial input
  *
- * This function processes the data in uart_buffer,
- * extracts the command and argument, and calls the appropriate handler.
+ * This function drains uart_rx_ring into the current command line and
+ * queues it as soon as a newline arrives. A line without a newline is
+ * queued once the UART has been idle for communicationTimeout_ms. While
+ * there is nothing to do the calling task sleeps until the receive callback
+ * notifies it. A baud rate negotiation that timed out falls back here too.
  */
 void handleSerialInput() {
-  if (uart_buffer.length() > 0) {
-    if (xSemaphoreTake(uart_buffer_Mutex, portMAX_DELAY)) {
-      uart_buffer.trim();
-
-      String command;
-      String argument;
-
-      int spaceIndex = uart_buffer.indexOf(' ');
-      if (spaceIndex != -1) {
-        command = uart_buffer.substring(0, spaceIndex);
-        argument = uart_buffer.substring(spaceIndex + 1);
-      } else {
-        command = uart_buffer;
-      }
-
-      handleCommand(command, argument, nullptr);
+  if (uart_rx_task == NULL) {
+    uart_rx_task = xTaskGetCurrentTaskHandle();
+  }
+  pollUartLink();
 
-      uart_buffer = "";
-      xSemaphoreGive(uart_buffer_Mutex);
+  uint8_t byte;
+  while (uart_rx_ring.pop(byte)) {
+    if (byte == '\n' || byte == '\r') {
+      dispatchSerialLine();
+    } else if (uart_line_length < MAX_COMMAND_LENGTH) {
+      uart_line[uart_line_length++] = (char)byte;
+    } else {
+      uart_line_overflow = true;
     }
   }
+
+  uint32_t idle_ms =
+      millis() - uart_last_rx_ms.load(std::memory_order_acquire);
+  if (uart_line_length > 0 && idle_ms >= communicationTimeout_ms) {
+    dispatchSerialLine();
+  }
+
+  // Sleep until more bytes arrive or the pending line times out
+  uint32_t wait_ms = uart_line_length > 0 && idle_ms < communicationTimeout_ms
+                         ? communicationTimeout_ms - idle_ms
+                         : communicationTimeout_ms;
+  if (uart_rx_ring.empty()) {
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(wait_ms));
+  }
 }
 
 
@@ -476,71 +1256,31 @@ void handleSerialInput() {
  *
  * @see sendUDPMessage()
  */
-void handleMessageUDPCommand(String argument, AsyncUDPPacket *packet) {
-  // Find the position of the last two spaces
-  int lastSpaceIndex = argument.lastIndexOf(' ');
-  int secondLastSpaceIndex = argument.lastIndexOf(' ', lastSpaceIndex - 1);
+void handleMessageUDPCommand(std::string_view argument, AsyncUDPPacket *packet) {
+  // Port and IP are the last two tokens, the message is everything before
+  ArgTokenizer tokens(argument);
+  std::string_view portToken = tokens.last();
+  String remoteIPString = toString(tokens.last());
+  String message = toString(tokens.rest());
 
   // Extract remotePort
-  uint16_t remotePort = argument.substring(lastSpaceIndex + 1).toInt();
+  uint32_t remotePort = 0;
+  if (!argToUint32(portToken, remotePort) || remotePort > UINT16_MAX) {
+    printResponse("ERROR: Invalid port", nullptr);
+    return;
+  }
 
   // Extract remoteIP
-  String remoteIPString = argument.substring(secondLastSpaceIndex + 1, lastSpaceIndex);
   IPAddress remoteIP;
   if (!remoteIP.fromString(remoteIPString)) {
-    UART0.println("ERROR: Invalid IP address format");
+    printResponse("ERROR: Invalid IP address format", nullptr);
     return;
   }
 
-  // Extract message
-  String message = argument.substring(0, secondLastSpaceIndex);
-
   // Send the UDP message
   sendUDPMessage(message.c_str(), remoteIP, remotePort);
 
-  UART0.println("UDP message sent: " + message);
-  UART0.println("To IP: " + remoteIPString + ", Port: " + String(remotePort));
-}
-
-/**
- * @brief Initialize the commands array with actual functions
- */
-void initializeCommands() {
-  commands[0].execute = getBoardVersionCommand;
-  commands[1].execute = connectCommand;
-  commands[2].execute = setSSIDCommand;
-  commands[3].execute = setPasswordCommand;
-  commands[4].execute = activateWiFiCommand;
-  commands[5].execute = disconnectWiFiCommand;
-  commands[6].execute = listWiFiCommand;
-  commands[7].execute = checkWiFiStatusCommand;
-  commands[8].execute = wifiNetworkCommand;
-  commands[9].execute = getWifiLocalIp;
-  commands[10].execute = getCommand;
-  commands[11].execute = getStreamCommand;
-  commands[12].execute = getFileStreamCommand;
-  commands[13].execute = postCommand;
-  commands[14].execute = postStreamCommand;
-  commands[15].execute = buildHttpMethodCommand;
-  commands[16].execute = buildHttpUrlCommand;
-  commands[17].execute = buildHttpHeaderCommand;
-  commands[18].execute = buildHttpPayloadCommand;
-  commands[19].execute = removeHttpHeaderCommand;
-  commands[20].execute = resetHttpConfigCommand;
-  commands[21].execute = buildHttpShowResponseHeadersCommand;
-  commands[22].execute = buildHttpImplementationCommand;
-  commands[23].execute = executeHttpCallCommand;
-  commands[24].execute = getHttpBuilderConfigCommand;
-  commands[25].execute = handleMessageUDPCommand;
-  commands[26].execute = helpCommand;
-  commands[27].execute = helpCommand;
-}
-
-/**
- * @brief Initialize UART commands and related resources
- */
-void init_cmds() {
-  uart_buffer_Mutex = xSemaphoreCreateMutex();
-  initializeCommands();
-  // Other setup code...
-}
\ No newline at end of file
+  printResponse("UDP message sent: " + message, nullptr);
+  printResponse("To IP: " + remoteIPString + ", Port: " + String(remotePort),
+                nullptr);
+}
@@ -10,42 +10,95 @@
 #include <Arduino.h>
 #include <AsyncUDP.h>
 #include <semphr.h>
+#include <string_view>
+typedef void (*CommandHandler)(std::string_view argument,
+                               AsyncUDPPacket *packet);
+
 // Command structure
 struct Command {
-  String name;
-  String description;
-  void (*execute)(String argument, AsyncUDPPacket *packet);
+  const char *name;
+  const char *description;
+  CommandHandler execute;
 };
 
-extern String uart_buffer;
-extern SemaphoreHandle_t uart_buffer_Mutex;
 extern const uint32_t communicationTimeout_ms;
 
 void UART0_RX_CB();
-void setSSIDCommand(String argument, AsyncUDPPacket *packet);
-void setPasswordCommand(String argument, AsyncUDPPacket *packet);
-void activateWiFiCommand(String argument, AsyncUDPPacket *packet);
-void disconnectWiFiCommand(String argument, AsyncUDPPacket *packet);
-void listWiFiCommand(String argument, AsyncUDPPacket *packet);
-void getCommand(String argument, AsyncUDPPacket *packet);
-void getStreamCommand(String argument, AsyncUDPPacket *packet);
-void postCommand(String argument, AsyncUDPPacket *packet);
-void buildHttpMethodCommand(String argument, AsyncUDPPacket *packet);
-void buildHttpUrlCommand(String argument, AsyncUDPPacket *packet);
-void buildHttpHeaderCommand(String argument, AsyncUDPPacket *packet);
-void buildHttpPayloadCommand(String argument, AsyncUDPPacket *packet);
-void removeHttpHeaderCommand(String argument, AsyncUDPPacket *packet);
-void resetHttpConfigCommand(String argument, AsyncUDPPacket *packet);
-void buildHttpImplementationCommand(String argument, AsyncUDPPacket *packet);
-void buildHttpShowResponseHeadersCommand(String argument,
+void getBoardVersionCommand(std::string_view argument, AsyncUDPPacket *packet);
+void setSSIDCommand(std::string_view argument, AsyncUDPPacket *packet);
+void setPasswordCommand(std::string_view argument, AsyncUDPPacket *packet);
+void activateWiFiCommand(std::string_view argument, AsyncUDPPacket *packet);
+void disconnectWiFiCommand(std::string_view argument, AsyncUDPPacket *packet);
+void listWiFiCommand(std::string_view argument, AsyncUDPPacket *packet);
+void checkWiFiStatusCommand(std::string_view argument, AsyncUDPPacket *packet);
+void wifiNetworkCommand(std::string_view argument, AsyncUDPPacket *packet);
+void getWifiLocalIp(std::string_view argument, AsyncUDPPacket *packet);
+void getCommand(std::string_view argument, AsyncUDPPacket *packet);
+void getStreamCommand(std::string_view argument, AsyncUDPPacket *packet);
+void getFileStreamCommand(std::string_view argument, AsyncUDPPacket *packet);
+void getFileRangeCommand(std::string_view argument, AsyncUDPPacket *packet);
+void getFilePageCommand(std::string_view argument, AsyncUDPPacket *packet);
+void postCommand(std::string_view argument, AsyncUDPPacket *packet);
+void postStreamCommand(std::string_view argument, AsyncUDPPacket *packet);
+void buildHttpMethodCommand(std::string_view argument, AsyncUDPPacket *packet);
+void buildHttpUrlCommand(std::string_view argument, AsyncUDPPacket *packet);
+void buildHttpHeaderCommand(std::string_view argument, AsyncUDPPacket *packet);
+void buildHttpPayloadCommand(std::string_view argument, AsyncUDPPacket *packet);
+void removeHttpHeaderCommand(std::string_view argument, AsyncUDPPacket *packet);
+void resetHttpConfigCommand(std::string_view argument, AsyncUDPPacket *packet);
+void buildHttpImplementationCommand(std::string_view argument, AsyncUDPPacket *packet);
+void buildHttpJsonFilterCommand(std::string_view argument,
+                                AsyncUDPPacket *packet);
+void buildHttpJsonFormatCommand(std::string_view argument,
+                                AsyncUDPPacket *packet);
+void buildHttpShowResponseHeadersCommand(std::string_view argument,
                                          AsyncUDPPacket *packet);
-void executeHttpCallCommand(String argument, AsyncUDPPacket *packet);
-void connectCommand(String argument, AsyncUDPPacket *packet);
-void helpCommand(String argument, AsyncUDPPacket *packet);
-void handleCommand(String command, String argument, AsyncUDPPacket *packet);
+void executeHttpCallCommand(std::string_view argument, AsyncUDPPacket *packet);
+void getHttpBuilderConfigCommand(std::string_view argument, AsyncUDPPacket *packet);
+void handleMessageUDPCommand(std::string_view argument, AsyncUDPPacket *packet);
+void connectCommand(std::string_view argument, AsyncUDPPacket *packet);
+void perfStatsCommand(std::string_view argument, AsyncUDPPacket *packet);
+void perfResetCommand(std::string_view argument, AsyncUDPPacket *packet);
+void perfHeapCommand(std::string_view argument, AsyncUDPPacket *packet);
+void queueStatsCommand(std::string_view argument, AsyncUDPPacket *packet);
+void httpPoolStatsCommand(std::string_view argument, AsyncUDPPacket *packet);
+void tlsStatsCommand(std::string_view argument, AsyncUDPPacket *packet);
+void cacheStatsCommand(std::string_view argument, AsyncUDPPacket *packet);
+void cacheClearCommand(std::string_view argument, AsyncUDPPacket *packet);
+void uartFlowCommand(std::string_view argument, AsyncUDPPacket *packet);
+void uartTxStatsCommand(std::string_view argument, AsyncUDPPacket *packet);
+void uartBaudCommand(std::string_view argument, AsyncUDPPacket *packet);
+void uartBaudEchoCommand(std::string_view argument, AsyncUDPPacket *packet);
+void uartStatusCommand(std::string_view argument, AsyncUDPPacket *packet);
+void uartModeCommand(std::string_view argument, AsyncUDPPacket *packet);
+void httpCompressionCommand(std::string_view argument, AsyncUDPPacket *packet);
+void uartCompressionCommand(std::string_view argument, AsyncUDPPacket *packet);
+void udpEchoCommand(std::string_view argument, AsyncUDPPacket *packet);
+void udpStatsCommand(std::string_view argument, AsyncUDPPacket *packet);
+void udpCoalesceCommand(std::string_view argument, AsyncUDPPacket *packet);
+void tcpStatusCommand(std::string_view argument, AsyncUDPPacket *packet);
+void wsConnectCommand(std::string_view argument, AsyncUDPPacket *packet);
+void wsSendCommand(std::string_view argument, AsyncUDPPacket *packet);
+void wsCloseCommand(std::string_view argument, AsyncUDPPacket *packet);
+void wsStatusCommand(std::string_view argument, AsyncUDPPacket *packet);
+void sseConnectCommand(std::string_view argument, AsyncUDPPacket *packet);
+void sseCloseCommand(std::string_view argument, AsyncUDPPacket *packet);
+void sseStatusCommand(std::string_view argument, AsyncUDPPacket *packet);
+void mqttConnectCommand(std::string_view argument, AsyncUDPPacket *packet);
+void mqttSubCommand(std::string_view argument, AsyncUDPPacket *packet);
+void mqttUnsubCommand(std::string_view argument, AsyncUDPPacket *packet);
+void mqttPubCommand(std::string_view argument, AsyncUDPPacket *packet);
+void mqttDisconnectCommand(std::string_view argument, AsyncUDPPacket *packet);
+void mqttStatusCommand(std::string_view argument, AsyncUDPPacket *packet);
+void asyncCommand(std::string_view argument, AsyncUDPPacket *packet);
+void asyncMaxCommand(std::string_view argument, AsyncUDPPacket *packet);
+void asyncStatsCommand(std::string_view argument, AsyncUDPPacket *packet);
+void helpCommand(std::string_view argument, AsyncUDPPacket *packet);
+const Command *findCommand(const char *name, size_t length);
+void handleCommand(std::string_view command, std::string_view argument,
+                   AsyncUDPPacket *packet);
 void handleSerialInput();
+void wakeSerialInput();
 String ensureHttpsPrefix(String url);
-void handleCommand(String command, String argument);
-void init_cmds();
 
 #endif // UART_UTILS_H
\ No newline at end of file
@@ -0,0 +1,157 @@
+/**
+ * @file udp_inbox.cpp
+ * @brief Hand-off of received UDP packets from the AsyncUDP callback
+ *
+ * This file contains the inbox between the AsyncUDP receive callback and a
+ * small worker task. The callback runs in the lwIP task, so it only takes a
+ * reference to the packet buffer (no payload copy) and pushes it into a
+ * lock-free ring. The worker echoes the packet to the UART if enabled,
+ * streams MESSAGE packets and queues everything else for the executor.
+ * Packets arriving while the ring is full are dropped and counted.
+ */
+
+#include "udp_inbox.h"
+#include "arg_utils.h"
+#include "command_queue.h"
+#include "http_utils.h"
+#include "perf_utils.h"
+#include "ring_buffer.h"
+#include "uart_frame.h"
+#include <atomic>
+
+/// Stack size of the UDP worker, it only parses and queues
+const uint32_t UDP_WORKER_STACK_SIZE = 4 * 1024;
+
+/// UDP worker priority, same as the executor
+const UBaseType_t UDP_WORKER_PRIORITY = 2;
+
+/**
+ * @struct UdpInboxEntry
+ * @brief Packet taken from the callback, holds a reference to its pbuf
+ */
+struct UdpInboxEntry {
+  AsyncUDPPacket *packet; ///< Heap copy of the callback's packet
+  int32_t heapMark;       ///< perfHeapMark() taken before the copy
+};
+
+static SpscRing<UdpInboxEntry, UDP_INBOX_SLOTS> inbox;
+
+static TaskHandle_t udpWorkerTask = NULL;
+
+/// Echo every packet as WIFI_UDP_INCOMING_DATA
+static std::atomic<bool> udpEcho{true};
+
+static std::atomic<uint32_t> udpReceived{0};
+static std::atomic<uint32_t> udpDropped{0};
+static std::atomic<uint32_t> udpMaxDepth{0};
+
+/**
+ * @brief Handle one packet on the worker task
+ * @param packet Heap copy of the packet, deleted unless queued
+ * @param heapMark perfHeapMark() taken when the packet arrived
+ */
+static void handleUdpPacket(AsyncUDPPacket *packet, int32_t heapMark) {
+  std::string_view receivedData((const char *)packet->data(),
+                                packet->length());
+  if (udpEcho.load(std::memory_order_relaxed)) {
+    uartWriteEvent("WIFI_UDP_INCOMING_DATA: ", packet->data(),
+                   packet->length());
+  }
+
+  // Special UDP Connection method
+  // Direct Message stream to uart from UDP
+  ArgTokenizer tokens(receivedData);
+  if (tokens.next() == "MESSAGE") {
+    std::string_view message = tokens.rest();
+    uartWriteEvent("MESSAGE: ", (const uint8_t *)message.data(),
+                   message.length());
+    delete packet;
+    return;
+  }
+
+  // The executor replies through the packet after it is queued
+  EnqueueResult result = enqueueCommand(
+      (const char *)packet->data(), packet->length(), packet, heapMark);
+  if (result != ENQUEUE_OK) {
+    reportEnqueueFailure(result, packet);
+    delete packet;
+  }
+}
+
+/**
+ * @brief Worker task, drains the inbox
+ * @param parameter Unused
+ */
+static void udpInboxTask(void *parameter) {
+  UdpInboxEntry entry;
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    while (inbox.pop(entry)) {
+      handleUdpPacket(entry.packet, entry.heapMark);
+    }
+  }
+}
+
+/**
+ * @brief Start the UDP worker task
+ * @return bool True on success
+ */
+bool initUdpInbox() {
+  return xTaskCreate(udpInboxTask, "udp_inbox", UDP_WORKER_STACK_SIZE, NULL,
+                     UDP_WORKER_PRIORITY, &udpWorkerTask) == pdPASS;
+}
+
+/**
+ * @brief Take a received packet, called from the AsyncUDP callback
+ *
+ * Never blocks or prints. The copy shares the packet buffer with the
+ * callback's packet, so the payload is not copied, but the copy itself is
+ * one heap block held until the command has run. The PERF_HEAP mark is
+ * taken before it, so the block is counted.
+ *
+ * @param packet Packet passed to the callback
+ */
+void udpInboxPush(AsyncUDPPacket &packet) {
+  udpReceived.fetch_add(1, std::memory_order_relaxed);
+  if (udpWorkerTask == NULL) {
+    udpDropped.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  int32_t heapMark = perfHeapMark();
+  AsyncUDPPacket *copy = new AsyncUDPPacket(packet);
+  if (!inbox.push({copy, heapMark})) {
+    delete copy;
+    udpDropped.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  uint32_t depth = inbox.size();
+  if (depth > udpMaxDepth.load(std::memory_order_relaxed)) {
+    udpMaxDepth.store(depth, std::memory_order_relaxed);
+  }
+  xTaskNotifyGive(udpWorkerTask);
+}
+
+/**
+ * @brief Enable or disable the WIFI_UDP_INCOMING_DATA echo of packets
+ * @param enable Boolean flag to echo packets to the UART
+ * @param packet Pointer to AsyncUDPPacket for response
+ */
+void setUdpEcho(bool enable, AsyncUDPPacket *packet) {
+  udpEcho.store(enable, std::memory_order_relaxed);
+  printResponse("UDP_ECHO: " + String(enable ? "true" : "false"), packet);
+}
+
+/**
+ * @brief Print UDP inbox counters
+ * @param packet Pointer to AsyncUDPPacket for response
+ */
+void printUdpInboxStats(AsyncUDPPacket *packet) {
+  printResponse("UDP_INBOX: queued=" + String(inbox.size()) + "/" +
+                    String(inbox.capacity()) +
+                    " max=" + String(udpMaxDepth.load()),
+                packet);
+  printResponse("UDP_PACKETS: received=" + String(udpReceived.load()) +
+                    " dropped=" + String(udpDropped.load()) +
+                    " echo=" + String(udpEcho.load() ? "true" : "false"),
+                packet);
+}
@@ -0,0 +1,15 @@
+#ifndef UDP_INBOX_H
+#define UDP_INBOX_H
+
+#include <Arduino.h>
+#include <AsyncUDP.h>
+
+/// Packets that can wait for the UDP worker, power of two
+const size_t UDP_INBOX_SLOTS = 16;
+
+bool initUdpInbox();
+void udpInboxPush(AsyncUDPPacket &packet);
+void setUdpEcho(bool enable, AsyncUDPPacket *packet);
+void printUdpInboxStats(AsyncUDPPacket *packet);
+
+#endif // UDP_INBOX_H
@@ -0,0 +1,322 @@
+/**
+ * @file udp_reply.cpp
+ * @brief Coalesced, sequenced replies to UDP commands
+ *
+ * This file contains the reply buffer of the UDP coalescing mode. Without
+ * it every response line and every body read goes out as its own datagram.
+ * With UDP_COALESCE on, the task running a UDP command packs its output
+ * into datagrams of up to UDP_REPLY_DATAGRAM bytes, each starting with a
+ * header:
+ *
+ *   flags (bit 0 = last), request ID (1, or the ASYNC ID), sequence (2 bytes,
+ *   little-endian, from 0 for each reply)
+ *
+ * A datagram is sent when it is full, when it has waited UDP_REPLY_FLUSH_MS
+ * (checked by a timer, so a slow body does not stall earlier lines) and at
+ * the end of the command, which always sends a datagram with the last flag.
+ *
+ * The timer sends from the timer service task rather than waking the task
+ * that owns the reply, because that task may be blocked on a slow server
+ * for seconds. The work is bounded: each tick sends at most one datagram
+ * per reply slot, only for slots it can lock without waiting, and a UDP
+ * send only hands the datagram to the lwIP task, it never waits for the
+ * network.
+ */
+
+#include "udp_reply.h"
+#include "async_requests.h"
+#include "http_utils.h"
+#include "uart_frame.h"
+#include <atomic>
+#include <freertos/timers.h>
+#include <mutex>
+
+/// Usable bytes of one datagram
+const size_t UDP_REPLY_PAYLOAD = UDP_REPLY_DATAGRAM - UDP_REPLY_HEADER;
+
+/// Replies that can be open at once, the executor and every ASYNC worker
+const size_t UDP_REPLY_SLOTS = 1 + ASYNC_MAX_WORKERS;
+
+/**
+ * @struct UdpReply
+ * @brief Output of one UDP command being packed into datagrams
+ */
+struct UdpReply {
+  std::mutex lock;        ///< Guards the buffer against the timer
+  AsyncUDPPacket *packet; ///< Packet the reply goes to, null if free
+  uint8_t channel;        ///< Request ID in the header
+  uint16_t sequence;      ///< Sequence number of the next datagram
+  size_t length;          ///< Payload bytes buffered
+  uint32_t firstWriteMs;  ///< millis() of the oldest buffered byte
+  uint8_t datagram[UDP_REPLY_DATAGRAM];
+};
+
+/**
+ * @struct UdpReplyStats
+ * @brief Counters of the coalesced replies
+ */
+struct UdpReplyStats {
+  std::atomic<uint32_t> replies{0};      ///< Replies sent in coalescing mode
+  std::atomic<uint32_t> datagrams{0};    ///< Datagrams sent in coalescing mode
+  std::atomic<uint32_t> writes{0};       ///< Lines and body chunks packed
+  std::atomic<uint32_t> timerFlushes{0}; ///< Datagrams sent by the timer
+};
+
+static UdpReply replies[UDP_REPLY_SLOTS];
+
+/// Guards claiming and releasing reply slots
+static std::mutex slotsMutex;
+
+/// Reply of the command running on this task
+static thread_local UdpReply *taskReply = nullptr;
+
+static std::atomic<bool> coalescing{false};
+static TimerHandle_t flushTimer = NULL;
+static UdpReplyStats replyStats;
+
+/**
+ * @brief Send the buffered payload as one datagram
+ * @param reply Reply to send, locked by the caller
+ * @param flags Header flags
+ */
+static void sendDatagramLocked(UdpReply &reply, uint8_t flags) {
+  reply.datagram[0] = flags;
+  reply.datagram[1] = reply.channel;
+  reply.datagram[2] = reply.sequence & 0xFF;
+  reply.datagram[3] = reply.sequence >> 8;
+  reply.packet->write(reply.datagram, UDP_REPLY_HEADER + reply.length);
+  reply.sequence++;
+  reply.length = 0;
+  replyStats.datagrams++;
+}
+
+/**
+ * @brief Append output to a reply, sending every datagram that fills up
+ * @param reply Reply to append to, locked by the caller
+ * @param data Output bytes
+ * @param length Number of bytes
+ */
+static void appendLocked(UdpReply &reply, const uint8_t *data, size_t length) {
+  replyStats.writes++;
+  while (length > 0) {
+    if (reply.length == 0) {
+      reply.firstWriteMs = millis();
+    }
+    size_t n = min(length, UDP_REPLY_PAYLOAD - reply.length);
+    memcpy(reply.datagram + UDP_REPLY_HEADER + reply.length, data, n);
+    reply.length += n;
+    data += n;
+    length -= n;
+    if (reply.length == UDP_REPLY_PAYLOAD) {
+      sendDatagramLocked(reply, 0);
+    }
+  }
+}
+
+/**
+ * @brief Send one datagram of output for a packet without an open reply,
+ * e.g. an error printed for an ASYNC request before it started
+ * @param data Output bytes, at most UDP_REPLY_PAYLOAD
+ * @param length Number of bytes
+ * @param newline True to end the output with a line break
+ * @param flags Header flags, UDP_REPLY_LAST on the last datagram
+ * @param sequence Sequence number in the header
+ * @param packet Packet to reply to
+ */
+static void sendUnbufferedDatagram(const uint8_t *data, size_t length,
+                                   bool newline, uint8_t flags,
+                                   uint16_t sequence, AsyncUDPPacket *packet) {
+  length = min(length, UDP_REPLY_PAYLOAD - (newline ? 1 : 0));
+  size_t size = UDP_REPLY_HEADER + length + (newline ? 1 : 0);
+  uint8_t *datagram = (uint8_t *)malloc(size);
+  if (!datagram) {
+    return;
+  }
+  datagram[0] = flags;
+  datagram[1] = uartResponseChannel();
+  datagram[2] = sequence & 0xFF;
+  datagram[3] = sequence >> 8;
+  memcpy(datagram + UDP_REPLY_HEADER, data, length);
+  if (newline) {
+    datagram[size - 1] = '\n';
+  }
+  packet->write(datagram, size);
+  free(datagram);
+  replyStats.datagrams++;
+  if (flags & UDP_REPLY_LAST) {
+    replyStats.replies++;
+  }
+}
+
+/**
+ * @brief Timer callback, sends datagrams that waited too long
+ *
+ * Runs in the timer service task, see the bound in the file comment.
+ *
+ * @param timer Unused
+ */
+static void flushTimerCallback(TimerHandle_t timer) {
+  uint32_t now = millis();
+  for (UdpReply &reply : replies) {
+    // A busy writer sends soon anyway, never block the timer task
+    std::unique_lock<std::mutex> lock(reply.lock, std::try_to_lock);
+    if (lock.owns_lock() && reply.packet && reply.length > 0 &&
+        now - reply.firstWriteMs >= UDP_REPLY_FLUSH_MS) {
+      sendDatagramLocked(reply, 0);
+      replyStats.timerFlushes++;
+    }
+  }
+}
+
+/**
+ * @brief Create the flush timer
+ * @return bool False if the timer could not be created
+ */
+bool initUdpReply() {
+  flushTimer = xTimerCreate("udp_reply", pdMS_TO_TICKS(UDP_REPLY_FLUSH_MS),
+                            pdTRUE, NULL, flushTimerCallback);
+  return flushTimer != NULL;
+}
+
+/**
+ * @brief Check whether UDP replies are coalesced
+ * @return bool True if coalescing is enabled
+ */
+bool udpCoalescingEnabled() {
+  return coalescing.load(std::memory_order_acquire);
+}
+
+/**
+ * @brief Enable or disable coalesced UDP replies
+ *
+ * The reply to this command is coalesced either way, so the client sees the
+ * switch in a known format.
+ *
+ * @param enable Boolean flag to coalesce replies
+ * @param packet Pointer to AsyncUDPPacket for response
+ */
+void setUdpCoalescing(bool enable, AsyncUDPPacket *packet) {
+  if (enable && flushTimer == NULL) {
+    printResponse("UDP_ERROR: Flush timer unavailable", packet);
+    return;
+  }
+  coalescing.store(enable, std::memory_order_release);
+  if (flushTimer) {
+    if (enable) {
+      xTimerStart(flushTimer, 0);
+    } else {
+      xTimerStop(flushTimer, 0);
+    }
+  }
+  printResponse("UDP_COALESCE: " + String(enable ? "true" : "false"), packet);
+}
+
+/**
+ * @brief Start buffering the output of a UDP command on this task
+ *
+ * Does nothing when coalescing is off or every slot is in use, the output
+ * is then sent datagram by datagram.
+ *
+ * @param packet Packet of the command, must outlive udpReplyEnd()
+ */
+void udpReplyBegin(AsyncUDPPacket *packet) {
+  if (!packet || !udpCoalescingEnabled()) {
+    return;
+  }
+  std::lock_guard<std::mutex> slots(slotsMutex);
+  for (UdpReply &reply : replies) {
+    if (reply.packet == nullptr) {
+      std::lock_guard<std::mutex> lock(reply.lock);
+      reply.packet = packet;
+      reply.channel = uartResponseChannel();
+      reply.sequence = 0;
+      reply.length = 0;
+      taskReply = &reply;
+      return;
+    }
+  }
+}
+
+/**
+ * @brief Send the rest of the output with the last flag and free the slot
+ */
+void udpReplyEnd() {
+  UdpReply *reply = taskReply;
+  if (!reply) {
+    return;
+  }
+  taskReply = nullptr;
+  std::lock_guard<std::mutex> slots(slotsMutex);
+  std::lock_guard<std::mutex> lock(reply->lock);
+  sendDatagramLocked(*reply, UDP_REPLY_LAST);
+  reply->packet = nullptr;
+  replyStats.replies++;
+}
+
+/**
+ * @brief Send a response line to a UDP client
+ * @param line Line without line ending
+ * @param packet Packet to reply to
+ */
+void udpReplyLine(const String &line, AsyncUDPPacket *packet) {
+  UdpReply *reply = taskReply;
+  if (reply && reply->packet == packet) {
+    std::lock_guard<std::mutex> lock(reply->lock);
+    appendLocked(*reply, (const uint8_t *)line.c_str(), line.length());
+    appendLocked(*reply, (const uint8_t *)"\n", 1);
+    return;
+  }
+
+  uint8_t channel = uartResponseChannel();
+  if (udpCoalescingEnabled()) {
+    sendUnbufferedDatagram((const uint8_t *)line.c_str(), line.length(), true,
+                           UDP_REPLY_LAST, 0, packet);
+  } else if (channel > UART_CHANNEL_RESPONSE) {
+    // Newlines that end a body come before the tag
+    const char *text = line.c_str();
+    size_t newlines = strspn(text, "\n");
+    packet->printf("%.*s#%u %s", (int)newlines, text, channel,
+                   text + newlines);
+  } else {
+    packet->printf("%s", line.c_str());
+  }
+}
+
+/**
+ * @brief Send response body bytes to a UDP client
+ * @param data Body bytes
+ * @param length Number of bytes
+ * @param packet Packet to reply to
+ */
+void udpReplyBody(const uint8_t *data, size_t length, AsyncUDPPacket *packet) {
+  UdpReply *reply = taskReply;
+  if (reply && reply->packet == packet) {
+    std::lock_guard<std::mutex> lock(reply->lock);
+    appendLocked(*reply, data, length);
+  } else if (udpCoalescingEnabled()) {
+    // One reply, sequenced, the last flag only on its final datagram
+    uint16_t sequence = 0;
+    for (size_t sent = 0; sent < length; sent += UDP_REPLY_PAYLOAD) {
+      size_t n = min(length - sent, UDP_REPLY_PAYLOAD);
+      sendUnbufferedDatagram(data + sent, n, false,
+                             sent + n == length ? UDP_REPLY_LAST : 0,
+                             sequence++, packet);
+    }
+  } else {
+    packet->write(data, length);
+  }
+}
+
+/**
+ * @brief Print coalesced reply counters
+ * @param packet Pointer to AsyncUDPPacket for response
+ */
+void printUdpReplyStats(AsyncUDPPacket *packet) {
+  printResponse("UDP_REPLIES: coalesce=" +
+                    String(udpCoalescingEnabled() ? "true" : "false") +
+                    " replies=" + String(replyStats.replies.load()) +
+                    " datagrams=" + String(replyStats.datagrams.load()) +
+                    " writes=" + String(replyStats.writes.load()) +
+                    " timer_flushes=" + String(replyStats.timerFlushes.load()),
+                packet);
+}
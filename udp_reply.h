@@ -0,0 +1,28 @@
+#ifndef UDP_REPLY_H
+#define UDP_REPLY_H
+
+#include <Arduino.h>
+#include <AsyncUDP.h>
+
+/// Largest reply datagram, a 1500 byte MTU minus the IP and UDP headers
+const size_t UDP_REPLY_DATAGRAM = 1472;
+
+/// Header in front of every coalesced datagram: flags, request ID, sequence
+const size_t UDP_REPLY_HEADER = 4;
+
+/// Set on the last datagram of a reply
+const uint8_t UDP_REPLY_LAST = 0x01;
+
+/// Longest a partly filled datagram waits for more output
+const uint32_t UDP_REPLY_FLUSH_MS = 20;
+
+bool initUdpReply();
+bool udpCoalescingEnabled();
+void setUdpCoalescing(bool enable, AsyncUDPPacket *packet);
+void udpReplyBegin(AsyncUDPPacket *packet);
+void udpReplyEnd();
+void udpReplyLine(const String &line, AsyncUDPPacket *packet);
+void udpReplyBody(const uint8_t *data, size_t length, AsyncUDPPacket *packet);
+void printUdpReplyStats(AsyncUDPPacket *packet);
+
+#endif // UDP_REPLY_H
@@ -10,8 +10,10 @@
 
 
 #include "wifi_utils.h"
+#include "http_utils.h"
 #include "led.h"
-#include "uart_utils.h"
+#include "tcp_server.h"
+#include "udp_inbox.h"
 #include <AsyncUDP.h>
 #include <WiFi.h>
 
@@ -36,12 +38,12 @@ void connectToWiFi() {
 
   // Check against empty SSID and password
   if (ssid.isEmpty()) {
-    UART0.println("WIFI_ERROR: SSID is missing");
+    printResponse("WIFI_ERROR: SSID is missing", nullptr);
     return;
   }
 
   if (password.isEmpty()) {
-    UART0.println("WIFI_ERROR: Password is missing");
+    printResponse("WIFI_ERROR: Password is missing", nullptr);
     return;
   }
 
@@ -59,15 +61,17 @@ void connectToWiFi() {
     led_set_blue(255);
     delay(RETRY_DELAY_MS);
     retryCount++;
-    UART0.println("WIFI_CONNECT: Connecting to WiFi... try " +
-                  String(retryCount) + "/" + String(MAX_RETRY_COUNT));
+    printResponse("WIFI_CONNECT: Connecting to WiFi... try " +
+                      String(retryCount) + "/" + String(MAX_RETRY_COUNT),
+                  nullptr);
 
     led_set_blue(0);
 
     // Check for specific WiFi statuses
     if (WiFi.status() == WL_CONNECT_FAILED) {
-      UART0.println("WIFI_ERROR: Failed to connect to WiFi: Incorrect password "
-                    "or other issue.");
+      printResponse("WIFI_ERROR: Failed to connect to WiFi: Incorrect "
+                    "password or other issue.",
+                    nullptr);
       break;
     }
   }
@@ -75,52 +79,33 @@ void connectToWiFi() {
   // After retries still not connected ? Return error
   if (WiFi.status() != WL_CONNECTED) {
     led_error();
-    UART0.println("WIFI_ERROR: Failed to connect to WiFi");
+    printResponse("WIFI_ERROR: Failed to connect to WiFi", nullptr);
     return;
   }
 
   // Connected to WiFi
   led_set_blue(0);
   led_set_green(255);
-  UART0.println("WIFI_CONNECTED: Connected to " + ssid);
-  UART0.print("WIFI_INFO: IP Address: ");
-  UART0.println(WiFi.localIP());
+  printResponse("WIFI_CONNECTED: Connected to " + ssid, nullptr);
+  printResponse("WIFI_INFO: IP Address: " + WiFi.localIP().toString(),
+                nullptr);
   led_set_green(0);
 
   // Start listening for UDP packets
   if (udp.listen(1234)) {
-    UART0.println("WIFI_INFO: UDP listening on port 1234");
-
-    udp.onPacket([](AsyncUDPPacket packet) {
-      String receivedData = String((char *)packet.data(), packet.length());
-      UART0.println("WIFI_UDP_INCOMING_DATA: " + receivedData);
-
-      String command;
-      String argument;
-
-      // Parse commands and arguments
-      int spaceIndex = receivedData.indexOf(' ');
-      if (spaceIndex != -1) {
-        command = receivedData.substring(0, spaceIndex);
-        argument = receivedData.substring(spaceIndex + 1);
-      } else {
-        command = receivedData;
-      }
-
-      // Special UDP Connection method
-      // Direct Message stream to uart from UDP
-      if (command == "MESSAGE") {
-        // Stream the message directly to UART and return
-        UART0.println("MESSAGE: " + argument);
-        return;
-      }
-
-      // Uart file command system
-      handleCommand(command, argument, &packet);
-    });
+    printResponse("WIFI_INFO: UDP listening on port 1234", nullptr);
+
+    // Only hand the packet over, the callback runs in the lwIP task
+    udp.onPacket([](AsyncUDPPacket packet) { udpInboxPush(packet); });
+  }
+
+  if (startTcpServer()) {
+    printResponse("WIFI_INFO: TCP listening on port " +
+                      String(TCP_SERVER_PORT),
+                  nullptr);
   }
 
-  UART0.println("WIFI_SUCCESS: WiFi connected");
+  printResponse("WIFI_SUCCESS: WiFi connected", nullptr);
 }
 
 
@@ -129,7 +114,7 @@ void connectToWiFi() {
  */
 void disconnectFromWiFi() {
   WiFi.disconnect();
-  UART0.println("WIFI_DISCONNECT: Wifi disconnected");
+  printResponse("WIFI_DISCONNECT: Wifi disconnected", nullptr);
 }
 
 /**
@@ -138,7 +123,7 @@ void disconnectFromWiFi() {
  * @return String A comma-separated list of available WiFi SSIDs
  */
 String listWiFiNetworks() {
-  UART0.println("WIFI_LIST: Scanning WiFi networks...");
+  printResponse("WIFI_LIST: Scanning WiFi networks...", nullptr);
   led_set_blue(255);
   int n = WiFi.scanNetworks();
   String result = "";
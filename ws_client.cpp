@@ -0,0 +1,685 @@
+/**
+ * @file ws_client.cpp
+ * @brief WebSocket client forwarding pushed messages to the UART
+ *
+ * This file contains a WebSocket (RFC 6455) client for one connection at a
+ * time. WS_CONNECT opens the socket with the same clients as the HTTP pool
+ * (TlsSessionClient for wss://, so TLS sessions are resumed) and performs
+ * the upgrade handshake. A receiver task then sleeps in select() on the
+ * socket and forwards every message as a WS_MESSAGE / WS_BINARY event as
+ * soon as it is complete, reassembling fragmented messages.
+ *
+ * The receiver answers pings, sends its own ping when the connection has
+ * been idle for WS_PING_INTERVAL_MS and drops the connection if nothing
+ * comes back within WS_PONG_TIMEOUT_MS. Frames above WS_MAX_FRAME and
+ * messages above WS_MAX_MESSAGE close the connection with code 1009.
+ *
+ * WS_SEND and WS_CLOSE write from the executor while the receiver reads,
+ * both under wsMutex (see socket_utils.cpp).
+ */
+
+#include "ws_client.h"
+#include "http_utils.h"
+#include "socket_utils.h"
+#include "tls_session.h"
+#include "uart_frame.h"
+#include <NetworkClient.h>
+#include <esp_random.h>
+#include <mbedtls/base64.h>
+#include <mbedtls/sha1.h>
+#include <mutex>
+
+/// Time allowed for the connection and the upgrade response
+const uint32_t WS_CONNECT_TIMEOUT_MS = 10000;
+
+/// Time the server gets to answer a close frame
+const uint32_t WS_CLOSE_TIMEOUT_MS = 2000;
+
+/// Stack size of the receiver task, it decrypts and parses frames
+const uint32_t WS_RECEIVER_STACK_SIZE = 6 * 1024;
+
+/// Receiver priority, same as the executor
+const UBaseType_t WS_RECEIVER_PRIORITY = 2;
+
+/// Largest frame header: 2 bytes, 8 byte length, 4 byte mask
+const size_t WS_MAX_HEADER = 14;
+
+/// Appended to the key to compute Sec-WebSocket-Accept
+static const char WS_GUID[] = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+/**
+ * @brief Frame opcodes
+ */
+enum WsOpcode : uint8_t {
+  WS_OP_CONTINUATION = 0x0,
+  WS_OP_TEXT = 0x1,
+  WS_OP_BINARY = 0x2,
+  WS_OP_CLOSE = 0x8,
+  WS_OP_PING = 0x9,
+  WS_OP_PONG = 0xA
+};
+
+/**
+ * @struct WsConnection
+ * @brief An open WebSocket and the state of its receiver
+ */
+struct WsConnection {
+  NetworkClient *client = nullptr;
+  String url;
+  uint32_t connectedAt = 0;   ///< millis() when the upgrade completed
+  uint32_t lastReceiveMs = 0; ///< millis() of the last received byte
+  uint32_t pingSentMs = 0;    ///< millis() of the unanswered ping, 0 if none
+  uint32_t closeSentMs = 0;   ///< millis() of our close frame, 0 if none
+
+  uint8_t *rx = nullptr;      ///< Received bytes not parsed yet
+  size_t rxLength = 0;
+  uint8_t *message = nullptr; ///< Fragments of the message being assembled
+  size_t messageLength = 0;
+  uint8_t messageOpcode = 0;  ///< Opcode of the first fragment, 0 if none
+
+  uint32_t messagesIn = 0;
+  uint32_t messagesOut = 0;
+  uint32_t bytesIn = 0;
+  uint32_t bytesOut = 0;
+  uint32_t pings = 0;
+
+  ~WsConnection() {
+    delete client;
+    free(rx);
+    free(message);
+  }
+};
+
+/// Guards current and every operation on its socket
+static std::mutex wsMutex;
+static WsConnection *current = nullptr;
+
+/**
+ * @brief Send one frame, masked as required for clients
+ * @param ws Connection, wsMutex held by the caller
+ * @param opcode Frame opcode
+ * @param payload Frame payload
+ * @param length Payload length
+ * @return bool False if the frame could not be sent completely
+ */
+static bool sendFrameLocked(WsConnection &ws, uint8_t opcode,
+                            const uint8_t *payload, size_t length) {
+  uint8_t header[WS_MAX_HEADER];
+  size_t headerLength = 2;
+  header[0] = 0x80 | opcode;
+  if (length < 126) {
+    header[1] = 0x80 | length;
+  } else if (length <= 0xFFFF) {
+    header[1] = 0x80 | 126;
+    header[2] = length >> 8;
+    header[3] = length & 0xFF;
+    headerLength = 4;
+  } else {
+    header[1] = 0x80 | 127;
+    for (int i = 0; i < 8; i++) {
+      header[2 + i] = i < 4 ? 0 : (uint64_t)length >> (8 * (7 - i));
+    }
+    headerLength = 10;
+  }
+  uint8_t mask[4];
+  esp_fill_random(mask, sizeof(mask));
+  memcpy(header + headerLength, mask, sizeof(mask));
+  headerLength += sizeof(mask);
+  if (ws.client->write(header, headerLength) != headerLength) {
+    return false;
+  }
+
+  uint8_t masked[256];
+  for (size_t sent = 0; sent < length;) {
+    size_t n = min(length - sent, sizeof(masked));
+    for (size_t i = 0; i < n; i++) {
+      masked[i] = payload[sent + i] ^ mask[(sent + i) & 3];
+    }
+    if (ws.client->write(masked, n) != n) {
+      return false;
+    }
+    sent += n;
+  }
+  ws.bytesOut += headerLength + length;
+  return true;
+}
+
+/**
+ * @brief Send a close frame
+ * @param ws Connection, wsMutex held by the caller
+ * @param code Close status code
+ */
+static void sendCloseLocked(WsConnection &ws, uint16_t code) {
+  if (ws.closeSentMs) {
+    return;
+  }
+  uint8_t payload[2] = {(uint8_t)(code >> 8), (uint8_t)(code & 0xFF)};
+  sendFrameLocked(ws, WS_OP_CLOSE, payload, sizeof(payload));
+  ws.closeSentMs = millis();
+}
+
+/**
+ * @brief Print a WS_CLOSED event
+ * @param code Close status code
+ * @param reason Reason sent by the server or detected locally
+ */
+static void printClosed(uint16_t code, const String &reason) {
+  String detail = "code=" + String(code);
+  if (!reason.isEmpty()) {
+    detail += " reason=" + reason;
+  }
+  uartWriteEvent("WS_CLOSED: ", (const uint8_t *)detail.c_str(),
+                 detail.length());
+}
+
+/**
+ * @brief Forward a complete message to the UART
+ * @param ws Connection the message came from
+ * @param opcode WS_OP_TEXT or WS_OP_BINARY
+ * @param data Message payload
+ * @param length Payload length
+ */
+static void deliverMessage(WsConnection &ws, uint8_t opcode,
+                           const uint8_t *data, size_t length) {
+  ws.messagesIn++;
+  uartWriteEvent(opcode == WS_OP_TEXT ? "WS_MESSAGE: " : "WS_BINARY: ", data,
+                 length);
+}
+
+/**
+ * @brief Handle one complete frame
+ * @param ws Connection the frame came from
+ * @param fin True if this is the last fragment
+ * @param opcode Frame opcode
+ * @param payload Unmasked payload
+ * @param length Payload length
+ * @param closeCode Set to the close code when the connection has to end
+ * @param closeReason Set to the close reason when the connection has to end
+ * @return bool False when the connection has to end
+ */
+static bool handleFrame(WsConnection &ws, bool fin, uint8_t opcode,
+                        uint8_t *payload, size_t length, uint16_t &closeCode,
+                        String &closeReason) {
+  switch (opcode) {
+  case WS_OP_PING: {
+    std::lock_guard<std::mutex> lock(wsMutex);
+    sendFrameLocked(ws, WS_OP_PONG, payload, length);
+    return true;
+  }
+  case WS_OP_PONG:
+    return true;
+  case WS_OP_CLOSE: {
+    closeCode = length >= 2 ? (payload[0] << 8) | payload[1] : 1005;
+    if (length > 2) {
+      closeReason = String((const char *)payload + 2, length - 2);
+    }
+    std::lock_guard<std::mutex> lock(wsMutex);
+    sendCloseLocked(ws, closeCode == 1005 ? 1000 : closeCode);
+    return false;
+  }
+  case WS_OP_TEXT:
+  case WS_OP_BINARY:
+    if (ws.messageOpcode) {
+      closeCode = 1002;
+      closeReason = "unfinished fragmented message";
+      return false;
+    }
+    if (fin) {
+      deliverMessage(ws, opcode, payload, length);
+      return true;
+    }
+    ws.messageOpcode = opcode;
+    ws.messageLength = 0;
+    [[fallthrough]]; // Store the first fragment
+  case WS_OP_CONTINUATION: {
+    if (!ws.messageOpcode) {
+      closeCode = 1002;
+      closeReason = "unexpected continuation frame";
+      return false;
+    }
+    if (ws.messageLength + length > WS_MAX_MESSAGE) {
+      closeCode = 1009;
+      closeReason = "message too big";
+      return false;
+    }
+    if (!ws.message) {
+      ws.message = (uint8_t *)malloc(WS_MAX_MESSAGE);
+      if (!ws.message) {
+        closeCode = 1011;
+        closeReason = "out of memory";
+        return false;
+      }
+    }
+    memcpy(ws.message + ws.messageLength, payload, length);
+    ws.messageLength += length;
+    if (fin) {
+      deliverMessage(ws, ws.messageOpcode, ws.message, ws.messageLength);
+      ws.messageOpcode = 0;
+      // Fragmented messages are rare, don't keep the buffer
+      free(ws.message);
+      ws.message = nullptr;
+    }
+    return true;
+  }
+  default:
+    closeCode = 1002;
+    closeReason = "unknown opcode";
+    return false;
+  }
+}
+
+/**
+ * @brief Parse and handle every complete frame in the receive buffer
+ * @param ws Connection to parse
+ * @param closeCode Set to the close code when the connection has to end
+ * @param closeReason Set to the close reason when the connection has to end
+ * @return bool False when the connection has to end
+ */
+static bool parseFrames(WsConnection &ws, uint16_t &closeCode,
+                        String &closeReason) {
+  size_t offset = 0;
+  bool open = true;
+  while (open && ws.rxLength - offset >= 2) {
+    uint8_t *frame = ws.rx + offset;
+    size_t available = ws.rxLength - offset;
+    bool fin = frame[0] & 0x80;
+    uint8_t opcode = frame[0] & 0x0F;
+    bool masked = frame[1] & 0x80;
+    uint64_t length = frame[1] & 0x7F;
+    size_t headerLength = 2;
+    if (length == 126) {
+      if (available < 4) {
+        break;
+      }
+      length = (frame[2] << 8) | frame[3];
+      headerLength = 4;
+    } else if (length == 127) {
+      if (available < 10) {
+        break;
+      }
+      length = 0;
+      for (int i = 0; i < 8; i++) {
+        length = (length << 8) | frame[2 + i];
+      }
+      headerLength = 10;
+    }
+    if (length > WS_MAX_FRAME) {
+      closeCode = 1009;
+      closeReason = "frame too big";
+      return false;
+    }
+    size_t maskOffset = headerLength;
+    if (masked) {
+      headerLength += 4;
+    }
+    if (available < headerLength + length) {
+      break;
+    }
+
+    uint8_t *payload = frame + headerLength;
+    if (masked) {
+      for (size_t i = 0; i < length; i++) {
+        payload[i] ^= frame[maskOffset + (i & 3)];
+      }
+    }
+    open = handleFrame(ws, fin, opcode, payload, length, closeCode,
+                       closeReason);
+    offset += headerLength + length;
+  }
+  memmove(ws.rx, ws.rx + offset, ws.rxLength - offset);
+  ws.rxLength -= offset;
+  return open;
+}
+
+/**
+ * @brief Time the receiver may sleep before the next keepalive check
+ * @param ws Connection
+ * @param now Current millis()
+ * @return uint32_t Milliseconds until a ping or a timeout is due
+ */
+static uint32_t keepaliveDelay(const WsConnection &ws, uint32_t now) {
+  uint32_t deadline;
+  if (ws.closeSentMs) {
+    deadline = ws.closeSentMs + WS_CLOSE_TIMEOUT_MS;
+  } else if (ws.pingSentMs) {
+    deadline = ws.pingSentMs + WS_PONG_TIMEOUT_MS;
+  } else {
+    deadline = ws.lastReceiveMs + WS_PING_INTERVAL_MS;
+  }
+  return millisUntil(deadline, now);
+}
+
+/**
+ * @brief Receiver task, forwards messages until the connection ends
+ * @param parameter The WsConnection
+ */
+static void wsReceiverTask(void *parameter) {
+  WsConnection *ws = (WsConnection *)parameter;
+  uint16_t closeCode = 1006;
+  String closeReason;
+
+  for (;;) {
+    uint32_t now = millis();
+    if (ws->closeSentMs && now - ws->closeSentMs >= WS_CLOSE_TIMEOUT_MS) {
+      closeCode = 1000;
+      break; // The server did not answer our close frame
+    }
+    if (ws->pingSentMs && now - ws->pingSentMs >= WS_PONG_TIMEOUT_MS) {
+      closeReason = "ping timeout";
+      break;
+    }
+    if (!ws->pingSentMs && !ws->closeSentMs &&
+        now - ws->lastReceiveMs >= WS_PING_INTERVAL_MS) {
+      std::lock_guard<std::mutex> lock(wsMutex);
+      sendFrameLocked(*ws, WS_OP_PING, nullptr, 0);
+      ws->pingSentMs = now;
+      ws->pings++;
+    }
+
+    int n = socketReceive(wsMutex, *ws->client, ws->rx + ws->rxLength,
+                          WS_MAX_HEADER + WS_MAX_FRAME - ws->rxLength,
+                          keepaliveDelay(*ws, millis()));
+    if (n < 0) {
+      closeReason = "connection lost";
+      break;
+    }
+    if (n > 0) {
+      ws->rxLength += n;
+      ws->bytesIn += n;
+      ws->lastReceiveMs = millis();
+      ws->pingSentMs = 0; // Anything received proves the server is alive
+      if (!parseFrames(*ws, closeCode, closeReason)) {
+        break;
+      }
+    }
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(wsMutex);
+    if (closeCode >= 1002 && closeCode != 1005 && closeCode != 1006) {
+      sendCloseLocked(*ws, closeCode);
+    }
+    current = nullptr;
+    ws->client->stop();
+  }
+  printClosed(closeCode, closeReason);
+  delete ws;
+  vTaskDelete(NULL);
+}
+
+/**
+ * @brief Split a WebSocket URL
+ * @param url ws://, wss://, http:// or https:// URL, wss:// if none
+ * @param host Host name
+ * @param port Explicit port or the scheme default
+ * @param path Path and query, "/" if none
+ * @param secure True for wss and https
+ * @return bool False if the URL has no host
+ */
+static bool parseWebSocketUrl(String url, String &host, uint16_t &port,
+                              String &path, bool &secure) {
+  int schemeEnd = url.indexOf("://");
+  String scheme = schemeEnd < 0 ? "wss" : url.substring(0, schemeEnd);
+  scheme.toLowerCase();
+  if (scheme == "wss" || scheme == "https") {
+    secure = true;
+    port = 443;
+  } else if (scheme == "ws" || scheme == "http") {
+    secure = false;
+    port = 80;
+  } else {
+    return false;
+  }
+
+  int hostStart = schemeEnd < 0 ? 0 : schemeEnd + 3;
+  int pathStart = url.indexOf('/', hostStart);
+  host = url.substring(hostStart, pathStart < 0 ? url.length() : pathStart);
+  path = pathStart < 0 ? "/" : url.substring(pathStart);
+  int portIndex = host.indexOf(':');
+  if (portIndex != -1) {
+    port = host.substring(portIndex + 1).toInt();
+    host = host.substring(0, portIndex);
+  }
+  return !host.isEmpty() && port != 0;
+}
+
+/**
+ * @brief Read one line of the upgrade response
+ * @param client Connection
+ * @param line Receives the line without line ending
+ * @param deadline millis() after which to give up
+ * @return bool False on timeout or when the connection closed
+ */
+static bool readHeaderLine(NetworkClient &client, String &line,
+                           uint32_t deadline) {
+  line = "";
+  while ((int32_t)(deadline - millis()) > 0) {
+    int c = client.available() > 0 ? client.read() : -1;
+    if (c < 0) {
+      if (!client.connected()) {
+        return false;
+      }
+      waitForClient(client, 50);
+      continue;
+    }
+    if (c == '\n') {
+      line.trim();
+      return true;
+    }
+    if (line.length() < 512) {
+      line += (char)c;
+    }
+  }
+  return false;
+}
+
+/**
+ * @brief Run the upgrade handshake on a connected client
+ * @param client Connected client
+ * @param host Host name for the Host header
+ * @param port Port for the Host header
+ * @param secure True for wss, decides the default port
+ * @param path Request path
+ * @param protocol Subprotocol to request, may be empty
+ * @param error Receives the reason on failure
+ * @return bool True if the server switched to the WebSocket protocol
+ */
+static bool upgradeConnection(NetworkClient &client, const String &host,
+                              uint16_t port, bool secure, const String &path,
+                              const String &protocol, String &error) {
+  uint8_t nonce[16];
+  esp_fill_random(nonce, sizeof(nonce));
+  unsigned char key[32];
+  size_t keyLength = 0;
+  mbedtls_base64_encode(key, sizeof(key), &keyLength, nonce, sizeof(nonce));
+  String keyText = String((const char *)key, keyLength);
+
+  String request = "GET " + path + " HTTP/1.1\r\nHost: " + host;
+  if (port != (secure ? 443 : 80)) {
+    request += ":" + String(port);
+  }
+  request += "\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+             "Sec-WebSocket-Key: " +
+             keyText + "\r\nSec-WebSocket-Version: 13\r\n";
+  if (!protocol.isEmpty()) {
+    request += "Sec-WebSocket-Protocol: " + protocol + "\r\n";
+  }
+  request += "\r\n";
+  client.write((const uint8_t *)request.c_str(), request.length());
+
+  uint32_t deadline = millis() + WS_CONNECT_TIMEOUT_MS;
+  String line;
+  if (!readHeaderLine(client, line, deadline)) {
+    error = "No upgrade response";
+    return false;
+  }
+  if (!line.startsWith("HTTP/1.1 101")) {
+    error = "Upgrade refused: " + line;
+    return false;
+  }
+
+  // Expected Sec-WebSocket-Accept: base64(SHA-1(key + GUID))
+  String challenge = keyText + WS_GUID;
+  unsigned char digest[20];
+  mbedtls_sha1((const unsigned char *)challenge.c_str(), challenge.length(),
+               digest);
+  unsigned char expected[32];
+  size_t expectedLength = 0;
+  mbedtls_base64_encode(expected, sizeof(expected), &expectedLength, digest,
+                        sizeof(digest));
+  String accept = String((const char *)expected, expectedLength);
+
+  bool accepted = false;
+  while (readHeaderLine(client, line, deadline)) {
+    if (line.isEmpty()) {
+      if (!accepted) {
+        error = "Missing or wrong Sec-WebSocket-Accept";
+      }
+      return accepted;
+    }
+    int colon = line.indexOf(':');
+    if (colon < 0) {
+      continue;
+    }
+    String name = line.substring(0, colon);
+    String value = line.substring(colon + 1);
+    value.trim();
+    if (name.equalsIgnoreCase("Sec-WebSocket-Accept")) {
+      accepted = value == accept;
+    }
+  }
+  error = "Incomplete upgrade response";
+  return false;
+}
+
+/**
+ * @brief Open a WebSocket and start forwarding its messages to the UART
+ * @param url ws:// or wss:// URL, wss:// if no scheme is given
+ * @param protocol Subprotocol to request, may be empty
+ * @param packet Pointer to AsyncUDPPacket for response
+ */
+void connectWebSocket(String url, String protocol, AsyncUDPPacket *packet) {
+  {
+    std::lock_guard<std::mutex> lock(wsMutex);
+    if (current) {
+      printResponse("WS_ERROR: Already connected, send WS_CLOSE first",
+                    packet);
+      return;
+    }
+  }
+
+  String host;
+  String path;
+  uint16_t port = 0;
+  bool secure = false;
+  if (!parseWebSocketUrl(url, host, port, path, secure)) {
+    printResponse("WS_ERROR: Invalid URL", packet);
+    return;
+  }
+
+  WsConnection *ws = new WsConnection();
+  ws->url = url;
+  ws->client = secure ? new TlsSessionClient() : new NetworkClient();
+  ws->rx = (uint8_t *)malloc(WS_MAX_HEADER + WS_MAX_FRAME);
+  if (!ws->rx) {
+    delete ws;
+    printResponse("WS_ERROR: Not enough memory", packet);
+    return;
+  }
+  if (!ws->client->connect(host.c_str(), port, WS_CONNECT_TIMEOUT_MS)) {
+    delete ws;
+    printResponse("WS_ERROR: Connection to " + host + " failed", packet);
+    return;
+  }
+
+  String error;
+  if (!upgradeConnection(*ws->client, host, port, secure, path, protocol,
+                         error)) {
+    ws->client->stop();
+    delete ws;
+    printResponse("WS_ERROR: " + error, packet);
+    return;
+  }
+
+  ws->connectedAt = millis();
+  ws->lastReceiveMs = ws->connectedAt;
+  if (!claimConnection(wsMutex, current, ws)) {
+    ws->client->stop();
+    delete ws;
+    printResponse("WS_ERROR: Already connected, send WS_CLOSE first", packet);
+    return;
+  }
+  // Report the connection before the receiver can forward a message
+  printResponse("WS_CONNECTED: " + url, packet);
+  if (!startReceiver(wsReceiverTask, "ws_receiver", WS_RECEIVER_STACK_SIZE,
+                     WS_RECEIVER_PRIORITY, wsMutex, current, ws)) {
+    printResponse("WS_ERROR: Could not start the receiver", packet);
+  }
+}
+
+/**
+ * @brief Send a text message on the open WebSocket
+ * @param text Message text
+ * @param packet Pointer to AsyncUDPPacket for response
+ */
+void sendWebSocketText(String text, AsyncUDPPacket *packet) {
+  bool sent = false;
+  bool connected;
+  {
+    std::lock_guard<std::mutex> lock(wsMutex);
+    connected = current && !current->closeSentMs;
+    if (connected) {
+      sent = sendFrameLocked(*current, WS_OP_TEXT,
+                             (const uint8_t *)text.c_str(), text.length());
+      current->messagesOut += sent;
+    }
+  }
+  if (!connected) {
+    printResponse("WS_ERROR: Not connected", packet);
+  } else if (!sent) {
+    printResponse("WS_ERROR: Send failed", packet);
+  } else {
+    printResponse("WS_SENT: " + String(text.length()), packet);
+  }
+}
+
+/**
+ * @brief Start the closing handshake, WS_CLOSED follows when it completes
+ * @param packet Pointer to AsyncUDPPacket for response
+ */
+void closeWebSocket(AsyncUDPPacket *packet) {
+  bool connected;
+  {
+    std::lock_guard<std::mutex> lock(wsMutex);
+    connected = current != nullptr;
+    if (connected) {
+      sendCloseLocked(*current, 1000);
+    }
+  }
+  printResponse(connected ? "WS_CLOSING" : "WS_ERROR: Not connected",
+                packet);
+}
+
+/**
+ * @brief Print the state and counters of the WebSocket
+ * @param packet Pointer to AsyncUDPPacket for response
+ */
+void printWebSocketStatus(AsyncUDPPacket *packet) {
+  String status;
+  {
+    std::lock_guard<std::mutex> lock(wsMutex);
+    if (current) {
+      uint32_t now = millis();
+      status = "WS_STATUS: connected url=" + current->url +
+               " up_s=" + String((now - current->connectedAt) / 1000) +
+               " idle_ms=" + String(now - current->lastReceiveMs) +
+               " in=" + String(current->messagesIn) + "/" +
+               String(current->bytesIn) +
+               " out=" + String(current->messagesOut) + "/" +
+               String(current->bytesOut) + " pings=" + String(current->pings);
+    } else {
+      status = "WS_STATUS: disconnected";
+    }
+  }
+  printResponse(status, packet);
+}
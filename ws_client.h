@@ -0,0 +1,24 @@
+#ifndef WS_CLIENT_H
+#define WS_CLIENT_H
+
+#include <Arduino.h>
+#include <AsyncUDP.h>
+
+/// Largest frame payload accepted from the server
+const size_t WS_MAX_FRAME = 4096;
+
+/// Largest message accepted after reassembling its fragments
+const size_t WS_MAX_MESSAGE = 8192;
+
+/// Idle time after which a ping is sent
+const uint32_t WS_PING_INTERVAL_MS = 20000;
+
+/// Time the server gets to answer a ping before the connection is dropped
+const uint32_t WS_PONG_TIMEOUT_MS = 10000;
+
+void connectWebSocket(String url, String protocol, AsyncUDPPacket *packet);
+void sendWebSocketText(String text, AsyncUDPPacket *packet);
+void closeWebSocket(AsyncUDPPacket *packet);
+void printWebSocketStatus(AsyncUDPPacket *packet);
+
+#endif // WS_CLIENT_H